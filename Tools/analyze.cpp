@@ -0,0 +1,385 @@
+// ----------------------------------------------------------------------------
+//  Filename: analyze.cpp
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+
+
+
+
+// Preprocessor directives.
+#include <algorithm>
+
+#include "../sim.h"
+
+// Serves go off at a random angle between these, in degrees from the
+// horizontal, at the usual launch speed.
+#define ANALYZE_MIN_ANGLE		20.0f
+#define ANALYZE_MAX_ANGLE		160.0f
+
+// A game that goes this long without destroying a brick is stuck.
+#define ANALYZE_STUCK_SECONDS	60.0f
+
+// How one game came out.
+struct GAMERESULT
+{
+	BoardState		State;
+	bool			bStuck;
+	float			fTime;			// Seconds of play.
+	unsigned int	nPaddle;		// Bounces off the paddle,
+	unsigned int	nWall;			// off the walls,
+	unsigned int	nBrick;			// and off bricks.
+};
+
+// A share of the games, played by one task.
+struct ANALYZETASK
+{
+	const CLevel*	pLevel;
+	int				nFirst;
+	int				nEnd;
+	unsigned int	nSeed;
+	int				nLives;
+	int				nMaxSteps;
+	float			fAimError;
+
+	GAMERESULT*		pResults;
+	vector<int>		tDestroyed;		// Games each brick was destroyed in.
+	double			dSteps;
+};
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Serve
+//
+//  Desc: Picks the angle the next ball goes off at.
+// ----------------------------------------------------------------------------
+static void Serve( CBoard* pBoard, CRandom* pRandom )
+{
+	float fSpeed, fAngle;
+
+	fSpeed = sqrtf( (BALL_LAUNCH_X * BALL_LAUNCH_X) + (BALL_LAUNCH_Y * BALL_LAUNCH_Y) );
+	fAngle = pRandom->Float( ANALYZE_MIN_ANGLE, ANALYZE_MAX_ANGLE ) * (3.14159265f / 180.0f);
+
+	pBoard->SetLaunch( fSpeed * cosf( fAngle ), fSpeed * sinf( fAngle ) );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: PlayGames
+//
+//  Desc: Plays a task's share of the games. Bounces are counted off the
+//        first ball turning around: off a brick if one went that step, off
+//        the paddle if it turned upwards down by the paddle, and off a wall
+//        otherwise.
+// ----------------------------------------------------------------------------
+static void PlayGames( ANALYZETASK* pTask )
+{
+	CBoard				board;
+	CPaddleBot			bot;
+	CRandom				random;
+	BOARDINPUT			input;
+	GAMERESULT*			pResult;
+	const CBallPool*	pBalls = board.GetBalls();
+	const CBrickSet*	pBricks = board.GetBricks();
+	float				vx, vy, fPrevX, fPrevY;
+	int					nLive, nLivesLost;
+	unsigned int		nLastBrick;
+
+	pTask->dSteps = 0.0;
+
+	board.SetLives( pTask->nLives );
+
+	for( int i = pTask->nFirst; i < pTask->nEnd; i++ )
+	{
+		pResult = &pTask->pResults[i];
+
+		random.Seed( pTask->nSeed + (unsigned int)i );
+		bot.Init( random.Next(), 40, pTask->fAimError, 60 );
+
+		Serve( &board, &random );
+		board.Reset( pTask->pLevel );
+
+		memset( pResult, 0, sizeof(GAMERESULT) );
+
+		nLive = pBricks->GetLive();
+		nLivesLost = 0;
+		nLastBrick = 0;
+		fPrevX = fPrevY = 0.0f;
+
+		while( (board.GetState() == BoardPlaying) && ((int)board.GetSteps() < pTask->nMaxSteps) )
+		{
+			input.nMouseX = bot.Think( &board );
+
+			board.Step( input );
+
+			if( board.GetLivesLost() != nLivesLost )
+			{
+				nLivesLost = board.GetLivesLost();
+				Serve( &board, &random );
+			}
+
+			if( pBricks->GetLive() != nLive )
+			{
+				pResult->nBrick += nLive - pBricks->GetLive();
+				nLive = pBricks->GetLive();
+				nLastBrick = board.GetSteps();
+			}
+			else if( pBalls->GetCount() )
+			{
+				vx = pBalls->GetVelX( 0 );
+				vy = pBalls->GetVelY( 0 );
+
+				if( (vy > 0.0f) && (fPrevY < 0.0f) && (pBalls->GetY( 0 ) < (board.GetPaddlePos().y + PADDLE_LOSE_DEPTH)) )
+				{
+					pResult->nPaddle++;
+				}
+				else if( ((vx * fPrevX) < 0.0f) || ((vy * fPrevY) < 0.0f) )
+				{
+					pResult->nWall++;
+				}
+			}
+
+			if( pBalls->GetCount() )
+			{
+				fPrevX = pBalls->GetVelX( 0 );
+				fPrevY = pBalls->GetVelY( 0 );
+			}
+
+			if( ((board.GetSteps() - nLastBrick) * board.GetTimeStep()) > ANALYZE_STUCK_SECONDS )
+			{
+				pResult->bStuck = true;
+				break;
+			}
+		}
+
+		pResult->State = board.GetState();
+		pResult->fTime = board.GetSteps() * board.GetTimeStep();
+
+		pTask->dSteps += board.GetSteps();
+
+		for( int b = 0; b < pBricks->GetCount(); b++ )
+		{
+			if( !pBricks->GetType( b ) ) pTask->tDestroyed[b]++;
+		}
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: PrintSpread
+//
+//  Desc: Prints the low, 10th, 50th and 90th percentile and high of a set of
+//        numbers, which gets sorted.
+// ----------------------------------------------------------------------------
+static void PrintSpread( const char* sName, vector<float>* pValues )
+{
+	size_t n = pValues->size();
+
+	if( !n )
+	{
+		printf( "  %-16s -\n", sName );
+		return;
+	}
+
+	sort( pValues->begin(), pValues->end() );
+
+	printf( "  %-16s %9.1f %9.1f %9.1f %9.1f %9.1f\n", sName, (*pValues)[0], (*pValues)[n / 10], (*pValues)[n / 2],
+			(*pValues)[(n * 9) / 10], (*pValues)[n - 1] );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: PrintHistogram
+//
+//  Desc: Prints a sorted set of numbers as ten bars between the lowest and
+//        the highest.
+// ----------------------------------------------------------------------------
+static void PrintHistogram( const vector<float>& tValues )
+{
+	int		tCounts[10] = { 0 };
+	float	fLow, fWidth;
+	int		b, nMost = 1;
+
+	if( tValues.empty() ) return;
+
+	fLow = tValues.front();
+	fWidth = (tValues.back() - fLow) / 10.0f;
+
+	for( size_t i = 0; i < tValues.size(); i++ )
+	{
+		b = (fWidth > 0.0f) ? (int)((tValues[i] - fLow) / fWidth) : 0;
+		if( b > 9 ) b = 9;
+
+		if( ++tCounts[b] > nMost ) nMost = tCounts[b];
+	}
+
+	for( b = 0; b < 10; b++ )
+	{
+		printf( "  %7.1f - %7.1f s %6d  %s\n", fLow + (fWidth * b), fLow + (fWidth * (b + 1)), tCounts[b],
+				string( (tCounts[b] * 50) / nMost, '#' ).c_str() );
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: main
+//
+//  Desc: Monte Carlo level analyzer. Plays a level thousands of times with
+//        the synthetic player and random serves, spread over every
+//        processor, and reports how long it takes to clear, how the ball
+//        bounces around, which bricks never get hit and how often the ball
+//        gets stuck going round without hitting anything. A thread count of
+//        0 means one per processor.
+//
+//        analyze <level file> [games] [threads] [seed] [max minutes]
+// ----------------------------------------------------------------------------
+int main( int argc, char* argv[] )
+{
+	CLevel					level;
+	CBoard					board;
+	CThreadPool				pool;
+	vector<ANALYZETASK>		tTasks;
+	vector<GAMERESULT>		tResults;
+	vector<int>				tDestroyed;
+	vector<float>			tClear, tPaddle, tWall, tBrick;
+	const CBrickSet*		pBricks = board.GetBricks();
+	int						nGames = 2000, nThreads = 0, nTasks;
+	unsigned int			nSeed = 1;
+	float					fMinutes = 10.0f;
+	int						nCleared = 0, nLost = 0, nStuck = 0, nNever = 0, nRare = 0;
+	double					dSteps = 0.0, dSeconds;
+	chrono::steady_clock::time_point tStart;
+	int						x, y;
+
+	if( argc < 2 )
+	{
+		printf( "analyze <level file> [games] [threads] [seed] [max minutes]\n" );
+		return -1;
+	}
+
+	if( argc > 2 ) nGames = atoi( argv[2] );
+	if( argc > 3 ) nThreads = atoi( argv[3] );
+	if( argc > 4 ) nSeed = (unsigned int)strtoul( argv[4], NULL, 10 );
+	if( argc > 5 ) fMinutes = (float)atof( argv[5] );
+
+	if( nGames < 1 ) nGames = 1;
+
+	if( !level.Load( argv[1] ) )
+	{
+		printf( "Unable to load: %s\n", argv[1] );
+		return -1;
+	}
+
+	board.Reset( &level );
+
+	pool.Init( nThreads );
+
+	// A few tasks per thread, so the long games even out.
+	nTasks = min( nGames, pool.GetThreadCount() * 8 );
+
+	tResults.resize( nGames );
+	tTasks.resize( nTasks );
+
+	tStart = chrono::steady_clock::now();
+
+	for( int i = 0; i < nTasks; i++ )
+	{
+		tTasks[i].pLevel = &level;
+		tTasks[i].nFirst = (int)(((int64_t)nGames * i) / nTasks);
+		tTasks[i].nEnd = (int)(((int64_t)nGames * (i + 1)) / nTasks);
+		tTasks[i].nSeed = nSeed;
+		tTasks[i].nLives = 3;
+		tTasks[i].nMaxSteps = (int)((fMinutes * 60.0f) / board.GetTimeStep());
+		tTasks[i].fAimError = 0.3f;
+		tTasks[i].pResults = &tResults[0];
+		tTasks[i].tDestroyed.assign( pBricks->GetCount(), 0 );
+
+		pool.Submit( bind( PlayGames, &tTasks[i] ) );
+	}
+
+	pool.Wait();
+
+	dSeconds = chrono::duration<double>( chrono::steady_clock::now() - tStart ).count();
+
+	// Put the tasks back together.
+	tDestroyed.assign( pBricks->GetCount(), 0 );
+
+	for( int i = 0; i < nTasks; i++ )
+	{
+		dSteps += tTasks[i].dSteps;
+
+		for( int b = 0; b < pBricks->GetCount(); b++ ) tDestroyed[b] += tTasks[i].tDestroyed[b];
+	}
+
+	for( int i = 0; i < nGames; i++ )
+	{
+		if( tResults[i].bStuck ) nStuck++;
+		else if( tResults[i].State == BoardCleared ) nCleared++;
+		else if( tResults[i].State == BoardLost ) nLost++;
+
+		if( tResults[i].State == BoardCleared ) tClear.push_back( tResults[i].fTime );
+
+		tPaddle.push_back( (float)tResults[i].nPaddle );
+		tWall.push_back( (float)tResults[i].nWall );
+		tBrick.push_back( (float)tResults[i].nBrick );
+	}
+
+	printf( "%s: %dx%d, %d bricks\n", argv[1], level.GetColumns(), level.GetRows(), pBricks->GetCount() );
+	printf( "%d games on %d threads in %.2f s, %.2f million steps per second\n\n", nGames, pool.GetThreadCount(), dSeconds,
+			(dSteps / dSeconds) / 1.0e6 );
+
+	printf( "outcomes: %d cleared, %d lost, %d stuck, %d timed out\n\n", nCleared, nLost, nStuck,
+			nGames - nCleared - nLost - nStuck );
+
+	printf( "                        low      10%%      50%%      90%%      high\n" );
+	PrintSpread( "clear time (s)", &tClear );
+	PrintSpread( "paddle bounces", &tPaddle );
+	PrintSpread( "wall bounces", &tWall );
+	PrintSpread( "brick bounces", &tBrick );
+
+	printf( "\nclear times\n" );
+	PrintHistogram( tClear );
+
+	printf( "\nbricks never hit:" );
+
+	for( int b = 0; b < pBricks->GetCount(); b++ )
+	{
+		if( (tDestroyed[b] * 20) < nGames ) nRare++;
+		if( tDestroyed[b] ) continue;
+
+		pBricks->GetSlot( b, &x, &y );
+
+		if( nNever++ < 32 ) printf( " (%d,%d)", x, y );
+	}
+
+	printf( "%s\n", nNever ? ((nNever > 32) ? " ..." : "") : " none" );
+	printf( "%d bricks never hit, %d hit in fewer than 5%% of games\n", nNever, nRare );
+
+	if( nStuck )
+	{
+		printf( "\nstuck games, by seed:" );
+
+		for( int i = 0, n = 0; (i < nGames) && (n < 16); i++ )
+		{
+			if( !tResults[i].bStuck ) continue;
+
+			printf( " %u", nSeed + (unsigned int)i );
+			n++;
+		}
+
+		printf( "\n" );
+	}
+
+	return 0;
+}
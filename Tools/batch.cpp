@@ -0,0 +1,95 @@
+// ----------------------------------------------------------------------------
+//  Filename: batch.cpp
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+
+
+
+
+// Preprocessor directives.
+#include "../sim.h"
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: main
+//
+//  Desc: Headless batch runner. Plays many boards of a level at once across
+//        every processor, with a synthetic player per board, and reports
+//        each board's outcome and the total throughput. A thread count of 0
+//        means one per processor.
+//
+//        batch [level file] [boards] [threads] [lives] [seed]
+// ----------------------------------------------------------------------------
+int main( int argc, char* argv[] )
+{
+	CLevel				level;
+	CThreadPool			pool;
+	CBatchRunner		batch;
+	const BATCHRESULT*	pResult;
+	const char*			sLevel = "Data/Levels/level1.lvl";
+	int					nBoards = 1000;
+	int					nThreads = 0;
+	int					nLives = 3;
+	unsigned int		nSeed = 1;
+	int					nCleared = 0, nLost = 0, nLivesLost = 0;
+	double				dScore = 0.0, dClearTime = 0.0;
+
+	if( argc > 1 ) sLevel = argv[1];
+	if( argc > 2 ) nBoards = atoi( argv[2] );
+	if( argc > 3 ) nThreads = atoi( argv[3] );
+	if( argc > 4 ) nLives = atoi( argv[4] );
+	if( argc > 5 ) nSeed = (unsigned int)strtoul( argv[5], NULL, 10 );
+
+	if( !level.Load( sLevel ) )
+	{
+		printf( "Unable to load: %s\n", sLevel );
+		return -1;
+	}
+
+	pool.Init( nThreads );
+
+	batch.SetLives( nLives );
+
+	if( !batch.Run( &pool, &level, nBoards, nSeed ) ) return -1;
+
+	printf( "board       seed  outcome      score   clear time  lives lost\n" );
+
+	for( int i = 0; i < batch.GetBoardCount(); i++ )
+	{
+		pResult = batch.GetResult( i );
+
+		printf( "%5d %10u  %-9s %8u ", i, pResult->nSeed,
+				(pResult->State == BoardCleared) ? "cleared" : (pResult->State == BoardLost) ? "lost" : "timed out", pResult->nScore );
+
+		if( pResult->fClearTime >= 0.0f )
+		{
+			printf( " %10.2f s", pResult->fClearTime );
+			dClearTime += pResult->fClearTime;
+		}
+		else
+		{
+			printf( "          - " );
+		}
+
+		printf( "  %10d\n", pResult->nLivesLost );
+
+		if( pResult->State == BoardCleared ) nCleared++;
+		if( pResult->State == BoardLost ) nLost++;
+
+		nLivesLost += pResult->nLivesLost;
+		dScore += pResult->nScore;
+	}
+
+	printf( "\n%s: %d boards on %d threads, %d cleared, %d lost, %d timed out\n", sLevel, nBoards, pool.GetThreadCount(),
+			nCleared, nLost, nBoards - nCleared - nLost );
+	printf( "average score %.1f, average clear time %.2f s, %.2f lives lost per board\n", dScore / nBoards,
+			nCleared ? (dClearTime / nCleared) : 0.0, (double)nLivesLost / nBoards );
+	printf( "%.0f steps in %.3f s, %.2f million steps per second\n", batch.GetTotalSteps(), batch.GetSeconds(),
+			(batch.GetTotalSteps() / batch.GetSeconds()) / 1000000.0 );
+
+	return 0;
+}
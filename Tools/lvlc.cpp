@@ -0,0 +1,66 @@
+// ----------------------------------------------------------------------------
+//  Filename: lvlc.cpp
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+
+
+
+
+// Preprocessor directives.
+#include "../sim.h"
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: main
+//
+//  Desc: Level compiler. Turns a text level into the compiled form the game
+//        maps straight into memory, with its bricks laid out where a board
+//        puts them and the hash of the text, then loads it back to be sure
+//        it's the same level.
+//
+//        lvlc <level file> <compiled file>
+// ----------------------------------------------------------------------------
+int main( int argc, char* argv[] )
+{
+	CLevel		level, compiled;
+	CBoard		board;
+	CMappedFile	source;
+	float		fOriginX, fOriginY;
+
+	if( argc < 3 )
+	{
+		printf( "usage: lvlc <level file> <compiled file>\n" );
+		return -1;
+	}
+
+	if( !source.Open( argv[1] ) || !level.LoadFromMemory( (const char*)source.GetData(), source.GetSize() ) )
+	{
+		printf( "Unable to load: %s\n", argv[1] );
+		return -1;
+	}
+
+	// The board works out where the level's first slot goes.
+	board.Reset( &level );
+	board.GetBrickCenter( 0, 0, &fOriginX, &fOriginY );
+
+	if( !level.SaveCompiled( argv[2], fOriginX, fOriginY, CMeshData::HashSource( source.GetData(), source.GetSize() ), source.GetSize() ) )
+	{
+		printf( "Unable to write: %s\n", argv[2] );
+		return -1;
+	}
+
+	if( !compiled.Load( argv[2] ) || !compiled.GetExtents() || (CReplay::HashLevel( &compiled ) != CReplay::HashLevel( &level )) )
+	{
+		printf( "%s doesn't load back the same as %s\n", argv[2], argv[1] );
+		return -1;
+	}
+
+	printf( "%s: %d x %d, %d bricks in %d chunks, %d rows moving\n", argv[2], compiled.GetColumns(), compiled.GetRows(),
+			compiled.CountBricks(), compiled.GetChunkCount(), compiled.GetMotionCount() );
+
+	return 0;
+}
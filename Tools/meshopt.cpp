@@ -0,0 +1,74 @@
+// ----------------------------------------------------------------------------
+//  Filename: meshopt.cpp
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+
+
+
+
+// Preprocessor directives.
+#include "../sim.h"
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: main
+//
+//  Desc: Mesh optimizer. Parses each model, optimizes it the way the game
+//        does on loading, and writes its cache, so the game never has to.
+//        Reports the vertices and triangles before and after, and the
+//        average cache miss ratio for a FIFO of MESH_FIFO_CACHE_SIZE.
+//
+//        meshopt <model file> [<model file> ...]
+// ----------------------------------------------------------------------------
+int main( int argc, char* argv[] )
+{
+	CMeshData	mesh;
+	CMappedFile	source;
+	string		sCache;
+	float		fBefore;
+	int			nVertices, nTriangles, nWelded;
+	int			nResult = 0;
+
+	if( argc < 2 )
+	{
+		printf( "usage: meshopt <model file> [<model file> ...]\n" );
+		return -1;
+	}
+
+	for( int i = 1; i < argc; i++ )
+	{
+		if( !source.Open( argv[i] ) || !mesh.ParseX( (const char*)source.GetData(), source.GetSize() ) )
+		{
+			printf( "Unable to load: %s\n", argv[i] );
+			nResult = -1;
+			continue;
+		}
+
+		nVertices = mesh.GetVertexCount();
+		nTriangles = mesh.GetTriangleCount();
+		fBefore = mesh.GetACMR( MESH_FIFO_CACHE_SIZE );
+
+		nWelded = mesh.Weld();
+		mesh.OptimizeVertexCache();
+		mesh.OptimizeFetch();
+
+		sCache = CMeshData::GetCacheName( argv[i] );
+
+		if( !mesh.SaveCache( sCache.c_str(), CMeshData::HashSource( source.GetData(), source.GetSize() ), source.GetSize() ) )
+		{
+			printf( "Unable to write: %s\n", sCache.c_str() );
+			nResult = -1;
+		}
+
+		printf( "%s: %d -> %d vertices (%d welded), %d -> %d triangles, ACMR %.3f -> %.3f\n", argv[i], nVertices,
+				mesh.GetVertexCount(), nWelded, nTriangles, mesh.GetTriangleCount(), fBefore, mesh.GetACMR( MESH_FIFO_CACHE_SIZE ) );
+
+		source.Close();
+	}
+
+	return nResult;
+}
@@ -0,0 +1,200 @@
+// ----------------------------------------------------------------------------
+//  Filename: pack.cpp
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+
+
+
+
+// Preprocessor directives.
+#include "../sim.h"
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: HasExtension
+//
+//  Desc: Returns whether a name ends in an extension.
+// ----------------------------------------------------------------------------
+static bool HasExtension( const string& sName, const char* sExtension )
+{
+	size_t nLength = strlen( sExtension );
+
+	return (sName.size() > nLength) && !sName.compare( sName.size() - nLength, nLength, sExtension );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: AddFile
+//
+//  Desc: Reads a file to be packed, named as it's given. Compiled levels and
+//        mesh caches are stored, since they're mapped. Returns false if it
+//        can't be read.
+// ----------------------------------------------------------------------------
+static bool AddFile( vector<PACKFILE>* pFiles, const string& sFileName )
+{
+	CMappedFile	file;
+	PACKFILE	packed;
+	string		sName;
+
+	if( !file.OpenFile( sFileName.c_str() ) ) return false;
+
+	sName = CAssetPack::NormalizeName( sFileName.c_str() );
+
+	packed.sName = sFileName;
+	packed.tData.assign( file.GetData(), file.GetData() + file.GetSize() );
+	packed.bStore = HasExtension( sName, ".lvb" ) || HasExtension( sName, MESH_CACHE_EXTENSION );
+
+	pFiles->push_back( packed );
+
+	return true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: AddList
+//
+//  Desc: Reads the names of files to be packed from a file with one to a
+//        line. Blank lines are skipped.
+// ----------------------------------------------------------------------------
+static bool AddList( vector<string>* pNames, const char* sFileName )
+{
+	ifstream	file;
+	string		sLine;
+	size_t		nStart, nEnd;
+
+	file.open( sFileName, ios::in );
+	if( !file.is_open() ) return false;
+
+	while( getline( file, sLine ) )
+	{
+		nStart = sLine.find_first_not_of( " \t\r" );
+		if( nStart == string::npos ) continue;
+
+		nEnd = sLine.find_last_not_of( " \t\r" );
+
+		pNames->push_back( sLine.substr( nStart, nEnd - nStart + 1 ) );
+	}
+
+	return true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: main
+//
+//  Desc: Asset packer. Packs the files given, and those named in any list
+//        given as @<list file>, into one, compressing those that are worth
+//        it unless told not to with -n. Each model is packed with its cache,
+//        made first if it isn't up to date, so the game never parses one.
+//        Reports each file's size and what it packed to, then reads every
+//        file back out of the pack to check it.
+//
+//        pack [-n] <pack file> <file | @list file> [...]
+// ----------------------------------------------------------------------------
+int main( int argc, char* argv[] )
+{
+	vector<PACKFILE>	tFiles;
+	vector<string>		tNames;
+	vector<unsigned char>	tData;
+	CAssetPack			pack;
+	CMeshData			mesh;
+	string				sCache;
+	const char*			sPackName;
+	uint64_t			nSize = 0, nPacked = 0;
+	bool				bCompress = true;
+	int					i, nEntry;
+	int					nResult = 0;
+
+	i = 1;
+
+	if( (argc > 1) && !strcmp( argv[1], "-n" ) )
+	{
+		bCompress = false;
+		i++;
+	}
+
+	if( argc < (i + 2) )
+	{
+		printf( "usage: pack [-n] <pack file> <file | @list file> [...]\n" );
+		return -1;
+	}
+
+	sPackName = argv[i++];
+
+	for( ; i < argc; i++ )
+	{
+		if( argv[i][0] != '@' ) tNames.push_back( argv[i] );
+		else if( !AddList( &tNames, argv[i] + 1 ) )
+		{
+			printf( "Unable to read: %s\n", argv[i] + 1 );
+			return -1;
+		}
+	}
+
+	for( i = 0; i < (int)tNames.size(); i++ )
+	{
+		if( !AddFile( &tFiles, tNames[i] ) )
+		{
+			printf( "Unable to read: %s\n", tNames[i].c_str() );
+			return -1;
+		}
+
+		if( !HasExtension( CAssetPack::NormalizeName( tNames[i].c_str() ), ".x" ) ) continue;
+
+		// Loading it brings its cache up to date.
+		sCache = CMeshData::GetCacheName( tNames[i].c_str() );
+
+		if( !mesh.Load( tNames[i].c_str() ) || !AddFile( &tFiles, sCache ) )
+		{
+			printf( "Unable to cache: %s\n", tNames[i].c_str() );
+			return -1;
+		}
+
+		mesh.Clear();
+	}
+
+	if( !CAssetPack::Write( sPackName, tFiles, bCompress ) )
+	{
+		printf( "Unable to write: %s\n", sPackName );
+		return -1;
+	}
+
+	if( !pack.Open( sPackName ) )
+	{
+		printf( "Unable to open: %s\n", sPackName );
+		return -1;
+	}
+
+	for( i = 0; i < (int)tFiles.size(); i++ )
+	{
+		nEntry = pack.Find( tFiles[i].sName.c_str() );
+
+		if( (nEntry < 0) || !pack.Read( nEntry, &tData ) || (tData != tFiles[i].tData) )
+		{
+			printf( "%s: doesn't read back the same\n", tFiles[i].sName.c_str() );
+			nResult = -1;
+			continue;
+		}
+
+		printf( "%-40s %10llu -> %10llu%s\n", pack.GetName( nEntry ).c_str(), (unsigned long long)pack.GetSize( nEntry ),
+				(unsigned long long)pack.GetPackedSize( nEntry ), pack.IsCompressed( nEntry ) ? " compressed" : "" );
+
+		nSize += pack.GetSize( nEntry );
+		nPacked += pack.GetPackedSize( nEntry );
+	}
+
+	printf( "%d files, %llu -> %llu bytes, %llu in the pack\n", (int)tFiles.size(), (unsigned long long)nSize,
+			(unsigned long long)nPacked, (unsigned long long)pack.GetFile()->GetSize() );
+
+	return nResult;
+}
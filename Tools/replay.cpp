@@ -0,0 +1,159 @@
+// ----------------------------------------------------------------------------
+//  Filename: replay.cpp
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+
+
+
+
+// Preprocessor directives.
+#include <time.h>
+
+#include "../sim.h"
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: LoadLevel
+//
+//  Desc: Loads a level named the way the game names it. Backslashes work as
+//        well as forward slashes.
+// ----------------------------------------------------------------------------
+static bool LoadLevel( CLevel* pLevel, string sLevel )
+{
+	for( size_t i = 0; i < sLevel.size(); i++ )
+	{
+		if( sLevel[i] == '\\' ) sLevel[i] = '/';
+	}
+
+	if( pLevel->Load( sLevel.c_str() ) ) return true;
+
+	printf( "Unable to load: %s\n", sLevel.c_str() );
+
+	return false;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Record
+//
+//  Desc: Records a game of the synthetic player, to have replays to try
+//        without running the game.
+// ----------------------------------------------------------------------------
+static int Record( const char* sLevel, const char* sFileName, unsigned int nSeed )
+{
+	CLevel		level;
+	CBoard		board;
+	CPaddleBot	bot;
+	CReplay		replay;
+	BOARDINPUT	input;
+
+	if( !LoadLevel( &level, sLevel ) ) return -1;
+
+	board.SetLives( 3 );
+	board.Reset( &level );
+
+	bot.Init( nSeed, 40, 0.3f, 60 );
+
+	replay.Begin( &board, &level, sLevel );
+
+	while( (board.GetState() == BoardPlaying) && (board.GetSteps() < 120 * 60 * 10) )
+	{
+		input.nMouseX = bot.Think( &board );
+
+		replay.Record( input, 0 );
+
+		board.Step( input );
+	}
+
+	replay.End( &board );
+
+	if( !replay.Save( sFileName ) )
+	{
+		printf( "Unable to save: %s\n", sFileName );
+		return -1;
+	}
+
+	printf( "%u steps, score %u, %u bytes of steps\n", board.GetSteps(), board.GetScore(), (unsigned int)replay.GetDataSize() );
+
+	return 0;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: main
+//
+//  Desc: Headless replay player. Plays a recorded game back as fast as it
+//        will go, a number of times, and checks it ends the way it did when
+//        it was recorded. The level comes from the replay unless another is
+//        given.
+//
+//        replay <replay file> [level file] [times]
+//        replay -record <level file> <replay file> [seed]
+// ----------------------------------------------------------------------------
+int main( int argc, char* argv[] )
+{
+	CLevel		level;
+	CBoard		board;
+	CReplay		replay;
+	BoardState	State = BoardPlaying;
+	int			nTimes = 1;
+	double		dSeconds;
+	clock_t		tStart;
+	bool		bSame;
+
+	if( argc < 2 )
+	{
+		printf( "replay <replay file> [level file] [times]\n" );
+		printf( "replay -record <level file> <replay file> [seed]\n" );
+		return -1;
+	}
+
+	if( !strcmp( argv[1], "-record" ) )
+	{
+		if( argc < 4 ) return -1;
+
+		return Record( argv[2], argv[3], (argc > 4) ? (unsigned int)strtoul( argv[4], NULL, 10 ) : 1 );
+	}
+
+	if( !replay.Load( argv[1] ) )
+	{
+		printf( "Unable to load: %s\n", argv[1] );
+		return -1;
+	}
+
+	if( !LoadLevel( &level, (argc > 2) ? argv[2] : replay.GetLevelName() ) ) return -1;
+	if( argc > 3 ) nTimes = atoi( argv[3] );
+	if( nTimes < 1 ) nTimes = 1;
+
+	if( CReplay::HashLevel( &level ) != replay.GetLevelHash() )
+	{
+		printf( "Warning: this is not the level the replay was recorded on.\n" );
+	}
+
+	tStart = clock();
+
+	for( int i = 0; i < nTimes; i++ )
+	{
+		State = replay.Play( &board, &level );
+	}
+
+	dSeconds = (double)(clock() - tStart) / CLOCKS_PER_SEC;
+
+	bSame = (State == replay.GetState()) && (board.GetSteps() == replay.GetSteps()) && (board.GetScore() == replay.GetScore());
+
+	printf( "recorded: state %d, %u steps, score %u\n", replay.GetState(), replay.GetSteps(), replay.GetScore() );
+	printf( "played:   state %d, %u steps, score %u\n", State, board.GetSteps(), board.GetScore() );
+	printf( "%u bytes of steps, %.2f million steps per second\n", (unsigned int)replay.GetDataSize(),
+			((double)board.GetSteps() * nTimes) / (dSeconds * 1.0e6) );
+	printf( "%s\n", bSame ? "Replay matches." : "Replay does NOT match!" );
+
+	return bSame ? 0 : 1;
+}
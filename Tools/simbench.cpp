@@ -0,0 +1,1489 @@
+// ----------------------------------------------------------------------------
+//  Filename: simbench.cpp
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+
+
+
+
+// Preprocessor directives.
+#include <time.h>
+#include <algorithm>
+
+#include "../sim.h"
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Seconds
+//
+//  Desc: Returns processor time used so far, in seconds.
+// ----------------------------------------------------------------------------
+static double Seconds()
+{
+	return (double)clock() / CLOCKS_PER_SEC;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: MakeLevelText
+//
+//  Desc: Writes out a random level with roughly nPercent of the slots
+//        filled, as a level file would have it.
+// ----------------------------------------------------------------------------
+static void MakeLevelText( string* pText, int nColumns, int nRows, int nPercent, unsigned int nSeed )
+{
+	string& sText = *pText;
+
+	sText.clear();
+
+	for( int y = 0; y < nRows; y++ )
+	{
+		for( int x = 0; x < nColumns; x++ )
+		{
+			nSeed = (nSeed * 1103515245u) + 12345u;
+
+			if( (int)((nSeed >> 16) % 100) < nPercent )
+			{
+				sText += (char)('1' + ((nSeed >> 8) % 3));
+			}
+			else
+			{
+				sText += '0';
+			}
+
+			sText += ' ';
+		}
+
+		sText += '\n';
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: MakeLevel
+//
+//  Desc: Builds a random level with roughly nPercent of the slots filled.
+// ----------------------------------------------------------------------------
+static void MakeLevel( CLevel* pLevel, int nColumns, int nRows, int nPercent, unsigned int nSeed )
+{
+	string sText;
+
+	MakeLevelText( &sText, nColumns, nRows, nPercent, nSeed );
+
+	pLevel->LoadFromMemory( sText.c_str(), sText.size() );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: PlayGames
+//
+//  Desc: Plays nGames games of at most nMaxSteps steps each with the simple
+//        paddle controller. Returns the total number of steps taken, and the
+//        total score in pScore so runs can be compared.
+// ----------------------------------------------------------------------------
+static double PlayGames( CBoard* pBoard, const CLevel* pLevel, int nGames, int nMaxSteps, double* pScore )
+{
+	BOARDINPUT	input;
+	double		dSteps = 0.0;
+
+	*pScore = 0.0;
+
+	for( int i = 0; i < nGames; i++ )
+	{
+		pBoard->Reset( pLevel );
+
+		for( int n = 0; (n < nMaxSteps) && (pBoard->GetState() == BoardPlaying); n++ )
+		{
+			input.nMouseX = pBoard->TrackBall( 40 );
+
+			pBoard->Step( input );
+		}
+
+		dSteps += pBoard->GetSteps();
+		*pScore += pBoard->GetScore();
+	}
+
+	return dSteps;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: BenchBroadphase
+//
+//  Desc: Compares the linear brick scan against the grid broadphase on full,
+//        half cleared and nearly empty boards.
+// ----------------------------------------------------------------------------
+static void BenchBroadphase()
+{
+	static const struct { const char* sName; int nPercent; } boards[] =
+	{
+		{ "full", 100 },
+		{ "half cleared", 50 },
+		{ "nearly empty", 3 }
+	};
+
+	CLevel	level;
+	CBoard	board;
+	double	dStart, dSteps, dScore[2], dNs[2];
+
+	printf( "broadphase: ns per step, linear scan vs. grid\n" );
+
+	for( int i = 0; i < (int)(sizeof(boards) / sizeof(boards[0])); i++ )
+	{
+		MakeLevel( &level, LEVEL_COLUMNS, LEVEL_ROWS, boards[i].nPercent, 1234 );
+
+		for( int n = 0; n < 2; n++ )
+		{
+			board.SetBroadphase( n ? BroadphaseGrid : BroadphaseLinear );
+
+			dStart = Seconds();
+			dSteps = PlayGames( &board, &level, 100, 120 * 60, &dScore[n] );
+			dNs[n] = ((Seconds() - dStart) * 1.0e9) / dSteps;
+		}
+
+		printf( "  %-14s %3d bricks  %8.1f  %8.1f  %5.1fx%s\n", boards[i].sName, level.CountBricks(), dNs[0], dNs[1], dNs[0] / dNs[1],
+				(dScore[0] == dScore[1]) ? "" : "  (scores differ!)" );
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: BenchKernel
+//
+//  Desc: Runs each ball/brick overlap kernel this machine supports over all
+//        the bricks of a full board from a spread of ball positions. Reports
+//        throughput in ball/brick tests per second.
+// ----------------------------------------------------------------------------
+static void BenchKernel()
+{
+	static const struct { const char* sName; BrickKernel kernel; } kernels[] =
+	{
+		{ "scalar", KernelScalar },
+		{ "sse", KernelSSE },
+		{ "avx", KernelAVX },
+		{ "avx512", KernelAVX512 }
+	};
+
+	CLevel			level;
+	CBrickSet		bricks;
+	vector<float>	tX, tY;
+	vector<int>		tHits;
+	BrickKernel		best = CBrickSet::GetKernel();
+	unsigned int	nSeed = 1234;
+	double			dStart, dTests, dHits, dExpected = -1.0;
+	int				nBricks;
+
+	MakeLevel( &level, LEVEL_COLUMNS, LEVEL_ROWS, 100, 1234 );
+	bricks.Build( &level, BRICK_ORIGIN_X, BRICK_ORIGIN_Y );
+
+	nBricks = bricks.GetCount();
+	tHits.resize( nBricks );
+
+	// Ball positions over the top half of the field, where the bricks are.
+	for( int i = 0; i < 4096; i++ )
+	{
+		nSeed = (nSeed * 1103515245u) + 12345u;
+		tX.push_back( WALL_LEFT + ((WALL_RIGHT - WALL_LEFT) * ((nSeed >> 8) & 0xFFFF) / 65536.0f) );
+
+		nSeed = (nSeed * 1103515245u) + 12345u;
+		tY.push_back( WALL_TOP * ((nSeed >> 8) & 0xFFFF) / 65536.0f );
+	}
+
+	printf( "kernel: million ball/brick tests per second, %d bricks\n", nBricks );
+
+	for( int k = 0; k < (int)(sizeof(kernels) / sizeof(kernels[0])); k++ )
+	{
+		if( !CBrickSet::SetKernel( kernels[k].kernel ) )
+		{
+			printf( "  %-8s not supported\n", kernels[k].sName );
+			continue;
+		}
+
+		dTests = dHits = 0.0;
+		dStart = Seconds();
+
+		for( int n = 0; n < 500; n++ )
+		{
+			for( int i = 0; i < (int)tX.size(); i++ )
+			{
+				dHits += bricks.FindOverlaps( 0, nBricks, tX[i], tY[i], BALL_RADIUS, &tHits[0] );
+			}
+
+			dTests += (double)nBricks * tX.size();
+		}
+
+		printf( "  %-8s %8.1f%s%s\n", kernels[k].sName, (dTests / (Seconds() - dStart)) / 1.0e6,
+				(kernels[k].kernel == best) ? "  (default)" : "", ((dExpected >= 0.0) && (dHits != dExpected)) ? "  (hits differ!)" : "" );
+
+		if( dExpected < 0.0 ) dExpected = dHits;
+	}
+
+	CBrickSet::SetKernel( best );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: BenchCollision
+//
+//  Desc: Compares the discrete and swept collision modes over a range of step
+//        lengths. Reports the cost of simulating one second of play and how
+//        many games were won, lost or ran out of time.
+// ----------------------------------------------------------------------------
+static void BenchCollision()
+{
+	static const float steps[] = { 1.0f / 240.0f, 1.0f / 120.0f, 1.0f / 60.0f, 1.0f / 30.0f, 1.0f / 15.0f };
+
+	CLevel		level;
+	CBoard		board;
+	BOARDINPUT	input;
+	double		dStart, dSeconds;
+	int			nResult[4];
+
+	printf( "collision: us per simulated second, games cleared/lost/timed out\n" );
+
+	level.Load( "Data/Levels/level2.lvl" );
+
+	for( int i = 0; i < (int)(sizeof(steps) / sizeof(steps[0])); i++ )
+	{
+		printf( "  step 1/%-4.0f", 1.0f / steps[i] );
+
+		for( int n = 0; n < 2; n++ )
+		{
+			board.SetCollisionMode( n ? CollideSwept : CollideDiscrete );
+			board.SetTimeStep( steps[i] );
+
+			nResult[BoardPlaying] = nResult[BoardCleared] = nResult[BoardLost] = 0;
+			dSeconds = 0.0;
+			dStart = Seconds();
+
+			for( int g = 0; g < 50; g++ )
+			{
+				board.Reset( &level );
+
+				while( (board.GetState() == BoardPlaying) && ((board.GetSteps() * steps[i]) < 600.0f) )
+				{
+					// The controller has as much reach per second whatever
+					// the step length.
+					input.nMouseX = board.TrackBall( (int)(40 * (steps[i] * 120.0f)) );
+
+					board.Step( input );
+				}
+
+				nResult[board.GetState()]++;
+				dSeconds += board.GetSteps() * steps[i];
+			}
+
+			printf( "  %s %8.2f us %3d/%3d/%3d", n ? "swept" : "discrete", ((Seconds() - dStart) * 1.0e6) / dSeconds,
+					nResult[BoardCleared], nResult[BoardLost], nResult[BoardPlaying] );
+		}
+
+		printf( "\n" );
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: BenchBalls
+//
+//  Desc: Times a step with more and more balls in play on a full board, in
+//        both collision modes, against the budget of one step. Lost balls
+//        are topped up between steps so the count holds.
+// ----------------------------------------------------------------------------
+static void BenchBalls()
+{
+	static const int counts[] = { 1, 10, 100, 1000, 10000, 50000 };
+
+	CLevel			level;
+	CBoard			board;
+	BOARDINPUT		input;
+	VEC2			vPos, vVel;
+	unsigned int	nSeed;
+	double			dStart, dTime, dBalls;
+	int				nSteps;
+
+	printf( "balls: us per step (ns per ball), %% of a %.2f ms step\n", BOARD_TIMESTEP * 1000.0f );
+
+	MakeLevel( &level, LEVEL_COLUMNS, LEVEL_ROWS, 100, 1234 );
+
+	for( int i = 0; i < (int)(sizeof(counts) / sizeof(counts[0])); i++ )
+	{
+		printf( "  %6d", counts[i] );
+
+		for( int m = 0; m < 2; m++ )
+		{
+			board.SetCollisionMode( m ? CollideSwept : CollideDiscrete );
+
+			nSeed = 1234;
+			nSteps = 0;
+			dTime = dBalls = 0.0;
+
+			board.Reset( &level );
+
+			while( nSteps < 1200 )
+			{
+				// Top the board back up with balls going off in random
+				// directions from the middle of the field.
+				while( board.GetBallCount() < counts[i] )
+				{
+					nSeed = (nSeed * 1103515245u) + 12345u;
+					vPos.x = -0.8f + (1.6f * ((nSeed >> 8) & 0xFFFF) / 65536.0f);
+					vPos.y = -0.3f + (0.6f * ((nSeed >> 4) & 0xFF) / 256.0f);
+
+					nSeed = (nSeed * 1103515245u) + 12345u;
+					vVel.x = cosf( 6.2831853f * ((nSeed >> 8) & 0xFFFF) / 65536.0f ) * 0.92f;
+					vVel.y = sinf( 6.2831853f * ((nSeed >> 8) & 0xFFFF) / 65536.0f ) * 0.92f;
+
+					board.AddBall( vPos, vVel );
+				}
+
+				input.nMouseX = board.TrackBall( 40 );
+
+				dBalls += board.GetBallCount();
+
+				dStart = Seconds();
+				board.Step( input );
+				dTime += Seconds() - dStart;
+
+				nSteps++;
+
+				// A full board with this many balls doesn't last.
+				if( board.GetState() != BoardPlaying ) board.Reset( &level );
+			}
+
+			printf( "  %s %9.2f us (%6.1f ns) %6.1f%%", m ? "swept" : "discrete", (dTime * 1.0e6) / nSteps, (dTime * 1.0e9) / dBalls,
+					((dTime / nSteps) * 100.0) / BOARD_TIMESTEP );
+		}
+
+		printf( "\n" );
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: BenchBatch
+//
+//  Desc: Runs the same batch of boards on 1, 2, 4... threads up to one per
+//        processor and reports how the throughput scales. The outcomes have
+//        to match whatever the thread count.
+// ----------------------------------------------------------------------------
+static void BenchBatch()
+{
+	CLevel			level;
+	CBatchRunner	batch;
+	double			dSteps, dBase = 0.0, dScore, dFirst = -1.0;
+	int				nMax = (int)thread::hardware_concurrency();
+
+	if( nMax < 1 ) nMax = 1;
+
+	printf( "batch: million steps per second, 256 boards, %d processors\n", nMax );
+
+	level.Load( "Data/Levels/level2.lvl" );
+
+	for( int n = 1; ; n *= 2 )
+	{
+		CThreadPool pool;
+
+		if( n > nMax ) n = nMax;
+
+		pool.Init( n );
+
+		batch.Run( &pool, &level, 256, 1 );
+
+		dSteps = batch.GetTotalSteps() / batch.GetSeconds();
+		if( n == 1 ) dBase = dSteps;
+
+		dScore = 0.0;
+		for( int i = 0; i < batch.GetBoardCount(); i++ ) dScore += batch.GetResult( i )->nScore;
+		if( dFirst < 0.0 ) dFirst = dScore;
+
+		printf( "  %3d threads %8.2f  %5.2fx%s\n", n, dSteps / 1.0e6, dSteps / dBase, (dScore == dFirst) ? "" : "  (outcomes differ!)" );
+
+		if( n == nMax ) break;
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: BenchLevels
+//
+//  Desc: Plays a minute on levels from the standard size up to the largest,
+//        full and sparse. Reports the memory the bricks take against one
+//        entry per slot, how long setting the board up takes and the cost
+//        of a step, which should follow the bricks near the ball and not the
+//        size of the level.
+// ----------------------------------------------------------------------------
+static void BenchLevels()
+{
+	static const struct { int nSize; int nPercent; } levels[] =
+	{
+		{ LEVEL_COLUMNS, 100 },
+		{ 64, 100 },
+		{ 512, 100 },
+		{ 512, 2 },
+		{ 4096, 10 },
+		{ 4096, 1 }
+	};
+
+	CLevel		level;
+	CBoard		board;
+	BOARDINPUT	input;
+	double		dStart, dReset, dSlots;
+	int			nSteps;
+
+	printf( "levels: size, bricks, chunks, KB kept vs. KB for every slot, ms to reset, ns per step\n" );
+
+	for( int i = 0; i < (int)(sizeof(levels) / sizeof(levels[0])); i++ )
+	{
+		MakeLevel( &level, levels[i].nSize, levels[i].nSize, levels[i].nPercent, 1234 );
+
+		dStart = Seconds();
+		board.Reset( &level );
+		dReset = Seconds() - dStart;
+
+		dStart = Seconds();
+
+		for( nSteps = 0; (nSteps < 120 * 60) && (board.GetState() == BoardPlaying); nSteps++ )
+		{
+			input.nMouseX = board.TrackBall( 40 );
+
+			board.Step( input );
+		}
+
+		// Five floats a slot, as every slot used to have.
+		dSlots = (double)levels[i].nSize * levels[i].nSize * 5 * sizeof(float);
+
+		printf( "  %4dx%-4d %3d%%  %8d  %6d  %9.1f  %9.1f  %8.2f  %8.1f\n", levels[i].nSize, levels[i].nSize, levels[i].nPercent,
+				board.GetBricks()->GetCount(), board.GetBricks()->GetChunkCount(), board.GetBricks()->GetBytes() / 1024.0, dSlots / 1024.0,
+				dReset * 1000.0, ((Seconds() - dStart) * 1.0e9) / nSteps );
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: BenchFixed
+//
+//  Desc: Plays the same games in discrete floating point and in fixed point.
+//        Besides the cost and the outcomes, prints a checksum of how every
+//        game ended, down to the bits of the ball. Fixed point should give
+//        the same checksum from every compiler and every set of flags.
+// ----------------------------------------------------------------------------
+static void BenchFixed()
+{
+	static const char* levels[] = { "Data/Levels/level1.lvl", "Data/Levels/level2.lvl" };
+
+	CLevel			level;
+	CBoard			board;
+	BOARDINPUT		input;
+	double			dStart, dSeconds;
+	int				nResult[4];
+	unsigned int	nHash, nBits;
+	float			f;
+
+	printf( "fixed: us per simulated second, games cleared/lost/timed out, checksum\n" );
+
+	for( int i = 0; i < (int)(sizeof(levels) / sizeof(levels[0])); i++ )
+	{
+		level.Load( levels[i] );
+
+		printf( "  %s\n", levels[i] );
+
+		for( int n = 0; n < 2; n++ )
+		{
+			board.SetCollisionMode( n ? CollideFixed : CollideDiscrete );
+
+			nResult[BoardPlaying] = nResult[BoardCleared] = nResult[BoardLost] = 0;
+			nHash = 2166136261u;
+			dSeconds = 0.0;
+			dStart = Seconds();
+
+			for( int g = 0; g < 50; g++ )
+			{
+				board.Reset( &level );
+
+				// Vary the games by holding the paddle still for a while first.
+				for( int s = 0; s < g; s++ ) board.Step( BOARDINPUT() );
+
+				while( (board.GetState() == BoardPlaying) && (board.GetSteps() < 120 * 600) )
+				{
+					input.nMouseX = board.TrackBall( 40 );
+
+					board.Step( input );
+				}
+
+				nResult[board.GetState()]++;
+				dSeconds += board.GetSteps() * board.GetTimeStep();
+
+				f = board.GetBallPos().x;
+				memcpy( &nBits, &f, sizeof(nBits) );
+
+				nHash = (nHash ^ board.GetScore()) * 16777619u;
+				nHash = (nHash ^ board.GetSteps()) * 16777619u;
+				nHash = (nHash ^ nBits) * 16777619u;
+			}
+
+			printf( "    %-8s %8.2f us %3d/%3d/%3d  %08x\n", n ? "fixed" : "discrete", ((Seconds() - dStart) * 1.0e6) / dSeconds,
+					nResult[BoardCleared], nResult[BoardLost], nResult[BoardPlaying], nHash );
+		}
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: BenchRewind
+//
+//  Desc: Plays a long game into the snapshot ring and then jumps around in
+//        it. Reports what recording costs a step, the memory the ring holds
+//        and how long a jump takes, and checks every jump lands on exactly
+//        the board that was played.
+// ----------------------------------------------------------------------------
+static void BenchRewind()
+{
+	static const struct { int nSize; int nPercent; } levels[] =
+	{
+		{ LEVEL_COLUMNS, 100 },
+		{ 512, 100 },
+		{ 4096, 1 }
+	};
+
+	CLevel				level;
+	CBoard				board;
+	CSnapshotRing		ring;
+	BOARDINPUT			input;
+	vector<BOARDINPUT>	tInputs;
+	vector<VEC2>		tBalls;
+	VEC2				vBall;
+	double				dStart, dPlain, dRecord, dSeek;
+	unsigned int		nStep, nSeed = 1;
+	int					nSeeks = 2000, nWrong;
+
+	printf( "rewind: ns per step plain/recording, KB kept, us per jump, jumps that missed\n" );
+
+	for( int i = 0; i < (int)(sizeof(levels) / sizeof(levels[0])); i++ )
+	{
+		MakeLevel( &level, levels[i].nSize, levels[i].nSize, levels[i].nPercent, 1234 );
+
+		// Play the game once to have its input and where the ball was.
+		tInputs.clear();
+		tBalls.clear();
+
+		board.Reset( &level );
+
+		dStart = Seconds();
+
+		while( (board.GetState() == BoardPlaying) && (board.GetSteps() < 120 * 60 * 10) )
+		{
+			input.nMouseX = board.TrackBall( 40 );
+
+			tInputs.push_back( input );
+			tBalls.push_back( board.GetBallPos() );
+
+			board.Step( input );
+		}
+
+		dPlain = Seconds() - dStart;
+
+		// And again into the ring.
+		ring.Init( SNAPSHOT_COUNT, SNAPSHOT_INTERVAL );
+		board.Reset( &level );
+
+		dStart = Seconds();
+
+		for( size_t n = 0; n < tInputs.size(); n++ )
+		{
+			ring.Record( &board, tInputs[n] );
+			board.Step( tInputs[n] );
+		}
+
+		dRecord = Seconds() - dStart;
+
+		nWrong = 0;
+		dStart = Seconds();
+
+		for( int n = 0; n < nSeeks; n++ )
+		{
+			nSeed = (nSeed * 1103515245u) + 12345u;
+			nStep = ring.GetFirstStep() + ((nSeed >> 8) % (ring.GetLastStep() - ring.GetFirstStep()));
+
+			ring.Seek( &board, nStep );
+
+			vBall = board.GetBallPos();
+
+			if( (board.GetSteps() != nStep) || memcmp( &vBall, &tBalls[nStep], sizeof(VEC2) ) ) nWrong++;
+		}
+
+		dSeek = Seconds() - dStart;
+
+		printf( "  %4dx%-4d %3d%%  %6.1f %6.1f  %9.1f  %7.2f  %d\n", levels[i].nSize, levels[i].nSize, levels[i].nPercent,
+				(dPlain * 1.0e9) / tInputs.size(), (dRecord * 1.0e9) / tInputs.size(), ring.GetBytes() / 1024.0,
+				(dSeek * 1.0e6) / nSeeks, nWrong );
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: BenchPredict
+//
+//  Desc: Predicts the ball's path over and over during swept mode games.
+//        Reports how long an eight bounce prediction takes, and checks its
+//        first bounce against the step the board actually bounces on, with
+//        the paddle held still. Static levels are cast through the grid and
+//        the tree, and a level whose rows all move through the tree, as it
+//        has to be. The path is cast against the bricks where they are, so
+//        on the moving level some first bounces land elsewhere.
+// ----------------------------------------------------------------------------
+static void BenchPredict()
+{
+	static const struct { int nSize; int nPercent; Broadphase Phase; bool bMoving; } levels[] =
+	{
+		{ LEVEL_COLUMNS, 100, BroadphaseGrid, false },
+		{ LEVEL_COLUMNS, 100, BroadphaseTree, false },
+		{ LEVEL_COLUMNS, 100, BroadphaseGrid, true },
+		{ 512, 30, BroadphaseGrid, false },
+		{ 512, 30, BroadphaseTree, false },
+		{ 4096, 1, BroadphaseGrid, false },
+		{ 4096, 1, BroadphaseTree, false }
+	};
+
+	CLevel			level;
+	CBoard			board, ahead;
+	BOARDINPUT		input, still;
+	PATHPOINT		path[8];
+	LEVELMOTION		motion;
+	VEC2			vVel, vTurn;
+	double			dStart, dQuery = 0.0;
+	int				n, nStep, nQueries, nChecked, nWrong, nPoints;
+
+	still.nMouseX = 0;
+
+	printf( "predict: how it's cast, us per 8 bounce prediction, bounces per prediction, first bounces checked, off by more than a step\n" );
+
+	for( int i = 0; i < (int)(sizeof(levels) / sizeof(levels[0])); i++ )
+	{
+		MakeLevel( &level, levels[i].nSize, levels[i].nSize, levels[i].nPercent, 1234 );
+
+		// Every row swings, as in BenchTree.
+		for( int k = 0; levels[i].bMoving && (k < levels[i].nSize); k++ )
+		{
+			motion.nRow = k;
+			motion.fAmpX = 0.06f;
+			motion.fAmpY = 0.02f;
+			motion.fPeriod = 2.0f + (k % 3);
+			motion.fPhase = 0.1f * k;
+			motion.fSpin = (k % 3) ? 0.0f : 90.0f;
+
+			level.AddMotion( motion );
+		}
+
+		board.SetCollisionMode( CollideSwept );
+		board.SetBroadphase( levels[i].Phase );
+		board.Reset( &level );
+
+		nQueries = nChecked = nWrong = nPoints = 0;
+		dQuery = 0.0;
+
+		while( (board.GetState() == BoardPlaying) && (board.GetSteps() < 120 * 60 * 5) )
+		{
+			input.nMouseX = board.TrackBall( 40 );
+			board.Step( input );
+
+			if( (board.GetSteps() % 31) || !board.GetBalls()->GetCount() ) continue;
+
+			vVel = board.GetBallVel();
+			if( (vVel.x == 0.0f) && (vVel.y == 0.0f) ) continue;
+
+			dStart = Seconds();
+
+			for( int j = 0; j < 100; j++ )
+			{
+				n = board.PredictPath( board.GetBallPos(), vVel, 10.0f, path, 8 );
+			}
+
+			dQuery += Seconds() - dStart;
+			nQueries += 100;
+			nPoints += n;
+
+			if( (path[0].Event == PathLost) || (path[0].Event == PathEnd) ) continue;
+
+			// Step a copy with the paddle still until the ball turns.
+			ahead = board;
+
+			for( nStep = 1; nStep < 60 * 20; nStep++ )
+			{
+				ahead.Step( still );
+
+				if( (ahead.GetState() != BoardPlaying) || (ahead.GetSteps() != board.GetSteps() + nStep) ) break;
+				vTurn = ahead.GetBallVel();
+				if( memcmp( &vTurn, &vVel, sizeof(VEC2) ) ) break;
+			}
+
+			nChecked++;
+
+			if( abs( nStep - (int)ceilf( path[0].fTime / board.GetTimeStep() ) ) > 1 ) nWrong++;
+		}
+
+		printf( "  %4dx%-4d %3d%%  %-6s  %6.2f us  %4.1f  %6d  %d\n", levels[i].nSize, levels[i].nSize, levels[i].nPercent,
+				levels[i].bMoving ? "moving" : ((levels[i].Phase == BroadphaseTree) ? "tree" : "grid"), nQueries ? ((dQuery * 1.0e6) / nQueries) : 0.0, nQueries ? ((nPoints * 100.0) / nQueries) : 0.0, nChecked, nWrong );
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: BenchParticles
+//
+//  Desc: Keeps a pool full of bursting particles and times the update, and
+//        writing them out as vertices the way the game does, scalar and SSE.
+//        Bursts top the pool back up between frames so the count holds.
+// ----------------------------------------------------------------------------
+static void BenchParticles()
+{
+	static const int counts[] = { 1000, 10000, 100000 };
+
+	struct PARTICLEVERTEX { float x, y, z; uint32_t color; };
+
+	CParticlePool			pool;
+	CRandom					random;
+	vector<PARTICLEVERTEX>	tVerts;
+	const float				fFrame = 1.0f / 60.0f;
+	const float				*pX, *pY, *pZ, *pLife, *pFade;
+	const uint32_t*			pColor;
+	double					dStart, dUpdate, dFill, dCount;
+	float					f;
+	int						n, nFrames = 600;
+
+	printf( "particles: us per frame update/vertices (ns per particle), %% of a %.2f ms frame\n", fFrame * 1000.0f );
+
+	for( int i = 0; i < (int)(sizeof(counts) / sizeof(counts[0])); i++ )
+	{
+		printf( "  %6d", counts[i] );
+
+		pool.Init( counts[i] );
+		tVerts.resize( counts[i] );
+
+		for( int m = 0; m < 2; m++ )
+		{
+			pool.SetSIMD( m != 0 );
+			pool.Clear();
+			random.Seed( 1234 );
+
+			dUpdate = dFill = dCount = 0.0;
+
+			for( int nFrame = 0; nFrame < nFrames; nFrame++ )
+			{
+				while( pool.GetCount() < counts[i] )
+				{
+					pool.Burst( random.Float( -1.0f, 1.0f ), random.Float( 0.0f, 1.0f ), BRICK_HALF_WIDTH, BRICK_HALF_HEIGHT,
+								0.0f, 0.92f, 40, 0xFFFF4020, &random );
+				}
+
+				dCount += pool.GetCount();
+
+				dStart = Seconds();
+				pool.Update( fFrame );
+				dUpdate += Seconds() - dStart;
+
+				dStart = Seconds();
+
+				n = pool.GetCount();
+
+				pX = pool.GetX();
+				pY = pool.GetY();
+				pZ = pool.GetZ();
+				pLife = pool.GetLife();
+				pFade = pool.GetFade();
+				pColor = pool.GetColor();
+
+				for( int j = 0; j < n; j++ )
+				{
+					f = pLife[j] * pFade[j];
+
+					tVerts[j].x = pX[j];
+					tVerts[j].y = pY[j];
+					tVerts[j].z = pZ[j];
+					tVerts[j].color = (pColor[j] & 0x00FFFFFF) | ((uint32_t)(f * 255.0f) << 24);
+				}
+
+				dFill += Seconds() - dStart;
+			}
+
+			printf( "   %s %8.1f/%-8.1f (%4.2f) %5.1f%%", m ? "sse" : "scalar", (dUpdate * 1.0e6) / nFrames, (dFill * 1.0e6) / nFrames,
+					(dUpdate * 1.0e9) / dCount, (((dUpdate + dFill) / nFrames) * 100.0) / fFrame );
+		}
+
+		printf( "\n" );
+	}
+}
+
+
+
+
+// Orders ball numbers left to right, for sorting them from scratch.
+struct BallLeftOf
+{
+	const CBallPool* pBalls;
+
+	BallLeftOf( const CBallPool* p ) : pBalls( p ) {}
+	bool operator()( int a, int b ) const { return pBalls->GetX( a ) < pBalls->GetX( b ); }
+};
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: BenchBallBall
+//
+//  Desc: Times balls bouncing off each other, 1k to 50k of them spread over
+//        a box that grows with the count, so they stay as crowded. Reports
+//        the incremental sort and sweep next to what sorting from scratch
+//        every step would cost, and checks no energy is lost.
+// ----------------------------------------------------------------------------
+static void BenchBallBall()
+{
+	static const int counts[] = { 1000, 5000, 10000, 50000 };
+
+	CBallPool		balls;
+	CRandom			random;
+	vector<int>		tBusy, tOrder;
+	const float		r = BALL_RADIUS;
+	double			dStart, dCollide, dSort, dEnergy0, dEnergy1;
+	float			fSize, x, y, vx, vy;
+	int				nSteps = 240, nBounces, n;
+
+	printf( "ballball: us per step sweep (ns per ball), us per step sorting from scratch, bounces per step, energy kept\n" );
+
+	for( int i = 0; i < (int)(sizeof(counts) / sizeof(counts[0])); i++ )
+	{
+		// About one ball for every 40 r^2 of floor.
+		fSize = sqrtf( counts[i] * 40.0f * r * r );
+
+		balls.Clear();
+		balls.Reserve( counts[i] );
+		random.Seed( 1234 );
+
+		for( n = 0; n < counts[i]; n++ )
+		{
+			x = random.Float( r, fSize - r );
+			y = random.Float( r, fSize - r );
+
+			balls.Add( x, y, random.Float( -1.0f, 1.0f ), random.Float( -1.0f, 1.0f ) );
+		}
+
+		tBusy.resize( counts[i] );
+		tOrder.resize( counts[i] );
+
+		dCollide = dSort = dEnergy0 = dEnergy1 = 0.0;
+		nBounces = 0;
+
+		for( n = 0; n < counts[i]; n++ ) dEnergy0 += (balls.GetVelX( n ) * balls.GetVelX( n )) + (balls.GetVelY( n ) * balls.GetVelY( n ));
+
+		for( int nStep = 0; nStep < nSteps; nStep++ )
+		{
+			// Move them, turning round the ones at the walls.
+			int nBusy = balls.MoveFree( BOARD_TIMESTEP, r, r, fSize - r, fSize - r, &tBusy[0] );
+
+			for( n = 0; n < nBusy; n++ )
+			{
+				x = balls.GetX( tBusy[n] );
+				y = balls.GetY( tBusy[n] );
+				vx = balls.GetVelX( tBusy[n] );
+				vy = balls.GetVelY( tBusy[n] );
+
+				if( ((x + (vx * BOARD_TIMESTEP)) <= r) || ((x + (vx * BOARD_TIMESTEP)) >= (fSize - r)) ) vx = -vx;
+				if( ((y + (vy * BOARD_TIMESTEP)) <= r) || ((y + (vy * BOARD_TIMESTEP)) >= (fSize - r)) ) vy = -vy;
+
+				balls.SetVel( tBusy[n], vx, vy );
+			}
+
+			dStart = Seconds();
+			nBounces += balls.Collide( r );
+			dCollide += Seconds() - dStart;
+
+			// What the sort alone would cost without the last step's order.
+			for( n = 0; n < counts[i]; n++ ) tOrder[n] = n;
+
+			dStart = Seconds();
+			sort( tOrder.begin(), tOrder.end(), BallLeftOf( &balls ) );
+			dSort += Seconds() - dStart;
+		}
+
+		for( n = 0; n < counts[i]; n++ ) dEnergy1 += (balls.GetVelX( n ) * balls.GetVelX( n )) + (balls.GetVelY( n ) * balls.GetVelY( n ));
+
+		printf( "  %6d  %8.1f (%5.1f)  %8.1f  %7.1f  %8.5f\n", counts[i], (dCollide * 1.0e6) / nSteps, (dCollide * 1.0e9) / (nSteps * (double)counts[i]),
+				(dSort * 1.0e6) / nSteps, (double)nBounces / nSteps, dEnergy1 / dEnergy0 );
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Wander
+//
+//  Desc: Moves a point on by one step at ball speed, bouncing it around the
+//        given bounds, so lookups along it come one ball step apart.
+// ----------------------------------------------------------------------------
+static void Wander( float fMinX, float fMinY, float fMaxX, float fMaxY, VEC2* pPos, VEC2* pVel )
+{
+	pPos->x += pVel->x * BOARD_TIMESTEP;
+	pPos->y += pVel->y * BOARD_TIMESTEP;
+
+	if( (pPos->x < fMinX) || (pPos->x > fMaxX) ) pVel->x = -pVel->x;
+	if( (pPos->y < fMinY) || (pPos->y > fMaxY) ) pVel->y = -pVel->y;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: BenchTree
+//
+//  Desc: Times the brick tree against brick count. Reports what building it
+//        costs next to refitting it, a whole step of moving bricks, and what
+//        a ball sized lookup costs: by slot and through the tree on a still
+//        level, then through the tree on a level that has been moving for a
+//        while, refit and rebuilt where the bricks are.
+// ----------------------------------------------------------------------------
+static void BenchTree()
+{
+	static const int sizes[] = { 32, 100, 316, 1000 };
+
+	CLevel			level;
+	CBoard			board;
+	CBrickSet		bricks;
+	CBoxTree		tree;
+	LEVELMOTION		motion;
+	const CBrickSet*	pBricks;
+	const BVHNODE*	pRoot;
+	vector<float>	tX, tY, tHalfX, tHalfY;
+	vector<int>		tFound, tSpan;
+	const float		h = BALL_RADIUS + 0.01f;
+	const int		nQueries = 200000;
+	double			dStart, dBuild, dRefit, dStep, dQuery[4];
+	float			fLeft, fTop, fRight, fBottom;
+	VEC2			vPos, vVel;
+	int				nCount, nFound[4], x0, y0, x1, y1, j, k;
+
+	printf( "tree: bricks, ms per build, us per refit, us per moving step, ns per lookup by slot / tree still / tree refit / tree rebuilt, bricks found by slot / tree\n" );
+
+	for( int i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++ )
+	{
+		MakeLevel( &level, sizes[i], sizes[i], 100, 1234 );
+
+		board.SetBroadphase( BroadphaseGrid );
+		board.Reset( &level );
+		board.GetWalls( &fLeft, &fTop, &fRight, &fBottom );
+
+		pBricks = board.GetBricks();
+		nCount = pBricks->GetCount();
+
+		// The same boxes as the tree in the brick set is built over.
+		tX.resize( nCount );
+		tY.resize( nCount );
+		tHalfX.resize( nCount );
+		tHalfY.resize( nCount );
+
+		for( j = 0; j < nCount; j++ )
+		{
+			tX[j] = pBricks->GetCenterX( j );
+			tY[j] = pBricks->GetCenterY( j );
+			tHalfX[j] = pBricks->GetHalfWidth( j );
+			tHalfY[j] = pBricks->GetHalfHeight( j );
+		}
+
+		dStart = Seconds();
+		for( j = 0; j < 10; j++ ) tree.Build( &tX[0], &tY[0], &tHalfX[0], &tHalfY[0], nCount );
+		dBuild = (Seconds() - dStart) / 10;
+
+		dStart = Seconds();
+		for( j = 0; j < 100; j++ ) tree.Refit( &tX[0], &tY[0], &tHalfX[0], &tHalfY[0] );
+		dRefit = (Seconds() - dStart) / 100;
+
+		// Lookups the size of a ball's step on the still level, by slot...
+		tSpan.resize( pBricks->GetColumns() );
+		nFound[0] = 0;
+
+		vPos.x = (fLeft + fRight) * 0.5f;
+		vPos.y = fTop - (BRICK_PITCH_Y * sizes[i] * 0.5f);
+		vVel.x = BALL_LAUNCH_X;
+		vVel.y = BALL_LAUNCH_Y;
+
+		dStart = Seconds();
+
+		for( j = 0; j < nQueries; j++ )
+		{
+			Wander( fLeft, fTop - (BRICK_PITCH_Y * sizes[i]), fRight, fTop, &vPos, &vVel );
+
+			if( !board.GetCellRange( vPos.x - h, vPos.y - h, vPos.x + h, vPos.y + h, &x0, &y0, &x1, &y1 ) ) continue;
+
+			for( k = y0; k <= y1; k++ )
+			{
+				nFound[0] += pBricks->ListSpan( 0, k, x0, x1, &tSpan[0] );
+			}
+		}
+
+		dQuery[0] = Seconds() - dStart;
+
+		// ...and through the tree.
+		board.SetBroadphase( BroadphaseTree );
+		nFound[1] = 0;
+
+		vPos.x = (fLeft + fRight) * 0.5f;
+		vPos.y = fTop - (BRICK_PITCH_Y * sizes[i] * 0.5f);
+		vVel.x = BALL_LAUNCH_X;
+		vVel.y = BALL_LAUNCH_Y;
+
+		dStart = Seconds();
+
+		for( j = 0; j < nQueries; j++ )
+		{
+			Wander( fLeft, fTop - (BRICK_PITCH_Y * sizes[i]), fRight, fTop, &vPos, &vVel );
+
+			nFound[1] += pBricks->FindInBox( vPos.x - h, vPos.y - h, vPos.x + h, vPos.y + h, &tFound );
+		}
+
+		dQuery[1] = Seconds() - dStart;
+
+		// Now every row swings, and every third one spins as well.
+		for( k = 0; k < sizes[i]; k++ )
+		{
+			motion.nRow = k;
+			motion.fAmpX = 0.06f;
+			motion.fAmpY = 0.02f;
+			motion.fPeriod = 2.0f + (k % 3);
+			motion.fPhase = 0.1f * k;
+			motion.fSpin = (k % 3) ? 0.0f : 90.0f;
+
+			level.AddMotion( motion );
+		}
+
+		bricks.Build( &level, fLeft + 0.1f, fTop - 0.1f );
+
+		dStart = Seconds();
+		for( j = 0; j < 120; j++ ) bricks.Animate( j * BOARD_TIMESTEP );
+		dStep = (Seconds() - dStart) / 120;
+
+		// Ten seconds on, with the tree refit and then rebuilt.
+		bricks.Animate( 10.0f );
+		pRoot = bricks.GetTree()->GetNode( 0 );
+
+		for( int nPass = 2; nPass < 4; nPass++ )
+		{
+			if( nPass == 3 ) bricks.BuildTree();
+
+			nFound[nPass] = 0;
+
+			vPos.x = (pRoot->fMinX + pRoot->fMaxX) * 0.5f;
+			vPos.y = (pRoot->fMinY + pRoot->fMaxY) * 0.5f;
+			vVel.x = BALL_LAUNCH_X;
+			vVel.y = BALL_LAUNCH_Y;
+
+			dStart = Seconds();
+
+			for( j = 0; j < nQueries; j++ )
+			{
+				Wander( pRoot->fMinX, pRoot->fMinY, pRoot->fMaxX, pRoot->fMaxY, &vPos, &vVel );
+
+				nFound[nPass] += bricks.FindInBox( vPos.x - h, vPos.y - h, vPos.x + h, vPos.y + h, &tFound );
+			}
+
+			dQuery[nPass] = Seconds() - dStart;
+		}
+
+		printf( "  %8d  %7.2f  %8.1f  %8.1f  %6.1f / %6.1f / %6.1f / %6.1f  %4.2f / %4.2f%s\n", nCount, dBuild * 1.0e3, dRefit * 1.0e6, dStep * 1.0e6,
+				(dQuery[0] * 1.0e9) / nQueries, (dQuery[1] * 1.0e9) / nQueries, (dQuery[2] * 1.0e9) / nQueries, (dQuery[3] * 1.0e9) / nQueries,
+				(double)nFound[0] / nQueries, (double)nFound[1] / nQueries, (nFound[2] == nFound[3]) ? "" : "  (refit and rebuilt differ!)" );
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: BenchLoad
+//
+//  Desc: Loads levels from text and compiled, and sets a board up with each.
+//        Parsing text goes with the size of the level. Loading a compiled
+//        one should take the same next to nothing however big it is, and
+//        leave setting the board up to copy the bricks' extents across
+//        rather than work them out.
+// ----------------------------------------------------------------------------
+static void BenchLoad()
+{
+	static const struct { int nSize; int nPercent; } levels[] =
+	{
+		{ LEVEL_COLUMNS, 100 },
+		{ 512, 100 },
+		{ 4096, 10 },
+		{ 4096, 100 }
+	};
+
+	static const char*	sText = "simbench.lvl";
+	static const char*	sCompiled = "simbench.lvb";
+
+	CLevel		level;
+	CBoard		board;
+	CMappedFile	compiled;
+	ofstream	file;
+	string		sLevel;
+	double		dStart, dText, dTextReset, dLoad, dLoadReset;
+	float		fOriginX, fOriginY;
+	uint32_t	nHash;
+	bool		bSame;
+
+	printf( "load: size, bricks, KB of text vs. compiled, ms to load and reset from text, from compiled\n" );
+
+	for( int i = 0; i < (int)(sizeof(levels) / sizeof(levels[0])); i++ )
+	{
+		MakeLevelText( &sLevel, levels[i].nSize, levels[i].nSize, levels[i].nPercent, 1234 );
+
+		file.open( sText, ios::out | ios::binary | ios::trunc );
+		file.write( sLevel.c_str(), sLevel.size() );
+		file.close();
+
+		dStart = Seconds();
+		level.Load( sText );
+		dText = Seconds() - dStart;
+
+		dStart = Seconds();
+		board.Reset( &level );
+		dTextReset = Seconds() - dStart;
+
+		board.GetBrickCenter( 0, 0, &fOriginX, &fOriginY );
+		level.SaveCompiled( sCompiled, fOriginX, fOriginY, CMeshData::HashSource( sLevel.c_str(), sLevel.size() ), sLevel.size() );
+
+		nHash = CReplay::HashLevel( &level );
+
+		dStart = Seconds();
+		level.Load( sCompiled );
+		dLoad = Seconds() - dStart;
+
+		dStart = Seconds();
+		board.Reset( &level );
+		dLoadReset = Seconds() - dStart;
+
+		bSame = (CReplay::HashLevel( &level ) == nHash) && (level.GetExtents() != NULL);
+
+		compiled.Open( sCompiled );
+
+		printf( "  %4dx%-4d %3d%%  %8d  %8.0f  %8.0f   %8.2f + %7.2f   %8.3f + %7.2f%s\n", levels[i].nSize, levels[i].nSize, levels[i].nPercent,
+				level.CountBricks(), sLevel.size() / 1024.0, compiled.GetSize() / 1024.0, dText * 1000.0, dTextReset * 1000.0,
+				dLoad * 1000.0, dLoadReset * 1000.0, bSame ? "" : "  (compiled level differs!)" );
+	}
+
+	level.Clear( LEVEL_COLUMNS, LEVEL_ROWS );
+	compiled.Close();
+
+	remove( sText );
+	remove( sCompiled );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: BenchMesh
+//
+//  Desc: Parses the shipped models out of memory over and over, then loads
+//        each from its file to see what mapping it adds, then from its
+//        cache, which is only hashing the model and mapping the cache. Run
+//        from the folder Data is in. Leaves the caches the game would make.
+// ----------------------------------------------------------------------------
+static void BenchMesh()
+{
+	static const char* sModels[] =
+	{
+		"Data/Models/Ball/ball.x",
+		"Data/Models/BlueBrick/bluebrick.x",
+		"Data/Models/GreenBrick/greenbrick.x",
+		"Data/Models/Paddle/paddle.x",
+		"Data/Models/RedBrick/redbrick.x"
+	};
+
+	CMeshData	mesh;
+	CMappedFile	file;
+	double		dStart, dParse, dLoad, dCached;
+	bool		bCached;
+	size_t		nTotal;
+	int			nParses;
+
+	printf( "mesh: model, KB, vertices, triangles, materials, MB/s and us a parse from memory, us to load from the file, from the cache\n" );
+
+	for( int i = 0; i < (int)(sizeof(sModels) / sizeof(sModels[0])); i++ )
+	{
+		if( !file.Open( sModels[i] ) )
+		{
+			printf( "  %-36s  not found\n", sModels[i] );
+			continue;
+		}
+
+		// Enough parses to come to a few MB of text, however small the model.
+		nParses = (int)(16 * 1024 * 1024 / (file.GetSize() + 1)) + 1;
+		nTotal = 0;
+
+		// Once first, so the mesh's arrays are already grown.
+		mesh.ParseX( (const char*)file.GetData(), file.GetSize() );
+
+		dStart = Seconds();
+
+		for( int n = 0; n < nParses; n++ )
+		{
+			if( !mesh.ParseX( (const char*)file.GetData(), file.GetSize() ) ) break;
+			nTotal += file.GetSize();
+		}
+
+		dParse = Seconds() - dStart;
+
+		dStart = Seconds();
+
+		for( int n = 0; n < nParses; n++ )
+		{
+			mesh.LoadX( sModels[i] );
+		}
+
+		dLoad = Seconds() - dStart;
+
+		// Once first to write the cache.
+		mesh.Load( sModels[i] );
+
+		dStart = Seconds();
+
+		for( int n = 0; n < nParses; n++ )
+		{
+			mesh.Load( sModels[i] );
+		}
+
+		dCached = Seconds() - dStart;
+		bCached = mesh.IsCached();
+
+		if( nTotal < file.GetSize() * nParses )
+		{
+			printf( "  %-36s  doesn't parse\n", sModels[i] );
+		}
+		else
+		{
+			printf( "  %-36s  %6.1f  %6d  %6d  %3d   %8.1f  %8.2f   %8.2f  %8.2f%s\n", sModels[i], file.GetSize() / 1024.0,
+					mesh.GetVertexCount(), mesh.GetTriangleCount(), mesh.GetMaterialCount(),
+					nTotal / (1024.0 * 1024.0) / (dParse > 0.0 ? dParse : 1e-9), dParse * 1e6 / nParses, dLoad * 1e6 / nParses,
+					dCached * 1e6 / nParses, bCached ? "" : "  (cache not written!)" );
+		}
+
+		file.Close();
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: BenchLod
+//
+//  Desc: Simplifies the ball a step at a time, the way the game does, and
+//        times each step. Shows how far each is from the real ball and how
+//        small the ball has to be on screen before the game draws it, and
+//        what drawing a thousand balls with it costs in vertices shaded.
+//        Run from the folder Data is in.
+// ----------------------------------------------------------------------------
+static void BenchLod()
+{
+	static const char*	sBall = "Data/Models/Ball/ball.x";
+	static const int	nSteps = 5;
+
+	CMeshData	mesh;
+	double		dStart, dTime;
+	float		fError = 0.0f;
+
+	if( !mesh.Load( sBall ) )
+	{
+		printf( "lod: %s not found\n", sBall );
+		return;
+	}
+
+	printf( "lod: triangles, vertices, error (units, %% of radius), ms to make, used below px radius, K vertices shaded per 1000 balls\n" );
+	printf( "  %5d  %5d  %8.5f  %5.1f%%  %7s  %7s   %7.1f\n", mesh.GetTriangleCount(), mesh.GetVertexCount(), 0.0f, 0.0f, "", "",
+			mesh.GetACMR( MESH_FIFO_CACHE_SIZE ) * mesh.GetTriangleCount() );
+
+	for( int i = 0; i < nSteps; i++ )
+	{
+		dStart = Seconds();
+		fError += mesh.Simplify( mesh.GetTriangleCount() / 2 );
+		dTime = Seconds() - dStart;
+
+		// A 1 pixel error at a ball radius of BALL_RADIUS / fError pixels.
+		printf( "  %5d  %5d  %8.5f  %5.1f%%  %7.3f  %7.1f   %7.1f\n", mesh.GetTriangleCount(), mesh.GetVertexCount(), fError,
+				fError * 100.0f / BALL_RADIUS, dTime * 1000.0, BALL_RADIUS / fError, mesh.GetACMR( MESH_FIFO_CACHE_SIZE ) * mesh.GetTriangleCount() );
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: BenchPack
+//
+//  Desc: Packs the game's assets, then times opening each one as a loose
+//        file against opening it out of the mounted pack, and how fast the
+//        compressed ones unpack. Run from the folder Data is in.
+// ----------------------------------------------------------------------------
+static void BenchPack()
+{
+	static const char*	sPackName = "simbench.pak";
+	static const int	nOpens = 2000;
+
+	shared_ptr<CAssetPack>	pPack( new CAssetPack() );
+	vector<PACKFILE>		tFiles;
+	vector<unsigned char>	tData;
+	CMappedFile				file;
+	ifstream				list;
+	PACKFILE				packed;
+	string					sLine;
+	double					dStart, dLoose, dPacked, dUnpack;
+	size_t					nTotal;
+	int						nEntry;
+
+	list.open( "Data/pack.txt", ios::in );
+
+	while( getline( list, sLine ) )
+	{
+		if( !sLine.empty() && (sLine[sLine.size() - 1] == '\r') ) sLine.erase( sLine.size() - 1 );
+		if( sLine.empty() || !file.OpenFile( sLine.c_str() ) ) continue;
+
+		packed.sName = sLine;
+		packed.tData.assign( file.GetData(), file.GetData() + file.GetSize() );
+		packed.bStore = false;
+
+		tFiles.push_back( packed );
+		file.Close();
+	}
+
+	if( tFiles.empty() || !CAssetPack::Write( sPackName, tFiles, true ) || !pPack->Open( sPackName ) )
+	{
+		printf( "pack: Data/pack.txt not found\n" );
+		return;
+	}
+
+	printf( "pack: file, KB, KB packed, us to open loose, from the pack, MB/s unpacked\n" );
+
+	for( int i = 0; i < (int)tFiles.size(); i++ )
+	{
+		dStart = Seconds();
+
+		for( int n = 0; n < nOpens; n++ )
+		{
+			file.Open( tFiles[i].sName.c_str() );
+		}
+
+		dLoose = Seconds() - dStart;
+
+		CAssetPack::Mount( pPack );
+
+		dStart = Seconds();
+
+		for( int n = 0; n < nOpens; n++ )
+		{
+			file.Open( tFiles[i].sName.c_str() );
+		}
+
+		dPacked = Seconds() - dStart;
+
+		CAssetPack::Mount( shared_ptr<CAssetPack>() );
+		file.Close();
+
+		nEntry = pPack->Find( tFiles[i].sName.c_str() );
+		nTotal = 0;
+		dUnpack = 0.0;
+
+		if( pPack->IsCompressed( nEntry ) )
+		{
+			dStart = Seconds();
+
+			for( int n = 0; n < 100; n++ )
+			{
+				if( pPack->Read( nEntry, &tData ) ) nTotal += tData.size();
+			}
+
+			dUnpack = Seconds() - dStart;
+		}
+
+		printf( "  %-36s  %6.1f  %6.1f   %7.2f  %7.2f", tFiles[i].sName.c_str(), pPack->GetSize( nEntry ) / 1024.0,
+				pPack->GetPackedSize( nEntry ) / 1024.0, dLoose * 1e6 / nOpens, dPacked * 1e6 / nOpens );
+
+		if( nTotal ) printf( "   %7.1f\n", nTotal / (1024.0 * 1024.0) / (dUnpack > 0.0 ? dUnpack : 1e-9) );
+		else printf( "\n" );
+	}
+
+	pPack->Close();
+	remove( sPackName );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: main
+//
+//  Desc: Runs the simulation benchmarks. Give a benchmark name to run just
+//        that one.
+//
+//        simbench [broadphase|collision|kernel|balls|batch|levels|fixed|rewind|predict|
+//                  particles|ballball|tree|load|mesh|lod|pack]
+// ----------------------------------------------------------------------------
+int main( int argc, char* argv[] )
+{
+	static const struct { const char* sName; void (*pfnBench)(); } benches[] =
+	{
+		{ "broadphase", BenchBroadphase },
+		{ "collision", BenchCollision },
+		{ "kernel", BenchKernel },
+		{ "balls", BenchBalls },
+		{ "batch", BenchBatch },
+		{ "levels", BenchLevels },
+		{ "fixed", BenchFixed },
+		{ "rewind", BenchRewind },
+		{ "predict", BenchPredict },
+		{ "particles", BenchParticles },
+		{ "ballball", BenchBallBall },
+		{ "tree", BenchTree },
+		{ "load", BenchLoad },
+		{ "mesh", BenchMesh },
+		{ "lod", BenchLod },
+		{ "pack", BenchPack }
+	};
+
+	for( int i = 0; i < (int)(sizeof(benches) / sizeof(benches[0])); i++ )
+	{
+		if( (argc > 1) && strcmp( argv[1], benches[i].sName ) ) continue;
+
+		benches[i].pfnBench();
+	}
+
+	return 0;
+}
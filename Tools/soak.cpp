@@ -0,0 +1,78 @@
+// ----------------------------------------------------------------------------
+//  Filename: soak.cpp
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+
+
+
+
+// Preprocessor directives.
+#include <time.h>
+
+#include "../sim.h"
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: main
+//
+//  Desc: Headless soak test. Plays a level over and over with the simple
+//        paddle controller and reports how fast the board steps.
+//
+//        soak [level file] [games] [max steps per game]
+// ----------------------------------------------------------------------------
+int main( int argc, char* argv[] )
+{
+	CLevel		level;
+	CBoard		board;
+	BOARDINPUT	input;
+	const char*	sLevel = "Data/Levels/level1.lvl";
+	int			nGames = 1000;
+	int			nMaxSteps = 120 * 60 * 5;
+	int			nCleared = 0, nLost = 0;
+	double		dSteps = 0.0, dScore = 0.0;
+	double		dSeconds;
+	clock_t		tStart;
+
+	if( argc > 1 ) sLevel = argv[1];
+	if( argc > 2 ) nGames = atoi( argv[2] );
+	if( argc > 3 ) nMaxSteps = atoi( argv[3] );
+
+	if( !level.Load( sLevel ) )
+	{
+		printf( "Unable to load: %s\n", sLevel );
+		return -1;
+	}
+
+	tStart = clock();
+
+	for( int i = 0; i < nGames; i++ )
+	{
+		board.Reset( &level );
+
+		for( int n = 0; (n < nMaxSteps) && (board.GetState() == BoardPlaying); n++ )
+		{
+			input.nMouseX = board.TrackBall( 40 );
+
+			board.Step( input );
+		}
+
+		if( board.GetState() == BoardCleared ) nCleared++;
+		if( board.GetState() == BoardLost ) nLost++;
+
+		dSteps += board.GetSteps();
+		dScore += board.GetScore();
+	}
+
+	dSeconds = (double)(clock() - tStart) / CLOCKS_PER_SEC;
+	if( dSeconds <= 0.0 ) dSeconds = 1.0 / CLOCKS_PER_SEC;
+
+	printf( "%s: %d games, %d cleared, %d lost, %d timed out\n", sLevel, nGames, nCleared, nLost, nGames - nCleared - nLost );
+	printf( "average score %.1f, average length %.1f steps\n", dScore / nGames, dSteps / nGames );
+	printf( "%.0f steps in %.3f s, %.2f million steps per second\n", dSteps, dSeconds, (dSteps / dSeconds) / 1000000.0 );
+
+	return 0;
+}
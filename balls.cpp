@@ -0,0 +1,592 @@
+// ----------------------------------------------------------------------------
+//  Filename: balls.cpp
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+
+
+
+
+// Preprocessor directives.
+#include "sim.h"
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CBallPool
+//
+//  Desc: Constructor
+// ----------------------------------------------------------------------------
+CBallPool::CBallPool()
+{
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: ~CBallPool
+//
+//  Desc: Destructor
+// ----------------------------------------------------------------------------
+CBallPool::~CBallPool()
+{
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Clear
+//
+//  Desc: Takes every ball out of play.
+// ----------------------------------------------------------------------------
+void CBallPool::Clear()
+{
+	m_tPosX.clear();
+	m_tPosY.clear();
+	m_tVelX.clear();
+	m_tVelY.clear();
+	m_tPrevX.clear();
+	m_tPrevY.clear();
+	m_tFixX.clear();
+	m_tFixY.clear();
+	m_tFixVelX.clear();
+	m_tFixVelY.clear();
+	m_tOrder.clear();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Reserve
+//
+//  Desc: Makes room for nBalls balls up front, so adding them during play
+//        never has to allocate.
+// ----------------------------------------------------------------------------
+void CBallPool::Reserve( int nBalls )
+{
+	m_tPosX.reserve( nBalls );
+	m_tPosY.reserve( nBalls );
+	m_tVelX.reserve( nBalls );
+	m_tVelY.reserve( nBalls );
+	m_tPrevX.reserve( nBalls );
+	m_tPrevY.reserve( nBalls );
+	m_tFixX.reserve( nBalls );
+	m_tFixY.reserve( nBalls );
+	m_tFixVelX.reserve( nBalls );
+	m_tFixVelY.reserve( nBalls );
+	m_tFree.reserve( nBalls );
+	m_tOrder.reserve( nBalls );
+	m_tRemap.reserve( nBalls );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CopyState
+//
+//  Desc: Makes the balls the same as pool's, leaving out the scratch Collide
+//        and RemoveBelow work in, which is never worth keeping. Reuses
+//        whatever room there already is.
+// ----------------------------------------------------------------------------
+void CBallPool::CopyState( const CBallPool& pool )
+{
+	m_tPosX.assign( pool.m_tPosX.begin(), pool.m_tPosX.end() );
+	m_tPosY.assign( pool.m_tPosY.begin(), pool.m_tPosY.end() );
+	m_tVelX.assign( pool.m_tVelX.begin(), pool.m_tVelX.end() );
+	m_tVelY.assign( pool.m_tVelY.begin(), pool.m_tVelY.end() );
+	m_tPrevX.assign( pool.m_tPrevX.begin(), pool.m_tPrevX.end() );
+	m_tPrevY.assign( pool.m_tPrevY.begin(), pool.m_tPrevY.end() );
+	m_tFixX.assign( pool.m_tFixX.begin(), pool.m_tFixX.end() );
+	m_tFixY.assign( pool.m_tFixY.begin(), pool.m_tFixY.end() );
+	m_tFixVelX.assign( pool.m_tFixVelX.begin(), pool.m_tFixVelX.end() );
+	m_tFixVelY.assign( pool.m_tFixVelY.begin(), pool.m_tFixVelY.end() );
+	m_tFree.assign( pool.m_tFree.begin(), pool.m_tFree.end() );
+	m_tOrder.assign( pool.m_tOrder.begin(), pool.m_tOrder.end() );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Add
+//
+//  Desc: Puts a new ball into play. Returns its index.
+// ----------------------------------------------------------------------------
+int CBallPool::Add( float x, float y, float vx, float vy )
+{
+	m_tPosX.push_back( x );
+	m_tPosY.push_back( y );
+	m_tVelX.push_back( vx );
+	m_tVelY.push_back( vy );
+	m_tPrevX.push_back( x );
+	m_tPrevY.push_back( y );
+	m_tFixX.push_back( FixFromFloat( x ) );
+	m_tFixY.push_back( FixFromFloat( y ) );
+	m_tFixVelX.push_back( FixFromFloat( vx ) );
+	m_tFixVelY.push_back( FixFromFloat( vy ) );
+
+	// The next sort moves it to where it goes.
+	m_tOrder.push_back( (int)m_tPosX.size() - 1 );
+
+	return (int)m_tPosX.size() - 1;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: RemoveBelow
+//
+//  Desc: Takes the balls below fY out of play, keeping the rest in order.
+//        Returns how many were removed.
+// ----------------------------------------------------------------------------
+int CBallPool::RemoveBelow( float fY )
+{
+	int i, n = 0, nCount = GetCount();
+
+	m_tRemap.resize( nCount );
+
+	for( i = 0; i < nCount; i++ )
+	{
+		m_tRemap[i] = -1;
+
+		if( m_tPosY[i] < fY ) continue;
+
+		m_tRemap[i] = n;
+
+		m_tPosX[n] = m_tPosX[i];
+		m_tPosY[n] = m_tPosY[i];
+		m_tVelX[n] = m_tVelX[i];
+		m_tVelY[n] = m_tVelY[i];
+		m_tPrevX[n] = m_tPrevX[i];
+		m_tPrevY[n] = m_tPrevY[i];
+		m_tFixX[n] = m_tFixX[i];
+		m_tFixY[n] = m_tFixY[i];
+		m_tFixVelX[n] = m_tFixVelX[i];
+		m_tFixVelY[n] = m_tFixVelY[i];
+		n++;
+	}
+
+	m_tPosX.resize( n );
+	m_tPosY.resize( n );
+	m_tVelX.resize( n );
+	m_tVelY.resize( n );
+	m_tPrevX.resize( n );
+	m_tPrevY.resize( n );
+	m_tFixX.resize( n );
+	m_tFixY.resize( n );
+	m_tFixVelX.resize( n );
+	m_tFixVelY.resize( n );
+
+	// Take them out of the sorted order too, renumbered.
+	if( n < nCount )
+	{
+		for( i = 0, n = 0; i < (int)m_tOrder.size(); i++ )
+		{
+			if( m_tRemap[m_tOrder[i]] >= 0 ) m_tOrder[n++] = m_tRemap[m_tOrder[i]];
+		}
+
+		m_tOrder.resize( n );
+	}
+
+	return nCount - n;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: SavePositions
+//
+//  Desc: Remembers where every ball is, before a step moves them.
+// ----------------------------------------------------------------------------
+void CBallPool::SavePositions()
+{
+	m_tPrevX = m_tPosX;
+	m_tPrevY = m_tPosY;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: MoveFree
+//
+//  Desc: Moves every ball whose path this step stays inside the given box,
+//        where there's nothing for it to hit. The box is for the ball's
+//        center, so the caller shrinks it by the radius. The others are left
+//        where they are and their indices go into pBusy, which needs room for
+//        every ball, for the caller to move one at a time. Returns how many
+//        of those there are.
+// ----------------------------------------------------------------------------
+int CBallPool::MoveFree( float fElapsedTime, float fMinX, float fMinY, float fMaxX, float fMaxY, int* pBusy )
+{
+	float			*pPosX, *pPosY;
+	const float		*pVelX, *pVelY;
+	unsigned char*	pFree;
+	float			x, y, newx, newy;
+	int				i, n = 0, nCount = GetCount();
+	bool			bFree;
+
+	if( !nCount ) return 0;
+
+	m_tFree.resize( nCount );
+
+	pPosX = &m_tPosX[0];
+	pPosY = &m_tPosY[0];
+	pVelX = &m_tVelX[0];
+	pVelY = &m_tVelY[0];
+	pFree = &m_tFree[0];
+
+	// No branches in here, so the compiler can do several balls at once. The
+	// box is convex, so if both ends of the path are inside it all of the
+	// path is.
+	for( i = 0; i < nCount; i++ )
+	{
+		x = pPosX[i];
+		y = pPosY[i];
+
+		newx = x + (pVelX[i] * fElapsedTime);
+		newy = y + (pVelY[i] * fElapsedTime);
+
+		bFree = (x > fMinX) & (newx > fMinX) & (x < fMaxX) & (newx < fMaxX) &
+				(y > fMinY) & (newy > fMinY) & (y < fMaxY) & (newy < fMaxY);
+
+		pPosX[i] = bFree ? newx : x;
+		pPosY[i] = bFree ? newy : y;
+		pFree[i] = (unsigned char)bFree;
+	}
+
+	for( i = 0; i < nCount; i++ )
+	{
+		if( !pFree[i] ) pBusy[n++] = i;
+	}
+
+	return n;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Collide
+//
+//  Desc: Bounces balls of radius r off each other. The floor is cut into
+//        bands one ball across, and the balls are sorted by band and then
+//        left to right. A ball can only touch the balls just after it in its
+//        own band and a short run of the band above, so the sweep tests a
+//        few balls for each whatever the count. Balls that touch and are
+//        closing trade the part of their velocities along the line between
+//        them, as balls of equal weight do. Returns how many bounced.
+// ----------------------------------------------------------------------------
+int CBallPool::Collide( float r )
+{
+	const float	*pPosX, *pPosY;
+	int			*pOrder, *pBand;
+	float		x, fReach = 2.0f * r, fScale = 1.0f / (2.0f * r);
+	int			a, b, c, i, t, nBand, nCount = GetCount();
+	int			n = 0;
+
+	if( nCount < 2 ) return 0;
+
+	m_tBand.resize( nCount );
+
+	pPosX = &m_tPosX[0];
+	pPosY = &m_tPosY[0];
+	pOrder = &m_tOrder[0];
+	pBand = &m_tBand[0];
+
+	for( i = 0; i < nCount; i++ ) pBand[i] = (int)floorf( pPosY[i] * fScale );
+
+	// Put the order from last time right.
+	for( a = 1; a < nCount; a++ )
+	{
+		t = pOrder[a];
+		x = pPosX[t];
+		nBand = pBand[t];
+
+		for( b = a; b > 0; b-- )
+		{
+			i = pOrder[b - 1];
+
+			if( (pBand[i] < nBand) || ((pBand[i] == nBand) && (pPosX[i] <= x)) ) break;
+
+			pOrder[b] = i;
+		}
+
+		pOrder[b] = t;
+	}
+
+	// And sweep. c follows along the band above, at the first ball that
+	// could reach back to the ball at a.
+	for( a = 0, c = 0; a < nCount - 1; a++ )
+	{
+		i = pOrder[a];
+		x = pPosX[i];
+		nBand = pBand[i];
+
+		for( b = a + 1; (b < nCount) && (pBand[pOrder[b]] == nBand) && ((pPosX[pOrder[b]] - x) < fReach); b++ )
+		{
+			n += Bounce( i, pOrder[b], fReach );
+		}
+
+		if( c <= a ) c = a + 1;
+
+		while( (c < nCount) && ((pBand[pOrder[c]] <= nBand) || ((pBand[pOrder[c]] == nBand + 1) && ((x - pPosX[pOrder[c]]) >= fReach))) ) c++;
+
+		for( b = c; (b < nCount) && (pBand[pOrder[b]] == nBand + 1) && ((pPosX[pOrder[b]] - x) < fReach); b++ )
+		{
+			n += Bounce( i, pOrder[b], fReach );
+		}
+	}
+
+	return n;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Bounce
+//
+//  Desc: Bounces two balls off each other if they're closer than fReach
+//        and closing. Returns 1 if they bounced.
+// ----------------------------------------------------------------------------
+int CBallPool::Bounce( int i, int j, float fReach )
+{
+	float dx, dy, d, p, nx, ny;
+
+	dx = m_tPosX[j] - m_tPosX[i];
+	dy = m_tPosY[j] - m_tPosY[i];
+
+	d = (dx * dx) + (dy * dy);
+
+	if( (d >= fReach * fReach) || (d == 0.0f) ) return 0;
+
+	// Only balls that are closing bounce. Ones already parting are left to
+	// carry on apart.
+	p = (dx * (m_tVelX[j] - m_tVelX[i])) + (dy * (m_tVelY[j] - m_tVelY[i]));
+
+	if( p >= 0.0f ) return 0;
+
+	d = sqrtf( d );
+	nx = dx / d;
+	ny = dy / d;
+	p /= d;
+
+	m_tVelX[i] += p * nx;
+	m_tVelY[i] += p * ny;
+	m_tVelX[j] -= p * nx;
+	m_tVelY[j] -= p * ny;
+
+	return 1;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetCount
+//
+//  Desc: Returns how many balls are in play.
+// ----------------------------------------------------------------------------
+int CBallPool::GetCount() const
+{
+	return (int)m_tPosX.size();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetBytes
+//
+//  Desc: Returns how much memory the balls take up, scratch and all, as
+//        allocated rather than as used.
+// ----------------------------------------------------------------------------
+size_t CBallPool::GetBytes() const
+{
+	size_t nBytes;
+
+	nBytes = (m_tPosX.capacity() + m_tPosY.capacity() + m_tVelX.capacity() + m_tVelY.capacity()) * sizeof(float);
+	nBytes += (m_tPrevX.capacity() + m_tPrevY.capacity()) * sizeof(float);
+	nBytes += (m_tFixX.capacity() + m_tFixY.capacity() + m_tFixVelX.capacity() + m_tFixVelY.capacity()) * sizeof(FIXED);
+	nBytes += m_tFree.capacity() * sizeof(unsigned char);
+	nBytes += (m_tOrder.capacity() + m_tBand.capacity() + m_tRemap.capacity()) * sizeof(int);
+
+	return nBytes;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetX
+//
+//  Desc: Returns the horizontal position of the given ball.
+// ----------------------------------------------------------------------------
+float CBallPool::GetX( int i ) const
+{
+	return m_tPosX[i];
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetY
+//
+//  Desc: Returns the vertical position of the given ball.
+// ----------------------------------------------------------------------------
+float CBallPool::GetY( int i ) const
+{
+	return m_tPosY[i];
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetVelX
+//
+//  Desc: Returns the horizontal velocity of the given ball.
+// ----------------------------------------------------------------------------
+float CBallPool::GetVelX( int i ) const
+{
+	return m_tVelX[i];
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetVelY
+//
+//  Desc: Returns the vertical velocity of the given ball.
+// ----------------------------------------------------------------------------
+float CBallPool::GetVelY( int i ) const
+{
+	return m_tVelY[i];
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetPrevX
+//
+//  Desc: Returns where the given ball was horizontally before the last step.
+// ----------------------------------------------------------------------------
+float CBallPool::GetPrevX( int i ) const
+{
+	return m_tPrevX[i];
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetPrevY
+//
+//  Desc: Returns where the given ball was vertically before the last step.
+// ----------------------------------------------------------------------------
+float CBallPool::GetPrevY( int i ) const
+{
+	return m_tPrevY[i];
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: SetPos
+//
+//  Desc: Moves the given ball.
+// ----------------------------------------------------------------------------
+void CBallPool::SetPos( int i, float x, float y )
+{
+	m_tPosX[i] = x;
+	m_tPosY[i] = y;
+	m_tFixX[i] = FixFromFloat( x );
+	m_tFixY[i] = FixFromFloat( y );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: SetVel
+//
+//  Desc: Changes the velocity of the given ball.
+// ----------------------------------------------------------------------------
+void CBallPool::SetVel( int i, float vx, float vy )
+{
+	m_tVelX[i] = vx;
+	m_tVelY[i] = vy;
+	m_tFixVelX[i] = FixFromFloat( vx );
+	m_tFixVelY[i] = FixFromFloat( vy );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetFixedPos
+//
+//  Desc: Returns the position of the given ball in fixed point.
+// ----------------------------------------------------------------------------
+FVEC2 CBallPool::GetFixedPos( int i ) const
+{
+	FVEC2 vPos;
+
+	vPos.x = m_tFixX[i];
+	vPos.y = m_tFixY[i];
+
+	return vPos;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetFixedVel
+//
+//  Desc: Returns the velocity of the given ball in fixed point.
+// ----------------------------------------------------------------------------
+FVEC2 CBallPool::GetFixedVel( int i ) const
+{
+	FVEC2 vVel;
+
+	vVel.x = m_tFixVelX[i];
+	vVel.y = m_tFixVelY[i];
+
+	return vVel;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: SetFixed
+//
+//  Desc: Moves the given ball and changes its velocity, in fixed point. The
+//        floats are set to match, as near as they come.
+// ----------------------------------------------------------------------------
+void CBallPool::SetFixed( int i, FVEC2 vPos, FVEC2 vVel )
+{
+	m_tFixX[i] = vPos.x;
+	m_tFixY[i] = vPos.y;
+	m_tFixVelX[i] = vVel.x;
+	m_tFixVelY[i] = vVel.y;
+
+	m_tPosX[i] = FixToFloat( vPos.x );
+	m_tPosY[i] = FixToFloat( vPos.y );
+	m_tVelX[i] = FixToFloat( vVel.x );
+	m_tVelY[i] = FixToFloat( vVel.y );
+}
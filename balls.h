@@ -0,0 +1,81 @@
+// ----------------------------------------------------------------------------
+//  Filename: balls.h
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+#pragma once
+
+// Every ball in play. Positions and velocities are kept in their own
+// contiguous arrays so a step can run down all of them in one pass. Balls
+// keep their order when others are removed, so ball 0 is always the oldest
+// one still in play.
+//
+// The balls are also kept sorted, in bands from the bottom up and left to
+// right along each band, for finding the ones that touch each other. Balls
+// only move a little in a step, so the order from the last step is nearly
+// right and an insertion sort puts it back in about one pass.
+//
+// Each ball is kept in fixed point as well, for the board's fixed mode to
+// carry from one step to the next. A float only holds Q16.16 exactly this
+// side of 256, and big levels go well past that. Setting a ball as floats
+// sets its fixed point copy too, but MoveFree and Collide only move the
+// floats, so the copy is only kept up while the board is in fixed mode.
+class CBallPool
+{
+protected:
+	vector<float>			m_tPosX;
+	vector<float>			m_tPosY;
+	vector<float>			m_tVelX;
+	vector<float>			m_tVelY;
+
+	// Where each ball was at the start of the last step, for drawing in
+	// between steps.
+	vector<float>			m_tPrevX;
+	vector<float>			m_tPrevY;
+
+	vector<FIXED>			m_tFixX;
+	vector<FIXED>			m_tFixY;
+	vector<FIXED>			m_tFixVelX;
+	vector<FIXED>			m_tFixVelY;
+
+	vector<unsigned char>	m_tFree;
+
+	vector<int>				m_tOrder;		// Balls in order, as of the last sort.
+	vector<int>				m_tBand;		// Scratch for Collide.
+	vector<int>				m_tRemap;		// Scratch for RemoveBelow.
+
+protected:
+	int		Bounce( int i, int j, float fReach );
+
+public:
+	CBallPool();
+	virtual ~CBallPool();
+
+	void	Clear();
+	void	Reserve( int nBalls );
+	void	CopyState( const CBallPool& pool );
+	int		Add( float x, float y, float vx, float vy );
+	int		RemoveBelow( float fY );
+	void	SavePositions();
+
+	int		MoveFree( float fElapsedTime, float fMinX, float fMinY, float fMaxX, float fMaxY, int* pBusy );
+	int		Collide( float r );
+
+	int		GetCount() const;
+	size_t	GetBytes() const;
+
+	float	GetX( int i ) const;
+	float	GetY( int i ) const;
+	float	GetVelX( int i ) const;
+	float	GetVelY( int i ) const;
+	float	GetPrevX( int i ) const;
+	float	GetPrevY( int i ) const;
+
+	void	SetPos( int i, float x, float y );
+	void	SetVel( int i, float vx, float vy );
+
+	FVEC2	GetFixedPos( int i ) const;
+	FVEC2	GetFixedVel( int i ) const;
+	void	SetFixed( int i, FVEC2 vPos, FVEC2 vVel );
+};
@@ -0,0 +1,309 @@
+// ----------------------------------------------------------------------------
+//  Filename: batch.cpp
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+
+
+
+
+// Preprocessor directives.
+#include "sim.h"
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CPaddleBot
+//
+//  Desc: Constructor
+// ----------------------------------------------------------------------------
+CPaddleBot::CPaddleBot()
+{
+	m_nMaxCounts	= 40;
+	m_fAimError		= 0.0f;
+	m_nReaction		= 60;
+	m_fOffset		= 0.0f;
+	m_nCountdown	= 0;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: ~CPaddleBot
+//
+//  Desc: Destructor
+// ----------------------------------------------------------------------------
+CPaddleBot::~CPaddleBot()
+{
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Init
+//
+//  Desc: Sets the player up for a new game.
+// ----------------------------------------------------------------------------
+void CPaddleBot::Init( unsigned int nSeed, int nMaxCounts, float fAimError, int nReaction )
+{
+	m_Random.Seed( nSeed );
+
+	m_nMaxCounts = nMaxCounts;
+	m_fAimError = fAimError;
+	m_nReaction = (nReaction > 0) ? nReaction : 1;
+
+	m_fOffset = 0.0f;
+	m_nCountdown = 0;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Think
+//
+//  Desc: Decides how far to move the mouse this step.
+// ----------------------------------------------------------------------------
+int CPaddleBot::Think( const CBoard* pBoard )
+{
+	const CBallPool*	pBalls = pBoard->GetBalls();
+	int					i, n, nLowest = 0;
+
+	if( !pBalls->GetCount() ) return 0;
+
+	if( --m_nCountdown <= 0 )
+	{
+		m_fOffset = m_Random.Float( -m_fAimError, m_fAimError );
+		m_nCountdown = m_Random.Range( m_nReaction / 2, m_nReaction + (m_nReaction / 2) );
+	}
+
+	for( i = 1; i < pBalls->GetCount(); i++ )
+	{
+		if( pBalls->GetY( i ) < pBalls->GetY( nLowest ) ) nLowest = i;
+	}
+
+	n = (int)((pBalls->GetX( nLowest ) + m_fOffset - pBoard->GetPaddlePos().x) / pBoard->GetMouseScale());
+
+	if( n > m_nMaxCounts ) n = m_nMaxCounts;
+	if( n < -m_nMaxCounts ) n = -m_nMaxCounts;
+
+	return n;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CBatchRunner
+//
+//  Desc: Constructor
+// ----------------------------------------------------------------------------
+CBatchRunner::CBatchRunner()
+{
+	m_pLevel		= NULL;
+	m_nLives		= 3;
+	m_nMaxSteps		= 120 * 60 * 10;
+	m_fAimError		= 0.3f;
+	m_CollisionMode	= CollideDiscrete;
+	m_dSeconds		= 0.0;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: ~CBatchRunner
+//
+//  Desc: Destructor
+// ----------------------------------------------------------------------------
+CBatchRunner::~CBatchRunner()
+{
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: SetLives
+//
+//  Desc: Sets how many balls each board gets.
+// ----------------------------------------------------------------------------
+void CBatchRunner::SetLives( int nLives )
+{
+	m_nLives = nLives;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: SetMaxSteps
+//
+//  Desc: Sets how long a board may play before it's stopped.
+// ----------------------------------------------------------------------------
+void CBatchRunner::SetMaxSteps( int nMaxSteps )
+{
+	m_nMaxSteps = nMaxSteps;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: SetAimError
+//
+//  Desc: Sets how far off the players may aim. 0 never misses.
+// ----------------------------------------------------------------------------
+void CBatchRunner::SetAimError( float fAimError )
+{
+	m_fAimError = fAimError;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: SetCollisionMode
+//
+//  Desc: Picks the collision mode every board uses.
+// ----------------------------------------------------------------------------
+void CBatchRunner::SetCollisionMode( CollisionMode mode )
+{
+	m_CollisionMode = mode;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Run
+//
+//  Desc: Plays nBoards games of the level to the end, spread over the pool,
+//        and waits for them all to finish.
+// ----------------------------------------------------------------------------
+bool CBatchRunner::Run( CThreadPool* pPool, const CLevel* pLevel, int nBoards, unsigned int nSeed )
+{
+	chrono::steady_clock::time_point tStart;
+
+	if( !pPool || !pLevel || (nBoards <= 0) ) return false;
+
+	m_pLevel = pLevel;
+	m_tResults.assign( nBoards, BATCHRESULT() );
+
+	tStart = chrono::steady_clock::now();
+
+	// One task per board. Games run for very different lengths, which is
+	// what the stealing is for.
+	for( int i = 0; i < nBoards; i++ )
+	{
+		pPool->Submit( bind( &CBatchRunner::PlayBoard, this, i, nSeed + (unsigned int)i ) );
+	}
+
+	pPool->Wait();
+
+	m_dSeconds = chrono::duration<double>( chrono::steady_clock::now() - tStart ).count();
+
+	return true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: PlayBoard
+//
+//  Desc: Plays one board of the batch. Runs on a worker thread and only
+//        touches its own result.
+// ----------------------------------------------------------------------------
+void CBatchRunner::PlayBoard( int i, unsigned int nSeed )
+{
+	CBoard		board;
+	CPaddleBot	bot;
+	BOARDINPUT	input;
+	BATCHRESULT	result;
+
+	board.SetLives( m_nLives );
+	board.SetCollisionMode( m_CollisionMode );
+	board.Reset( m_pLevel );
+
+	bot.Init( nSeed, 40, m_fAimError, 60 );
+
+	while( (board.GetState() == BoardPlaying) && ((int)board.GetSteps() < m_nMaxSteps) )
+	{
+		input.nMouseX = bot.Think( &board );
+
+		board.Step( input );
+	}
+
+	result.nSeed = nSeed;
+	result.State = board.GetState();
+	result.nScore = board.GetScore();
+	result.nSteps = board.GetSteps();
+	result.fClearTime = (result.State == BoardCleared) ? (board.GetSteps() * board.GetTimeStep()) : -1.0f;
+	result.nLivesLost = board.GetLivesLost();
+
+	m_tResults[i] = result;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetBoardCount
+//
+//  Desc: Returns how many boards the last batch played.
+// ----------------------------------------------------------------------------
+int CBatchRunner::GetBoardCount() const
+{
+	return (int)m_tResults.size();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetResult
+//
+//  Desc: Returns how the given board came out.
+// ----------------------------------------------------------------------------
+const BATCHRESULT* CBatchRunner::GetResult( int i ) const
+{
+	return &m_tResults[i];
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetTotalSteps
+//
+//  Desc: Returns how many steps all the boards took between them.
+// ----------------------------------------------------------------------------
+double CBatchRunner::GetTotalSteps() const
+{
+	double dSteps = 0.0;
+
+	for( size_t i = 0; i < m_tResults.size(); i++ )
+	{
+		dSteps += m_tResults[i].nSteps;
+	}
+
+	return dSteps;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetSeconds
+//
+//  Desc: Returns how long the last batch took, wall clock.
+// ----------------------------------------------------------------------------
+double CBatchRunner::GetSeconds() const
+{
+	return m_dSeconds;
+}
@@ -0,0 +1,77 @@
+// ----------------------------------------------------------------------------
+//  Filename: batch.h
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+#pragma once
+
+// Synthetic player for headless runs. It chases the lowest ball, but aims
+// off by a random amount it picks again every so often, so it misses now
+// and then like a person would.
+class CPaddleBot
+{
+protected:
+	CRandom		m_Random;
+
+	int			m_nMaxCounts;	// Fastest it can move the mouse in one step.
+	float		m_fAimError;	// Largest distance it aims off the ball.
+	int			m_nReaction;	// Steps between picking a new aim.
+
+	float		m_fOffset;
+	int			m_nCountdown;
+
+public:
+	CPaddleBot();
+	virtual ~CPaddleBot();
+
+	void	Init( unsigned int nSeed, int nMaxCounts, float fAimError, int nReaction );
+	int		Think( const CBoard* pBoard );
+};
+
+// How one board in a batch came out.
+struct BATCHRESULT
+{
+	unsigned int	nSeed;
+	BoardState		State;
+	unsigned int	nScore;
+	unsigned int	nSteps;
+	float			fClearTime;		// Seconds of play to clear the level, or -1.
+	int				nLivesLost;
+};
+
+// Plays many independent boards at once on a thread pool. Every board has
+// its own state and its own player, seeded from the batch seed and its
+// index, so a batch gives the same results however many threads run it.
+class CBatchRunner
+{
+protected:
+	const CLevel*			m_pLevel;
+
+	int						m_nLives;
+	int						m_nMaxSteps;
+	float					m_fAimError;
+	CollisionMode			m_CollisionMode;
+
+	vector<BATCHRESULT>		m_tResults;
+	double					m_dSeconds;
+
+protected:
+	void	PlayBoard( int i, unsigned int nSeed );
+
+public:
+	CBatchRunner();
+	virtual ~CBatchRunner();
+
+	void	SetLives( int nLives );
+	void	SetMaxSteps( int nMaxSteps );
+	void	SetAimError( float fAimError );
+	void	SetCollisionMode( CollisionMode mode );
+
+	bool	Run( CThreadPool* pPool, const CLevel* pLevel, int nBoards, unsigned int nSeed );
+
+	int					GetBoardCount() const;
+	const BATCHRESULT*	GetResult( int i ) const;
+	double				GetTotalSteps() const;
+	double				GetSeconds() const;
+};
@@ -0,0 +1,2362 @@
+// ----------------------------------------------------------------------------
+//  Filename: board.cpp
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+
+
+
+
+// Preprocessor directives.
+#include "sim.h"
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: VecNormalize
+//
+//  Desc: Normalizes a vector.
+// ----------------------------------------------------------------------------
+static VEC2 VecNormalize( VEC2 v )
+{
+	float	fMag;
+	VEC2	r;
+
+	// The simple distance formula.
+	fMag = sqrtf( (v.x * v.x) + (v.y * v.y) );
+
+	// Normal of a vector is the components divided by the magnitude.
+	r.x = r.y = 0.0f;
+
+	if( fMag )
+	{
+		r.x = v.x / fMag;
+		r.y = v.y / fMag;
+	}
+
+	return r;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: VecDot
+//
+//  Desc: Computes the dot product of two vectors.
+// ----------------------------------------------------------------------------
+static float VecDot( VEC2 v1, VEC2 v2 )
+{
+	// Can't any simpler than this.
+	return (v1.x * v2.x) + (v1.y * v2.y);
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: VecTurn
+//
+//  Desc: Turns a vector anticlockwise by the angle with the given cosine and
+//        sine.
+// ----------------------------------------------------------------------------
+static inline VEC2 VecTurn( VEC2 v, float c, float s )
+{
+	VEC2 r;
+
+	r.x = (v.x * c) - (v.y * s);
+	r.y = (v.x * s) + (v.y * c);
+
+	return r;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: BrickContains
+//
+//  Desc: Checks whether a point lies inside the brick centered at bx, by.
+// ----------------------------------------------------------------------------
+static inline bool BrickContains( float bx, float by, float x, float y )
+{
+	return (y <= (by + BRICK_HALF_HEIGHT)) && (y >= (by - BRICK_HALF_HEIGHT)) && (x >= (bx - BRICK_HALF_WIDTH)) && (x <= (bx + BRICK_HALF_WIDTH));
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: BrickContainsFixed
+//
+//  Desc: Fixed point version of BrickContains.
+// ----------------------------------------------------------------------------
+static inline bool BrickContainsFixed( FVEC2 b, FIXED x, FIXED y )
+{
+	const FIXED hw = FixFromFloat( BRICK_HALF_WIDTH );
+	const FIXED hh = FixFromFloat( BRICK_HALF_HEIGHT );
+
+	return (y <= (b.y + hh)) && (y >= (b.y - hh)) && (x >= (b.x - hw)) && (x <= (b.x + hw));
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: FloorDiv
+//
+//  Desc: Divides two whole numbers, rounding down rather than towards zero.
+//        b must be positive.
+// ----------------------------------------------------------------------------
+static inline int FloorDiv( int a, int b )
+{
+	return (a >= 0) ? (a / b) : -((b - 1 - a) / b);
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: SweepBox
+//
+//  Desc: Finds when a ball of radius r moving from p by d first touches the
+//        box centered at c with half extents hw, hh. This is a ray cast
+//        against the box grown by r with rounded corners. Only contacts the
+//        ball is moving into count. Returns false if there is none in
+//        [0, *t), otherwise the time of impact goes in *t and the surface
+//        normal in *n.
+// ----------------------------------------------------------------------------
+static bool SweepBox( VEC2 p, VEC2 d, VEC2 c, float hw, float hh, float r, float* t, VEC2* n )
+{
+	float	x, y, ex, ey;
+	float	tx0, tx1, ty0, ty1;
+	float	tEnter, tExit, tHit;
+	float	a, b, cc, disc, fLen;
+	VEC2	m, hit;
+
+	// Work relative to the center of the box.
+	x = p.x - c.x;
+	y = p.y - c.y;
+
+	ex = hw + r;
+	ey = hh + r;
+
+	if( (fabsf( x ) <= ex) && (fabsf( y ) <= ey) )
+	{
+		// Already touching? That only counts if the ball is heading in.
+		m.x = x - max( -hw, min( hw, x ) );
+		m.y = y - max( -hh, min( hh, y ) );
+
+		fLen = sqrtf( (m.x * m.x) + (m.y * m.y) );
+
+		if( fLen <= r )
+		{
+			if( fLen > 0.0f )
+			{
+				m.x /= fLen;
+				m.y /= fLen;
+			}
+			else if( (hw - fabsf( x )) < (hh - fabsf( y )) )
+			{
+				// The center is inside the box. Push out the shallow way.
+				m.x = (x < 0.0f) ? -1.0f : 1.0f;
+				m.y = 0.0f;
+			}
+			else
+			{
+				m.x = 0.0f;
+				m.y = (y < 0.0f) ? -1.0f : 1.0f;
+			}
+
+			if( ((d.x * m.x) + (d.y * m.y)) >= 0.0f ) return false;
+
+			*t = 0.0f;
+			*n = m;
+
+			return true;
+		}
+
+		// Inside the grown box but not touching means the ball starts out in
+		// one of the rounded corners.
+		hit.x = x;
+		hit.y = y;
+	}
+	else
+	{
+		// Slab test against the grown box.
+		if( d.x != 0.0f )
+		{
+			tx0 = (-ex - x) / d.x;
+			tx1 = (ex - x) / d.x;
+			if( tx0 > tx1 ) swap( tx0, tx1 );
+		}
+		else
+		{
+			if( fabsf( x ) > ex ) return false;
+			tx0 = -1.0e30f;
+			tx1 = 1.0e30f;
+		}
+
+		if( d.y != 0.0f )
+		{
+			ty0 = (-ey - y) / d.y;
+			ty1 = (ey - y) / d.y;
+			if( ty0 > ty1 ) swap( ty0, ty1 );
+		}
+		else
+		{
+			if( fabsf( y ) > ey ) return false;
+			ty0 = -1.0e30f;
+			ty1 = 1.0e30f;
+		}
+
+		tEnter = max( tx0, ty0 );
+		tExit = min( tx1, ty1 );
+
+		if( (tEnter > tExit) || (tEnter < 0.0f) || (tEnter >= *t) ) return false;
+
+		hit.x = x + (d.x * tEnter);
+		hit.y = y + (d.y * tEnter);
+
+		// Hitting one of the flat sides?
+		if( (tx0 >= ty0) && (fabsf( hit.y ) <= hh) )
+		{
+			n->x = (d.x > 0.0f) ? -1.0f : 1.0f;
+			n->y = 0.0f;
+			*t = tEnter;
+
+			return true;
+		}
+
+		if( (ty0 > tx0) && (fabsf( hit.x ) <= hw) )
+		{
+			n->x = 0.0f;
+			n->y = (d.y > 0.0f) ? -1.0f : 1.0f;
+			*t = tEnter;
+
+			return true;
+		}
+	}
+
+	// Otherwise it came in over a corner, where the grown box is rounded.
+	// Solve |m + d * t| = r for the corner.
+	m.x = x - ((hit.x < 0.0f) ? -hw : hw);
+	m.y = y - ((hit.y < 0.0f) ? -hh : hh);
+
+	a = (d.x * d.x) + (d.y * d.y);
+	b = 2.0f * ((m.x * d.x) + (m.y * d.y));
+	cc = (m.x * m.x) + (m.y * m.y) - (r * r);
+
+	disc = (b * b) - (4.0f * a * cc);
+	if( disc < 0.0f ) return false;
+
+	tHit = (-b - sqrtf( disc )) / (2.0f * a);
+	if( (tHit < 0.0f) || (tHit >= *t) ) return false;
+
+	n->x = (m.x + (d.x * tHit)) / r;
+	n->y = (m.y + (d.y * tHit)) / r;
+	*t = tHit;
+
+	return true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: SweepWall
+//
+//  Desc: Finds when a ball at position p moving by d along one axis reaches
+//        the plane at fWall, given the direction the wall faces (-1 or 1).
+// ----------------------------------------------------------------------------
+static bool SweepWall( float p, float d, float fWall, float fFacing, float* t )
+{
+	float tHit;
+
+	// Only count walls the ball is moving towards.
+	if( (d * fFacing) >= 0.0f ) return false;
+
+	tHit = (fWall - p) / d;
+	if( tHit < 0.0f ) tHit = 0.0f;
+
+	if( tHit >= *t ) return false;
+
+	*t = tHit;
+
+	return true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CBoard
+//
+//  Desc: Constructor
+// ----------------------------------------------------------------------------
+CBoard::CBoard()
+{
+	m_nColumns		= 0;
+	m_nRows			= 0;
+	m_fOriginX		= BRICK_ORIGIN_X;
+	m_fOriginY		= BRICK_ORIGIN_Y;
+	m_fWallLeft		= WALL_LEFT;
+	m_fWallRight	= WALL_RIGHT;
+	m_fWallTop		= WALL_TOP;
+	m_fWallBottom	= WALL_BOTTOM;
+	m_fPaddleTravel	= PADDLE_TRAVEL;
+	m_fMouseScale	= PADDLE_MOUSE_SCALE;
+	m_fBallRadius	= BALL_RADIUS;
+	m_vLaunch.x		= BALL_LAUNCH_X;
+	m_vLaunch.y		= BALL_LAUNCH_Y;
+	m_qOriginX		= FixFromFloat( BRICK_ORIGIN_X );
+	m_qOriginY		= FixFromFloat( BRICK_ORIGIN_Y );
+	m_qWallLeft		= FixFromFloat( WALL_LEFT );
+	m_qWallRight	= FixFromFloat( WALL_RIGHT );
+	m_qWallTop		= FixFromFloat( WALL_TOP );
+	m_qWallBottom	= FixFromFloat( WALL_BOTTOM );
+	m_qPaddleTravel	= FixFromFloat( PADDLE_TRAVEL );
+	m_qMouseScale	= FixFromFloat( PADDLE_MOUSE_SCALE );
+	m_qBallRadius	= FixFromFloat( BALL_RADIUS );
+	m_fTimeStep		= BOARD_TIMESTEP;
+	m_fSecondCount	= 0.0f;
+	m_nBallTimer	= 0;
+	m_nScore		= 0;
+	m_nSteps		= 0;
+	m_nLives		= 1;
+	m_nLivesLost	= 0;
+	m_State			= BoardLost;
+	m_Broadphase	= BroadphaseGrid;
+	m_CollisionMode	= CollideDiscrete;
+	m_bBallCollisions = true;
+
+	m_vPaddlePos.x = m_vPaddlePos.y = 0.0f;
+	m_vPrevPaddlePos = m_vPaddlePos;
+	m_vBallPos.x = m_vBallPos.y = 0.0f;
+	m_vBallVel.x = m_vBallVel.y = 0.0f;
+
+	m_qPaddlePos.x = m_qPaddlePos.y = 0;
+	m_qBallPos.x = m_qBallPos.y = 0;
+	m_qBallVel.x = m_qBallVel.y = 0;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: ~CBoard
+//
+//  Desc: Destructor
+// ----------------------------------------------------------------------------
+CBoard::~CBoard()
+{
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Reset
+//
+//  Desc: Sets the board up to play the given level from the start.
+// ----------------------------------------------------------------------------
+void CBoard::Reset( const CLevel* pLevel )
+{
+	float	fExtraX, fExtraY;
+	int		nExtraX, nExtraY;
+
+	m_nColumns = pLevel->GetColumns();
+	m_nRows = pLevel->GetRows();
+
+	// Lay the field out around the level.
+	fExtraX = (m_nColumns > LEVEL_COLUMNS) ? (BRICK_PITCH_X * (m_nColumns - LEVEL_COLUMNS)) : 0.0f;
+	fExtraY = (m_nRows > LEVEL_ROWS) ? (BRICK_PITCH_Y * (m_nRows - LEVEL_ROWS)) : 0.0f;
+
+	m_fOriginX = BRICK_ORIGIN_X - (fExtraX * 0.5f);
+	m_fOriginY = BRICK_ORIGIN_Y + fExtraY;
+
+	m_fWallLeft = WALL_LEFT - (fExtraX * 0.5f);
+	m_fWallRight = WALL_RIGHT + (fExtraX * 0.5f);
+	m_fWallTop = WALL_TOP + fExtraY;
+	m_fWallBottom = WALL_BOTTOM;
+
+	m_fPaddleTravel = PADDLE_TRAVEL + (fExtraX * 0.5f);
+
+	// The same sweep of the mouse crosses the field however wide it is.
+	m_fMouseScale = PADDLE_MOUSE_SCALE * ((m_fWallRight - m_fWallLeft) / (WALL_RIGHT - WALL_LEFT));
+
+	// And again in fixed point, working from whole numbers of bricks so
+	// nothing depends on how the floats came out.
+	nExtraX = (m_nColumns > LEVEL_COLUMNS) ? (m_nColumns - LEVEL_COLUMNS) : 0;
+	nExtraY = (m_nRows > LEVEL_ROWS) ? (m_nRows - LEVEL_ROWS) : 0;
+
+	m_qOriginX = FixFromFloat( BRICK_ORIGIN_X ) - ((FixFromFloat( BRICK_PITCH_X ) * nExtraX) / 2);
+	m_qOriginY = FixFromFloat( BRICK_ORIGIN_Y ) + (FixFromFloat( BRICK_PITCH_Y ) * nExtraY);
+
+	m_qWallLeft = FixFromFloat( WALL_LEFT ) - ((FixFromFloat( BRICK_PITCH_X ) * nExtraX) / 2);
+	m_qWallRight = FixFromFloat( WALL_RIGHT ) + ((FixFromFloat( BRICK_PITCH_X ) * nExtraX) / 2);
+	m_qWallTop = FixFromFloat( WALL_TOP ) + (FixFromFloat( BRICK_PITCH_Y ) * nExtraY);
+	m_qWallBottom = FixFromFloat( WALL_BOTTOM );
+
+	m_qPaddleTravel = FixFromFloat( PADDLE_TRAVEL ) + ((FixFromFloat( BRICK_PITCH_X ) * nExtraX) / 2);
+	m_qMouseScale = (FIXED)(((int64_t)FixFromFloat( PADDLE_MOUSE_SCALE ) * (m_qWallRight - m_qWallLeft)) /
+							(FixFromFloat( WALL_RIGHT ) - FixFromFloat( WALL_LEFT )));
+
+	// Copy the bricks out of the level. Levels that move come with a tree
+	// over their bricks, others only get one if it's been asked for.
+	m_Bricks.Build( pLevel, m_fOriginX, m_fOriginY );
+
+	if( (m_Broadphase == BroadphaseTree) && !m_Bricks.HasTree() ) m_Bricks.BuildTree();
+	if( m_CollisionMode != CollideFixed ) m_Bricks.Animate( 0.0f );
+
+	m_tHits.resize( m_nColumns );
+
+	// Set up the ball and paddle.
+	m_vPaddlePos.x = 0.0f;
+	m_vPaddlePos.y = PADDLE_START_Y;
+
+	m_vPrevPaddlePos = m_vPaddlePos;
+
+	m_qPaddlePos.x = 0;
+	m_qPaddlePos.y = FixFromFloat( PADDLE_START_Y );
+
+	m_fBallRadius = BALL_RADIUS;
+	m_qBallRadius = FixFromFloat( BALL_RADIUS );
+
+	m_Balls.Clear();
+	ServeBall();
+
+	m_nScore = 0;
+	m_nSteps = 0;
+	m_nLivesLost = 0;
+
+	m_tEvents.clear();
+
+	m_State = BoardPlaying;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: ServeBall
+//
+//  Desc: Puts a new ball on the paddle. It takes off once the launch delay
+//        has passed.
+// ----------------------------------------------------------------------------
+void CBoard::ServeBall()
+{
+	int i;
+
+	m_vBallPos.x = m_vPaddlePos.x;
+	m_vBallPos.y = m_vPaddlePos.y + PADDLE_HALF_HEIGHT + BALL_RADIUS + 0.001f;
+
+	if( m_CollisionMode == CollideFixed )
+	{
+		m_qBallPos.x = m_qPaddlePos.x;
+		m_qBallPos.y = m_qPaddlePos.y + FixFromFloat( PADDLE_HALF_HEIGHT ) + FixFromFloat( BALL_RADIUS ) + FixFromFloat( 0.001f );
+
+		m_vBallPos.x = FixToFloat( m_qBallPos.x );
+		m_vBallPos.y = FixToFloat( m_qBallPos.y );
+	}
+
+	m_vBallVel.x = m_vBallVel.y = 0.0f;
+
+	i = m_Balls.Add( m_vBallPos.x, m_vBallPos.y, m_vBallVel.x, m_vBallVel.y );
+
+	if( m_CollisionMode == CollideFixed )
+	{
+		m_qBallVel.x = m_qBallVel.y = 0;
+		m_Balls.SetFixed( i, m_qBallPos, m_qBallVel );
+	}
+
+	m_fSecondCount = 0.0f;
+	m_nBallTimer = 0;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Step
+//
+//  Desc: Advances the board by one fixed time step. Processes ball and
+//        paddle movement as well as collisions.
+// ----------------------------------------------------------------------------
+BoardState CBoard::Step( const BOARDINPUT& input )
+{
+	float fLose;
+
+	if( m_State != BoardPlaying ) return m_State;
+
+	// Only this step's bricks are reported.
+	m_tEvents.clear();
+
+	// Remember where everything was, so it can be drawn part way through the
+	// step.
+	m_vPrevPaddlePos = m_vPaddlePos;
+	m_Balls.SavePositions();
+
+	// Position the paddle.
+	MovePaddle( input.nMouseX );
+
+	// Move the bricks to where they are at the end of the step, and so where
+	// the balls are tested against them. Fixed mode leaves them in their
+	// slots, it can't follow them out bit for bit.
+	if( m_CollisionMode != CollideFixed ) m_Bricks.Animate( (float)(m_nSteps + 1) * m_fTimeStep );
+
+	// Move the balls.
+	MoveBalls( m_fTimeStep );
+
+	// Then bounce them off each other.
+	if( m_bBallCollisions && (m_CollisionMode != CollideFixed) ) m_Balls.Collide( m_fBallRadius );
+
+	// Balls that fell past the paddle are out of play. Losing the last one
+	// costs a life, and the game once there are none left.
+	fLose = m_vPaddlePos.y - PADDLE_LOSE_DEPTH;
+	if( m_CollisionMode == CollideFixed ) fLose = FixToFloat( m_qPaddlePos.y - FixFromFloat( PADDLE_LOSE_DEPTH ) );
+
+	m_Balls.RemoveBelow( fLose );
+
+	if( !m_Balls.GetCount() )
+	{
+		m_nLivesLost++;
+
+		if( m_nLivesLost >= m_nLives )
+		{
+			m_State = BoardLost;
+		}
+		else
+		{
+			ServeBall();
+		}
+	}
+
+	// End the game if all the bricks have been destroyed.
+	if( !m_Bricks.GetLive() ) m_State = BoardCleared;
+
+	m_fSecondCount += m_fTimeStep;
+
+	if( m_fSecondCount >= 1.0f )
+	{
+		// Increase the ball start timer.
+		m_nBallTimer++;
+
+		m_fSecondCount = 0.0f;
+	}
+
+	if( (m_nBallTimer == BALL_LAUNCH_DELAY) && m_Balls.GetCount() )
+	{
+		// If enough time has passed, then start the first ball moving.
+		m_Balls.SetVel( 0, m_vLaunch.x, m_vLaunch.y );
+	}
+
+	m_nSteps++;
+
+	return m_State;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: SaveState
+//
+//  Desc: Takes a snapshot of the board between steps. The bricks are shared
+//        with the last snapshot where nothing has changed since.
+// ----------------------------------------------------------------------------
+void CBoard::SaveState( BOARDSNAPSHOT* pSnapshot )
+{
+	pSnapshot->nSteps = m_nSteps;
+	pSnapshot->nScore = m_nScore;
+	pSnapshot->nLivesLost = m_nLivesLost;
+	pSnapshot->State = m_State;
+
+	pSnapshot->vPaddlePos = m_vPaddlePos;
+	pSnapshot->vPrevPaddlePos = m_vPrevPaddlePos;
+	pSnapshot->qPaddlePos = m_qPaddlePos;
+	pSnapshot->vBallPos = m_vBallPos;
+	pSnapshot->vBallVel = m_vBallVel;
+
+	pSnapshot->fSecondCount = m_fSecondCount;
+	pSnapshot->nBallTimer = m_nBallTimer;
+
+	pSnapshot->Balls.CopyState( m_Balls );
+
+	m_Bricks.SaveLive( &pSnapshot->pBricks );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: LoadState
+//
+//  Desc: Puts the board back the way it was when the snapshot was taken.
+// ----------------------------------------------------------------------------
+void CBoard::LoadState( const BOARDSNAPSHOT* pSnapshot )
+{
+	m_nSteps = pSnapshot->nSteps;
+	m_nScore = pSnapshot->nScore;
+	m_nLivesLost = pSnapshot->nLivesLost;
+	m_State = pSnapshot->State;
+
+	m_vPaddlePos = pSnapshot->vPaddlePos;
+	m_vPrevPaddlePos = pSnapshot->vPrevPaddlePos;
+	m_qPaddlePos = pSnapshot->qPaddlePos;
+	m_vBallPos = pSnapshot->vBallPos;
+	m_vBallVel = pSnapshot->vBallVel;
+
+	m_fSecondCount = pSnapshot->fSecondCount;
+	m_nBallTimer = pSnapshot->nBallTimer;
+
+	m_Balls.CopyState( pSnapshot->Balls );
+
+	m_Bricks.LoadLive( pSnapshot->pBricks );
+
+	// Bricks that move are wherever the time says.
+	if( m_CollisionMode != CollideFixed ) m_Bricks.Animate( (float)m_nSteps * m_fTimeStep );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: SetBroadphase
+//
+//  Desc: Picks how the board finds bricks to test the ball against. The
+//        tree is built straight away if the bricks don't have one yet.
+// ----------------------------------------------------------------------------
+void CBoard::SetBroadphase( Broadphase bp )
+{
+	m_Broadphase = bp;
+
+	if( (m_Broadphase == BroadphaseTree) && m_Bricks.GetCount() && !m_Bricks.HasTree() ) m_Bricks.BuildTree();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: SetCollisionMode
+//
+//  Desc: Picks between the discrete and the swept collision checks.
+// ----------------------------------------------------------------------------
+void CBoard::SetCollisionMode( CollisionMode mode )
+{
+	m_CollisionMode = mode;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: SetBallCollisions
+//
+//  Desc: Turns balls bouncing off each other on or off. They never do in
+//        fixed collision mode, which has no float math in it.
+// ----------------------------------------------------------------------------
+void CBoard::SetBallCollisions( bool bEnable )
+{
+	m_bBallCollisions = bEnable;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: SetTimeStep
+//
+//  Desc: Changes the length of a step. Long steps are only safe in swept
+//        collision mode.
+// ----------------------------------------------------------------------------
+void CBoard::SetTimeStep( float fTimeStep )
+{
+	m_fTimeStep = fTimeStep;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: SetLives
+//
+//  Desc: Sets how many balls the player can lose before the game is over.
+//        Takes effect from the next reset.
+// ----------------------------------------------------------------------------
+void CBoard::SetLives( int nLives )
+{
+	m_nLives = nLives;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: SetLaunch
+//
+//  Desc: Sets the velocity a served ball takes off with. Takes effect from
+//        the next launch.
+// ----------------------------------------------------------------------------
+void CBoard::SetLaunch( float fVelX, float fVelY )
+{
+	m_vLaunch.x = fVelX;
+	m_vLaunch.y = fVelY;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: AddBall
+//
+//  Desc: Puts another ball into play. Returns its index.
+// ----------------------------------------------------------------------------
+int CBoard::AddBall( VEC2 vPos, VEC2 vVel )
+{
+	return m_Balls.Add( vPos.x, vPos.y, vVel.x, vVel.y );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetCellRange
+//
+//  Desc: Maps a bounding box on the board to the range of brick slots whose
+//        bricks could overlap it. Returns false if there are none.
+// ----------------------------------------------------------------------------
+bool CBoard::GetCellRange( float fMinX, float fMinY, float fMaxX, float fMaxY, int* x0, int* y0, int* x1, int* y1 ) const
+{
+	// A hair of slack so that rounding never loses a brick that is only just
+	// touching the box. The bricks found are tested exactly afterwards.
+	const float e = 0.0001f;
+
+	*x0 = (int)ceilf( (fMinX - BRICK_HALF_WIDTH - e - m_fOriginX) / BRICK_PITCH_X );
+	*x1 = (int)floorf( (fMaxX + BRICK_HALF_WIDTH + e - m_fOriginX) / BRICK_PITCH_X );
+
+	// Rows count downwards from the top of the board.
+	*y0 = (int)ceilf( (m_fOriginY - BRICK_HALF_HEIGHT - e - fMaxY) / BRICK_PITCH_Y );
+	*y1 = (int)floorf( (m_fOriginY + BRICK_HALF_HEIGHT + e - fMinY) / BRICK_PITCH_Y );
+
+	if( *x0 < 0 ) *x0 = 0;
+	if( *y0 < 0 ) *y0 = 0;
+	if( *x1 >= m_nColumns ) *x1 = m_nColumns - 1;
+	if( *y1 >= m_nRows ) *y1 = m_nRows - 1;
+
+	return (*x0 <= *x1) && (*y0 <= *y1);
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: TrackBall
+//
+//  Desc: A very simple paddle controller for headless runs. Returns the mouse
+//        movement that puts the paddle under the lowest ball, limited to
+//        nMaxCounts.
+// ----------------------------------------------------------------------------
+int CBoard::TrackBall( int nMaxCounts ) const
+{
+	int n, i, nLowest = 0;
+
+	if( !m_Balls.GetCount() ) return 0;
+
+	for( i = 1; i < m_Balls.GetCount(); i++ )
+	{
+		if( m_Balls.GetY( i ) < m_Balls.GetY( nLowest ) ) nLowest = i;
+	}
+
+	// Fixed mode keeps the controller in fixed point too, so headless runs
+	// of it don't depend on the floating point unit anywhere.
+	if( m_CollisionMode == CollideFixed )
+	{
+		n = FixDiv( m_Balls.GetFixedPos( nLowest ).x - m_qPaddlePos.x, m_qMouseScale ) / FIXED_ONE;
+	}
+	else
+	{
+		n = (int)((m_Balls.GetX( nLowest ) - m_vPaddlePos.x) / m_fMouseScale);
+	}
+
+	if( n > nMaxCounts ) n = nMaxCounts;
+	if( n < -nMaxCounts ) n = -nMaxCounts;
+
+	return n;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: PredictPath
+//
+//  Desc: Predicts where a ball at vPos moving at vVel will go over the next
+//        fMaxTime seconds. Each leg is cast straight to whatever it hits
+//        first and reflected there, the way swept mode bounces, with the
+//        paddle held where it is and bricks gone once they've been hit.
+//        Fills in a point for each bounce and for where the path ends, up
+//        to nPoints of them, and returns how many there are. Nothing on the
+//        board is touched, so it's safe to call from several threads at once.
+// ----------------------------------------------------------------------------
+int CBoard::PredictPath( VEC2 vPos, VEC2 vVel, float fMaxTime, PATHPOINT* pPath, int nPoints ) const
+{
+	VEC2		d, n, vNormal;
+	float		t, fDot, fTime = 0.0f, r = m_fBallRadius;
+	float		fLose = m_vPaddlePos.y - PADDLE_LOSE_DEPTH;
+	int			nBrick, nPoint;
+	PathEvent	Event;
+	vector<int>	tCast;
+
+	for( nPoint = 0; nPoint < nPoints; nPoint++ )
+	{
+		// Where the ball would go with the time that is left.
+		d.x = vVel.x * (fMaxTime - fTime);
+		d.y = vVel.y * (fMaxTime - fTime);
+
+		t = 1.0f;
+		nBrick = -1;
+		Event = PathEnd;
+		vNormal.x = vNormal.y = 0.0f;
+
+		if( (d.x != 0.0f) || (d.y != 0.0f) )
+		{
+			// The walls.
+			if( SweepWall( vPos.x, d.x, m_fWallRight - r, -1.0f, &t ) ) { vNormal.x = -1.0f; vNormal.y = 0.0f; Event = PathWall; }
+			if( SweepWall( vPos.x, d.x, m_fWallLeft + r, 1.0f, &t ) ) { vNormal.x = 1.0f; vNormal.y = 0.0f; Event = PathWall; }
+			if( SweepWall( vPos.y, d.y, m_fWallTop - r, -1.0f, &t ) ) { vNormal.x = 0.0f; vNormal.y = -1.0f; Event = PathWall; }
+			if( SweepWall( vPos.y, d.y, m_fWallBottom + r, 1.0f, &t ) ) { vNormal.x = 0.0f; vNormal.y = 1.0f; Event = PathWall; }
+
+			// The paddle.
+			if( SweepBox( vPos, d, m_vPaddlePos, PADDLE_HALF_WIDTH, PADDLE_HALF_HEIGHT, r, &t, &n ) ) { vNormal = n; Event = PathPaddle; }
+
+			// The bricks.
+			if( SweepBricks( vPos, d, pPath, nPoint, &t, &n, &nBrick, &tCast ) ) { vNormal = n; Event = PathBrick; }
+
+			// Falling past the paddle ends the path.
+			if( (d.y < 0.0f) && ((vPos.y + (d.y * t)) < fLose) )
+			{
+				t = (fLose - vPos.y) / d.y;
+				nBrick = -1;
+				Event = PathLost;
+			}
+		}
+
+		vPos.x += d.x * t;
+		vPos.y += d.y * t;
+		fTime += (fMaxTime - fTime) * t;
+
+		// Reflect the velocity about the surface normal.
+		//
+		// v2 = v1 - 2 * (n . v1) * n
+		if( (Event != PathEnd) && (Event != PathLost) )
+		{
+			fDot = 2.0f * VecDot( vNormal, vVel );
+			vVel.x -= vNormal.x * fDot;
+			vVel.y -= vNormal.y * fDot;
+		}
+
+		pPath[nPoint].Event = Event;
+		pPath[nPoint].vPos = vPos;
+		pPath[nPoint].vVel = vVel;
+		pPath[nPoint].fTime = fTime;
+		pPath[nPoint].nBrick = (Event == PathBrick) ? nBrick : -1;
+
+		if( (Event == PathEnd) || (Event == PathLost) ) return nPoint + 1;
+	}
+
+	return nPoint;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: SweepBrick
+//
+//  Desc: SweepBox for brick i. A brick that's turned is swept in its own
+//        frame, where it's square to the axes, and the normal turned back.
+// ----------------------------------------------------------------------------
+bool CBoard::SweepBrick( int i, VEC2 p, VEC2 d, float* t, VEC2* n ) const
+{
+	VEC2	c, m;
+	float	fAngle, fCos, fSin;
+
+	c.x = m_Bricks.GetCenterX( i );
+	c.y = m_Bricks.GetCenterY( i );
+
+	fAngle = m_Bricks.GetAngle( i ) * (3.1415927f / 180.0f);
+
+	if( fAngle == 0.0f ) return SweepBox( p, d, c, m_Bricks.GetHalfWidth( i ), m_Bricks.GetHalfHeight( i ), m_fBallRadius, t, n );
+
+	fCos = cosf( fAngle );
+	fSin = sinf( fAngle );
+
+	p.x -= c.x;
+	p.y -= c.y;
+	p = VecTurn( p, fCos, -fSin );
+	d = VecTurn( d, fCos, -fSin );
+
+	c.x = c.y = 0.0f;
+
+	if( !SweepBox( p, d, c, m_Bricks.GetHalfWidth( i ), m_Bricks.GetHalfHeight( i ), m_fBallRadius, t, &m ) ) return false;
+
+	*n = VecTurn( m, fCos, fSin );
+
+	return true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: SweepBricks
+//
+//  Desc: Finds the first brick a ball at p moving by d runs into before t,
+//        leaving out the ones already hit on the path so far. Goes through
+//        the rows in the order the ball crosses them and looks only at the
+//        part of each row the ball passes over, so a long cast costs about
+//        what a short one does. pCast is the caller's, for the tree to find
+//        bricks into.
+// ----------------------------------------------------------------------------
+bool CBoard::SweepBricks( VEC2 p, VEC2 d, const PATHPOINT* pPath, int nPoints, float* t, VEC2* n, int* pBrick, vector<int>* pCast ) const
+{
+	// A hair of slack, as GetCellRange has.
+	const float e = 0.0001f;
+	const float ey = BRICK_HALF_HEIGHT + m_fBallRadius + e;
+	const float ex = BRICK_HALF_WIDTH + m_fBallRadius + e;
+
+	int			tSpan[64];
+	float		cy, t0, t1, xa, xb;
+	int			y, y0, y1, nStep, x0, x1, x, i, j, k, nCount;
+	bool		bHit = false;
+
+	if( !m_nRows || !m_nColumns ) return false;
+
+	// Bricks that aren't in their slots are found along the cast with the
+	// tree instead, into the caller's list, kept from one leg of the path to
+	// the next so only the first few allocate.
+	if( UseTree() )
+	{
+		nCount = m_Bricks.FindAlong( p.x, p.y, d.x * *t, d.y * *t, m_fBallRadius + e, pCast );
+
+		for( j = 0; j < nCount; j++ )
+		{
+			i = (*pCast)[j];
+
+			for( k = 0; (k < nPoints) && (pPath[k].nBrick != i); k++ );
+			if( k < nPoints ) continue;
+
+			if( SweepBrick( i, p, d, t, n ) )
+			{
+				*pBrick = i;
+				bHit = true;
+			}
+		}
+
+		return bHit;
+	}
+
+	// The rows the cast passes over, in the order the ball reaches them.
+	// Rows count downwards, so going up means going through them backwards.
+	y0 = (int)ceilf( (m_fOriginY - ey - max( p.y, p.y + (d.y * *t) )) / BRICK_PITCH_Y );
+	y1 = (int)floorf( (m_fOriginY + ey - min( p.y, p.y + (d.y * *t) )) / BRICK_PITCH_Y );
+
+	if( y0 < 0 ) y0 = 0;
+	if( y1 >= m_nRows ) y1 = m_nRows - 1;
+
+	if( y0 > y1 ) return false;
+
+	nStep = (d.y > 0.0f) ? -1 : 1;
+
+	for( y = (nStep > 0) ? y0 : y1; (y >= y0) && (y <= y1); y += nStep )
+	{
+		// When the ball is level with the row.
+		cy = m_fOriginY - (BRICK_PITCH_Y * y);
+
+		if( d.y != 0.0f )
+		{
+			t0 = ((cy - ey) - p.y) / d.y;
+			t1 = ((cy + ey) - p.y) / d.y;
+			if( t0 > t1 ) swap( t0, t1 );
+
+			// Rows further on are only reached later still.
+			if( t0 >= *t ) break;
+			if( t1 < 0.0f ) continue;
+
+			t0 = max( t0, 0.0f );
+			t1 = min( t1, *t );
+		}
+		else
+		{
+			if( fabsf( p.y - cy ) > ey ) continue;
+
+			t0 = 0.0f;
+			t1 = *t;
+		}
+
+		// And the slots it passes over while it is.
+		xa = p.x + (d.x * t0);
+		xb = p.x + (d.x * t1);
+
+		x0 = (int)ceilf( (min( xa, xb ) - ex - m_fOriginX) / BRICK_PITCH_X );
+		x1 = (int)floorf( (max( xa, xb ) + ex - m_fOriginX) / BRICK_PITCH_X );
+
+		if( x0 < 0 ) x0 = 0;
+		if( x1 >= m_nColumns ) x1 = m_nColumns - 1;
+
+		for( x = x0; x <= x1; x += 64 )
+		{
+			nCount = m_Bricks.ListSpan( 0, y, x, min( x + 63, x1 ), tSpan );
+
+			for( j = 0; j < nCount; j++ )
+			{
+				i = tSpan[j];
+
+				for( k = 0; (k < nPoints) && (pPath[k].nBrick != i); k++ );
+				if( k < nPoints ) continue;
+
+				if( SweepBrick( i, p, d, t, n ) )
+				{
+					*pBrick = i;
+					bHit = true;
+				}
+			}
+		}
+	}
+
+	return bHit;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: AutoPilot
+//
+//  Desc: A paddle controller that plays ahead. Predicts where the lowest
+//        ball coming down will reach the paddle and returns the mouse
+//        movement towards that spot, limited to nMaxCounts.
+// ----------------------------------------------------------------------------
+int CBoard::AutoPilot( int nMaxCounts ) const
+{
+	PATHPOINT	path[BOARD_PREDICT_BOUNCES];
+	VEC2		vPos, vVel;
+	float		fTarget = 0.0f, fLine;
+	int			n, i, nLowest = 0;
+
+	if( !m_Balls.GetCount() ) return 0;
+
+	for( i = 1; i < m_Balls.GetCount(); i++ )
+	{
+		if( m_Balls.GetY( i ) < m_Balls.GetY( nLowest ) ) nLowest = i;
+	}
+
+	vPos.x = m_Balls.GetX( nLowest );
+	vPos.y = m_Balls.GetY( nLowest );
+	vVel.x = m_Balls.GetVelX( nLowest );
+	vVel.y = m_Balls.GetVelY( nLowest );
+
+	fTarget = vPos.x;
+
+	// Follow the path to the first time it comes down to the paddle, and be
+	// where it crosses the top of it.
+	n = PredictPath( vPos, vVel, 10.0f, path, BOARD_PREDICT_BOUNCES );
+
+	fLine = m_vPaddlePos.y + PADDLE_HALF_HEIGHT + m_fBallRadius;
+
+	for( i = 0; i < n; i++ )
+	{
+		if( (path[i].Event == PathPaddle) || (path[i].Event == PathLost) )
+		{
+			fTarget = path[i].vPos.x;
+
+			if( (path[i].Event == PathLost) && (path[i].vVel.y != 0.0f) )
+			{
+				fTarget -= path[i].vVel.x * ((path[i].vPos.y - fLine) / path[i].vVel.y);
+			}
+
+			break;
+		}
+	}
+
+	n = (int)((fTarget - m_vPaddlePos.x) / m_fMouseScale);
+
+	if( n > nMaxCounts ) n = nMaxCounts;
+	if( n < -nMaxCounts ) n = -nMaxCounts;
+
+	return n;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: UseTree
+//
+//  Desc: Checks whether bricks are looked up in the tree rather than by
+//        their slots. Fixed mode always goes by the slots.
+// ----------------------------------------------------------------------------
+bool CBoard::UseTree() const
+{
+	return m_Bricks.HasTree() && (m_CollisionMode != CollideFixed) && ((m_Broadphase == BroadphaseTree) || m_Bricks.IsAnimated());
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: MovePaddle
+//
+//  Desc: Moves the paddle by the given number of mouse counts.
+// ----------------------------------------------------------------------------
+void CBoard::MovePaddle( int nMouseX )
+{
+	if( m_CollisionMode == CollideFixed )
+	{
+		m_qPaddlePos.x += nMouseX * m_qMouseScale;
+
+		if( m_qPaddlePos.x <= -m_qPaddleTravel ) m_qPaddlePos.x = -m_qPaddleTravel;
+		if( m_qPaddlePos.x >= m_qPaddleTravel ) m_qPaddlePos.x = m_qPaddleTravel;
+
+		m_vPaddlePos.x = FixToFloat( m_qPaddlePos.x );
+		m_vPaddlePos.y = FixToFloat( m_qPaddlePos.y );
+
+		return;
+	}
+
+	m_vPaddlePos.x += (nMouseX * m_fMouseScale);
+
+	// Make sure the paddle cannot be moved outside of the game boundaries.
+	if( m_vPaddlePos.x <= -m_fPaddleTravel ) m_vPaddlePos.x = -m_fPaddleTravel;
+	if( m_vPaddlePos.x >= m_fPaddleTravel ) m_vPaddlePos.x = m_fPaddleTravel;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: MoveBalls
+//
+//  Desc: Moves every ball through a step. Most balls are nowhere near
+//        anything they could hit, and those are all moved in one pass. Only
+//        the rest go through the collision checks.
+// ----------------------------------------------------------------------------
+void CBoard::MoveBalls( float fElapsedTime )
+{
+	// The open space runs from just inside the walls down to just above the
+	// paddle, and up to the bottom of the lowest row of bricks. The margin
+	// keeps balls that are only just touching on the careful path.
+	const float e = 0.002f;
+
+	float	r = m_fBallRadius;
+	float	fTop;
+	int		i, n;
+
+	if( !m_Balls.GetCount() ) return;
+
+	// The open space pass is float math, so in fixed mode every ball goes
+	// the careful way.
+	if( m_CollisionMode == CollideFixed )
+	{
+		for( i = 0; i < m_Balls.GetCount(); i++ ) MoveBall( i, fElapsedTime );
+
+		return;
+	}
+
+	fTop = m_fOriginY - (BRICK_PITCH_Y * (m_nRows - 1)) - BRICK_HALF_HEIGHT;
+	if( fTop > m_fWallTop ) fTop = m_fWallTop;
+
+	m_tBusy.resize( m_Balls.GetCount() );
+
+	n = m_Balls.MoveFree( fElapsedTime, m_fWallLeft + r + e, m_vPaddlePos.y + PADDLE_HALF_HEIGHT + r + e,
+						  m_fWallRight - r - e, fTop - r - e, &m_tBusy[0] );
+
+	for( i = 0; i < n; i++ ) MoveBall( m_tBusy[i], fElapsedTime );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: MoveBall
+//
+//  Desc: Moves a single ball through a step, with all the collision checks.
+// ----------------------------------------------------------------------------
+void CBoard::MoveBall( int i, float fElapsedTime )
+{
+	if( m_CollisionMode == CollideFixed )
+	{
+		MoveBallFixed( i, FixFromFloat( fElapsedTime ) );
+		return;
+	}
+
+	m_vBallPos.x = m_Balls.GetX( i );
+	m_vBallPos.y = m_Balls.GetY( i );
+	m_vBallVel.x = m_Balls.GetVelX( i );
+	m_vBallVel.y = m_Balls.GetVelY( i );
+
+	if( m_CollisionMode == CollideSwept )
+	{
+		// Move the ball, bouncing off bricks, walls and the paddle as it goes.
+		SweepBall( fElapsedTime );
+	}
+	else
+	{
+		// Position the ball.
+		CheckForCollisions( fElapsedTime );
+
+		// Bounce the ball off the walls and the paddle.
+		CheckWalls();
+		CheckPaddle();
+	}
+
+	m_Balls.SetPos( i, m_vBallPos.x, m_vBallPos.y );
+	m_Balls.SetVel( i, m_vBallVel.x, m_vBallVel.y );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CheckForCollisions
+//
+//  Desc: Checks for a collision between the ball and each brick still in
+//        existance, then moves the ball.
+// ----------------------------------------------------------------------------
+void CBoard::CheckForCollisions( float fElapsedTime )
+{
+	float	newx, newy;
+	float	r = m_fBallRadius;
+	int		i, y, n;
+	int		x0, y0, x1, y1;
+
+	// Calculate where the ball *will* be if it moves.
+	newx = m_vBallPos.x + (m_vBallVel.x * fElapsedTime);
+	newy = m_vBallPos.y + (m_vBallVel.y * fElapsedTime);
+
+	if( UseTree() )
+	{
+		// The tree finds the bricks the ball's new position overlaps wherever
+		// they've got to, in the same order the slots would give them.
+		n = m_Bricks.FindInBox( newx - r - 0.0001f, newy - r - 0.0001f, newx + r + 0.0001f, newy + r + 0.0001f, &m_tFound );
+
+		for( i = 0; i < n; i++ )
+		{
+			if( CheckBrick( m_tFound[i], newx, newy, fElapsedTime ) ) return;
+		}
+
+		m_vBallPos.x += m_vBallVel.x * fElapsedTime;
+		m_vBallPos.y += m_vBallVel.y * fElapsedTime;
+		return;
+	}
+
+	if( m_Broadphase == BroadphaseLinear )
+	{
+		// Every brick slot in existance...
+		x0 = y0 = 0;
+		x1 = m_nColumns - 1;
+		y1 = m_nRows - 1;
+	}
+	else
+	{
+		// ...or only the slots the ball can reach this step. Both ways visit
+		// the slots in the same order, so they hit the same brick.
+		if( !GetCellRange( min( m_vBallPos.x, newx ) - r, min( m_vBallPos.y, newy ) - r,
+						   max( m_vBallPos.x, newx ) + r, max( m_vBallPos.y, newy ) + r, &x0, &y0, &x1, &y1 ) )
+		{
+			x1 = x0 - 1;
+			y1 = y0 - 1;
+		}
+	}
+
+	// Every test in CheckBrick needs the ball to overlap the brick, so the
+	// kernel throws out the rest a batch at a time. The radius gets a little
+	// slack so rounding can never drop a brick CheckBrick would have hit.
+	for( y = y0; y <= y1; y++ )
+	{
+		n = m_Bricks.FindRowOverlaps( y, x0, x1, newx, newy, r + 0.0001f, &m_tHits[0] );
+
+		for( i = 0; i < n; i++ )
+		{
+			// This is going to be ball color independent.
+			if( CheckBrick( m_tHits[i], newx, newy, fElapsedTime ) ) return;
+		}
+	}
+
+	// If we didn't hit any bricks, we'll just keep moving the same way we
+	// were going to do otherwise.
+	m_vBallPos.x += m_vBallVel.x * fElapsedTime;
+	m_vBallPos.y += m_vBallVel.y * fElapsedTime;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CheckBrick
+//
+//  Desc: Checks whether the ball's new position hits the given brick. If it
+//        does, the ball is bounced and moved and the brick is destroyed.
+// ----------------------------------------------------------------------------
+bool CBoard::CheckBrick( int i, float newx, float newy, float fElapsedTime )
+{
+	float	bx, by;
+	float	tx, ty;
+	float	r = m_fBallRadius;
+	float	fAngle, c = 1.0f, s = 0.0f;
+	VEC2	v;
+	bool	hit;
+
+	// The center of the current brick.
+	bx = m_Bricks.GetCenterX( i );
+	by = m_Bricks.GetCenterY( i );
+
+	// A brick that's turned is checked in its own frame, where it's square
+	// to the axes. The ball is turned the other way about the brick's center
+	// and turned back again afterwards.
+	fAngle = m_Bricks.GetAngle( i ) * (3.1415927f / 180.0f);
+
+	if( fAngle != 0.0f )
+	{
+		c = cosf( fAngle );
+		s = sinf( fAngle );
+
+		v.x = m_vBallPos.x - bx;
+		v.y = m_vBallPos.y - by;
+		v = VecTurn( v, c, -s );
+		m_vBallPos.x = bx + v.x;
+		m_vBallPos.y = by + v.y;
+
+		m_vBallVel = VecTurn( m_vBallVel, c, -s );
+
+		v.x = newx - bx;
+		v.y = newy - by;
+		v = VecTurn( v, c, -s );
+		newx = bx + v.x;
+		newy = by + v.y;
+	}
+
+	hit = false;
+
+	// For each side of the ball figure out if the new position will
+	// take that side inside the brick boundaries.
+	if( BrickContains( bx, by, newx, newy + r ) )
+	{
+		// Ok, it went inside, we know it hit.
+		hit = true;
+
+		// Reverse the direction of the ball based on which side of
+		// the brick the ball hit.
+		m_vBallVel.y = -m_vBallVel.y;
+
+		// Use the triangle ration math equation to determine how much
+		// the ball will move in the x direction (the y is pretty self-
+		// explanatory).
+		ty = by - BRICK_HALF_HEIGHT - (newy + r);
+		tx = (ty * newx) / newy;
+
+		// Move the ball, and we are done.
+		m_vBallPos.x += tx * fElapsedTime;
+		m_vBallPos.y += ty * fElapsedTime;
+	}
+	else if( BrickContains( bx, by, newx, newy - r ) )
+	{
+		hit = true;
+
+		m_vBallVel.y = -m_vBallVel.y;
+
+		ty = (newy - r) - by + BRICK_HALF_HEIGHT;
+		tx = (ty * newx) / newy;
+
+		m_vBallPos.x += tx * fElapsedTime;
+		m_vBallPos.y += ty * fElapsedTime;
+	}
+	else if( BrickContains( bx, by, newx - r, newy ) )
+	{
+		hit = true;
+
+		m_vBallVel.x = -m_vBallVel.x;
+
+		tx = (newx - r) - (bx + 0.02f);
+		ty = tx * (newy / newx);
+
+		m_vBallPos.x += tx * fElapsedTime;
+		m_vBallPos.y += ty * fElapsedTime;
+	}
+	else if( BrickContains( bx, by, newx + r, newy ) )
+	{
+		hit = true;
+
+		m_vBallVel.x = -m_vBallVel.x;
+
+		tx = (bx - 0.02f) - (newx + r);
+		ty = tx * (newy / newx);
+
+		m_vBallPos.x += tx * fElapsedTime;
+		m_vBallPos.y += ty * fElapsedTime;
+	}
+	else
+	{
+		// Check each corner of the brick in turn.
+		hit = CheckCorner( bx - BRICK_HALF_WIDTH, by + BRICK_HALF_HEIGHT, newx, newy, fElapsedTime ) ||
+			  CheckCorner( bx + BRICK_HALF_WIDTH, by + BRICK_HALF_HEIGHT, newx, newy, fElapsedTime ) ||
+			  CheckCorner( bx - BRICK_HALF_WIDTH, by - BRICK_HALF_HEIGHT, newx, newy, fElapsedTime ) ||
+			  CheckCorner( bx + BRICK_HALF_WIDTH, by - BRICK_HALF_HEIGHT, newx, newy, fElapsedTime );
+	}
+
+	if( fAngle != 0.0f )
+	{
+		v.x = m_vBallPos.x - bx;
+		v.y = m_vBallPos.y - by;
+		v = VecTurn( v, c, s );
+		m_vBallPos.x = bx + v.x;
+		m_vBallPos.y = by + v.y;
+
+		m_vBallVel = VecTurn( m_vBallVel, c, s );
+	}
+
+	// Now, if we hit, the brick is destroyed.
+	if( hit )
+	{
+		DestroyBrick( i );
+
+		return true;
+	}
+
+	return false;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: SweepBall
+//
+//  Desc: Continuous collision. Moves the ball through the step, finding the
+//        earliest time of impact against the bricks, the walls and the
+//        paddle, bouncing there and carrying on with whatever time is left.
+// ----------------------------------------------------------------------------
+void CBoard::SweepBall( float fElapsedTime )
+{
+	VEC2	d, n, vNormal;
+	float	t, fDot, r = m_fBallRadius;
+	float	fLose = m_vPaddlePos.y - PADDLE_LOSE_DEPTH;
+	float	fLeft = 1.0f;
+	int		i, j, y, x0, y0, x1, y1;
+	int		nBrick, nCount;
+
+	for( int nBounce = 0; (nBounce < BOARD_MAX_BOUNCES) && (fLeft > 0.0f); nBounce++ )
+	{
+		// Where the ball would go with the time that is left.
+		d.x = m_vBallVel.x * fElapsedTime * fLeft;
+		d.y = m_vBallVel.y * fElapsedTime * fLeft;
+
+		if( (d.x == 0.0f) && (d.y == 0.0f) ) return;
+
+		t = 1.0f;
+		nBrick = -1;
+		vNormal.x = vNormal.y = 0.0f;
+
+		// The walls.
+		if( SweepWall( m_vBallPos.x, d.x, m_fWallRight - r, -1.0f, &t ) ) { vNormal.x = -1.0f; vNormal.y = 0.0f; }
+		if( SweepWall( m_vBallPos.x, d.x, m_fWallLeft + r, 1.0f, &t ) ) { vNormal.x = 1.0f; vNormal.y = 0.0f; }
+		if( SweepWall( m_vBallPos.y, d.y, m_fWallTop - r, -1.0f, &t ) ) { vNormal.x = 0.0f; vNormal.y = -1.0f; }
+		if( SweepWall( m_vBallPos.y, d.y, m_fWallBottom + r, 1.0f, &t ) ) { vNormal.x = 0.0f; vNormal.y = 1.0f; }
+
+		// The paddle.
+		if( SweepBox( m_vBallPos, d, m_vPaddlePos, PADDLE_HALF_WIDTH, PADDLE_HALF_HEIGHT, r, &t, &n ) ) vNormal = n;
+
+		// The bricks the ball can reach.
+		if( UseTree() )
+		{
+			nCount = m_Bricks.FindInBox( min( m_vBallPos.x, m_vBallPos.x + d.x ) - r - 0.0001f, min( m_vBallPos.y, m_vBallPos.y + d.y ) - r - 0.0001f,
+										 max( m_vBallPos.x, m_vBallPos.x + d.x ) + r + 0.0001f, max( m_vBallPos.y, m_vBallPos.y + d.y ) + r + 0.0001f, &m_tFound );
+
+			for( j = 0; j < nCount; j++ )
+			{
+				if( SweepBrick( m_tFound[j], m_vBallPos, d, &t, &n ) )
+				{
+					vNormal = n;
+					nBrick = m_tFound[j];
+				}
+			}
+		}
+		else if( GetCellRange( min( m_vBallPos.x, m_vBallPos.x + d.x ) - r, min( m_vBallPos.y, m_vBallPos.y + d.y ) - r,
+							   max( m_vBallPos.x, m_vBallPos.x + d.x ) + r, max( m_vBallPos.y, m_vBallPos.y + d.y ) + r, &x0, &y0, &x1, &y1 ) )
+		{
+			for( y = y0; y <= y1; y++ )
+			{
+				nCount = m_Bricks.ListSpan( 0, y, x0, x1, &m_tHits[0] );
+
+				for( j = 0; j < nCount; j++ )
+				{
+					i = m_tHits[j];
+
+					if( SweepBrick( i, m_vBallPos, d, &t, &n ) )
+					{
+						vNormal = n;
+						nBrick = i;
+					}
+				}
+			}
+		}
+
+		// Falling past the paddle ends the sweep, there's nothing down there
+		// worth bouncing off.
+		if( (d.y < 0.0f) && ((m_vBallPos.y + (d.y * t)) < fLose) )
+		{
+			m_vBallPos.x += d.x * ((fLose - m_vBallPos.y) / d.y);
+			m_vBallPos.y = fLose - 0.0001f;
+			return;
+		}
+
+		// Move up to the point of impact.
+		m_vBallPos.x += d.x * t;
+		m_vBallPos.y += d.y * t;
+
+		if( t >= 1.0f ) return;
+
+		// Reflect the velocity about the surface normal.
+		//
+		// v2 = v1 - 2 * (n . v1) * n
+		fDot = 2.0f * VecDot( vNormal, m_vBallVel );
+		m_vBallVel.x -= vNormal.x * fDot;
+		m_vBallVel.y -= vNormal.y * fDot;
+
+		if( nBrick >= 0 ) DestroyBrick( nBrick );
+
+		fLeft *= (1.0f - t);
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: DestroyBrick
+//
+//  Desc: Increments our score based on the color of the brick and "destroys"
+//        the brick, making it disappear, as well as decrement the brick count
+//        so we know when we end the game.
+// ----------------------------------------------------------------------------
+void CBoard::DestroyBrick( int i )
+{
+	BRICKEVENT Event;
+
+	m_nScore += 100 * m_Bricks.GetType( i );
+
+	Event.nBrick = i;
+	Event.nType = m_Bricks.GetType( i );
+	Event.vPos.x = m_Bricks.GetCenterX( i );
+	Event.vPos.y = m_Bricks.GetCenterY( i );
+	Event.vHalfSize.x = m_Bricks.GetHalfWidth( i );
+	Event.vHalfSize.y = m_Bricks.GetHalfHeight( i );
+	Event.vBallVel = m_vBallVel;
+
+	if( m_CollisionMode == CollideFixed )
+	{
+		Event.vBallVel.x = FixToFloat( m_qBallVel.x );
+		Event.vBallVel.y = FixToFloat( m_qBallVel.y );
+	}
+
+	m_tEvents.push_back( Event );
+
+	m_Bricks.Destroy( i );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CheckCorner
+//
+//  Desc: Checks whether the ball's new position swallows the brick corner at
+//        cx, cy and bounces it off the corner if it does.
+// ----------------------------------------------------------------------------
+bool CBoard::CheckCorner( float cx, float cy, float newx, float newy, float fElapsedTime )
+{
+	VEC2	d;
+	float	d1, d2;
+	float	r = m_fBallRadius;
+
+	// Is the corner inside the square boundaries of the ball?
+	if( (cx < (newx - r)) || (cx > (newx + r)) || (cy < (newy - r)) || (cy > (newy + r)) ) return false;
+
+	// It's inside the boundaries. Determine if the corner is actually inside
+	// the circle defined by the ball. This is simply done by taking the
+	// distance between the corner and the center of the ball, and if it's
+	// equal or less than the radius of the ball, then it has intersected.
+	d1 = sqrtf( ((cx - newx) * (cx - newx)) + ((cy - newy) * (cy - newy)) );
+
+	if( d1 > r ) return false;
+
+	// Figure out the magnitude of how much the ball would have moved in the
+	// direction specified by the velocity vector.
+	d.x = m_vBallVel.x * fElapsedTime;
+	d.y = m_vBallVel.y * fElapsedTime;
+
+	d2 = sqrtf( (d.x * d.x) + (d.y * d.y) );
+
+	// Now, normalize the velocity vector.
+	d = VecNormalize( d );
+
+	// Find out how much the ball actually needs to move so that the edge of
+	// the ball is only just touching the corner of the brick.
+	d2 -= (r - d1);
+
+	// Move the ball.
+	m_vBallPos.x += d.x * d2;
+	m_vBallPos.y += d.y * d2;
+
+	// Now the fun part. Find out what the vector is between the corner of the
+	// brick and the center of the ball (the normal vector for this
+	// calculation).
+	d.x = (cx - m_vBallPos.x);
+	d.y = (cy - m_vBallPos.y);
+
+	// Normalize the vector.
+	d = VecNormalize( d );
+
+	// Now, to calculate the angle that the ball bounces when it hits the
+	// brick, the formula is as follows:
+	//
+	// v2 = -(2 * (n . v1) * n - v1)
+	//
+	// Where . is the dot product of two vectors, n is the normal vector at
+	// the colision point, v1 is the initial velocity vector and v2 is the new
+	// velocity vector.
+	d2 = 2 * VecDot( d, m_vBallVel );
+	d.x *= d2;
+	d.y *= d2;
+
+	// Now we have a new direction and velocity vector.
+	m_vBallVel.x = -(d.x - m_vBallVel.x);
+	m_vBallVel.y = -(d.y - m_vBallVel.y);
+
+	return true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CheckWalls
+//
+//  Desc: Bounces the ball off the sides of the walls.
+// ----------------------------------------------------------------------------
+void CBoard::CheckWalls()
+{
+	if( (m_vBallPos.x + m_fBallRadius) >= m_fWallRight )
+	{
+		m_vBallVel.x = -m_vBallVel.x;
+		m_vBallPos.x = m_fWallRight - (m_fBallRadius + 0.01f);
+	}
+	if( (m_vBallPos.x - m_fBallRadius) <= m_fWallLeft )
+	{
+		m_vBallVel.x = -m_vBallVel.x;
+		m_vBallPos.x = m_fWallLeft + (m_fBallRadius + 0.01f);
+	}
+
+	if( (m_vBallPos.y + m_fBallRadius) >= m_fWallTop )
+	{
+		m_vBallVel.y = -m_vBallVel.y;
+		m_vBallPos.y = m_fWallTop - (m_fBallRadius + 0.01f);
+	}
+	if( (m_vBallPos.y - m_fBallRadius) <= m_fWallBottom )
+	{
+		m_vBallVel.y = -m_vBallVel.y;
+		m_vBallPos.y = m_fWallBottom + (m_fBallRadius + 0.01f);
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CheckPaddle
+//
+//  Desc: Finds out how the ball bounces off the paddle.
+// ----------------------------------------------------------------------------
+void CBoard::CheckPaddle()
+{
+	VEC2 d;
+
+	// Find the point on the edge of the ball closest to the paddle's center.
+	d.x = m_vPaddlePos.x - m_vBallPos.x;
+	d.y = m_vPaddlePos.y - m_vBallPos.y;
+
+	d = VecNormalize( d );
+
+	d.x = m_vBallPos.x + (d.x * m_fBallRadius);
+	d.y = m_vBallPos.y + (d.y * m_fBallRadius);
+
+	if( (d.y <= (m_vPaddlePos.y + PADDLE_HALF_HEIGHT)) && (d.x >= (m_vPaddlePos.x - PADDLE_HALF_WIDTH)) && (d.x <= (m_vPaddlePos.x + PADDLE_HALF_WIDTH)) )
+	{
+		m_vBallVel.y = -m_vBallVel.y;
+		m_vBallPos.y = m_vPaddlePos.y + PADDLE_HALF_HEIGHT + m_fBallRadius + 0.001f;
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: MoveBallFixed
+//
+//  Desc: Moves a single ball through a step in fixed point. The ball is
+//        carried from one step to the next in the pool's fixed point copy,
+//        never through a float, which drops fraction bits past 256.
+// ----------------------------------------------------------------------------
+void CBoard::MoveBallFixed( int i, FIXED qElapsedTime )
+{
+	m_qBallPos = m_Balls.GetFixedPos( i );
+	m_qBallVel = m_Balls.GetFixedVel( i );
+
+	CheckForCollisionsFixed( qElapsedTime );
+	CheckWallsFixed();
+	CheckPaddleFixed();
+
+	m_vBallPos.x = FixToFloat( m_qBallPos.x );
+	m_vBallPos.y = FixToFloat( m_qBallPos.y );
+	m_vBallVel.x = FixToFloat( m_qBallVel.x );
+	m_vBallVel.y = FixToFloat( m_qBallVel.y );
+
+	m_Balls.SetFixed( i, m_qBallPos, m_qBallVel );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetCellRangeFixed
+//
+//  Desc: Fixed point version of GetCellRange. The division is exact, so it
+//        needs no slack.
+// ----------------------------------------------------------------------------
+bool CBoard::GetCellRangeFixed( FIXED qMinX, FIXED qMinY, FIXED qMaxX, FIXED qMaxY, int* x0, int* y0, int* x1, int* y1 ) const
+{
+	const FIXED hw = FixFromFloat( BRICK_HALF_WIDTH );
+	const FIXED hh = FixFromFloat( BRICK_HALF_HEIGHT );
+	const FIXED px = FixFromFloat( BRICK_PITCH_X );
+	const FIXED py = FixFromFloat( BRICK_PITCH_Y );
+
+	*x0 = -FloorDiv( m_qOriginX - (qMinX - hw), px );
+	*x1 = FloorDiv( (qMaxX + hw) - m_qOriginX, px );
+
+	// Rows count downwards from the top of the board.
+	*y0 = -FloorDiv( (qMaxY + hh) - m_qOriginY, py );
+	*y1 = FloorDiv( m_qOriginY - (qMinY - hh), py );
+
+	if( *x0 < 0 ) *x0 = 0;
+	if( *y0 < 0 ) *y0 = 0;
+	if( *x1 >= m_nColumns ) *x1 = m_nColumns - 1;
+	if( *y1 >= m_nRows ) *y1 = m_nRows - 1;
+
+	return (*x0 <= *x1) && (*y0 <= *y1);
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CheckForCollisionsFixed
+//
+//  Desc: Fixed point version of CheckForCollisions. CheckBrickFixed does its
+//        own overlap tests, so every brick left in range goes to it.
+// ----------------------------------------------------------------------------
+void CBoard::CheckForCollisionsFixed( FIXED qElapsedTime )
+{
+	FVEC2	vNew;
+	FIXED	r = m_qBallRadius;
+	int		i, y, n;
+	int		x0, y0, x1, y1;
+
+	// Calculate where the ball *will* be if it moves.
+	vNew.x = m_qBallPos.x + FixMul( m_qBallVel.x, qElapsedTime );
+	vNew.y = m_qBallPos.y + FixMul( m_qBallVel.y, qElapsedTime );
+
+	if( m_Broadphase == BroadphaseLinear )
+	{
+		x0 = y0 = 0;
+		x1 = m_nColumns - 1;
+		y1 = m_nRows - 1;
+	}
+	else if( !GetCellRangeFixed( min( m_qBallPos.x, vNew.x ) - r, min( m_qBallPos.y, vNew.y ) - r,
+								 max( m_qBallPos.x, vNew.x ) + r, max( m_qBallPos.y, vNew.y ) + r, &x0, &y0, &x1, &y1 ) )
+	{
+		x1 = x0 - 1;
+		y1 = y0 - 1;
+	}
+
+	for( y = y0; y <= y1; y++ )
+	{
+		n = m_Bricks.ListSpan( 0, y, x0, x1, &m_tHits[0] );
+
+		for( i = 0; i < n; i++ )
+		{
+			if( CheckBrickFixed( m_tHits[i], vNew, qElapsedTime ) ) return;
+		}
+	}
+
+	m_qBallPos.x += FixMul( m_qBallVel.x, qElapsedTime );
+	m_qBallPos.y += FixMul( m_qBallVel.y, qElapsedTime );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CheckBrickFixed
+//
+//  Desc: Fixed point version of CheckBrick. The brick's center comes from
+//        its slot rather than from the float layout.
+// ----------------------------------------------------------------------------
+bool CBoard::CheckBrickFixed( int i, FVEC2 vNew, FIXED qElapsedTime )
+{
+	const FIXED hw = FixFromFloat( BRICK_HALF_WIDTH );
+	const FIXED hh = FixFromFloat( BRICK_HALF_HEIGHT );
+	const FIXED e = FixFromFloat( 0.02f );
+
+	FVEC2	b;
+	FIXED	tx, ty;
+	FIXED	r = m_qBallRadius;
+	bool	hit;
+	int		x, y;
+
+	m_Bricks.GetSlot( i, &x, &y );
+
+	b.x = m_qOriginX + (FixFromFloat( BRICK_PITCH_X ) * x);
+	b.y = m_qOriginY - (FixFromFloat( BRICK_PITCH_Y ) * y);
+
+	hit = true;
+
+	if( BrickContainsFixed( b, vNew.x, vNew.y + r ) )
+	{
+		m_qBallVel.y = -m_qBallVel.y;
+
+		ty = b.y - hh - (vNew.y + r);
+		tx = FixDiv( FixMul( ty, vNew.x ), vNew.y );
+
+		m_qBallPos.x += FixMul( tx, qElapsedTime );
+		m_qBallPos.y += FixMul( ty, qElapsedTime );
+	}
+	else if( BrickContainsFixed( b, vNew.x, vNew.y - r ) )
+	{
+		m_qBallVel.y = -m_qBallVel.y;
+
+		ty = (vNew.y - r) - b.y + hh;
+		tx = FixDiv( FixMul( ty, vNew.x ), vNew.y );
+
+		m_qBallPos.x += FixMul( tx, qElapsedTime );
+		m_qBallPos.y += FixMul( ty, qElapsedTime );
+	}
+	else if( BrickContainsFixed( b, vNew.x - r, vNew.y ) )
+	{
+		m_qBallVel.x = -m_qBallVel.x;
+
+		tx = (vNew.x - r) - (b.x + e);
+		ty = FixMul( tx, FixDiv( vNew.y, vNew.x ) );
+
+		m_qBallPos.x += FixMul( tx, qElapsedTime );
+		m_qBallPos.y += FixMul( ty, qElapsedTime );
+	}
+	else if( BrickContainsFixed( b, vNew.x + r, vNew.y ) )
+	{
+		m_qBallVel.x = -m_qBallVel.x;
+
+		tx = (b.x - e) - (vNew.x + r);
+		ty = FixMul( tx, FixDiv( vNew.y, vNew.x ) );
+
+		m_qBallPos.x += FixMul( tx, qElapsedTime );
+		m_qBallPos.y += FixMul( ty, qElapsedTime );
+	}
+	else
+	{
+		hit = CheckCornerFixed( b.x - hw, b.y + hh, vNew, qElapsedTime ) ||
+			  CheckCornerFixed( b.x + hw, b.y + hh, vNew, qElapsedTime ) ||
+			  CheckCornerFixed( b.x - hw, b.y - hh, vNew, qElapsedTime ) ||
+			  CheckCornerFixed( b.x + hw, b.y - hh, vNew, qElapsedTime );
+	}
+
+	if( hit ) DestroyBrick( i );
+
+	return hit;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CheckCornerFixed
+//
+//  Desc: Fixed point version of CheckCorner.
+// ----------------------------------------------------------------------------
+bool CBoard::CheckCornerFixed( FIXED cx, FIXED cy, FVEC2 vNew, FIXED qElapsedTime )
+{
+	FVEC2	d;
+	FIXED	d1, d2;
+	FIXED	r = m_qBallRadius;
+
+	if( (cx < (vNew.x - r)) || (cx > (vNew.x + r)) || (cy < (vNew.y - r)) || (cy > (vNew.y + r)) ) return false;
+
+	d1 = FixLength( cx - vNew.x, cy - vNew.y );
+
+	if( d1 > r ) return false;
+
+	d.x = FixMul( m_qBallVel.x, qElapsedTime );
+	d.y = FixMul( m_qBallVel.y, qElapsedTime );
+
+	d2 = FixLength( d.x, d.y );
+
+	d = FixNormalize( d );
+
+	// Move the ball so it only just touches the corner.
+	d2 -= (r - d1);
+
+	m_qBallPos.x += FixMul( d.x, d2 );
+	m_qBallPos.y += FixMul( d.y, d2 );
+
+	// Bounce off the normal between the corner and the center of the ball.
+	//
+	// v2 = -(2 * (n . v1) * n - v1)
+	d.x = (cx - m_qBallPos.x);
+	d.y = (cy - m_qBallPos.y);
+
+	d = FixNormalize( d );
+
+	d2 = 2 * FixDot( d, m_qBallVel );
+
+	m_qBallVel.x = -(FixMul( d.x, d2 ) - m_qBallVel.x);
+	m_qBallVel.y = -(FixMul( d.y, d2 ) - m_qBallVel.y);
+
+	return true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CheckWallsFixed
+//
+//  Desc: Fixed point version of CheckWalls.
+// ----------------------------------------------------------------------------
+void CBoard::CheckWallsFixed()
+{
+	const FIXED e = FixFromFloat( 0.01f );
+
+	if( (m_qBallPos.x + m_qBallRadius) >= m_qWallRight )
+	{
+		m_qBallVel.x = -m_qBallVel.x;
+		m_qBallPos.x = m_qWallRight - (m_qBallRadius + e);
+	}
+	if( (m_qBallPos.x - m_qBallRadius) <= m_qWallLeft )
+	{
+		m_qBallVel.x = -m_qBallVel.x;
+		m_qBallPos.x = m_qWallLeft + (m_qBallRadius + e);
+	}
+
+	if( (m_qBallPos.y + m_qBallRadius) >= m_qWallTop )
+	{
+		m_qBallVel.y = -m_qBallVel.y;
+		m_qBallPos.y = m_qWallTop - (m_qBallRadius + e);
+	}
+	if( (m_qBallPos.y - m_qBallRadius) <= m_qWallBottom )
+	{
+		m_qBallVel.y = -m_qBallVel.y;
+		m_qBallPos.y = m_qWallBottom + (m_qBallRadius + e);
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CheckPaddleFixed
+//
+//  Desc: Fixed point version of CheckPaddle.
+// ----------------------------------------------------------------------------
+void CBoard::CheckPaddleFixed()
+{
+	const FIXED hw = FixFromFloat( PADDLE_HALF_WIDTH );
+	const FIXED hh = FixFromFloat( PADDLE_HALF_HEIGHT );
+
+	FVEC2 d;
+
+	d.x = m_qPaddlePos.x - m_qBallPos.x;
+	d.y = m_qPaddlePos.y - m_qBallPos.y;
+
+	d = FixNormalize( d );
+
+	d.x = m_qBallPos.x + FixMul( d.x, m_qBallRadius );
+	d.y = m_qBallPos.y + FixMul( d.y, m_qBallRadius );
+
+	if( (d.y <= (m_qPaddlePos.y + hh)) && (d.x >= (m_qPaddlePos.x - hw)) && (d.x <= (m_qPaddlePos.x + hw)) )
+	{
+		m_qBallVel.y = -m_qBallVel.y;
+		m_qBallPos.y = m_qPaddlePos.y + hh + m_qBallRadius + FixFromFloat( 0.001f );
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetColumns
+//
+//  Desc: Returns the width of the board in bricks.
+// ----------------------------------------------------------------------------
+int CBoard::GetColumns() const
+{
+	return m_nColumns;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetRows
+//
+//  Desc: Returns the height of the board in bricks.
+// ----------------------------------------------------------------------------
+int CBoard::GetRows() const
+{
+	return m_nRows;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetBrick
+//
+//  Desc: Returns the type of brick left in the given slot.
+// ----------------------------------------------------------------------------
+int CBoard::GetBrick( int x, int y ) const
+{
+	return m_Bricks.GetBrick( x, y );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetBrickCenter
+//
+//  Desc: Returns the center of the given slot, where its brick is unless it
+//        moves.
+// ----------------------------------------------------------------------------
+void CBoard::GetBrickCenter( int x, int y, float* bx, float* by ) const
+{
+	*bx = m_fOriginX + (BRICK_PITCH_X * x);
+	*by = m_fOriginY - (BRICK_PITCH_Y * y);
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetTotalBricks
+//
+//  Desc: Returns how many bricks are left.
+// ----------------------------------------------------------------------------
+int CBoard::GetTotalBricks() const
+{
+	return m_Bricks.GetLive();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetBricks
+//
+//  Desc: Returns the bricks, for drawing them.
+// ----------------------------------------------------------------------------
+const CBrickSet* CBoard::GetBricks() const
+{
+	return &m_Bricks;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetWalls
+//
+//  Desc: Returns where the walls of the field are, for the size of the level.
+// ----------------------------------------------------------------------------
+void CBoard::GetWalls( float* pLeft, float* pTop, float* pRight, float* pBottom ) const
+{
+	*pLeft = m_fWallLeft;
+	*pTop = m_fWallTop;
+	*pRight = m_fWallRight;
+	*pBottom = m_fWallBottom;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetMouseScale
+//
+//  Desc: Returns how far one mouse count moves the paddle.
+// ----------------------------------------------------------------------------
+float CBoard::GetMouseScale() const
+{
+	return m_fMouseScale;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetPaddlePos
+//
+//  Desc: Returns the position of the paddle.
+// ----------------------------------------------------------------------------
+VEC2 CBoard::GetPaddlePos() const
+{
+	return m_vPaddlePos;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetPrevPaddlePos
+//
+//  Desc: Returns where the paddle was before the last step.
+// ----------------------------------------------------------------------------
+VEC2 CBoard::GetPrevPaddlePos() const
+{
+	return m_vPrevPaddlePos;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetBallPos
+//
+//  Desc: Returns the position of the first ball. Once they're all gone, it's
+//        where the last one went out.
+// ----------------------------------------------------------------------------
+VEC2 CBoard::GetBallPos() const
+{
+	VEC2 v = m_vBallPos;
+
+	if( m_Balls.GetCount() )
+	{
+		v.x = m_Balls.GetX( 0 );
+		v.y = m_Balls.GetY( 0 );
+	}
+
+	return v;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetBallVel
+//
+//  Desc: Returns the velocity of the first ball.
+// ----------------------------------------------------------------------------
+VEC2 CBoard::GetBallVel() const
+{
+	VEC2 v = m_vBallVel;
+
+	if( m_Balls.GetCount() )
+	{
+		v.x = m_Balls.GetVelX( 0 );
+		v.y = m_Balls.GetVelY( 0 );
+	}
+
+	return v;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetBallRadius
+//
+//  Desc: Returns the radius of the ball.
+// ----------------------------------------------------------------------------
+float CBoard::GetBallRadius() const
+{
+	return m_fBallRadius;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetTimeStep
+//
+//  Desc: Returns the length of one step in seconds.
+// ----------------------------------------------------------------------------
+float CBoard::GetTimeStep() const
+{
+	return m_fTimeStep;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetBallCollisions
+//
+//  Desc: Returns whether balls bounce off each other.
+// ----------------------------------------------------------------------------
+bool CBoard::GetBallCollisions() const
+{
+	return m_bBallCollisions;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetBroadphase
+//
+//  Desc: Returns how the board finds the bricks near the ball.
+// ----------------------------------------------------------------------------
+Broadphase CBoard::GetBroadphase() const
+{
+	return m_Broadphase;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetCollisionMode
+//
+//  Desc: Returns how the ball moves through a step.
+// ----------------------------------------------------------------------------
+CollisionMode CBoard::GetCollisionMode() const
+{
+	return m_CollisionMode;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetScore
+//
+//  Desc: Returns the current score.
+// ----------------------------------------------------------------------------
+unsigned int CBoard::GetScore() const
+{
+	return m_nScore;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetSteps
+//
+//  Desc: Returns how many steps have been simulated since the last reset.
+// ----------------------------------------------------------------------------
+unsigned int CBoard::GetSteps() const
+{
+	return m_nSteps;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetState
+//
+//  Desc: Returns whether the board is still in play, cleared or lost.
+// ----------------------------------------------------------------------------
+BoardState CBoard::GetState() const
+{
+	return m_State;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetBallCount
+//
+//  Desc: Returns how many balls are in play.
+// ----------------------------------------------------------------------------
+int CBoard::GetBallCount() const
+{
+	return m_Balls.GetCount();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetBalls
+//
+//  Desc: Returns every ball in play, for drawing them.
+// ----------------------------------------------------------------------------
+const CBallPool* CBoard::GetBalls() const
+{
+	return &m_Balls;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetEventCount
+//
+//  Desc: Returns how many bricks the last step destroyed.
+// ----------------------------------------------------------------------------
+int CBoard::GetEventCount() const
+{
+	return (int)m_tEvents.size();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetEvents
+//
+//  Desc: Returns the bricks the last step destroyed, in the order it
+//        destroyed them.
+// ----------------------------------------------------------------------------
+const BRICKEVENT* CBoard::GetEvents() const
+{
+	return m_tEvents.empty() ? NULL : &m_tEvents[0];
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetLives
+//
+//  Desc: Returns how many balls the player can lose in a game.
+// ----------------------------------------------------------------------------
+int CBoard::GetLives() const
+{
+	return m_nLives;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetLivesLost
+//
+//  Desc: Returns how many balls the player has lost so far.
+// ----------------------------------------------------------------------------
+int CBoard::GetLivesLost() const
+{
+	return m_nLivesLost;
+}
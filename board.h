@@ -0,0 +1,289 @@
+// ----------------------------------------------------------------------------
+//  Filename: board.h
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+#pragma once
+
+// Length of one simulation step, in seconds.
+#define BOARD_TIMESTEP			(1.0f / 120.0f)
+
+// Brick layout. Slot (x, y) of a standard size level is centered at
+// (BRICK_ORIGIN_X + BRICK_PITCH_X * x, BRICK_ORIGIN_Y - BRICK_PITCH_Y * y).
+// Bigger levels keep the same bricks and the field grows to fit them, half
+// of the extra width on each side and all of the extra height at the top.
+#define BRICK_ORIGIN_X			-0.9f
+#define BRICK_ORIGIN_Y			0.9f
+#define BRICK_PITCH_X			0.19f
+#define BRICK_PITCH_Y			0.08f
+#define BRICK_HALF_WIDTH		0.075f
+#define BRICK_HALF_HEIGHT		0.02f
+
+// Walls of the playing field for a standard size level.
+#define WALL_LEFT				-1.0f
+#define WALL_RIGHT				0.99f
+#define WALL_TOP				1.0f
+#define WALL_BOTTOM				-1.0f
+
+// The ball sits still on the paddle for BALL_LAUNCH_DELAY seconds, then
+// takes off with the launch velocity.
+#define BALL_RADIUS				0.03f
+#define BALL_LAUNCH_DELAY		2
+#define BALL_LAUNCH_X			0.7f
+#define BALL_LAUNCH_Y			0.6f
+
+// The paddle. PADDLE_MOUSE_SCALE is how far one mouse count moves the
+// paddle, PADDLE_TRAVEL is how far off center it may go and the ball is lost
+// once it drops PADDLE_LOSE_DEPTH below it.
+#define PADDLE_START_Y			-0.75f
+#define PADDLE_HALF_WIDTH		0.25f
+#define PADDLE_HALF_HEIGHT		0.02f
+#define PADDLE_TRAVEL			0.75f
+#define PADDLE_MOUSE_SCALE		(0.1f / 60.0f)
+#define PADDLE_LOSE_DEPTH		0.2f
+
+// Most bounces the swept collision mode handles in one step.
+#define BOARD_MAX_BOUNCES		8
+
+// How many bounces ahead the autopilot looks for where the ball comes down.
+#define BOARD_PREDICT_BOUNCES	16
+
+// How the board finds the bricks the ball might hit. The linear scan tests
+// every row, the grid only the slots under the ball's swept bounds and the
+// tree only the bricks whose bounds the ball's swept bounds overlap. Levels
+// with bricks that move always use the tree, in every mode but fixed, since
+// their bricks aren't in their slots.
+enum Broadphase
+{
+	BroadphaseLinear = 1,
+	BroadphaseGrid,
+	BroadphaseTree
+};
+
+// How the ball moves through a step. Discrete mode moves it and then looks
+// for overlaps at the end position. Swept mode finds the earliest time of
+// impact along the way and bounces as many times as the step needs. Fixed
+// mode is discrete mode done in Q16.16 fixed point, paddle and all, so a game
+// plays out to the same bits on every build.
+enum CollisionMode
+{
+	CollideDiscrete = 1,
+	CollideSwept,
+	CollideFixed
+};
+
+enum BoardState
+{
+	BoardPlaying = 1,
+	BoardCleared,
+	BoardLost
+};
+
+// Plain two component vector. The board is flat, so there's no z.
+struct VEC2
+{
+	float x, y;
+};
+
+// What a predicted path runs into.
+enum PathEvent
+{
+	PathWall = 1,
+	PathPaddle,
+	PathBrick,
+	PathLost,		// Falls past the paddle. The path ends here.
+	PathEnd			// Runs out of time first. The path ends here too.
+};
+
+// A point on a predicted path: where the ball is when it hits something,
+// and how it goes off again.
+struct PATHPOINT
+{
+	PathEvent	Event;
+	VEC2		vPos;
+	VEC2		vVel;
+	float		fTime;		// Seconds from the start of the path.
+	int			nBrick;		// The brick it hits, or -1.
+};
+
+// A brick destroyed during the last step, for effects. Where it was and what
+// it was, since it's gone from the board by the time anyone looks.
+struct BRICKEVENT
+{
+	int		nBrick;
+	int		nType;
+	VEC2	vPos;
+	VEC2	vHalfSize;
+	VEC2	vBallVel;		// How the ball that hit it went off again.
+};
+
+// Everything the player can do to the board during a single step.
+struct BOARDINPUT
+{
+	int		nMouseX;	// Relative mouse movement in counts since the last step.
+};
+
+// Everything about a board that changes as it's played, so it can be put
+// back the way it was. Only good for the board and level it came from.
+struct BOARDSNAPSHOT
+{
+	unsigned int		nSteps;
+	unsigned int		nScore;
+	int					nLivesLost;
+	BoardState			State;
+
+	VEC2				vPaddlePos;
+	VEC2				vPrevPaddlePos;
+	FVEC2				qPaddlePos;
+	VEC2				vBallPos;
+	VEC2				vBallVel;
+
+	float				fSecondCount;
+	int					nBallTimer;
+
+	CBallPool			Balls;
+	BRICKPAGES			pBricks;
+};
+
+class CBoard
+{
+protected:
+	int						m_nColumns;
+	int						m_nRows;
+
+	CBrickSet				m_Bricks;
+	vector<int>				m_tHits;
+	vector<int>				m_tFound;		// Bricks the tree finds.
+
+	// Where the bricks and walls are, for the size of the level.
+	float			m_fOriginX;
+	float			m_fOriginY;
+	float			m_fWallLeft;
+	float			m_fWallRight;
+	float			m_fWallTop;
+	float			m_fWallBottom;
+	float			m_fPaddleTravel;
+	float			m_fMouseScale;
+
+	// The same in fixed point, for the fixed collision mode. The paddle and
+	// the ball being moved are kept in fixed point too, and only copied out
+	// to the floats.
+	FIXED			m_qOriginX;
+	FIXED			m_qOriginY;
+	FIXED			m_qWallLeft;
+	FIXED			m_qWallRight;
+	FIXED			m_qWallTop;
+	FIXED			m_qWallBottom;
+	FIXED			m_qPaddleTravel;
+	FIXED			m_qMouseScale;
+	FIXED			m_qBallRadius;
+
+	FVEC2			m_qPaddlePos;
+	FVEC2			m_qBallPos;
+	FVEC2			m_qBallVel;
+
+	CBallPool				m_Balls;
+	vector<int>				m_tBusy;
+	vector<BRICKEVENT>		m_tEvents;
+
+	VEC2			m_vPaddlePos;
+	VEC2			m_vPrevPaddlePos;
+
+	// The ball being moved. The collision checks work on this copy, one ball
+	// at a time.
+	VEC2			m_vBallPos;
+	VEC2			m_vBallVel;
+
+	float			m_fBallRadius;
+	VEC2			m_vLaunch;
+
+	float			m_fTimeStep;
+	float			m_fSecondCount;
+	int				m_nBallTimer;
+
+	unsigned int	m_nScore;
+	unsigned int	m_nSteps;
+
+	int				m_nLives;
+	int				m_nLivesLost;
+
+	BoardState		m_State;
+	Broadphase		m_Broadphase;
+	CollisionMode	m_CollisionMode;
+	bool			m_bBallCollisions;
+
+protected:
+	bool	UseTree() const;
+	void	MovePaddle( int nMouseX );
+	void	ServeBall();
+	void	MoveBalls( float fElapsedTime );
+	void	MoveBall( int i, float fElapsedTime );
+	void	CheckForCollisions( float fElapsedTime );
+	bool	CheckBrick( int i, float newx, float newy, float fElapsedTime );
+	bool	CheckCorner( float cx, float cy, float newx, float newy, float fElapsedTime );
+	void	SweepBall( float fElapsedTime );
+	bool	SweepBrick( int i, VEC2 p, VEC2 d, float* t, VEC2* n ) const;
+	bool	SweepBricks( VEC2 p, VEC2 d, const PATHPOINT* pPath, int nPoints, float* t, VEC2* n, int* pBrick, vector<int>* pCast ) const;
+	void	DestroyBrick( int i );
+	void	CheckWalls();
+	void	CheckPaddle();
+
+	void	MoveBallFixed( int i, FIXED qElapsedTime );
+	bool	GetCellRangeFixed( FIXED qMinX, FIXED qMinY, FIXED qMaxX, FIXED qMaxY, int* x0, int* y0, int* x1, int* y1 ) const;
+	void	CheckForCollisionsFixed( FIXED qElapsedTime );
+	bool	CheckBrickFixed( int i, FVEC2 vNew, FIXED qElapsedTime );
+	bool	CheckCornerFixed( FIXED cx, FIXED cy, FVEC2 vNew, FIXED qElapsedTime );
+	void	CheckWallsFixed();
+	void	CheckPaddleFixed();
+
+public:
+	CBoard();
+	virtual ~CBoard();
+
+	void		Reset( const CLevel* pLevel );
+	BoardState	Step( const BOARDINPUT& input );
+	void		SaveState( BOARDSNAPSHOT* pSnapshot );
+	void		LoadState( const BOARDSNAPSHOT* pSnapshot );
+
+	void		SetBroadphase( Broadphase bp );
+	void		SetCollisionMode( CollisionMode mode );
+	void		SetBallCollisions( bool bEnable );
+	void		SetTimeStep( float fTimeStep );
+	void		SetLives( int nLives );
+	void		SetLaunch( float fVelX, float fVelY );
+	int			AddBall( VEC2 vPos, VEC2 vVel );
+	bool		GetCellRange( float fMinX, float fMinY, float fMaxX, float fMaxY, int* x0, int* y0, int* x1, int* y1 ) const;
+	int			TrackBall( int nMaxCounts ) const;
+	int			PredictPath( VEC2 vPos, VEC2 vVel, float fMaxTime, PATHPOINT* pPath, int nPoints ) const;
+	int			AutoPilot( int nMaxCounts ) const;
+
+	int			GetColumns() const;
+	int			GetRows() const;
+	int			GetBrick( int x, int y ) const;
+	void		GetBrickCenter( int x, int y, float* bx, float* by ) const;
+	int			GetTotalBricks() const;
+	const CBrickSet*	GetBricks() const;
+	void		GetWalls( float* pLeft, float* pTop, float* pRight, float* pBottom ) const;
+	float		GetMouseScale() const;
+
+	VEC2		GetPaddlePos() const;
+	VEC2		GetPrevPaddlePos() const;
+	VEC2		GetBallPos() const;
+	VEC2		GetBallVel() const;
+	float		GetBallRadius() const;
+	int			GetBallCount() const;
+	const CBallPool*	GetBalls() const;
+	int			GetEventCount() const;
+	const BRICKEVENT*	GetEvents() const;
+
+	float		GetTimeStep() const;
+	Broadphase	GetBroadphase() const;
+	CollisionMode	GetCollisionMode() const;
+	bool		GetBallCollisions() const;
+	unsigned int	GetScore() const;
+	unsigned int	GetSteps() const;
+	BoardState	GetState() const;
+	int			GetLives() const;
+	int			GetLivesLost() const;
+};
@@ -0,0 +1,1342 @@
+// ----------------------------------------------------------------------------
+//  Filename: bricks.cpp
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+
+
+
+
+// Preprocessor directives.
+#include "sim.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define BRICKS_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only let a function use AVX instructions if it's marked for
+// them. The Microsoft compiler takes them anywhere.
+#if defined(__GNUC__)
+#define TARGET_AVX		__attribute__((target("avx")))
+#define TARGET_AVX512	__attribute__((target("avx512f")))
+#else
+#define TARGET_AVX
+#define TARGET_AVX512
+#endif
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: BitScan
+//
+//  Desc: Returns the index of the lowest set bit. n must not be 0.
+// ----------------------------------------------------------------------------
+static inline int BitScan( unsigned int n )
+{
+#if defined(_MSC_VER)
+	unsigned long i;
+
+	_BitScanForward( &i, n );
+
+	return (int)i;
+#else
+	return __builtin_ctz( n );
+#endif
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: BitScan64
+//
+//  Desc: Returns the index of the lowest set bit of a 64-bit word. n must not
+//        be 0.
+// ----------------------------------------------------------------------------
+static inline int BitScan64( uint64_t n )
+{
+#if defined(_MSC_VER)
+	if( (unsigned int)n ) return BitScan( (unsigned int)n );
+
+	return 32 + BitScan( (unsigned int)(n >> 32) );
+#else
+	return __builtin_ctzll( n );
+#endif
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: PopCount64
+//
+//  Desc: Counts the set bits of a 64-bit word.
+// ----------------------------------------------------------------------------
+static inline int PopCount64( uint64_t n )
+{
+#if defined(_MSC_VER)
+	// The popcnt instruction isn't on every processor we run on, so add the
+	// bits up in parallel instead.
+	n = n - ((n >> 1) & 0x5555555555555555ull);
+	n = (n & 0x3333333333333333ull) + ((n >> 2) & 0x3333333333333333ull);
+	n = (n + (n >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+
+	return (int)((n * 0x0101010101010101ull) >> 56);
+#else
+	return __builtin_popcountll( n );
+#endif
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: RowMask
+//
+//  Desc: Returns the bits of a chunk that cover slots x0 to x1 of row y of
+//        the chunk. The columns are clipped to the chunk.
+// ----------------------------------------------------------------------------
+static inline uint64_t RowMask( int y, int x0, int x1 )
+{
+	if( x0 < 0 ) x0 = 0;
+	if( x1 > (LEVEL_CHUNK_SIZE - 1) ) x1 = LEVEL_CHUNK_SIZE - 1;
+
+	if( x0 > x1 ) return 0;
+
+	return (uint64_t)((0xFFu << x0) & (0xFFu >> ((LEVEL_CHUNK_SIZE - 1) - x1))) << (y * LEVEL_CHUNK_SIZE);
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: AddHits
+//
+//  Desc: Turns a mask of overlapping bricks from a batch starting at brick i
+//        into brick numbers.
+// ----------------------------------------------------------------------------
+static inline int AddHits( unsigned int nMask, int i, int* pHits )
+{
+	int n = 0;
+
+	while( nMask )
+	{
+		pHits[n++] = i + BitScan( nMask );
+		nMask &= nMask - 1;
+	}
+
+	return n;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: KernelScalarOverlaps
+//
+//  Desc: Finds the bricks numbered nFirst to nEnd - 1 that the circle at x, y
+//        overlaps, one brick at a time. The distance from the circle to a box
+//        is the length of how far it lies outside the box on each axis.
+//        Returns how many brick numbers were written to pHits.
+// ----------------------------------------------------------------------------
+static int KernelScalarOverlaps( const BRICKARRAYS* pBricks, int nFirst, int nEnd, float x, float y, float r, int* pHits )
+{
+	float	dx, dy;
+	int		n = 0;
+
+	for( int i = nFirst; i < nEnd; i++ )
+	{
+		dx = fabsf( x - pBricks->pCenterX[i] ) - pBricks->pHalfWidth[i];
+		dy = fabsf( y - pBricks->pCenterY[i] ) - pBricks->pHalfHeight[i];
+
+		if( dx < 0.0f ) dx = 0.0f;
+		if( dy < 0.0f ) dy = 0.0f;
+
+		if( (pBricks->pType[i] > 0.0f) && (((dx * dx) + (dy * dy)) <= (r * r)) ) pHits[n++] = i;
+	}
+
+	return n;
+}
+
+
+
+
+#ifdef BRICKS_X86
+// ----------------------------------------------------------------------------
+//  Name: KernelSSEOverlaps
+//
+//  Desc: Same as the scalar kernel, 4 bricks at a time.
+// ----------------------------------------------------------------------------
+static int KernelSSEOverlaps( const BRICKARRAYS* pBricks, int nFirst, int nEnd, float x, float y, float r, int* pHits )
+{
+	const __m128	vAbs = _mm_castsi128_ps( _mm_set1_epi32( 0x7FFFFFFF ) );
+	const __m128	vZero = _mm_setzero_ps();
+	const __m128	vX = _mm_set1_ps( x );
+	const __m128	vY = _mm_set1_ps( y );
+	const __m128	vR2 = _mm_set1_ps( r * r );
+	__m128			dx, dy, m;
+	unsigned int	nMask;
+	int				n = 0;
+
+	for( int i = nFirst; i < nEnd; i += 4 )
+	{
+		dx = _mm_and_ps( _mm_sub_ps( vX, _mm_loadu_ps( pBricks->pCenterX + i ) ), vAbs );
+		dy = _mm_and_ps( _mm_sub_ps( vY, _mm_loadu_ps( pBricks->pCenterY + i ) ), vAbs );
+
+		dx = _mm_max_ps( _mm_sub_ps( dx, _mm_loadu_ps( pBricks->pHalfWidth + i ) ), vZero );
+		dy = _mm_max_ps( _mm_sub_ps( dy, _mm_loadu_ps( pBricks->pHalfHeight + i ) ), vZero );
+
+		m = _mm_cmple_ps( _mm_add_ps( _mm_mul_ps( dx, dx ), _mm_mul_ps( dy, dy ) ), vR2 );
+		m = _mm_and_ps( m, _mm_cmpgt_ps( _mm_loadu_ps( pBricks->pType + i ), vZero ) );
+
+		nMask = (unsigned int)_mm_movemask_ps( m );
+
+		// Drop anything read past the end of the range.
+		if( (nEnd - i) < 4 ) nMask &= (1u << (nEnd - i)) - 1;
+
+		n += AddHits( nMask, i, pHits + n );
+	}
+
+	return n;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: KernelAVXOverlaps
+//
+//  Desc: Same as the scalar kernel, 8 bricks at a time.
+// ----------------------------------------------------------------------------
+TARGET_AVX static int KernelAVXOverlaps( const BRICKARRAYS* pBricks, int nFirst, int nEnd, float x, float y, float r, int* pHits )
+{
+	const __m256	vAbs = _mm256_castsi256_ps( _mm256_set1_epi32( 0x7FFFFFFF ) );
+	const __m256	vZero = _mm256_setzero_ps();
+	const __m256	vX = _mm256_set1_ps( x );
+	const __m256	vY = _mm256_set1_ps( y );
+	const __m256	vR2 = _mm256_set1_ps( r * r );
+	__m256			dx, dy, m;
+	unsigned int	nMask;
+	int				n = 0;
+
+	for( int i = nFirst; i < nEnd; i += 8 )
+	{
+		dx = _mm256_and_ps( _mm256_sub_ps( vX, _mm256_loadu_ps( pBricks->pCenterX + i ) ), vAbs );
+		dy = _mm256_and_ps( _mm256_sub_ps( vY, _mm256_loadu_ps( pBricks->pCenterY + i ) ), vAbs );
+
+		dx = _mm256_max_ps( _mm256_sub_ps( dx, _mm256_loadu_ps( pBricks->pHalfWidth + i ) ), vZero );
+		dy = _mm256_max_ps( _mm256_sub_ps( dy, _mm256_loadu_ps( pBricks->pHalfHeight + i ) ), vZero );
+
+		m = _mm256_cmp_ps( _mm256_add_ps( _mm256_mul_ps( dx, dx ), _mm256_mul_ps( dy, dy ) ), vR2, _CMP_LE_OQ );
+		m = _mm256_and_ps( m, _mm256_cmp_ps( _mm256_loadu_ps( pBricks->pType + i ), vZero, _CMP_GT_OQ ) );
+
+		nMask = (unsigned int)_mm256_movemask_ps( m );
+
+		if( (nEnd - i) < 8 ) nMask &= (1u << (nEnd - i)) - 1;
+
+		n += AddHits( nMask, i, pHits + n );
+	}
+
+	return n;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: KernelAVX512Overlaps
+//
+//  Desc: Same as the scalar kernel, 16 bricks at a time.
+// ----------------------------------------------------------------------------
+TARGET_AVX512 static int KernelAVX512Overlaps( const BRICKARRAYS* pBricks, int nFirst, int nEnd, float x, float y, float r, int* pHits )
+{
+	const __m512i	vAbs = _mm512_set1_epi32( 0x7FFFFFFF );
+	const __m512	vZero = _mm512_setzero_ps();
+	const __m512	vX = _mm512_set1_ps( x );
+	const __m512	vY = _mm512_set1_ps( y );
+	const __m512	vR2 = _mm512_set1_ps( r * r );
+	__m512			dx, dy;
+	unsigned int	nMask;
+	int				n = 0;
+
+	for( int i = nFirst; i < nEnd; i += 16 )
+	{
+		dx = _mm512_castsi512_ps( _mm512_and_epi32( _mm512_castps_si512( _mm512_sub_ps( vX, _mm512_loadu_ps( pBricks->pCenterX + i ) ) ), vAbs ) );
+		dy = _mm512_castsi512_ps( _mm512_and_epi32( _mm512_castps_si512( _mm512_sub_ps( vY, _mm512_loadu_ps( pBricks->pCenterY + i ) ) ), vAbs ) );
+
+		// The zero masked max is the plain one with every lane enabled. Some
+		// GCC headers warn about the plain one.
+		dx = _mm512_maskz_max_ps( 0xFFFF, _mm512_sub_ps( dx, _mm512_loadu_ps( pBricks->pHalfWidth + i ) ), vZero );
+		dy = _mm512_maskz_max_ps( 0xFFFF, _mm512_sub_ps( dy, _mm512_loadu_ps( pBricks->pHalfHeight + i ) ), vZero );
+
+		nMask = _mm512_cmp_ps_mask( _mm512_add_ps( _mm512_mul_ps( dx, dx ), _mm512_mul_ps( dy, dy ) ), vR2, _CMP_LE_OQ );
+		nMask &= _mm512_cmp_ps_mask( _mm512_loadu_ps( pBricks->pType + i ), vZero, _CMP_GT_OQ );
+
+		if( (nEnd - i) < 16 ) nMask &= (1u << (nEnd - i)) - 1;
+
+		n += AddHits( nMask, i, pHits + n );
+	}
+
+	return n;
+}
+#endif
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CpuSupports
+//
+//  Desc: Asks the processor, and the operating system, whether a kernel's
+//        instructions can be used.
+// ----------------------------------------------------------------------------
+static bool CpuSupports( BrickKernel kernel )
+{
+	switch( kernel )
+	{
+	case KernelScalar:
+		return true;
+
+#ifdef BRICKS_X86
+#if defined(_MSC_VER)
+	case KernelSSE:
+		return true;
+
+	case KernelAVX:
+	case KernelAVX512:
+		{
+			int info[4];
+
+			// The processor has to have AVX and the OS has to save the
+			// registers for it.
+			__cpuid( info, 1 );
+			if( !(info[2] & (1 << 27)) || !(info[2] & (1 << 28)) ) return false;
+			if( (_xgetbv( 0 ) & 0x06) != 0x06 ) return false;
+
+			if( kernel == KernelAVX ) return true;
+
+			__cpuidex( info, 7, 0 );
+			if( !(info[1] & (1 << 16)) ) return false;
+
+			return ((_xgetbv( 0 ) & 0xE6) == 0xE6);
+		}
+#elif defined(__GNUC__)
+	case KernelSSE:
+		return __builtin_cpu_supports( "sse2" ) != 0;
+
+	case KernelAVX:
+		return __builtin_cpu_supports( "avx" ) != 0;
+
+	case KernelAVX512:
+		return __builtin_cpu_supports( "avx512f" ) != 0;
+#endif
+#endif
+
+	default:
+		return false;
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: KernelFunction
+//
+//  Desc: Returns the function that implements a kernel.
+// ----------------------------------------------------------------------------
+static PFNBRICKKERNEL KernelFunction( BrickKernel kernel )
+{
+	switch( kernel )
+	{
+#ifdef BRICKS_X86
+	case KernelSSE:
+		return KernelSSEOverlaps;
+
+	case KernelAVX:
+		return KernelAVXOverlaps;
+
+	case KernelAVX512:
+		return KernelAVX512Overlaps;
+#endif
+
+	default:
+		return KernelScalarOverlaps;
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: BestKernel
+//
+//  Desc: Returns the widest kernel this machine can run.
+// ----------------------------------------------------------------------------
+static BrickKernel BestKernel()
+{
+	if( CpuSupports( KernelAVX512 ) ) return KernelAVX512;
+	if( CpuSupports( KernelAVX ) ) return KernelAVX;
+	if( CpuSupports( KernelSSE ) ) return KernelSSE;
+
+	return KernelScalar;
+}
+
+
+
+
+// Global declarations. The kernel is picked before main runs, so boards on
+// different threads never race to set it.
+BrickKernel		CBrickSet::s_Kernel = BestKernel();
+PFNBRICKKERNEL	CBrickSet::s_pfnKernel = KernelFunction( CBrickSet::s_Kernel );
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CBrickSet
+//
+//  Desc: Constructor
+// ----------------------------------------------------------------------------
+CBrickSet::CBrickSet()
+{
+	m_nColumns	= 0;
+	m_nRows		= 0;
+	m_nLive		= 0;
+	m_bDirty	= true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: ~CBrickSet
+//
+//  Desc: Destructor
+// ----------------------------------------------------------------------------
+CBrickSet::~CBrickSet()
+{
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Build
+//
+//  Desc: Lays out the bricks of a level, with slot (0, 0) centered at
+//        fOriginX, fOriginY.
+// ----------------------------------------------------------------------------
+void CBrickSet::Build( const CLevel* pLevel, float fOriginX, float fOriginY )
+{
+	const LEVELCHUNK*	pCells;
+	const LEVELMOTION*	pMotion;
+	const LEVELEXTENTS*	pExtents;
+	BRICKCHUNK*			pChunk;
+	BRICKMOVER			mover;
+	vector<int>			tRow;		// Motion of each row, or -1.
+	uint64_t			nBits;
+	int					c, i, t, x, y, nSlot;
+	int					nBricks = 0;
+
+	m_nColumns = pLevel->GetColumns();
+	m_nRows = pLevel->GetRows();
+
+	m_tChunks.resize( pLevel->GetChunkCount() );
+	m_tBuiltBits.resize( m_tChunks.size() * BRICK_TYPES );
+
+	// Nothing has been snapshotted yet.
+	m_tPages.assign( (m_tChunks.size() + BRICKS_PAGE_CHUNKS - 1) / BRICKS_PAGE_CHUNKS, BRICKPAGE() );
+	m_tDirty.assign( m_tPages.size(), 1 );
+	m_pPages.reset();
+	m_bDirty = true;
+	m_tBands.assign( ((m_nRows + LEVEL_CHUNK_SIZE - 1) >> LEVEL_CHUNK_SHIFT) + 1, 0 );
+
+	for( c = 0; c < (int)m_tChunks.size(); c++ )
+	{
+		pCells = pLevel->GetChunk( c );
+		pChunk = &m_tChunks[c];
+
+		pChunk->nX = pCells->nX;
+		pChunk->nY = pCells->nY;
+		pChunk->nFirst = nBricks;
+		pChunk->nBuilt = pCells->nBits[0];
+
+		for( t = 0; t <= BRICK_TYPES; t++ )
+		{
+			pChunk->nBits[t] = pCells->nBits[t];
+		}
+
+		for( t = 1; t <= BRICK_TYPES; t++ )
+		{
+			m_tBuiltBits[(c * BRICK_TYPES) + t - 1] = pCells->nBits[t];
+		}
+
+		m_tBands[pChunk->nY + 1] = c + 1;
+
+		nBricks += PopCount64( pChunk->nBuilt );
+	}
+
+	// Rows of chunks with nothing in them end where the one before did.
+	for( c = 1; c < (int)m_tBands.size(); c++ )
+	{
+		if( m_tBands[c] < m_tBands[c - 1] ) m_tBands[c] = m_tBands[c - 1];
+	}
+
+	m_tCenterX.assign( nBricks + BRICKS_PADDING, 0.0f );
+	m_tCenterY.assign( nBricks + BRICKS_PADDING, 0.0f );
+	m_tHalfWidth.assign( nBricks + BRICKS_PADDING, 0.0f );
+	m_tHalfHeight.assign( nBricks + BRICKS_PADDING, 0.0f );
+	m_tType.assign( nBricks + BRICKS_PADDING, 0.0f );
+
+	m_tChunk.resize( nBricks );
+	m_tSlot.resize( nBricks );
+
+	// A compiled level laid out for this origin already has every brick's
+	// extents worked out, and they come straight across.
+	pExtents = pLevel->GetExtents();
+
+	if( pExtents && ((pExtents->fOriginX != fOriginX) || (pExtents->fOriginY != fOriginY) || (pExtents->nBricks != nBricks)) )
+	{
+		pExtents = NULL;
+	}
+
+	if( pExtents && nBricks )
+	{
+		memcpy( &m_tCenterX[0], pExtents->pCenterX, nBricks * sizeof(float) );
+		memcpy( &m_tCenterY[0], pExtents->pCenterY, nBricks * sizeof(float) );
+		memcpy( &m_tHalfWidth[0], pExtents->pHalfWidth, nBricks * sizeof(float) );
+		memcpy( &m_tHalfHeight[0], pExtents->pHalfHeight, nBricks * sizeof(float) );
+	}
+
+	for( c = 0; c < (int)m_tChunks.size(); c++ )
+	{
+		pChunk = &m_tChunks[c];
+		i = pChunk->nFirst;
+
+		for( nBits = pChunk->nBuilt; nBits; nBits &= nBits - 1 )
+		{
+			nSlot = BitScan64( nBits );
+
+			if( !pExtents )
+			{
+				x = (pChunk->nX << LEVEL_CHUNK_SHIFT) + (nSlot & (LEVEL_CHUNK_SIZE - 1));
+				y = (pChunk->nY << LEVEL_CHUNK_SHIFT) + (nSlot >> LEVEL_CHUNK_SHIFT);
+
+				m_tCenterX[i] = fOriginX + (BRICK_PITCH_X * x);
+				m_tCenterY[i] = fOriginY - (BRICK_PITCH_Y * y);
+				m_tHalfWidth[i] = BRICK_HALF_WIDTH;
+				m_tHalfHeight[i] = BRICK_HALF_HEIGHT;
+			}
+
+			for( t = 1; t <= BRICK_TYPES; t++ )
+			{
+				if( pChunk->nBits[t] & (nBits & (0 - nBits)) ) m_tType[i] = (float)t;
+			}
+
+			m_tChunk[i] = c;
+			m_tSlot[i] = (unsigned char)nSlot;
+
+			i++;
+		}
+	}
+
+	m_nLive = nBricks;
+
+	// Work out which bricks move. Rows told to do neither don't count.
+	m_tAngle.clear();
+	m_tBoundX.clear();
+	m_tBoundY.clear();
+	m_tMovers.clear();
+	m_tMotions.clear();
+	m_Tree.Clear();
+
+	tRow.assign( m_nRows, -1 );
+
+	for( c = 0; c < pLevel->GetMotionCount(); c++ )
+	{
+		pMotion = pLevel->GetMotion( c );
+
+		if( (pMotion->nRow < 0) || (pMotion->nRow >= m_nRows) ) continue;
+		if( (pMotion->fPeriod <= 0.0f) && (pMotion->fSpin == 0.0f) ) continue;
+
+		tRow[pMotion->nRow] = (int)m_tMotions.size();
+		m_tMotions.push_back( *pMotion );
+	}
+
+	if( m_tMotions.empty() ) return;
+
+	for( i = 0; i < nBricks; i++ )
+	{
+		GetSlot( i, &x, &y );
+
+		if( tRow[y] < 0 ) continue;
+
+		mover.nBrick = i;
+		mover.fHomeX = m_tCenterX[i];
+		mover.fHomeY = m_tCenterY[i];
+		mover.nMotion = tRow[y];
+
+		m_tMovers.push_back( mover );
+	}
+
+	if( m_tMovers.empty() ) return;
+
+	// Bricks sit in their slots until they're first animated.
+	m_tAngle.assign( nBricks + BRICKS_PADDING, 0.0f );
+	m_tBoundX = m_tHalfWidth;
+	m_tBoundY = m_tHalfHeight;
+
+	BuildTree();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Destroy
+//
+//  Desc: Removes the given brick.
+// ----------------------------------------------------------------------------
+void CBrickSet::Destroy( int i )
+{
+	BRICKCHUNK*	pChunk = &m_tChunks[m_tChunk[i]];
+	uint64_t	nBit = (uint64_t)1 << m_tSlot[i];
+
+	if( !(pChunk->nBits[0] & nBit) ) return;
+
+	for( int t = 0; t <= BRICK_TYPES; t++ )
+	{
+		pChunk->nBits[t] &= ~nBit;
+	}
+
+	m_tType[i] = 0.0f;
+	m_nLive--;
+
+	m_tDirty[m_tChunk[i] / BRICKS_PAGE_CHUNKS] = 1;
+	m_bDirty = true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: SaveLive
+//
+//  Desc: Gets which bricks are left, for a snapshot. Pages nothing has
+//        happened to since the last snapshot are shared with it.
+// ----------------------------------------------------------------------------
+void CBrickSet::SaveLive( BRICKPAGES* pPages )
+{
+	vector<uint64_t>*	pPage;
+	int					c, nEnd;
+
+	if( m_bDirty )
+	{
+		for( int p = 0; p < (int)m_tPages.size(); p++ )
+		{
+			if( !m_tDirty[p] ) continue;
+
+			c = p * BRICKS_PAGE_CHUNKS;
+			nEnd = min( c + BRICKS_PAGE_CHUNKS, (int)m_tChunks.size() );
+
+			pPage = new vector<uint64_t>( nEnd - c );
+
+			for( int i = c; i < nEnd; i++ )
+			{
+				(*pPage)[i - c] = m_tChunks[i].nBits[0];
+			}
+
+			m_tPages[p] = BRICKPAGE( pPage );
+			m_tDirty[p] = 0;
+		}
+
+		m_pPages = BRICKPAGES( new vector<BRICKPAGE>( m_tPages ) );
+		m_bDirty = false;
+	}
+
+	*pPages = m_pPages;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: LoadLive
+//
+//  Desc: Puts the bricks back the way SaveLive found them. Only pages that
+//        differ from the ones already in place are gone through.
+// ----------------------------------------------------------------------------
+void CBrickSet::LoadLive( const BRICKPAGES& pPages )
+{
+	int c, nEnd;
+
+	if( !m_bDirty && (pPages == m_pPages) ) return;
+
+	for( int p = 0; p < (int)m_tPages.size(); p++ )
+	{
+		if( !m_tDirty[p] && ((*pPages)[p] == m_tPages[p]) ) continue;
+
+		c = p * BRICKS_PAGE_CHUNKS;
+		nEnd = min( c + BRICKS_PAGE_CHUNKS, (int)m_tChunks.size() );
+
+		for( int i = c; i < nEnd; i++ )
+		{
+			RestoreChunk( i, (*(*pPages)[p])[i - c] );
+		}
+
+		m_tPages[p] = (*pPages)[p];
+		m_tDirty[p] = 0;
+	}
+
+	m_pPages = pPages;
+	m_bDirty = false;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: RestoreChunk
+//
+//  Desc: Sets which slots of a chunk have a brick left. Bricks coming back
+//        get the type the level gave them.
+// ----------------------------------------------------------------------------
+void CBrickSet::RestoreChunk( int c, uint64_t nLive )
+{
+	BRICKCHUNK*	pChunk = &m_tChunks[c];
+	uint64_t	nBits, nBit;
+	int			i, t;
+
+	for( nBits = pChunk->nBits[0] ^ nLive; nBits; nBits &= nBits - 1 )
+	{
+		nBit = nBits & (0 - nBits);
+		i = pChunk->nFirst + PopCount64( pChunk->nBuilt & (nBit - 1) );
+
+		m_tType[i] = 0.0f;
+
+		if( nLive & nBit )
+		{
+			for( t = 1; t <= BRICK_TYPES; t++ )
+			{
+				if( m_tBuiltBits[(c * BRICK_TYPES) + t - 1] & nBit ) m_tType[i] = (float)t;
+			}
+
+			m_nLive++;
+		}
+		else
+		{
+			m_nLive--;
+		}
+	}
+
+	pChunk->nBits[0] = nLive;
+
+	for( t = 1; t <= BRICK_TYPES; t++ )
+	{
+		pChunk->nBits[t] = m_tBuiltBits[(c * BRICK_TYPES) + t - 1] & nLive;
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: FindOverlaps
+//
+//  Desc: Finds the live bricks numbered nFirst to nEnd - 1 that overlap the
+//        circle at x, y. Their numbers go into pHits in increasing order,
+//        which needs room for nEnd - nFirst entries. Returns how many there
+//        are.
+// ----------------------------------------------------------------------------
+int CBrickSet::FindOverlaps( int nFirst, int nEnd, float x, float y, float r, int* pHits ) const
+{
+	BRICKARRAYS bricks;
+
+	if( nFirst >= nEnd ) return 0;
+
+	bricks.pCenterX = &m_tCenterX[0];
+	bricks.pCenterY = &m_tCenterY[0];
+	bricks.pHalfWidth = &m_tHalfWidth[0];
+	bricks.pHalfHeight = &m_tHalfHeight[0];
+	bricks.pType = &m_tType[0];
+
+	return s_pfnKernel( &bricks, nFirst, nEnd, x, y, r, pHits );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: FirstChunk
+//
+//  Desc: Returns the first chunk in row of chunks cy at or right of column
+//        of chunks cx.
+// ----------------------------------------------------------------------------
+int CBrickSet::FirstChunk( int cy, int cx ) const
+{
+	int lo = m_tBands[cy];
+	int hi = m_tBands[cy + 1];
+	int mid;
+
+	while( lo < hi )
+	{
+		mid = (lo + hi) / 2;
+
+		if( m_tChunks[mid].nX < cx ) lo = mid + 1;
+		else hi = mid;
+	}
+
+	return lo;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: FindRowOverlaps
+//
+//  Desc: Finds the live bricks in columns x0 to x1 of a row that overlap the
+//        circle at x, y. Their numbers go into pHits from left to right,
+//        which needs room for x1 - x0 + 1 entries. Returns how many there
+//        are. Only chunks with bricks left in the span are tested.
+// ----------------------------------------------------------------------------
+int CBrickSet::FindRowOverlaps( int nRow, int x0, int x1, float x, float y, float r, int* pHits ) const
+{
+	const BRICKCHUNK*	pChunk;
+	BRICKARRAYS			bricks;
+	uint64_t			nMask;
+	int					c, cy, nFirst, nEnd;
+	int					n = 0;
+
+	if( (nRow < 0) || (nRow >= m_nRows) || (x0 > x1) ) return 0;
+
+	bricks.pCenterX = &m_tCenterX[0];
+	bricks.pCenterY = &m_tCenterY[0];
+	bricks.pHalfWidth = &m_tHalfWidth[0];
+	bricks.pHalfHeight = &m_tHalfHeight[0];
+	bricks.pType = &m_tType[0];
+
+	cy = nRow >> LEVEL_CHUNK_SHIFT;
+
+	for( c = FirstChunk( cy, x0 >> LEVEL_CHUNK_SHIFT ); c < m_tBands[cy + 1]; c++ )
+	{
+		pChunk = &m_tChunks[c];
+
+		if( pChunk->nX > (x1 >> LEVEL_CHUNK_SHIFT) ) break;
+
+		nMask = RowMask( nRow & (LEVEL_CHUNK_SIZE - 1), x0 - (pChunk->nX << LEVEL_CHUNK_SHIFT), x1 - (pChunk->nX << LEVEL_CHUNK_SHIFT) );
+
+		if( !(pChunk->nBits[0] & nMask) ) continue;
+
+		// The bricks the span started with are numbered one after the other,
+		// from however many the chunk had before it.
+		nFirst = pChunk->nFirst + PopCount64( pChunk->nBuilt & ((nMask & (0 - nMask)) - 1) );
+		nEnd = nFirst + PopCount64( pChunk->nBuilt & nMask );
+
+		n += s_pfnKernel( &bricks, nFirst, nEnd, x, y, r, pHits + n );
+	}
+
+	return n;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: ListSpan
+//
+//  Desc: Finds the bricks of the given type, or of any type for 0, left in
+//        columns x0 to x1 of a row. Their numbers go into pBricks from left
+//        to right. Returns how many there are.
+// ----------------------------------------------------------------------------
+int CBrickSet::ListSpan( int nType, int nRow, int x0, int x1, int* pBricks ) const
+{
+	const BRICKCHUNK*	pChunk;
+	uint64_t			nBits;
+	int					c, cy;
+	int					n = 0;
+
+	if( (nRow < 0) || (nRow >= m_nRows) || (x0 > x1) ) return 0;
+
+	cy = nRow >> LEVEL_CHUNK_SHIFT;
+
+	for( c = FirstChunk( cy, x0 >> LEVEL_CHUNK_SHIFT ); c < m_tBands[cy + 1]; c++ )
+	{
+		pChunk = &m_tChunks[c];
+
+		if( pChunk->nX > (x1 >> LEVEL_CHUNK_SHIFT) ) break;
+
+		nBits = pChunk->nBits[nType] & RowMask( nRow & (LEVEL_CHUNK_SIZE - 1), x0 - (pChunk->nX << LEVEL_CHUNK_SHIFT), x1 - (pChunk->nX << LEVEL_CHUNK_SHIFT) );
+
+		while( nBits )
+		{
+			pBricks[n++] = pChunk->nFirst + PopCount64( pChunk->nBuilt & ((nBits & (0 - nBits)) - 1) );
+			nBits &= nBits - 1;
+		}
+	}
+
+	return n;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: BuildTree
+//
+//  Desc: Builds the tree over the bricks as they are now. Levels that move
+//        get one when they're built, other levels only if it's asked for.
+// ----------------------------------------------------------------------------
+void CBrickSet::BuildTree()
+{
+	const float*	pBoundX = m_tBoundX.empty() ? &m_tHalfWidth[0] : &m_tBoundX[0];
+	const float*	pBoundY = m_tBoundY.empty() ? &m_tHalfHeight[0] : &m_tBoundY[0];
+
+	m_Tree.Build( &m_tCenterX[0], &m_tCenterY[0], pBoundX, pBoundY, (int)m_tChunk.size() );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Animate
+//
+//  Desc: Puts the bricks that move where they are fTime seconds into the
+//        game and refits the tree around them. Where they are only depends
+//        on the time, so it works the same going backwards.
+// ----------------------------------------------------------------------------
+void CBrickSet::Animate( float fTime )
+{
+	const BRICKMOVER*	pMover;
+	const LEVELMOTION*	pMotion;
+	float				fSwing, fAngle, c, s;
+	int					i;
+
+	if( m_tMovers.empty() ) return;
+
+	for( size_t k = 0; k < m_tMovers.size(); k++ )
+	{
+		pMover = &m_tMovers[k];
+		pMotion = &m_tMotions[pMover->nMotion];
+		i = pMover->nBrick;
+
+		// Ones that are gone stay where they were.
+		if( m_tType[i] == 0.0f ) continue;
+
+		fSwing = 0.0f;
+
+		if( pMotion->fPeriod > 0.0f )
+		{
+			fSwing = sinf( 6.2831853f * ((fmodf( fTime, pMotion->fPeriod ) / pMotion->fPeriod) + pMotion->fPhase) );
+		}
+
+		m_tCenterX[i] = pMover->fHomeX + (pMotion->fAmpX * fSwing);
+		m_tCenterY[i] = pMover->fHomeY + (pMotion->fAmpY * fSwing);
+
+		if( pMotion->fSpin != 0.0f )
+		{
+			fAngle = fmodf( pMotion->fSpin * fTime, 360.0f );
+
+			c = fabsf( cosf( fAngle * (3.1415927f / 180.0f) ) );
+			s = fabsf( sinf( fAngle * (3.1415927f / 180.0f) ) );
+
+			m_tAngle[i] = fAngle;
+			m_tBoundX[i] = (c * m_tHalfWidth[i]) + (s * m_tHalfHeight[i]);
+			m_tBoundY[i] = (s * m_tHalfWidth[i]) + (c * m_tHalfHeight[i]);
+		}
+	}
+
+	m_Tree.Refit( &m_tCenterX[0], &m_tCenterY[0], &m_tBoundX[0], &m_tBoundY[0] );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetOrder
+//
+//  Desc: Returns where the given brick comes when the slots are read a row
+//        at a time, from the top left.
+// ----------------------------------------------------------------------------
+int CBrickSet::GetOrder( int i ) const
+{
+	int x, y;
+
+	GetSlot( i, &x, &y );
+
+	return (y * LEVEL_MAX_SIZE) + x;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: FindInBox
+//
+//  Desc: Finds the bricks left whose bounds overlap the given box, using the
+//        tree. They go into pBricks in the order the slot lookups would find
+//        them, by row and then by column, so both ways hit the same brick
+//        first. Returns how many there are.
+// ----------------------------------------------------------------------------
+int CBrickSet::FindInBox( float fMinX, float fMinY, float fMaxX, float fMaxY, vector<int>* pBricks ) const
+{
+	const float*	pBoundX = m_tBoundX.empty() ? &m_tHalfWidth[0] : &m_tBoundX[0];
+	const float*	pBoundY = m_tBoundY.empty() ? &m_tHalfHeight[0] : &m_tBoundY[0];
+	int				i, j, k, nOrder, nCount;
+	int				n = 0;
+
+	nCount = m_Tree.FindBox( fMinX, fMinY, fMaxX, fMaxY, pBricks );
+
+	// The tree hands back whole leaves. Throw out the bricks that are gone
+	// or miss the box themselves, and sort the rest into place as they go.
+	// Nothing is ever written past the one being looked at.
+	for( j = 0; j < nCount; j++ )
+	{
+		i = (*pBricks)[j];
+
+		if( m_tType[i] == 0.0f ) continue;
+
+		if( ((m_tCenterX[i] - pBoundX[i]) > fMaxX) || ((m_tCenterX[i] + pBoundX[i]) < fMinX) ||
+			((m_tCenterY[i] - pBoundY[i]) > fMaxY) || ((m_tCenterY[i] + pBoundY[i]) < fMinY) ) continue;
+
+		nOrder = GetOrder( i );
+
+		for( k = n; (k > 0) && (GetOrder( (*pBricks)[k - 1] ) > nOrder); k-- )
+		{
+			(*pBricks)[k] = (*pBricks)[k - 1];
+		}
+
+		(*pBricks)[k] = i;
+		n++;
+	}
+
+	pBricks->resize( n );
+
+	return n;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: FindAlong
+//
+//  Desc: Finds the bricks left that a ball of radius r moving from x, y by
+//        dx, dy could run into, using the tree. They still need testing
+//        exactly. Returns how many there are.
+// ----------------------------------------------------------------------------
+int CBrickSet::FindAlong( float x, float y, float dx, float dy, float r, vector<int>* pBricks ) const
+{
+	int i, j, nCount;
+	int n = 0;
+
+	nCount = m_Tree.FindSegment( x, y, dx, dy, r, pBricks );
+
+	for( j = 0; j < nCount; j++ )
+	{
+		i = (*pBricks)[j];
+
+		if( m_tType[i] != 0.0f ) (*pBricks)[n++] = i;
+	}
+
+	pBricks->resize( n );
+
+	return n;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetColumns
+//
+//  Desc: Returns the width of the layout in slots.
+// ----------------------------------------------------------------------------
+int CBrickSet::GetColumns() const
+{
+	return m_nColumns;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetRows
+//
+//  Desc: Returns the height of the layout in slots.
+// ----------------------------------------------------------------------------
+int CBrickSet::GetRows() const
+{
+	return m_nRows;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetCount
+//
+//  Desc: Returns how many bricks the level started with. Bricks are numbered
+//        from 0 up to this.
+// ----------------------------------------------------------------------------
+int CBrickSet::GetCount() const
+{
+	return (int)m_tChunk.size();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetLive
+//
+//  Desc: Returns how many bricks are left.
+// ----------------------------------------------------------------------------
+int CBrickSet::GetLive() const
+{
+	return m_nLive;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetChunkCount
+//
+//  Desc: Returns how many chunks are kept.
+// ----------------------------------------------------------------------------
+int CBrickSet::GetChunkCount() const
+{
+	return (int)m_tChunks.size();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetBytes
+//
+//  Desc: Returns about how much memory the bricks take up.
+// ----------------------------------------------------------------------------
+size_t CBrickSet::GetBytes() const
+{
+	return (m_tChunks.size() * sizeof(BRICKCHUNK)) + (m_tBands.size() * sizeof(int)) +
+		   (m_tCenterX.size() * 5 * sizeof(float)) + (m_tChunk.size() * (sizeof(int) + sizeof(unsigned char))) +
+		   (m_tBuiltBits.size() * sizeof(uint64_t)) + ((m_tAngle.size() + m_tBoundX.size() + m_tBoundY.size()) * sizeof(float)) +
+		   (m_tMovers.size() * sizeof(BRICKMOVER)) + (m_tMotions.size() * sizeof(LEVELMOTION)) + m_Tree.GetBytes();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetBrick
+//
+//  Desc: Returns the type of brick left in the given slot.
+// ----------------------------------------------------------------------------
+int CBrickSet::GetBrick( int x, int y ) const
+{
+	uint64_t	nBit;
+	int			c;
+
+	if( (x < 0) || (x >= m_nColumns) || (y < 0) || (y >= m_nRows) ) return BrickNone;
+
+	c = FirstChunk( y >> LEVEL_CHUNK_SHIFT, x >> LEVEL_CHUNK_SHIFT );
+
+	if( (c >= m_tBands[(y >> LEVEL_CHUNK_SHIFT) + 1]) || (m_tChunks[c].nX != (x >> LEVEL_CHUNK_SHIFT)) ) return BrickNone;
+
+	nBit = (uint64_t)1 << (((y & (LEVEL_CHUNK_SIZE - 1)) * LEVEL_CHUNK_SIZE) + (x & (LEVEL_CHUNK_SIZE - 1)));
+
+	for( int t = 1; t <= BRICK_TYPES; t++ )
+	{
+		if( m_tChunks[c].nBits[t] & nBit ) return t;
+	}
+
+	return BrickNone;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: IsAnimated
+//
+//  Desc: Checks whether any of the bricks move.
+// ----------------------------------------------------------------------------
+bool CBrickSet::IsAnimated() const
+{
+	return !m_tMovers.empty();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: HasTree
+//
+//  Desc: Checks whether there's a tree to look bricks up in.
+// ----------------------------------------------------------------------------
+bool CBrickSet::HasTree() const
+{
+	return m_Tree.GetNodeCount() > 0;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetTree
+//
+//  Desc: Returns the tree over the bricks' bounds.
+// ----------------------------------------------------------------------------
+const CBoxTree* CBrickSet::GetTree() const
+{
+	return &m_Tree;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetType
+//
+//  Desc: Returns the type of the given brick, 0 once it's destroyed.
+// ----------------------------------------------------------------------------
+int CBrickSet::GetType( int i ) const
+{
+	return (int)m_tType[i];
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetSlot
+//
+//  Desc: Returns which slot of the level the given brick is in.
+// ----------------------------------------------------------------------------
+void CBrickSet::GetSlot( int i, int* x, int* y ) const
+{
+	const BRICKCHUNK* pChunk = &m_tChunks[m_tChunk[i]];
+
+	*x = (pChunk->nX << LEVEL_CHUNK_SHIFT) + (m_tSlot[i] & (LEVEL_CHUNK_SIZE - 1));
+	*y = (pChunk->nY << LEVEL_CHUNK_SHIFT) + (m_tSlot[i] >> LEVEL_CHUNK_SHIFT);
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetCenterX
+//
+//  Desc: Returns the horizontal center of the given brick.
+// ----------------------------------------------------------------------------
+float CBrickSet::GetCenterX( int i ) const
+{
+	return m_tCenterX[i];
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetCenterY
+//
+//  Desc: Returns the vertical center of the given brick.
+// ----------------------------------------------------------------------------
+float CBrickSet::GetCenterY( int i ) const
+{
+	return m_tCenterY[i];
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetHalfWidth
+//
+//  Desc: Returns half the width of the given brick.
+// ----------------------------------------------------------------------------
+float CBrickSet::GetHalfWidth( int i ) const
+{
+	return m_tHalfWidth[i];
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetHalfHeight
+//
+//  Desc: Returns half the height of the given brick.
+// ----------------------------------------------------------------------------
+float CBrickSet::GetHalfHeight( int i ) const
+{
+	return m_tHalfHeight[i];
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetAngle
+//
+//  Desc: Returns how far the given brick is turned about its center, in
+//        degrees anticlockwise.
+// ----------------------------------------------------------------------------
+float CBrickSet::GetAngle( int i ) const
+{
+	return m_tAngle.empty() ? 0.0f : m_tAngle[i];
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: IsKernelSupported
+//
+//  Desc: Checks whether this machine can run the given kernel.
+// ----------------------------------------------------------------------------
+bool CBrickSet::IsKernelSupported( BrickKernel kernel )
+{
+	return CpuSupports( kernel );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: SetKernel
+//
+//  Desc: Overrides the kernel picked at startup. Only meant for benchmarks
+//        and tests, and not while other threads are stepping boards.
+// ----------------------------------------------------------------------------
+bool CBrickSet::SetKernel( BrickKernel kernel )
+{
+	if( !CpuSupports( kernel ) ) return false;
+
+	s_Kernel = kernel;
+	s_pfnKernel = KernelFunction( kernel );
+
+	return true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetKernel
+//
+//  Desc: Returns the kernel in use.
+// ----------------------------------------------------------------------------
+BrickKernel CBrickSet::GetKernel()
+{
+	return s_Kernel;
+}
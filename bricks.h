@@ -0,0 +1,162 @@
+// ----------------------------------------------------------------------------
+//  Filename: bricks.h
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+#pragma once
+
+// The arrays are padded so a kernel can always read a full batch past the
+// last brick.
+#define BRICKS_PADDING		16
+
+// Snapshots keep which bricks are left in pages of this many chunks.
+#define BRICKS_PAGE_CHUNKS	64
+
+// Kernels for testing the ball against a batch of bricks. The widest one the
+// processor supports is picked at startup.
+enum BrickKernel
+{
+	KernelScalar = 1,
+	KernelSSE,			// 4 bricks at a time.
+	KernelAVX,			// 8 bricks at a time.
+	KernelAVX512		// 16 bricks at a time.
+};
+
+// Everything a kernel needs to know about the bricks. One entry per brick
+// the level started with, a type of 0 means it has been destroyed.
+struct BRICKARRAYS
+{
+	const float*	pCenterX;
+	const float*	pCenterY;
+	const float*	pHalfWidth;
+	const float*	pHalfHeight;
+	const float*	pType;
+};
+
+typedef int (*PFNBRICKKERNEL)( const BRICKARRAYS* pBricks, int nFirst, int nEnd, float x, float y, float r, int* pHits );
+
+// A chunk of the level, as the brick set keeps it. Bricks are numbered in
+// chunk order, and within a chunk in slot order, so the bricks of one row of
+// a chunk have consecutive numbers.
+struct BRICKCHUNK
+{
+	int			nX, nY;						// Position, in chunks.
+	int			nFirst;						// Number of the chunk's first brick.
+	uint64_t	nBuilt;						// Slots that started with a brick.
+	uint64_t	nBits[BRICK_TYPES + 1];		// Slots with a brick left, by type. [0] is every type.
+};
+
+// Which slots of a page of chunks still had a brick when a snapshot was
+// taken, and the pages of a whole level. Neither is changed once made, so
+// any number of snapshots can share one.
+typedef shared_ptr< const vector<uint64_t> > BRICKPAGE;
+typedef shared_ptr< const vector<BRICKPAGE> > BRICKPAGES;
+
+// A brick that moves, where its slot is and how it moves from there.
+struct BRICKMOVER
+{
+	int		nBrick;
+	float	fHomeX, fHomeY;
+	int		nMotion;
+};
+
+// Structure of arrays brick storage. Each property of every brick is kept in
+// its own contiguous array so the overlap test runs down them in batches.
+//
+// Only the chunks of the level that have bricks are kept, sorted by row and
+// then by column, with a bitboard per type saying which of their slots still
+// hold one. Memory goes with the number of bricks, not the size of the
+// level, and a search only ever looks at chunks that have bricks.
+//
+// Bricks of rows the level gives a motion to move through the game and
+// leave their slots, so the slot lookups can't find them. Those levels, and
+// anyone who asks for it on a still one, get a tree over the bricks' bounds
+// as well. Its shape is set when it's built and it's refit as the bricks
+// move, which is enough since they only ever swing about their slots.
+class CBrickSet
+{
+protected:
+	int					m_nColumns;
+	int					m_nRows;
+	int					m_nLive;
+
+	vector<BRICKCHUNK>	m_tChunks;
+	vector<int>			m_tBands;		// First chunk of each row of chunks, and the end.
+
+	vector<float>	m_tCenterX;
+	vector<float>	m_tCenterY;
+	vector<float>	m_tHalfWidth;
+	vector<float>	m_tHalfHeight;
+	vector<float>	m_tType;
+	vector<float>	m_tAngle;		// Degrees, only kept for levels that move.
+	vector<float>	m_tBoundX;		// Half the size of the box around each
+	vector<float>	m_tBoundY;		// brick however it's turned. Same.
+
+	vector<BRICKMOVER>	m_tMovers;
+	vector<LEVELMOTION>	m_tMotions;
+	CBoxTree			m_Tree;
+
+	vector<int>				m_tChunk;	// Chunk each brick is in.
+	vector<unsigned char>	m_tSlot;	// And its slot there.
+
+	// Slots of each type the level started with, BRICK_TYPES to a chunk, so
+	// bricks can be put back.
+	vector<uint64_t>		m_tBuiltBits;
+
+	// The pages the last snapshot got, and which have had a brick destroyed
+	// since. Only those are copied for the next one, and if there are none
+	// it gets the same pages as the last.
+	BRICKPAGES				m_pPages;
+	vector<BRICKPAGE>		m_tPages;
+	vector<unsigned char>	m_tDirty;
+	bool					m_bDirty;
+
+	static PFNBRICKKERNEL	s_pfnKernel;
+	static BrickKernel		s_Kernel;
+
+protected:
+	int		FirstChunk( int cy, int cx ) const;
+	void	RestoreChunk( int c, uint64_t nLive );
+	int		GetOrder( int i ) const;
+
+public:
+	CBrickSet();
+	virtual ~CBrickSet();
+
+	void	Build( const CLevel* pLevel, float fOriginX, float fOriginY );
+	void	Destroy( int i );
+	void	SaveLive( BRICKPAGES* pPages );
+	void	LoadLive( const BRICKPAGES& pPages );
+	void	BuildTree();
+	void	Animate( float fTime );
+
+	int		FindOverlaps( int nFirst, int nEnd, float x, float y, float r, int* pHits ) const;
+	int		FindRowOverlaps( int nRow, int x0, int x1, float x, float y, float r, int* pHits ) const;
+	int		ListSpan( int nType, int nRow, int x0, int x1, int* pBricks ) const;
+	int		FindInBox( float fMinX, float fMinY, float fMaxX, float fMaxY, vector<int>* pBricks ) const;
+	int		FindAlong( float x, float y, float dx, float dy, float r, vector<int>* pBricks ) const;
+
+	int		GetColumns() const;
+	int		GetRows() const;
+	int		GetCount() const;
+	int		GetLive() const;
+	int		GetChunkCount() const;
+	size_t	GetBytes() const;
+	int		GetBrick( int x, int y ) const;
+	bool	IsAnimated() const;
+	bool	HasTree() const;
+	const CBoxTree*	GetTree() const;
+
+	int		GetType( int i ) const;
+	void	GetSlot( int i, int* x, int* y ) const;
+	float	GetCenterX( int i ) const;
+	float	GetCenterY( int i ) const;
+	float	GetHalfWidth( int i ) const;
+	float	GetHalfHeight( int i ) const;
+	float	GetAngle( int i ) const;
+
+	static bool			IsKernelSupported( BrickKernel kernel );
+	static bool			SetKernel( BrickKernel kernel );
+	static BrickKernel	GetKernel();
+};
@@ -0,0 +1,411 @@
+// ----------------------------------------------------------------------------
+//  Filename: bvh.cpp
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+
+
+
+
+// Preprocessor directives.
+#include "sim.h"
+
+
+
+
+// Orders box numbers by their centers along one axis, for splitting a node.
+struct CenterBelow
+{
+	const float* pCenter;
+
+	CenterBelow( const float* p ) : pCenter( p ) {}
+	bool operator()( int a, int b ) const { return (pCenter[a] < pCenter[b]) || ((pCenter[a] == pCenter[b]) && (a < b)); }
+};
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: SegmentHits
+//
+//  Desc: Checks whether the segment from x, y to x + dx, y + dy passes
+//        through a node's bounds grown by r on every side.
+// ----------------------------------------------------------------------------
+static inline bool SegmentHits( const BVHNODE* pNode, float x, float y, float dx, float dy, float r )
+{
+	float t0 = 0.0f, t1 = 1.0f, ta, tb, fInv;
+
+	if( dx != 0.0f )
+	{
+		fInv = 1.0f / dx;
+		ta = (pNode->fMinX - r - x) * fInv;
+		tb = (pNode->fMaxX + r - x) * fInv;
+		if( ta > tb ) swap( ta, tb );
+
+		t0 = max( t0, ta );
+		t1 = min( t1, tb );
+	}
+	else if( (x < (pNode->fMinX - r)) || (x > (pNode->fMaxX + r)) )
+	{
+		return false;
+	}
+
+	if( dy != 0.0f )
+	{
+		fInv = 1.0f / dy;
+		ta = (pNode->fMinY - r - y) * fInv;
+		tb = (pNode->fMaxY + r - y) * fInv;
+		if( ta > tb ) swap( ta, tb );
+
+		t0 = max( t0, ta );
+		t1 = min( t1, tb );
+	}
+	else if( (y < (pNode->fMinY - r)) || (y > (pNode->fMaxY + r)) )
+	{
+		return false;
+	}
+
+	return t0 <= t1;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CBoxTree
+//
+//  Desc: Constructor
+// ----------------------------------------------------------------------------
+CBoxTree::CBoxTree()
+{
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: ~CBoxTree
+//
+//  Desc: Destructor
+// ----------------------------------------------------------------------------
+CBoxTree::~CBoxTree()
+{
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Clear
+//
+//  Desc: Empties the tree.
+// ----------------------------------------------------------------------------
+void CBoxTree::Clear()
+{
+	m_tNodes.clear();
+	m_tItems.clear();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Build
+//
+//  Desc: Builds the tree over nCount boxes, numbered 0 to nCount - 1. This is
+//        the only time its shape is worked out.
+// ----------------------------------------------------------------------------
+void CBoxTree::Build( const float* pX, const float* pY, const float* pHalfX, const float* pHalfY, int nCount )
+{
+	Clear();
+
+	if( nCount <= 0 ) return;
+
+	m_tItems.resize( nCount );
+
+	for( int i = 0; i < nCount; i++ )
+	{
+		m_tItems[i] = i;
+	}
+
+	// A tree split down to BVH_LEAF_SIZE has fewer than twice as many nodes
+	// as it has leaves.
+	m_tNodes.reserve( ((nCount / BVH_LEAF_SIZE) + 1) * 2 );
+	m_tNodes.resize( 1 );
+
+	BuildNode( 0, 0, nCount, pX, pY );
+
+	Refit( pX, pY, pHalfX, pHalfY );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: BuildNode
+//
+//  Desc: Makes node nNode hold items nFirst to nFirst + nCount - 1. Bigger
+//        nodes are split in half across the longer side of their centers.
+// ----------------------------------------------------------------------------
+void CBoxTree::BuildNode( int nNode, int nFirst, int nCount, const float* pX, const float* pY )
+{
+	float	fMinX, fMinY, fMaxX, fMaxY;
+	int		i, nChild, nHalf;
+	int*	pItems = &m_tItems[nFirst];
+
+	if( nCount <= BVH_LEAF_SIZE )
+	{
+		// Items of a leaf are kept in order, so whoever asks gets them the
+		// same way however the split went.
+		sort( pItems, pItems + nCount );
+
+		m_tNodes[nNode].nFirst = nFirst;
+		m_tNodes[nNode].nCount = nCount;
+		return;
+	}
+
+	fMinX = fMaxX = pX[pItems[0]];
+	fMinY = fMaxY = pY[pItems[0]];
+
+	for( i = 1; i < nCount; i++ )
+	{
+		fMinX = min( fMinX, pX[pItems[i]] );
+		fMaxX = max( fMaxX, pX[pItems[i]] );
+		fMinY = min( fMinY, pY[pItems[i]] );
+		fMaxY = max( fMaxY, pY[pItems[i]] );
+	}
+
+	nHalf = nCount / 2;
+
+	if( (fMaxX - fMinX) >= (fMaxY - fMinY) )
+	{
+		nth_element( pItems, pItems + nHalf, pItems + nCount, CenterBelow( pX ) );
+	}
+	else
+	{
+		nth_element( pItems, pItems + nHalf, pItems + nCount, CenterBelow( pY ) );
+	}
+
+	// Both children go on the end together. The node array can move while
+	// they're built, so nothing holds on to a node across the calls.
+	nChild = (int)m_tNodes.size();
+	m_tNodes.resize( nChild + 2 );
+
+	m_tNodes[nNode].nFirst = nChild;
+	m_tNodes[nNode].nCount = 0;
+
+	BuildNode( nChild, nFirst, nHalf, pX, pY );
+	BuildNode( nChild + 1, nFirst + nHalf, nCount - nHalf, pX, pY );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Refit
+//
+//  Desc: Works out every node's bounds again from where the boxes are now.
+//        Children always come after their parent, so running backwards down
+//        the nodes has each one's children done before it.
+// ----------------------------------------------------------------------------
+void CBoxTree::Refit( const float* pX, const float* pY, const float* pHalfX, const float* pHalfY )
+{
+	BVHNODE*		pNode;
+	const BVHNODE*	pLeft;
+	const BVHNODE*	pRight;
+	const int*		pItems;
+	int				i, j;
+
+	for( i = (int)m_tNodes.size() - 1; i >= 0; i-- )
+	{
+		pNode = &m_tNodes[i];
+
+		if( pNode->nCount )
+		{
+			pItems = &m_tItems[pNode->nFirst];
+
+			j = pItems[0];
+			pNode->fMinX = pX[j] - pHalfX[j];
+			pNode->fMaxX = pX[j] + pHalfX[j];
+			pNode->fMinY = pY[j] - pHalfY[j];
+			pNode->fMaxY = pY[j] + pHalfY[j];
+
+			for( int k = 1; k < pNode->nCount; k++ )
+			{
+				j = pItems[k];
+				pNode->fMinX = min( pNode->fMinX, pX[j] - pHalfX[j] );
+				pNode->fMaxX = max( pNode->fMaxX, pX[j] + pHalfX[j] );
+				pNode->fMinY = min( pNode->fMinY, pY[j] - pHalfY[j] );
+				pNode->fMaxY = max( pNode->fMaxY, pY[j] + pHalfY[j] );
+			}
+		}
+		else
+		{
+			pLeft = &m_tNodes[pNode->nFirst];
+			pRight = pLeft + 1;
+
+			pNode->fMinX = min( pLeft->fMinX, pRight->fMinX );
+			pNode->fMaxX = max( pLeft->fMaxX, pRight->fMaxX );
+			pNode->fMinY = min( pLeft->fMinY, pRight->fMinY );
+			pNode->fMaxY = max( pLeft->fMaxY, pRight->fMaxY );
+		}
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: FindBox
+//
+//  Desc: Lists the boxes of every leaf whose bounds overlap the given ones
+//        into pHits. That's every box that overlaps them and a few of their
+//        neighbours. Returns how many there are.
+// ----------------------------------------------------------------------------
+int CBoxTree::FindBox( float fMinX, float fMinY, float fMaxX, float fMaxY, vector<int>* pHits ) const
+{
+	int				tStack[BVH_MAX_DEPTH];
+	int				n = 0, i;
+	const BVHNODE*	pNode;
+	const BVHNODE*	pChild;
+
+	pHits->clear();
+
+	if( m_tNodes.empty() ) return 0;
+
+	pNode = &m_tNodes[0];
+	if( (pNode->fMinX > fMaxX) || (pNode->fMaxX < fMinX) || (pNode->fMinY > fMaxY) || (pNode->fMaxY < fMinY) ) return 0;
+
+	tStack[n++] = 0;
+
+	// Only nodes that overlap go on the stack, so a child is tested while
+	// its parent, and its sibling, are still in the cache.
+	while( n )
+	{
+		pNode = &m_tNodes[tStack[--n]];
+
+		if( pNode->nCount )
+		{
+			for( i = 0; i < pNode->nCount; i++ )
+			{
+				pHits->push_back( m_tItems[pNode->nFirst + i] );
+			}
+
+			continue;
+		}
+
+		// The right child goes on first so the left comes off first.
+		for( i = 1; i >= 0; i-- )
+		{
+			pChild = &m_tNodes[pNode->nFirst + i];
+
+			if( (pChild->fMinX > fMaxX) || (pChild->fMaxX < fMinX) || (pChild->fMinY > fMaxY) || (pChild->fMaxY < fMinY) ) continue;
+
+			tStack[n++] = pNode->nFirst + i;
+		}
+	}
+
+	return (int)pHits->size();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: FindSegment
+//
+//  Desc: Lists the boxes of every leaf whose bounds, grown by r, the segment
+//        from x, y to x + dx, y + dy passes through. That's everything a
+//        ball of radius r moving along it could touch, and some more, so
+//        each one still needs testing exactly.
+// ----------------------------------------------------------------------------
+int CBoxTree::FindSegment( float x, float y, float dx, float dy, float r, vector<int>* pHits ) const
+{
+	int				tStack[BVH_MAX_DEPTH];
+	int				n = 0, i;
+	const BVHNODE*	pNode;
+
+	pHits->clear();
+
+	if( m_tNodes.empty() ) return 0;
+
+	if( !SegmentHits( &m_tNodes[0], x, y, dx, dy, r ) ) return 0;
+
+	tStack[n++] = 0;
+
+	// As FindBox.
+	while( n )
+	{
+		pNode = &m_tNodes[tStack[--n]];
+
+		if( pNode->nCount )
+		{
+			for( i = 0; i < pNode->nCount; i++ )
+			{
+				pHits->push_back( m_tItems[pNode->nFirst + i] );
+			}
+
+			continue;
+		}
+
+		for( i = 1; i >= 0; i-- )
+		{
+			if( SegmentHits( &m_tNodes[pNode->nFirst + i], x, y, dx, dy, r ) ) tStack[n++] = pNode->nFirst + i;
+		}
+	}
+
+	return (int)pHits->size();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetNodeCount
+//
+//  Desc: Returns how many nodes the tree has.
+// ----------------------------------------------------------------------------
+int CBoxTree::GetNodeCount() const
+{
+	return (int)m_tNodes.size();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetItemCount
+//
+//  Desc: Returns how many boxes the tree was built over.
+// ----------------------------------------------------------------------------
+int CBoxTree::GetItemCount() const
+{
+	return (int)m_tItems.size();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetBytes
+//
+//  Desc: Returns about how much memory the tree is using.
+// ----------------------------------------------------------------------------
+size_t CBoxTree::GetBytes() const
+{
+	return (m_tNodes.capacity() * sizeof(BVHNODE)) + (m_tItems.capacity() * sizeof(int));
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetNode
+//
+//  Desc: Returns node i. Node 0 is the root and bounds everything.
+// ----------------------------------------------------------------------------
+const BVHNODE* CBoxTree::GetNode( int i ) const
+{
+	return &m_tNodes[i];
+}
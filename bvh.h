@@ -0,0 +1,59 @@
+// ----------------------------------------------------------------------------
+//  Filename: bvh.h
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+#pragma once
+
+// Most boxes in a leaf of the tree.
+#define BVH_LEAF_SIZE		4
+
+// Deepest a tree can get. Splits are at the median, so a tree of any level
+// the board can hold is nowhere near it.
+#define BVH_MAX_DEPTH		64
+
+// A node of the tree and the bounds of everything under it. An inner node's
+// children are next to each other, at nFirst and nFirst + 1, and always
+// come after it.
+struct BVHNODE
+{
+	float	fMinX, fMinY;
+	float	fMaxX, fMaxY;
+	int		nFirst;		// First child, or first item of a leaf.
+	int		nCount;		// Items in a leaf, 0 for an inner node.
+};
+
+// A bounding volume hierarchy over a set of axis aligned boxes, given by
+// their centers and half sizes. The shape of the tree is fixed when it is
+// built and only the bounds are refit as the boxes move, which is a single
+// pass back up the node array. That stays good as long as the boxes wander
+// about where they were built rather than right across the board.
+//
+// The tree only knows boxes by number. Anything else, such as which of them
+// are still there, is up to whoever asks it.
+class CBoxTree
+{
+protected:
+	vector<BVHNODE>	m_tNodes;
+	vector<int>		m_tItems;		// Box numbers, leaf by leaf.
+
+protected:
+	void	BuildNode( int nNode, int nFirst, int nCount, const float* pX, const float* pY );
+
+public:
+	CBoxTree();
+	virtual ~CBoxTree();
+
+	void	Clear();
+	void	Build( const float* pX, const float* pY, const float* pHalfX, const float* pHalfY, int nCount );
+	void	Refit( const float* pX, const float* pY, const float* pHalfX, const float* pHalfY );
+
+	int		FindBox( float fMinX, float fMinY, float fMaxX, float fMaxY, vector<int>* pHits ) const;
+	int		FindSegment( float x, float y, float dx, float dy, float r, vector<int>* pHits ) const;
+
+	int		GetNodeCount() const;
+	int		GetItemCount() const;
+	size_t	GetBytes() const;
+	const BVHNODE*	GetNode( int i ) const;
+};
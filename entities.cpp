@@ -0,0 +1,621 @@
+// ----------------------------------------------------------------------------
+//  Filename: entities.cpp
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+
+
+
+
+// Preprocessor directives.
+#include "sim.h"
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CWorld
+//
+//  Desc: Constructor
+// ----------------------------------------------------------------------------
+CWorld::CWorld()
+{
+	m_nCount = 0;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: ~CWorld
+//
+//  Desc: Destructor
+// ----------------------------------------------------------------------------
+CWorld::~CWorld()
+{
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Clear
+//
+//  Desc: Destroys every entity. Handles to them stay dead, since the slots
+//        keep their generations.
+// ----------------------------------------------------------------------------
+void CWorld::Clear()
+{
+	m_tFree.clear();
+
+	for( size_t i = 0; i < m_tSlots.size(); i++ )
+	{
+		if( m_tSlots[i].nArchetype >= 0 ) m_tSlots[i].nGeneration++;
+
+		m_tSlots[i].nArchetype = -1;
+		m_tFree.push_back( (unsigned int)i );
+	}
+
+	// The archetypes stay, so their arrays keep the memory they have.
+	for( size_t a = 0; a < m_tArchetypes.size(); a++ )
+	{
+		m_tArchetypes[a].tEntities.clear();
+		m_tArchetypes[a].tPosition.clear();
+		m_tArchetypes[a].tRotation.clear();
+		m_tArchetypes[a].tVelocity.clear();
+		m_tArchetypes[a].tSpin.clear();
+		m_tArchetypes[a].tMesh.clear();
+		m_tArchetypes[a].tLink.clear();
+	}
+
+	m_nCount = 0;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: FindArchetype
+//
+//  Desc: Returns the archetype with exactly the components in nMask, making
+//        it if there isn't one yet. There are only ever a handful, so they're
+//        just searched.
+// ----------------------------------------------------------------------------
+int CWorld::FindArchetype( unsigned int nMask )
+{
+	ARCHETYPE Archetype;
+
+	for( size_t a = 0; a < m_tArchetypes.size(); a++ )
+	{
+		if( m_tArchetypes[a].nMask == nMask ) return (int)a;
+	}
+
+	Archetype.nMask = nMask;
+	m_tArchetypes.push_back( Archetype );
+
+	return (int)m_tArchetypes.size() - 1;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: AddRow
+//
+//  Desc: Adds a row for e to the end of an archetype, with its components
+//        zeroed. Returns the row.
+// ----------------------------------------------------------------------------
+int CWorld::AddRow( int nArchetype, ENTITY e )
+{
+	ARCHETYPE*	p = &m_tArchetypes[nArchetype];
+	VEC3		v = { 0.0f, 0.0f, 0.0f };
+
+	p->tEntities.push_back( e );
+
+	if( p->nMask & COMP_POSITION ) p->tPosition.push_back( v );
+	if( p->nMask & COMP_ROTATION ) p->tRotation.push_back( v );
+	if( p->nMask & COMP_VELOCITY ) p->tVelocity.push_back( v );
+	if( p->nMask & COMP_SPIN ) p->tSpin.push_back( v );
+	if( p->nMask & COMP_MESH ) p->tMesh.push_back( 0 );
+	if( p->nMask & COMP_LINK ) p->tLink.push_back( 0 );
+
+	return (int)p->tEntities.size() - 1;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: RemoveRow
+//
+//  Desc: Takes a row out of an archetype by moving the last row into it, and
+//        points the slot of the entity that moved at its new row.
+// ----------------------------------------------------------------------------
+void CWorld::RemoveRow( int nArchetype, int nRow )
+{
+	ARCHETYPE*	p = &m_tArchetypes[nArchetype];
+	int			nLast = (int)p->tEntities.size() - 1;
+
+	if( nRow != nLast )
+	{
+		p->tEntities[nRow] = p->tEntities[nLast];
+
+		if( p->nMask & COMP_POSITION ) p->tPosition[nRow] = p->tPosition[nLast];
+		if( p->nMask & COMP_ROTATION ) p->tRotation[nRow] = p->tRotation[nLast];
+		if( p->nMask & COMP_VELOCITY ) p->tVelocity[nRow] = p->tVelocity[nLast];
+		if( p->nMask & COMP_SPIN ) p->tSpin[nRow] = p->tSpin[nLast];
+		if( p->nMask & COMP_MESH ) p->tMesh[nRow] = p->tMesh[nLast];
+		if( p->nMask & COMP_LINK ) p->tLink[nRow] = p->tLink[nLast];
+
+		m_tSlots[p->tEntities[nRow].nIndex].nRow = nRow;
+	}
+
+	p->tEntities.pop_back();
+
+	if( p->nMask & COMP_POSITION ) p->tPosition.pop_back();
+	if( p->nMask & COMP_ROTATION ) p->tRotation.pop_back();
+	if( p->nMask & COMP_VELOCITY ) p->tVelocity.pop_back();
+	if( p->nMask & COMP_SPIN ) p->tSpin.pop_back();
+	if( p->nMask & COMP_MESH ) p->tMesh.pop_back();
+	if( p->nMask & COMP_LINK ) p->tLink.pop_back();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: FindSlot
+//
+//  Desc: Returns the slot of a live entity, or NULL if the handle is stale.
+// ----------------------------------------------------------------------------
+const ENTITYSLOT* CWorld::FindSlot( ENTITY e ) const
+{
+	const ENTITYSLOT* pSlot;
+
+	if( e.nIndex >= m_tSlots.size() ) return NULL;
+
+	pSlot = &m_tSlots[e.nIndex];
+
+	if( (pSlot->nGeneration != e.nGeneration) || (pSlot->nArchetype < 0) ) return NULL;
+
+	return pSlot;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Create
+//
+//  Desc: Makes an entity with the components in nMask, all zeroed.
+// ----------------------------------------------------------------------------
+ENTITY CWorld::Create( unsigned int nMask )
+{
+	ENTITYSLOT	Slot;
+	ENTITY		e;
+
+	if( m_tFree.empty() )
+	{
+		Slot.nGeneration = 1;
+		Slot.nArchetype = -1;
+		Slot.nRow = 0;
+
+		m_tSlots.push_back( Slot );
+		m_tFree.push_back( (unsigned int)m_tSlots.size() - 1 );
+	}
+
+	e.nIndex = m_tFree.back();
+	e.nGeneration = m_tSlots[e.nIndex].nGeneration;
+
+	m_tFree.pop_back();
+
+	m_tSlots[e.nIndex].nArchetype = FindArchetype( nMask );
+	m_tSlots[e.nIndex].nRow = AddRow( m_tSlots[e.nIndex].nArchetype, e );
+
+	m_nCount++;
+
+	return e;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Destroy
+//
+//  Desc: Destroys an entity. Returns false if it was already gone.
+// ----------------------------------------------------------------------------
+bool CWorld::Destroy( ENTITY e )
+{
+	ENTITYSLOT* pSlot;
+
+	if( !FindSlot( e ) ) return false;
+
+	pSlot = &m_tSlots[e.nIndex];
+
+	RemoveRow( pSlot->nArchetype, pSlot->nRow );
+
+	pSlot->nGeneration++;
+	pSlot->nArchetype = -1;
+
+	m_tFree.push_back( e.nIndex );
+	m_nCount--;
+
+	return true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: DestroyAll
+//
+//  Desc: Destroys every entity that has all the components in nMask.
+//        Returns how many there were.
+// ----------------------------------------------------------------------------
+int CWorld::DestroyAll( unsigned int nMask )
+{
+	int n = 0;
+
+	for( size_t a = 0; a < m_tArchetypes.size(); a++ )
+	{
+		if( (m_tArchetypes[a].nMask & nMask) != nMask ) continue;
+
+		while( !m_tArchetypes[a].tEntities.empty() )
+		{
+			Destroy( m_tArchetypes[a].tEntities.back() );
+			n++;
+		}
+	}
+
+	return n;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: IsAlive
+//
+//  Desc: Returns whether the handle still refers to an entity.
+// ----------------------------------------------------------------------------
+bool CWorld::IsAlive( ENTITY e ) const
+{
+	return FindSlot( e ) != NULL;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: AddComponents
+//
+//  Desc: Gives an entity more components. The ones it had keep their values,
+//        the new ones start zeroed.
+// ----------------------------------------------------------------------------
+bool CWorld::AddComponents( ENTITY e, unsigned int nMask )
+{
+	return SetMask( e, GetMask( e ) | nMask );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: RemoveComponents
+//
+//  Desc: Takes components away from an entity.
+// ----------------------------------------------------------------------------
+bool CWorld::RemoveComponents( ENTITY e, unsigned int nMask )
+{
+	return SetMask( e, GetMask( e ) & ~nMask );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: SetMask
+//
+//  Desc: Moves an entity to the archetype with the components in nMask,
+//        bringing along the values of the ones both archetypes have.
+// ----------------------------------------------------------------------------
+bool CWorld::SetMask( ENTITY e, unsigned int nMask )
+{
+	const ENTITYSLOT*	pSlot = FindSlot( e );
+	ARCHETYPE			*pFrom, *pTo;
+	unsigned int		nBoth;
+	int					nFrom, nTo, nRow, nNewRow;
+
+	if( !pSlot ) return false;
+
+	nFrom = pSlot->nArchetype;
+	nRow = pSlot->nRow;
+	nTo = FindArchetype( nMask );
+
+	if( nTo == nFrom ) return true;
+
+	nNewRow = AddRow( nTo, e );
+
+	// Finding the archetype may have moved them.
+	pFrom = &m_tArchetypes[nFrom];
+	pTo = &m_tArchetypes[nTo];
+
+	nBoth = pFrom->nMask & pTo->nMask;
+
+	if( nBoth & COMP_POSITION ) pTo->tPosition[nNewRow] = pFrom->tPosition[nRow];
+	if( nBoth & COMP_ROTATION ) pTo->tRotation[nNewRow] = pFrom->tRotation[nRow];
+	if( nBoth & COMP_VELOCITY ) pTo->tVelocity[nNewRow] = pFrom->tVelocity[nRow];
+	if( nBoth & COMP_SPIN ) pTo->tSpin[nNewRow] = pFrom->tSpin[nRow];
+	if( nBoth & COMP_MESH ) pTo->tMesh[nNewRow] = pFrom->tMesh[nRow];
+	if( nBoth & COMP_LINK ) pTo->tLink[nNewRow] = pFrom->tLink[nRow];
+
+	RemoveRow( nFrom, nRow );
+
+	m_tSlots[e.nIndex].nArchetype = nTo;
+	m_tSlots[e.nIndex].nRow = nNewRow;
+
+	return true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetMask
+//
+//  Desc: Returns which components an entity has, or 0 if it's gone.
+// ----------------------------------------------------------------------------
+unsigned int CWorld::GetMask( ENTITY e ) const
+{
+	const ENTITYSLOT* pSlot = FindSlot( e );
+
+	return pSlot ? m_tArchetypes[pSlot->nArchetype].nMask : 0;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetPosition
+//
+//  Desc: Returns an entity's position, or NULL if it hasn't got one. The
+//        pointer only holds until entities are next made, destroyed or
+//        given other components.
+// ----------------------------------------------------------------------------
+VEC3* CWorld::GetPosition( ENTITY e )
+{
+	const ENTITYSLOT* pSlot = FindSlot( e );
+
+	if( !pSlot || !(m_tArchetypes[pSlot->nArchetype].nMask & COMP_POSITION) ) return NULL;
+
+	return &m_tArchetypes[pSlot->nArchetype].tPosition[pSlot->nRow];
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetRotation
+//
+//  Desc: See GetPosition.
+// ----------------------------------------------------------------------------
+VEC3* CWorld::GetRotation( ENTITY e )
+{
+	const ENTITYSLOT* pSlot = FindSlot( e );
+
+	if( !pSlot || !(m_tArchetypes[pSlot->nArchetype].nMask & COMP_ROTATION) ) return NULL;
+
+	return &m_tArchetypes[pSlot->nArchetype].tRotation[pSlot->nRow];
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetVelocity
+//
+//  Desc: See GetPosition.
+// ----------------------------------------------------------------------------
+VEC3* CWorld::GetVelocity( ENTITY e )
+{
+	const ENTITYSLOT* pSlot = FindSlot( e );
+
+	if( !pSlot || !(m_tArchetypes[pSlot->nArchetype].nMask & COMP_VELOCITY) ) return NULL;
+
+	return &m_tArchetypes[pSlot->nArchetype].tVelocity[pSlot->nRow];
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetSpin
+//
+//  Desc: See GetPosition.
+// ----------------------------------------------------------------------------
+VEC3* CWorld::GetSpin( ENTITY e )
+{
+	const ENTITYSLOT* pSlot = FindSlot( e );
+
+	if( !pSlot || !(m_tArchetypes[pSlot->nArchetype].nMask & COMP_SPIN) ) return NULL;
+
+	return &m_tArchetypes[pSlot->nArchetype].tSpin[pSlot->nRow];
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetMesh
+//
+//  Desc: See GetPosition.
+// ----------------------------------------------------------------------------
+int* CWorld::GetMesh( ENTITY e )
+{
+	const ENTITYSLOT* pSlot = FindSlot( e );
+
+	if( !pSlot || !(m_tArchetypes[pSlot->nArchetype].nMask & COMP_MESH) ) return NULL;
+
+	return &m_tArchetypes[pSlot->nArchetype].tMesh[pSlot->nRow];
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetLink
+//
+//  Desc: See GetPosition.
+// ----------------------------------------------------------------------------
+int* CWorld::GetLink( ENTITY e )
+{
+	const ENTITYSLOT* pSlot = FindSlot( e );
+
+	if( !pSlot || !(m_tArchetypes[pSlot->nArchetype].nMask & COMP_LINK) ) return NULL;
+
+	return &m_tArchetypes[pSlot->nArchetype].tLink[pSlot->nRow];
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Move
+//
+//  Desc: The movement system. Moves everything with a velocity and turns
+//        everything with a spin.
+// ----------------------------------------------------------------------------
+void CWorld::Move( float fElapsedTime )
+{
+	ARCHETYPE*	p;
+	int			n;
+
+	for( size_t a = 0; a < m_tArchetypes.size(); a++ )
+	{
+		p = &m_tArchetypes[a];
+		n = (int)p->tEntities.size();
+
+		if( !n ) continue;
+
+		if( (p->nMask & (COMP_POSITION | COMP_VELOCITY)) == (COMP_POSITION | COMP_VELOCITY) )
+		{
+			VEC3*		pPos = &p->tPosition[0];
+			const VEC3*	pVel = &p->tVelocity[0];
+
+			for( int i = 0; i < n; i++ )
+			{
+				pPos[i].x += pVel[i].x * fElapsedTime;
+				pPos[i].y += pVel[i].y * fElapsedTime;
+				pPos[i].z += pVel[i].z * fElapsedTime;
+			}
+		}
+
+		if( (p->nMask & (COMP_ROTATION | COMP_SPIN)) == (COMP_ROTATION | COMP_SPIN) )
+		{
+			VEC3*		pRot = &p->tRotation[0];
+			const VEC3*	pSpin = &p->tSpin[0];
+
+			for( int i = 0; i < n; i++ )
+			{
+				pRot[i].x = fmodf( pRot[i].x + (pSpin[i].x * fElapsedTime), 360.0f );
+				pRot[i].y = fmodf( pRot[i].y + (pSpin[i].y * fElapsedTime), 360.0f );
+				pRot[i].z = fmodf( pRot[i].z + (pSpin[i].z * fElapsedTime), 360.0f );
+			}
+		}
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: SyncLinks
+//
+//  Desc: Makes there be exactly one entity with the components in nMask
+//        linked to each of 0 up to nCount, for following things on the board
+//        that come and go, like balls. Extra ones are destroyed, missing ones
+//        are made with the link set and everything else zeroed.
+// ----------------------------------------------------------------------------
+void CWorld::SyncLinks( unsigned int nMask, int nCount )
+{
+	ARCHETYPE*	p;
+	ENTITY		e;
+	int			i, nLink;
+
+	nMask |= COMP_LINK;
+
+	if( nCount < 0 ) nCount = 0;
+
+	m_tSeen.assign( nCount, 0 );
+
+	for( size_t a = 0; a < m_tArchetypes.size(); a++ )
+	{
+		if( (m_tArchetypes[a].nMask & nMask) != nMask ) continue;
+
+		// Backwards, since destroying moves the last row into the gap.
+		for( i = (int)m_tArchetypes[a].tEntities.size() - 1; i >= 0; i-- )
+		{
+			p = &m_tArchetypes[a];
+			nLink = p->tLink[i];
+
+			if( (nLink < 0) || (nLink >= nCount) || m_tSeen[nLink] )
+			{
+				Destroy( p->tEntities[i] );
+			}
+			else
+			{
+				m_tSeen[nLink] = 1;
+			}
+		}
+	}
+
+	for( nLink = 0; nLink < nCount; nLink++ )
+	{
+		if( m_tSeen[nLink] ) continue;
+
+		e = Create( nMask );
+		*GetLink( e ) = nLink;
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetCount
+//
+//  Desc: Returns how many entities there are.
+// ----------------------------------------------------------------------------
+int CWorld::GetCount() const
+{
+	return m_nCount;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetArchetypeCount
+//
+//  Desc: Returns how many archetypes there are, for systems to go through.
+// ----------------------------------------------------------------------------
+int CWorld::GetArchetypeCount() const
+{
+	return (int)m_tArchetypes.size();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetArchetype
+//
+//  Desc: Returns an archetype. Systems check its mask for the components
+//        they need and run down its arrays.
+// ----------------------------------------------------------------------------
+ARCHETYPE* CWorld::GetArchetype( int i )
+{
+	return &m_tArchetypes[i];
+}
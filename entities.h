@@ -0,0 +1,112 @@
+// ----------------------------------------------------------------------------
+//  Filename: entities.h
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+#pragma once
+
+// Components an entity can have. An entity's mask says which.
+#define COMP_POSITION		0x0001		// VEC3, where it is.
+#define COMP_ROTATION		0x0002		// VEC3, degrees about each axis.
+#define COMP_VELOCITY		0x0004		// VEC3, units per second.
+#define COMP_SPIN			0x0008		// VEC3, degrees per second.
+#define COMP_MESH			0x0010		// int, which mesh it's drawn with.
+#define COMP_LINK			0x0020		// int, what it follows on the board.
+
+// Tags. They hold nothing, they only say what kind of entity it is, and so
+// what its link means.
+#define COMP_BALL			0x0100		// Links to a ball.
+#define COMP_PADDLE			0x0200		// Links to a paddle.
+#define COMP_MARKER			0x0400		// Links to a point of the aim guide.
+
+// A point or direction in the 3D world the board is drawn in.
+struct VEC3
+{
+	float x, y, z;
+};
+
+// A handle to an entity. The generation goes up every time the entity's
+// slot is reused, so a handle to an entity that has been destroyed never
+// finds whatever took its place. Generations start at 1, so a handle that's
+// all zeroes is never alive.
+struct ENTITY
+{
+	unsigned int	nIndex;
+	unsigned int	nGeneration;
+};
+
+// Every entity with the same set of components. Each component is kept in
+// its own contiguous array, one entry per entity, and arrays for components
+// the archetype doesn't have stay empty. Systems run straight down the
+// arrays of every archetype that has what they need.
+struct ARCHETYPE
+{
+	unsigned int	nMask;
+
+	vector<ENTITY>	tEntities;
+	vector<VEC3>	tPosition;
+	vector<VEC3>	tRotation;
+	vector<VEC3>	tVelocity;
+	vector<VEC3>	tSpin;
+	vector<int>		tMesh;
+	vector<int>		tLink;
+};
+
+// Where an entity's components are, by the index in its handle.
+struct ENTITYSLOT
+{
+	unsigned int	nGeneration;
+	int				nArchetype;		// -1 while the slot is free.
+	int				nRow;
+};
+
+// Entity storage, grouped by archetype. Destroying an entity moves the last
+// one of its archetype into its row, so the arrays stay packed. Adding or
+// removing components moves it to another archetype. Slots of destroyed
+// entities are reused.
+class CWorld
+{
+protected:
+	vector<ARCHETYPE>		m_tArchetypes;
+	vector<ENTITYSLOT>		m_tSlots;
+	vector<unsigned int>	m_tFree;
+	vector<unsigned char>	m_tSeen;		// Scratch for SyncLinks.
+	int						m_nCount;
+
+protected:
+	int		FindArchetype( unsigned int nMask );
+	int		AddRow( int nArchetype, ENTITY e );
+	void	RemoveRow( int nArchetype, int nRow );
+	const ENTITYSLOT*	FindSlot( ENTITY e ) const;
+
+public:
+	CWorld();
+	virtual ~CWorld();
+
+	void	Clear();
+
+	ENTITY	Create( unsigned int nMask );
+	bool	Destroy( ENTITY e );
+	int		DestroyAll( unsigned int nMask );
+	bool	IsAlive( ENTITY e ) const;
+
+	bool	AddComponents( ENTITY e, unsigned int nMask );
+	bool	RemoveComponents( ENTITY e, unsigned int nMask );
+	bool	SetMask( ENTITY e, unsigned int nMask );
+	unsigned int	GetMask( ENTITY e ) const;
+
+	VEC3*	GetPosition( ENTITY e );
+	VEC3*	GetRotation( ENTITY e );
+	VEC3*	GetVelocity( ENTITY e );
+	VEC3*	GetSpin( ENTITY e );
+	int*	GetMesh( ENTITY e );
+	int*	GetLink( ENTITY e );
+
+	void	Move( float fElapsedTime );
+	void	SyncLinks( unsigned int nMask, int nCount );
+
+	int			GetCount() const;
+	int			GetArchetypeCount() const;
+	ARCHETYPE*	GetArchetype( int i );
+};
@@ -0,0 +1,171 @@
+// ----------------------------------------------------------------------------
+//  Filename: fixed.h
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+#pragma once
+
+// Q16.16 fixed point. A number is held in a 32-bit integer as 16 bits of
+// whole number and 16 bits of fraction. Everything here is integer math, so
+// it gives the same bits whatever the compiler, the optimization level or
+// the floating point unit.
+#define FIXED_SHIFT		16
+#define FIXED_ONE		(1 << FIXED_SHIFT)
+
+typedef int32_t FIXED;
+
+// Fixed point two component vector.
+struct FVEC2
+{
+	FIXED x, y;
+};
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: FixFromFloat
+//
+//  Desc: Converts a float to fixed point, rounding towards zero. Scaling by
+//        a power of two is exact, so this is the same on every build.
+// ----------------------------------------------------------------------------
+inline FIXED FixFromFloat( float f )
+{
+	return (FIXED)(f * (float)FIXED_ONE);
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: FixToFloat
+//
+//  Desc: Converts a fixed point number to a float. Exact for anything under
+//        256 either way.
+// ----------------------------------------------------------------------------
+inline float FixToFloat( FIXED n )
+{
+	return (float)n / (float)FIXED_ONE;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: FixMul
+//
+//  Desc: Multiplies two fixed point numbers, rounding down.
+// ----------------------------------------------------------------------------
+inline FIXED FixMul( FIXED a, FIXED b )
+{
+	return (FIXED)(((int64_t)a * b) >> FIXED_SHIFT);
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: FixDiv
+//
+//  Desc: Divides two fixed point numbers, rounding towards zero. Anything too
+//        big, including a divide by zero, is clamped to the largest number
+//        with the right sign.
+// ----------------------------------------------------------------------------
+inline FIXED FixDiv( FIXED a, FIXED b )
+{
+	int64_t q;
+
+	if( !b ) return (a < 0) ? INT32_MIN : INT32_MAX;
+
+	q = ((int64_t)a * FIXED_ONE) / b;
+
+	if( q > INT32_MAX ) return INT32_MAX;
+	if( q < INT32_MIN ) return INT32_MIN;
+
+	return (FIXED)q;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: FixSqrt64
+//
+//  Desc: Integer square root, rounded down, one bit at a time.
+// ----------------------------------------------------------------------------
+inline uint32_t FixSqrt64( uint64_t n )
+{
+	uint64_t	r = 0;
+	uint64_t	b = (uint64_t)1 << 62;
+
+	while( b > n ) b >>= 2;
+
+	while( b )
+	{
+		if( n >= (r + b) )
+		{
+			n -= r + b;
+			r = (r >> 1) + b;
+		}
+		else
+		{
+			r >>= 1;
+		}
+
+		b >>= 2;
+	}
+
+	return (uint32_t)r;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: FixLength
+//
+//  Desc: Returns the length of a fixed point vector. The squares are summed
+//        with 32 bits of fraction, so the root comes out with 16.
+// ----------------------------------------------------------------------------
+inline FIXED FixLength( FIXED x, FIXED y )
+{
+	return (FIXED)FixSqrt64( ((uint64_t)((int64_t)x * x)) + ((uint64_t)((int64_t)y * y)) );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: FixDot
+//
+//  Desc: Computes the dot product of two fixed point vectors.
+// ----------------------------------------------------------------------------
+inline FIXED FixDot( FVEC2 v1, FVEC2 v2 )
+{
+	return (FIXED)((((int64_t)v1.x * v2.x) + ((int64_t)v1.y * v2.y)) >> FIXED_SHIFT);
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: FixNormalize
+//
+//  Desc: Normalizes a fixed point vector. A zero vector stays zero.
+// ----------------------------------------------------------------------------
+inline FVEC2 FixNormalize( FVEC2 v )
+{
+	FIXED	qMag = FixLength( v.x, v.y );
+	FVEC2	r;
+
+	r.x = r.y = 0;
+
+	if( qMag )
+	{
+		r.x = FixDiv( v.x, qMag );
+		r.y = FixDiv( v.y, qMag );
+	}
+
+	return r;
+}
@@ -25,14 +25,16 @@ CGame::CGame()
 	m_pCamera		= NULL;
 	m_pBackground	= NULL;
 	m_pBoard		= NULL;
+	m_pParticles	= NULL;
 	m_pText			= NULL;
-	m_pRedBrick		= NULL;
-	m_pBlueBrick	= NULL;
-	m_pGreenBrick	= NULL;
-	m_pBall			= NULL;
-	m_pPaddle		= NULL;
+	m_pLevel		= NULL;
+	m_pGameBoard	= NULL;
+	m_nLevel		= 0;
 	m_hWnd			= NULL;
 	m_hInstance		= NULL;
+
+	for( int i = 0; i < GAME_MESHES; i++ ) m_pMeshes[i] = NULL;
+	for( int i = 0; i < GAME_BALL_LODS; i++ ) m_pBallLods[i] = NULL;
 }
 
 
@@ -61,6 +63,21 @@ HRESULT CGame::Init( HWND hWnd, HINSTANCE hInstance, DWORD nWidth, DWORD nHeight
 	HRESULT hr;
 	int i;
 	char	sBackground[255];
+	CMeshData	ball;
+	string		sBall;
+	FLOAT		fError;
+	shared_ptr<CAssetPack>	pPack( new CAssetPack() );
+
+	// Where each mesh is loaded from, by GameMesh.
+	static const struct { const char* sPath; const char* sFile; } meshes[GAME_MESHES] =
+	{
+		{ NULL, NULL },
+		{ "Data\\Models\\RedBrick\\", "redbrick.x" },
+		{ "Data\\Models\\GreenBrick\\", "greenbrick.x" },
+		{ "Data\\Models\\BlueBrick\\", "bluebrick.x" },
+		{ "Data\\Models\\Ball\\", "ball.x" },
+		{ "Data\\Models\\Paddle\\", "paddle.x" }
+	};
 
 	m_hWnd = hWnd;
 	m_hInstance = hInstance;
@@ -68,6 +85,11 @@ HRESULT CGame::Init( HWND hWnd, HINSTANCE hInstance, DWORD nWidth, DWORD nHeight
 	m_dwWinWidth = nWidth;
 	m_dwWinHeight = nHeight;
 
+	// Mount the asset pack before anything is loaded, or the loader thread
+	// is started.
+	if( pPack->Open( GAME_PACK_FILE ) ) CAssetPack::Mount( pPack );
+	else DbgPrint( "No asset pack, loading loose files." );
+
 
 	// Create a new graphics object.
 	m_pGraphics = new CGraphics();
@@ -85,21 +107,29 @@ HRESULT CGame::Init( HWND hWnd, HINSTANCE hInstance, DWORD nWidth, DWORD nHeight
 	m_pText = new CText();
 	if( !m_pText ) return E_OUTOFMEMORY;
 
-	// Create the game objects.
-	m_pRedBrick = new CObject();
-	if( !m_pRedBrick ) return E_OUTOFMEMORY;
+	// Create the meshes.
+	for( i = 1; i < GAME_MESHES; i++ )
+	{
+		m_pMeshes[i] = new CObject();
+		if( !m_pMeshes[i] ) return E_OUTOFMEMORY;
+	}
+
+	// Create the level and the board it gets played on.
+	m_pLevel = new CLevel();
+	if( !m_pLevel ) return E_OUTOFMEMORY;
 
-	m_pBlueBrick = new CObject();
-	if( !m_pBlueBrick ) return E_OUTOFMEMORY;
+	m_pGameBoard = new CBoard();
+	if( !m_pGameBoard ) return E_OUTOFMEMORY;
 
-	m_pGreenBrick = new CObject();
-	if( !m_pGreenBrick ) return E_OUTOFMEMORY;
+	// Start loading the first level straight away, so it's ready by the time
+	// the player starts.
+	if( !m_Loader.LoadSequence( GAME_LEVEL_SEQUENCE ) ) m_Loader.AddLevel( GAME_FIRST_LEVEL );
 
-	m_pBall = new CObject();
-	if( !m_pBall ) return E_OUTOFMEMORY;
+	m_Loader.Init();
+	m_Loader.Request( 0, m_pGameBoard );
 
-	m_pPaddle = new CObject();
-	if( !m_pPaddle ) return E_OUTOFMEMORY;
+	m_Rewind.Init( SNAPSHOT_COUNT, SNAPSHOT_INTERVAL );
+	m_Particles.Init( GAME_MAX_PARTICLES );
 
 	// Init the graphics system.
 	hr = m_pGraphics->Init( hWnd, nWidth, nHeight );
@@ -125,20 +155,31 @@ HRESULT CGame::Init( HWND hWnd, HINSTANCE hInstance, DWORD nWidth, DWORD nHeight
 	if( FAILED( hr ) ) return hr;
 
 	// Load the object models.
-	hr = m_pRedBrick->LoadX( m_pDevice, "Data\\Models\\RedBrick\\", "redbrick.x" );
-	if( FAILED( hr ) ) return hr;
+	for( i = 1; i < GAME_MESHES; i++ )
+	{
+		hr = m_pMeshes[i]->LoadX( m_pDevice, meshes[i].sPath, meshes[i].sFile );
+		if( FAILED( hr ) ) return hr;
+	}
 
-	hr = m_pBlueBrick->LoadX( m_pDevice, "Data\\Models\\BlueBrick\\", "bluebrick.x" );
-	if( FAILED( hr ) ) return hr;
+	// Simplify the ball a step at a time. Each step's error is from the one
+	// before, so they add up.
+	sBall = string( meshes[MeshBall].sPath ) + meshes[MeshBall].sFile;
+	fError = 0.0f;
 
-	hr = m_pGreenBrick->LoadX( m_pDevice, "Data\\Models\\GreenBrick\\", "greenbrick.x" );
-	if( FAILED( hr ) ) return hr;
+	if( !ball.Load( sBall.c_str() ) ) return E_FAIL;
 
-	hr = m_pBall->LoadX( m_pDevice, "Data\\Models\\Ball\\", "ball.x" );
-	if( FAILED( hr ) ) return hr;
+	for( i = 0; i < GAME_BALL_LODS; i++ )
+	{
+		fError += ball.Simplify( ball.GetTriangleCount() / 2 );
 
-	hr = m_pPaddle->LoadX( m_pDevice, "Data\\Models\\Paddle\\", "paddle.x" );
-	if( FAILED( hr ) ) return hr;
+		m_pBallLods[i] = new CObject();
+		if( !m_pBallLods[i] ) return E_OUTOFMEMORY;
+
+		hr = m_pBallLods[i]->LoadMesh( m_pDevice, meshes[MeshBall].sPath, ball );
+		if( FAILED( hr ) ) return hr;
+
+		m_fBallLodError[i] = fError;
+	}
 
 	// Randomly pick a backdrop to use.
 	i = TrueRandNum( 1, 10 );
@@ -148,11 +189,16 @@ HRESULT CGame::Init( HWND hWnd, HINSTANCE hInstance, DWORD nWidth, DWORD nHeight
 	DbgPrint( sBackground );
 
 	// Load the background texture.
-	hr = D3DXCreateTextureFromFile( m_pDevice, sBackground, &m_pBackground );
+	hr = CGraphics::LoadTexture( m_pDevice, sBackground, &m_pBackground );
 	if( FAILED( hr ) ) return hr;
 
 	// Load the board texture.
-	hr = D3DXCreateTextureFromFile( m_pDevice, "Data\\Images\\bg2.png", &m_pBoard );
+	hr = CGraphics::LoadTexture( m_pDevice, "Data\\Images\\bg2.png", &m_pBoard );
+	if( FAILED( hr ) ) return hr;
+
+	// The particles are written into this every frame and drawn as points.
+	hr = m_pDevice->CreateVertexBuffer( GAME_MAX_PARTICLES * sizeof(VERTEX), D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY | D3DUSAGE_POINTS,
+										D3DFVF_VERTEX, D3DPOOL_DEFAULT, &m_pParticles, NULL );
 	if( FAILED( hr ) ) return hr;
 
 	// Set up the scene lighting.
@@ -171,10 +217,9 @@ HRESULT CGame::Init( HWND hWnd, HINSTANCE hInstance, DWORD nWidth, DWORD nHeight
 	m_pDevice->LightEnable( 0, TRUE );
 
 	// Set up the game timing.
-	timeBeginPeriod( 1 );
+	hr = m_Timer.Init();
+	if( FAILED( hr ) ) return hr;
 
-	m_fOldTime = 0.0f;
-	m_fNewTime = 0.0f;
 	m_fDeltaTime = 0.0f;
 
 	// Set up the various screens. Title, game, etc.
@@ -203,21 +248,34 @@ HRESULT CGame::Init( HWND hWnd, HINSTANCE hInstance, DWORD nWidth, DWORD nHeight
 // ----------------------------------------------------------------------------
 void CGame::Destroy()
 {
-	timeEndPeriod( 1 );
-
 	m_pBackground->Release();
 	m_pBoard->Release();
+	m_pParticles->Release();
+
+	m_Loader.Destroy();
+
+	delete m_pGameBoard;
+	delete m_pLevel;
+
+	for( int i = 0; i < GAME_MESHES; i++ )
+	{
+		delete m_pMeshes[i];
+		m_pMeshes[i] = NULL;
+	}
+
+	for( int i = 0; i < GAME_BALL_LODS; i++ )
+	{
+		delete m_pBallLods[i];
+		m_pBallLods[i] = NULL;
+	}
 
-	delete m_pPaddle;
-	delete m_pBall;
-	delete m_pGreenBrick;
-	delete m_pBlueBrick;
-	delete m_pRedBrick;
 	delete m_pText;
 	delete m_pInput;
 	delete m_pCamera;
 	delete m_pGraphics;
 
+	CAssetPack::Mount( shared_ptr<CAssetPack>() );
+
 	ShowCursor( TRUE );
 
 	m_pGraphics		= NULL;
@@ -225,13 +283,12 @@ void CGame::Destroy()
 	m_pBackground	= NULL;
 	m_pBoard		= NULL;
 	m_pText			= NULL;
-	m_pRedBrick		= NULL;
-	m_pBlueBrick	= NULL;
-	m_pGreenBrick	= NULL;
-	m_pBall			= NULL;
-	m_pPaddle		= NULL;
+	m_pLevel		= NULL;
+	m_pGameBoard	= NULL;
 	m_hWnd			= NULL;
 	m_hInstance		= NULL;
+
+	m_sLevelFile.clear();
 }
 
 
@@ -263,15 +320,13 @@ void CGame::Run()
 			}
 			else
 			{
-				m_fOldTime = (FLOAT)timeGetTime() / 1000;
+				// Calculate how much time has passed since the last frame.
+				// This helps with regulating the speed of the game, otherwise
+				// things would move to fast.
+				m_fDeltaTime = (FLOAT)m_Timer.Tick();
 
 				Update( m_fDeltaTime );
 				Render();
-
-				// Calculate how much time has passed. This helps with regulating
-				// the speed of the game, otherwise things would move to fast.
-				m_fNewTime = (FLOAT)timeGetTime() / 1000;
-				m_fDeltaTime = m_fNewTime - m_fOldTime;
 			}
 		}
 	}
@@ -424,6 +479,10 @@ HRESULT CGame::InitTitleScreen()
 	m_bStartGameSelected = FALSE;
 	m_bExitGameSelected = FALSE;
 
+	// Whatever happened, the next game starts from the first level again.
+	m_nLevel = 0;
+	m_Loader.Request( m_nLevel, m_pGameBoard );
+
 	m_bMouseL = FALSE;
 	m_bMouseR = FALSE;
 	m_bEscape = FALSE;
@@ -567,56 +626,52 @@ HRESULT CGame::RenderTitleScreen()
 // ----------------------------------------------------------------------------
 HRESULT CGame::InitGameScreen()
 {
-	ifstream	level;
-	CHAR		brick;
-	char		t[255];
-	int			i;
+	LOADEDLEVEL loaded;
 
-	// Load the level.
-	m_dwTotalBricks = 0;
-	i = 0;
-
-	// Open a level file.
-	// Level files are a simple 10x10 grid of numbers 0-3.
-	level.open( "Data\\Levels\\level1.lvl", ios::in );
-
-	do
+	// The level and a board set up to play it should be waiting already, so
+	// all there is to do is swap them in. The ones they replace are freed on
+	// the loader's thread.
+	if( m_Loader.Take( m_nLevel, m_pGameBoard, &loaded ) )
 	{
-		level >> brick;
+		m_Loader.Retire( m_pLevel, m_pGameBoard );
 
-		m_tMap[i] = brick;
+		m_pLevel = loaded.pLevel;
+		m_pGameBoard = loaded.pBoard;
+		m_sLevelFile = loaded.sFileName;
+	}
+	else
+	{
+		DbgPrint( string( "Unable to load: " ) + m_Loader.GetName( m_nLevel ) );
 
-		if( (brick > '0') && (brick < '4') )
-		{
-			// If a 1 2 or 3 is speficied, it's a brick.
-			sprintf( t, "%c", brick );
+		// The level before is played again, and recorded as what it is.
+		m_pGameBoard->Reset( m_pLevel );
+	}
 
-			m_dwTotalBricks++;
-		}
+	// And the one after starts loading.
+	m_Loader.Request( m_nLevel + 1, m_pGameBoard );
 
-		i++;
-	} while( !level.eof() && (i < 100) );
+	m_Replay.Begin( m_pGameBoard, m_pLevel, m_sLevelFile.c_str() );
+	m_nEdges = 0;
 
-	level.close();
+	m_Rewind.Clear();
 
-	// Set up the ball and paddle.
-	m_vPaddlePos.x = 0.0f;
-	m_vPaddlePos.y = -0.75f;
-	m_vPaddlePos.z = 0.0f;
+	m_Particles.Clear();
+	m_World.Clear();
 
-	m_vBallPos.x = 0.0f;
-	m_vBallPos.y = m_vPaddlePos.y + 0.051f;
-	m_vBallPos.z = 0.0f;
+	m_bGuideKey = m_bPilotKey = FALSE;
+	m_bGuide = m_bAutoPilot = FALSE;
+	m_nGuide = 0;
 
-	m_vBallVel.x = m_vBallVel.y = m_vBallVel.z = 0.0f;
+	m_dStepTime = 0.0;
+	m_fAlpha = 0.0f;
+	m_nMouseX = 0;
 
-	m_fBallRadius = 0.03f;
+	m_fViewX = m_fViewY = 0.0f;
+	m_fViewHalfWidth = m_fViewHalfHeight = 0.0f;
 
 	// FPS Counter. For fun.
 	m_dwOldFPS = 0;
 	m_dwNewFPS = 0;
-	m_dwBallTimer = 0;
-	m_dwScore = 0;
 	m_fSecondCount = 0.f;
 
 	return D3D_OK;
@@ -634,8 +689,14 @@ HRESULT CGame::InitGameScreen()
 GameState CGame::UpdateGameScreen( FLOAT fElapsedTime )
 {
 	FLOAT x, y;
+	FLOAT fLeft, fTop, fRight, fBottom, fZoom;
 	BOOL l, r;
-	D3DVECTOR d;
+	BOOL bRewind, bForward;
+	UINT nStep;
+	VEC2 vPos, vVel;
+	BOARDINPUT input;
+	const BRICKEVENT* pEvent;
+	static const DWORD dwColors[BRICK_TYPES + 1] = { 0xFFFFFFFF, 0xFFFF4020, 0xFF40FF40, 0xFF4080FF };
 	GameState NextState = GameScreen;
 
 	// Go back to the title screen if escape is pressed.
@@ -644,6 +705,7 @@ GameState CGame::UpdateGameScreen( FLOAT fElapsedTime )
 		NextState = TitleScreen;
 
 		m_bEscape = FALSE;
+		m_nEdges |= REPLAY_ESCAPE;
 	}
 	else if( !m_bEscape && m_pInput->KeyDown( DIK_ESCAPE ) )
 	{
@@ -651,79 +713,156 @@ GameState CGame::UpdateGameScreen( FLOAT fElapsedTime )
 	}
 
 	// Get the deltas for how much the mouse moved and what buttons were
-	// pressed.
+	// pressed. Mouse movement is saved up until the next board step.
 	m_pInput->GetMouse( &l, &r, &x, &y );
 
-	// Position the paddle.
-	m_vPaddlePos.x += (x * 0.1f * fElapsedTime);
+	m_nMouseX += (LONG)x;
+
+	// Buttons going down are kept for the replay, with the next step.
+	if( l && !m_bMouseL ) m_nEdges |= REPLAY_MOUSE_L;
+	if( r && !m_bMouseR ) m_nEdges |= REPLAY_MOUSE_R;
+
+	m_bMouseL = l;
+	m_bMouseR = r;
 
-	// Make sure the paddle cannot be moved outside of the game boundaries.
-	// TODO: Refactor this so that magic numbers are NOT used.
-	if( (m_vPaddlePos.x - 0.15f) <= (-0.9f) ) m_vPaddlePos.x = -0.75f;
-	if( (m_vPaddlePos.x + 0.15f) >= (0.9f) ) m_vPaddlePos.x = 0.75f;
+	bRewind = m_pInput->KeyDown( DIK_R );
+	bForward = m_pInput->KeyDown( DIK_F );
 
-	m_pPaddle->SetPosition( m_vPaddlePos.x, m_vPaddlePos.y, m_vPaddlePos.z );
+	// The aim guide and the autopilot switch on and off as the key goes down.
+	if( m_pInput->KeyDown( DIK_G ) && !m_bGuideKey ) m_bGuide = !m_bGuide;
+	if( m_pInput->KeyDown( DIK_P ) && !m_bPilotKey ) m_bAutoPilot = !m_bAutoPilot;
 
-	// Position the ball.
-	CheckForCollisions( fElapsedTime );
+	m_bGuideKey = m_pInput->KeyDown( DIK_G );
+	m_bPilotKey = m_pInput->KeyDown( DIK_P );
 
-	// Bounce the ball off the sides of the walls.
-	// TODO: Refactor this so that magic numbers are NOT used.
-	if( (m_vBallPos.x + 0.03f) >= (0.99f) )
+	// Run as many fixed steps of the board as the elapsed time covers, but
+	// no more than GAME_MAX_STEPS. Time left over past that is dropped.
+	m_dStepTime += fElapsedTime;
+
+	for( int n = 0; m_dStepTime >= m_pGameBoard->GetTimeStep(); n++ )
 	{
-		m_vBallVel.x = -m_vBallVel.x;
-		m_vBallPos.x = 0.95f;
+		if( n == GAME_MAX_STEPS )
+		{
+			m_dStepTime = 0.0;
+			break;
+		}
+
+		if( bRewind || bForward )
+		{
+			// The mouse does nothing while going through the recording.
+			nStep = m_pGameBoard->GetSteps();
+			nStep = bRewind ? ((nStep > GAME_SEEK_SPEED) ? (nStep - GAME_SEEK_SPEED) : 0) : (nStep + GAME_SEEK_SPEED);
+
+			m_Rewind.Seek( m_pGameBoard, nStep );
+			m_nMouseX = 0;
+		}
+		else
+		{
+			input.nMouseX = m_nMouseX;
+			m_nMouseX = 0;
+
+			// The autopilot's movement is recorded like the player's would be.
+			if( m_bAutoPilot ) input.nMouseX = m_pGameBoard->AutoPilot( 40 );
+
+			// Playing on from a rewind replaces whatever came after.
+			m_Replay.Truncate( m_pGameBoard->GetSteps() );
+			m_Replay.Record( input, m_nEdges );
+			m_nEdges = 0;
+
+			m_Rewind.Record( m_pGameBoard, input );
+			m_pGameBoard->Step( input );
+
+			// Burst whatever bricks that step destroyed.
+			for( int i = 0; i < m_pGameBoard->GetEventCount(); i++ )
+			{
+				pEvent = &m_pGameBoard->GetEvents()[i];
+
+				m_Particles.Burst( pEvent->vPos.x, pEvent->vPos.y, pEvent->vHalfSize.x, pEvent->vHalfSize.y,
+								   pEvent->vBallVel.x, pEvent->vBallVel.y, GAME_BURST_PARTICLES, dwColors[pEvent->nType], &m_Sparks );
+			}
+		}
+
+		m_dStepTime -= m_pGameBoard->GetTimeStep();
 	}
-	if( (m_vBallPos.x - 0.03f) <= (-1.0f) )
+
+	// Where the first ball is headed, for the aim guide.
+	m_nGuide = 0;
+
+	if( m_bGuide && m_pGameBoard->GetBalls()->GetCount() )
 	{
-		m_vBallVel.x = -m_vBallVel.x;
-		m_vBallPos.x = -0.96f;
+		vPos.x = m_pGameBoard->GetBalls()->GetX( 0 );
+		vPos.y = m_pGameBoard->GetBalls()->GetY( 0 );
+		vVel.x = m_pGameBoard->GetBalls()->GetVelX( 0 );
+		vVel.y = m_pGameBoard->GetBalls()->GetVelY( 0 );
+
+		m_nGuide = m_pGameBoard->PredictPath( vPos, vVel, 5.0f, m_tGuide, GAME_GUIDE_BOUNCES );
 	}
-	
-	if( (m_vBallPos.y + 0.03f) >= (1.0f) )
+
+	// The particles run on frame time. They're only for show.
+	m_Particles.Update( fElapsedTime );
+
+	// How far we are into the next step. Everything is drawn that far
+	// between where the last step started and where it ended.
+	m_fAlpha = (FLOAT)(m_dStepTime / m_pGameBoard->GetTimeStep());
+
+	// Bring the balls and paddle drawn up to date, that far along.
+	SyncEntities( fElapsedTime );
+
+	// The ball got past the paddle or all the bricks have been destroyed.
+	if( m_pGameBoard->GetState() != BoardPlaying ) NextState = TitleScreen;
+
+	// The game is over one way or another. Keep the replay of it.
+	if( NextState != GameScreen ) m_Replay.End( m_pGameBoard );
+
+	// A cleared level goes straight on to the next one in the sequence, if
+	// there is one. Its replay is written out on the loader's thread, so
+	// the switch doesn't wait on the disk.
+	if( (m_pGameBoard->GetState() == BoardCleared) && ((m_nLevel + 1) < m_Loader.GetCount()) )
 	{
-		m_vBallVel.y = -m_vBallVel.y;
-		m_vBallPos.y = 0.96f;
+		m_Loader.SaveReplay( m_Replay, GAME_REPLAY_FILE );
+
+		m_nLevel++;
+		InitGameScreen();
+
+		NextState = GameScreen;
 	}
-	if( (m_vBallPos.y - 0.03f) <= (-1.0f) )
+	else if( (NextState != GameScreen) && !m_Replay.Save( GAME_REPLAY_FILE ) )
 	{
-		m_vBallVel.y = -m_vBallVel.y;
-		m_vBallPos.y = -0.96f;
+		DbgPrint( "Unable to save: " GAME_REPLAY_FILE );
 	}
 
-	// Find out how the ball bounces off the paddle.
-	d.x = m_vPaddlePos.x - m_vBallPos.x;
-	d.y = m_vPaddlePos.y - m_vBallPos.y;
-	d.z = m_vPaddlePos.z - m_vBallPos.z;
+	if( m_Loader.SaveFailed() ) DbgPrint( "Unable to save: " GAME_REPLAY_FILE );
+
+	// Pull the camera back until the whole field is in view. If that's too
+	// far, follow the play instead, between the paddle and the first ball.
+	m_pGameBoard->GetWalls( &fLeft, &fTop, &fRight, &fBottom );
+
+	fZoom = max( (fRight - fLeft) / (WALL_RIGHT - WALL_LEFT), (fTop - fBottom) / (WALL_TOP - WALL_BOTTOM) );
+	if( fZoom > GAME_MAX_ZOOM ) fZoom = GAME_MAX_ZOOM;
 
-	d = VecNormalize( d );
+	m_fViewHalfHeight = 2.5f * fZoom * tanf( D3DX_PI / 8 );
+	m_fViewHalfWidth = m_fViewHalfHeight * ((FLOAT)m_dwWinWidth / (FLOAT)m_dwWinHeight);
 
-	d.x = m_vBallPos.x + (d.x * 0.03);
-	d.y = m_vBallPos.y + (d.y * 0.03);
-	d.z = m_vBallPos.z + (d.z * 0.03);
+	m_fViewX = 0.0f;
+	m_fViewY = (fTop + fBottom) * 0.5f;
 
-	// TODO: Refactor so that magic numbers are NOT used.
-	if( (d.y <= (m_vPaddlePos.y + 0.02f)) && (d.x >= (m_vPaddlePos.x - 0.25f)) && (d.x <= (m_vPaddlePos.x + 0.25f)) )
+	if( (fRight - fLeft) > (m_fViewHalfWidth * 2.0f) )
 	{
-		m_vBallVel.y = -m_vBallVel.y;
-		m_vBallPos.y = m_vPaddlePos.y + 0.051f;
+		m_fViewX = m_pGameBoard->GetPaddlePos().x;
+		m_fViewX = max( fLeft + m_fViewHalfWidth, min( fRight - m_fViewHalfWidth, m_fViewX ) );
 	}
-	
-	if( (m_vBallPos.y < (m_vPaddlePos.y - 0.2f)) )
+
+	if( (fTop - fBottom) > (m_fViewHalfHeight * 2.0f) )
 	{
-		NextState = TitleScreen;
+		m_fViewY = (m_pGameBoard->GetPaddlePos().y + m_pGameBoard->GetBallPos().y) * 0.5f;
+		m_fViewY = max( fBottom + m_fViewHalfHeight, min( fTop - m_fViewHalfHeight, m_fViewY ) );
 	}
 
-	m_pBall->SetPosition( m_vBallPos.x, m_vBallPos.y, m_vBallPos.z );
-
 	// Make sure the camera is oriented just right.
-	m_pCamera->Position( 0.0f, 0.0f, -2.5f );
+	m_pCamera->Position( m_fViewX, m_fViewY, -2.5f * fZoom );
 
 	m_pDevice->SetTransform( D3DTS_VIEW, &m_pCamera->GetViewMatrix() );
 
-	// End the game if all the bricks have been destroyed.
-	if( !m_dwTotalBricks ) NextState = TitleScreen;
-
 	m_fSecondCount += fElapsedTime;
 	m_dwNewFPS++;
 
@@ -733,19 +872,9 @@ GameState CGame::UpdateGameScreen( FLOAT fElapsedTime )
 		m_dwOldFPS = m_dwNewFPS;
 		m_dwNewFPS = 0;
 
-		// Increase the ball start timer.
-		m_dwBallTimer++;
-
 		m_fSecondCount = 0.0f;
 	}
 
-	if( m_dwBallTimer == 2 )
-	{
-		// If 3 seconds have passed, then start the ball moving.
-		m_vBallVel.x = 0.7f;
-		m_vBallVel.y = 0.6f;
-	}
-
 	return NextState;
 }
 
@@ -759,11 +888,6 @@ GameState CGame::UpdateGameScreen( FLOAT fElapsedTime )
 // ----------------------------------------------------------------------------
 HRESULT CGame::RenderGameScreen()
 {
-	FLOAT x, y;
-
-	x = 0;
-	y = 0;
-
 	// See RenderBoard function below.
 	RenderBoard();
 
@@ -771,52 +895,9 @@ HRESULT CGame::RenderGameScreen()
 	// X, Y, color, text.
 	m_pText->Print( 200, (m_dwWinHeight) - 50, 0xFF0000FF, "Press Esc to quit and go back to the main menu." );
 
-	// Render the paddle and the ball.
-	m_pPaddle->Render( m_pDevice );
-	m_pBall->Render( m_pDevice );
-
-	// Render the remaining bricks in the map.
-	for( int i = 0; i < 100; i++ )
-	{
-		switch( m_tMap[i] )
-		{
-		case '0':
-			// Do nothing. Brick got destroyed or wasn't there in the first place.
-			break;
-
-		case '1':
-			// Red brick.
-			// Just calculate the position of the brick, then render it.
-			// TODO: refactor this so the calculation is only done once in one place.
-			m_pRedBrick->SetPosition( (-0.9f + (0.19f * x)), (0.4 - (0.08 * y)) + 0.5f, 0.0f );
-			m_pRedBrick->Render( m_pDevice );
-
-			break;
-
-		case '2':
-			// Green brick.
-			// TODO: refactor this so the calculation is only done once in one place.
-			m_pGreenBrick->SetPosition( (-0.9f + (0.19f * x)), (0.4 - (0.08 * y)) + 0.5f, 0.0f );
-			m_pGreenBrick->Render( m_pDevice );
-			break;
-
-		case '3':
-			// Blue brick;
-			// TODO: refactor this so the calculation is only done once in one place.
-			m_pBlueBrick->SetPosition( (-0.9f + (0.19f * x)), (0.4 - (0.08 * y)) + 0.5f, 0.0f );
-			m_pBlueBrick->Render( m_pDevice );
+	RenderEntities();
 
-			break;
-		}
-
-		x++;
-
-		if( x > 9 )
-		{
-			x = 0;
-			y++;
-		}
-	}
+	RenderParticles();
 
 	RenderScore();
 
@@ -826,369 +907,6 @@ HRESULT CGame::RenderGameScreen()
 
 
 
-// ----------------------------------------------------------------------------
-//  Name: CheckForCollisions
-//
-//  Desc: Checks for a collision between the ball and each brick still in
-//        existance.
-// ----------------------------------------------------------------------------
-VOID CGame::CheckForCollisions( FLOAT fElapsedTime )
-{
-	D3DVECTOR d;
-	FLOAT x, y, bx, by;
-	FLOAT newx, newy;
-	FLOAT bx1, by1;
-	FLOAT tx, ty;
-	FLOAT d1, d2;
-	BOOL cx, cy;
-	BOOL hit = FALSE;
-	char t[255];
-
-	x = 0.0f;
-	y = 0.0f;
-
-	// For each brick slot in existance...
-	for( int i = 0; i < 100; i++ )
-	{
-		switch( m_tMap[i] )
-		{
-		// This is going to be ball color independent.
-		case '1':
-		case '2':
-		case '3':
-			// Calculate the center of the current brick.
-			bx = (-0.9f + (0.19f * x));
-			by = (0.4f - (0.08f * y)) + 0.5f;
-
-			// Calculate where the ball *will* be if it moves.
-			newx = m_vBallPos.x + (m_vBallVel.x * fElapsedTime);
-			newy = m_vBallPos.y + (m_vBallVel.y * fElapsedTime);
-
-			// I am only going to type this once... for each side of the ball
-			// figure out if the new position will take that side inside the
-			// brick boundaries.
-			d.x = newx;
-			d.y = newy + m_fBallRadius;
-
-			if( (d.y <= (by + 0.02f)) && (d.y >= (by - 0.02f)) && (d.x >= (bx - 0.075f)) && (d.x <= (bx + 0.075f)) && !hit )
-			{
-				// Ok, it went inside, we know it hit.
-				hit = TRUE;
-
-				// Reverse the direction of the ball based on which side of
-				// the brick the ball hit.
-				m_vBallVel.y = -m_vBallVel.y;
-
-				// Use the triangle ration math equation to determine how much
-				// the ball will move in the x direction (the y is pretty self-
-				// explanatory).
-				ty = by - 0.02f - d.y;
-				tx = (ty * newx) / newy;
-
-				// Move the ball, and we are done.
-				m_vBallPos.x += tx * fElapsedTime;
-				m_vBallPos.y += ty * fElapsedTime;
-			}
-			
-			d.x = newx;
-			d.y = newy - m_fBallRadius;
-
-			if( (d.y <= (by + 0.02f)) && (d.y >= (by - 0.02f)) && (d.x >= (bx - 0.075f)) && (d.x <= (bx + 0.075f)) && !hit )
-			{
-				hit = TRUE;
-
-				m_vBallVel.y = -m_vBallVel.y;
-
-				ty = d.y - by + 0.02f;
-				tx = (ty * newx) / newy;
-
-				m_vBallPos.x += tx * fElapsedTime;
-				m_vBallPos.y += ty * fElapsedTime;
-			}
-
-			d.x = newx - m_fBallRadius;
-			d.y = newy;
-
-			if( (d.y <= (by + 0.02f)) && (d.y >= (by - 0.02f)) && (d.x >= (bx - 0.075f)) && (d.x <= (bx + 0.075f)) && !hit )
-			{
-				hit = TRUE;
-
-				m_vBallVel.x = -m_vBallVel.x;
-
-				tx = d.x - (bx + 0.02f);
-				ty = tx * (newy / newx);
-
-				m_vBallPos.x += tx * fElapsedTime;
-				m_vBallPos.y += ty * fElapsedTime;
-			}
-
-			d.x = newx + m_fBallRadius;
-			d.y = newy;
-
-			if( (d.y <= (by + 0.02f)) && (d.y >= (by - 0.02f)) && (d.x >= (bx - 0.075f)) && (d.x <= (bx + 0.075f)) && !hit )
-			{
-				hit = TRUE;
-
-				m_vBallVel.x = -m_vBallVel.x;
-
-				tx = (bx - 0.02f) - d.x;
-				ty = tx * (newy / newx);
-
-				m_vBallPos.x += tx * fElapsedTime;
-				m_vBallPos.y += ty * fElapsedTime;
-			}
-
-			// This section is a bit different and more complex. As before I
-			// will only go over this once to save space. For each corner of
-			// the brick, calculate whether or not the corner is inside the
-			// square boundaries of the ball.
-			bx1 = bx - 0.075f;
-			by1 = by + 0.02f;
-
-			if( (bx1 >= (newx - m_fBallRadius)) && (bx1 <= (newx + m_fBallRadius)) && (by1 >= (newy - m_fBallRadius)) && (by1 <= (newy + m_fBallRadius)) && !hit )
-			{
-				// It's inside the boundaries. Determine if the corner is
-				// actually inside the circle defined by the ball. This is
-				// simply done by taking the distance between the corner and
-				// the center of the ball, and if it's equal or less than the
-				// radius of the ball, then it has intersected.
-				d1 = sqrt( pow( (bx1 - newx), 2.0f ) + pow( (by1 - newy), 2.0f ) );
-
-				if( d1 <= m_fBallRadius )
-				{
-					// Ok, we hit.
-					hit = TRUE;
-
-					d.x = m_vBallVel.x;
-					d.y = m_vBallVel.y;
-					d.z = m_vBallVel.z;
-
-					// Figure out the magnitude of how much the ball would have
-					// moved in the direction specified by the velocity vector.
-					d2 = sqrt( pow( (d.x * fElapsedTime), 2.0f ) + pow( (d.y * fElapsedTime), 2.0f ) + pow( (d.z * fElapsedTime), 2.0f ) );
-
-					// Now, normalize the velocity vector.
-					d = VecNormalize( d );
-
-					// Find out how much the ball actually needs to move so that
-					// the edge of the ball is only just touching the corner of
-					// the brick.
-					d2 -= (m_fBallRadius - d1);
-
-					// Move the ball.
-					m_vBallPos.x += d.x * d2;
-					m_vBallPos.y += d.y * d2;
-					m_vBallPos.z += d.z * d2;
-
-					// Now the fun part. Find out what the vector is between the
-					// corner of the brick and the center of the ball (the
-					// normal vector for this calculation).
-					d.x = (bx1 - m_vBallPos.x);
-					d.y = (by1 - m_vBallPos.y);
-					d.z = 0.0f;
-
-					// Normalize the vector.
-					d = VecNormalize( d );
-
-					// Now, to calculate the angle that the ball bounces when it
-					// hits the brick, the formula is as follows:
-					//
-					// v2 = -(2 * (n . v1) * n - v1)
-					//
-					// Where . is the dot product of two vectors, n is the normal
-					// vector at the colision point, v1 is the initial velocity
-					// vector and v2 is the new velocity vector.
-					d2 = 2 * VecDot( d, m_vBallVel );
-					d.x *= d2;
-					d.y *= d2;
-					d.z *= d2;
-
-					// Now we have a new direction and velocity vector.
-					m_vBallVel.x = -(d.x - m_vBallVel.x);
-					m_vBallVel.y = -(d.y - m_vBallVel.y);
-					m_vBallVel.z = -(d.z - m_vBallVel.z);
-				}
-			}
-
-			bx1 = bx + 0.075f;
-			by1 = by + 0.02f;
-
-			if( (bx1 >= (newx - m_fBallRadius)) && (bx1 <= (newx + m_fBallRadius)) && (by1 >= (newy - m_fBallRadius)) && (by1 <= (newy + m_fBallRadius)) && !hit )
-			{
-				d1 = sqrt( pow( (bx1 - newx), 2.0f ) + pow( (by1 - newy), 2.0f ) );
-
-				if( d1 <= m_fBallRadius )
-				{
-					hit = TRUE;
-
-					d.x = m_vBallVel.x;
-					d.y = m_vBallVel.y;
-					d.z = m_vBallVel.z;
-
-					d2 = sqrt( pow( (d.x * fElapsedTime), 2.0f ) + pow( (d.y * fElapsedTime), 2.0f ) + pow( (d.z * fElapsedTime), 2.0f ) );
-
-					d = VecNormalize( d );
-
-					d2 -= (m_fBallRadius - d1);
-
-					m_vBallPos.x += d.x * d2;
-					m_vBallPos.y += d.y * d2;
-					m_vBallPos.z += d.z * d2;
-
-					d.x = (bx1 - m_vBallPos.x);
-					d.y = (by1 - m_vBallPos.y);
-					d.z = 0.0f;
-
-					d = VecNormalize( d );
-
-					d2 = 2 * VecDot( d, m_vBallVel );
-					d.x *= d2;
-					d.y *= d2;
-					d.z *= d2;
-
-					m_vBallVel.x = -(d.x - m_vBallVel.x);
-					m_vBallVel.y = -(d.y - m_vBallVel.y);
-					m_vBallVel.z = -(d.z - m_vBallVel.z);
-				}
-			}
-
-			bx1 = bx - 0.075f;
-			by1 = by - 0.02f;
-
-			if( (bx1 >= (newx - m_fBallRadius)) && (bx1 <= (newx + m_fBallRadius)) && (by1 >= (newy - m_fBallRadius)) && (by1 <= (newy + m_fBallRadius)) && !hit )
-			{
-				d1 = sqrt( pow( (bx1 - newx), 2.0f ) + pow( (by1 - newy), 2.0f ) );
-
-				if( d1 <= m_fBallRadius )
-				{
-					hit = TRUE;
-
-					d.x = m_vBallVel.x;
-					d.y = m_vBallVel.y;
-					d.z = m_vBallVel.z;
-
-					d2 = sqrt( pow( (d.x * fElapsedTime), 2.0f ) + pow( (d.y * fElapsedTime), 2.0f ) + pow( (d.z * fElapsedTime), 2.0f ) );
-
-					d = VecNormalize( d );
-
-					d2 -= (m_fBallRadius - d1);
-
-					m_vBallPos.x += d.x * d2;
-					m_vBallPos.y += d.y * d2;
-					m_vBallPos.z += d.z * d2;
-
-					d.x = (bx1 - m_vBallPos.x);
-					d.y = (by1 - m_vBallPos.y);
-					d.z = 0.0f;
-
-					d = VecNormalize( d );
-
-					d2 = 2 * VecDot( d, m_vBallVel );
-					d.x *= d2;
-					d.y *= d2;
-					d.z *= d2;
-
-					m_vBallVel.x = -(d.x - m_vBallVel.x);
-					m_vBallVel.y = -(d.y - m_vBallVel.y);
-					m_vBallVel.z = -(d.z - m_vBallVel.z);
-				}
-			}
-
-			bx1 = bx + 0.075f;
-			by1 = by - 0.02f;
-
-			if( (bx1 >= (newx - m_fBallRadius)) && (bx1 <= (newx + m_fBallRadius)) && (by1 >= (newy - m_fBallRadius)) && (by1 <= (newy + m_fBallRadius)) && !hit )
-			{
-				d1 = sqrt( pow( (bx1 - newx), 2.0f ) + pow( (by1 - newy), 2.0f ) );
-
-				if( d1 <= m_fBallRadius )
-				{
-					hit = TRUE;
-
-					d.x = m_vBallVel.x * fElapsedTime;
-					d.y = m_vBallVel.y * fElapsedTime;
-					d.z = m_vBallVel.z * fElapsedTime;
-
-					d2 = sqrt( pow( d.x, 2.0f ) + pow( d.y, 2.0f ) + pow( d.z, 2.0f ) );
-
-					d = VecNormalize( d );
-
-					d2 -= (m_fBallRadius - d1);
-
-					m_vBallPos.x += d.x * d2;
-					m_vBallPos.y += d.y * d2;
-					m_vBallPos.z += d.z * d2;
-
-					d.x = (bx1 - m_vBallPos.x);
-					d.y = (by1 - m_vBallPos.y);
-					d.z = 0.0f;
-
-					d = VecNormalize( d );
-
-					d2 = 2 * VecDot( d, m_vBallVel );
-
-					d.x *= d2;
-					d.y *= d2;
-					d.z *= d2;
-
-					m_vBallVel.x = -(d.x - m_vBallVel.x);
-					m_vBallVel.y = -(d.y - m_vBallVel.y);
-					m_vBallVel.z = -(d.z - m_vBallVel.z);
-				}
-			}
-
-			// Now, if we hit, we will increment our score based on the color
-			// of the brick, and we will "destroy" the brick, making it
-			// disappear, as well as decrement the brick count so we know when
-			// we end the game.
-			if( hit )
-			{
-				switch( m_tMap[i] )
-				{
-				case '1':
-					m_dwScore += 100;
-					break;
-
-				case '2':
-					m_dwScore += 200;
-					break;
-
-				case '3':
-					m_dwScore += 300;
-					break;
-				}
-
-				m_tMap[i] = '0';
-				m_dwTotalBricks--;
-
-				return;
-			}
-
-			break;
-
-		default:
-			break;
-		}
-
-		x++;
-
-		if( x > 9 )
-		{
-			x = 0;
-			y++;
-		}
-	}
-
-	// If we didn't hit any bricks, we'll just keep moving the same way we
-	// were going to do otherwise.
-	m_vBallPos.x += m_vBallVel.x * fElapsedTime;
-	m_vBallPos.y += m_vBallVel.y * fElapsedTime;
-	m_vBallPos.z += m_vBallVel.z * fElapsedTime;
-}
-
-
-
-
 // ----------------------------------------------------------------------------
 //  Name: RenderMouse
 //
@@ -1230,16 +948,25 @@ VOID CGame::RenderBoard()
 {
 	D3DXMATRIX matWorld;
 	D3DMATERIAL9 mat;
+	FLOAT l, t, r, b;
+
+	// The board reaches a little past the walls, however big the level is.
+	m_pGameBoard->GetWalls( &l, &t, &r, &b );
+
+	l -= 0.3f;
+	t += 0.3f;
+	r += 0.3f;
+	b -= 0.3f;
 
 	// Create a square mesh for the background behind the actual game. This is
 	// to help make the actual game easier to see.
 	TLVERTEX v[4] =
 	{
 		// This structure is defined in types.h
-		{ -1.3f, 1.3f, 0.6f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f },
-		{ 1.3f, 1.3f, 0.6f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f },
-		{ -1.3f, -1.3f, 0.6f, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f },
-		{ 1.3f, -1.3f, 0.6f, 0.0f, 0.0f, -1.0f, 1.0f, 1.0f }
+		{ l, t, 0.6f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f },
+		{ r, t, 0.6f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f },
+		{ l, b, 0.6f, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f },
+		{ r, b, 0.6f, 0.0f, 0.0f, -1.0f, 1.0f, 1.0f }
 	};
 
 	// Create a material for this. We just want it to receive full light, but
@@ -1325,57 +1052,261 @@ VOID CGame::RenderBackground()
 
 
 // ----------------------------------------------------------------------------
-//  Name: RenderScore
+//  Name: SyncEntities
 //
-//  Desc: Render the game score.
+//  Desc: Brings the entities up to date with the board. There's one for each
+//        ball, paddle and aim guide point, following it, blended between the
+//        last two board steps so they move smoothly whatever the frame rate.
 // ----------------------------------------------------------------------------
-VOID CGame::RenderScore()
+VOID CGame::SyncEntities( FLOAT fElapsedTime )
 {
-	char sFPS[255];
+	const CBallPool*	pBalls = m_pGameBoard->GetBalls();
+	ARCHETYPE*			p;
+	FLOAT				a = m_fAlpha;
+	VEC2				v0, v1;
+	int					i, n;
 
-	sprintf( sFPS, "Score: %d", m_dwScore );
+	m_World.SyncLinks( COMP_POSITION | COMP_MESH | COMP_PADDLE, 1 );
+	m_World.SyncLinks( COMP_POSITION | COMP_MESH | COMP_BALL, pBalls->GetCount() );
+	m_World.SyncLinks( COMP_POSITION | COMP_ROTATION | COMP_SPIN | COMP_MESH | COMP_MARKER, m_nGuide );
 
-	// X, Y, color (black at 100% opacity), text.
-	m_pText->Print( 700, (m_dwWinHeight) - 50, 0xFF000000, sFPS );
+	m_World.Move( fElapsedTime );
+
+	v0 = m_pGameBoard->GetPrevPaddlePos();
+	v1 = m_pGameBoard->GetPaddlePos();
+
+	for( int t = 0; t < m_World.GetArchetypeCount(); t++ )
+	{
+		p = m_World.GetArchetype( t );
+		n = (int)p->tEntities.size();
+
+		if( !n || ((p->nMask & (COMP_POSITION | COMP_MESH | COMP_LINK)) != (COMP_POSITION | COMP_MESH | COMP_LINK)) ) continue;
+
+		if( p->nMask & COMP_PADDLE )
+		{
+			for( i = 0; i < n; i++ )
+			{
+				p->tPosition[i].x = v0.x + ((v1.x - v0.x) * a);
+				p->tPosition[i].y = v0.y + ((v1.y - v0.y) * a);
+				p->tMesh[i] = MeshPaddle;
+			}
+		}
+		else if( p->nMask & COMP_BALL )
+		{
+			for( i = 0; i < n; i++ )
+			{
+				p->tPosition[i].x = pBalls->GetPrevX( p->tLink[i] ) + ((pBalls->GetX( p->tLink[i] ) - pBalls->GetPrevX( p->tLink[i] )) * a);
+				p->tPosition[i].y = pBalls->GetPrevY( p->tLink[i] ) + ((pBalls->GetY( p->tLink[i] ) - pBalls->GetPrevY( p->tLink[i] )) * a);
+				p->tMesh[i] = MeshBall;
+			}
+		}
+		else if( p->nMask & COMP_MARKER )
+		{
+			// The aim guide marks each bounce with a spinning ball.
+			for( i = 0; i < n; i++ )
+			{
+				p->tPosition[i].x = m_tGuide[p->tLink[i]].vPos.x;
+				p->tPosition[i].y = m_tGuide[p->tLink[i]].vPos.y;
+				p->tMesh[i] = MeshBall;
+
+				if( p->nMask & COMP_SPIN ) p->tSpin[i].y = GAME_MARKER_SPIN;
+			}
+		}
+	}
 }
 
 
 
 
 // ----------------------------------------------------------------------------
-//  Name: VecNormalize
+//  Name: RenderEntities
 //
-//  Desc: Normalizes a vector.
+//  Desc: Renders everything with a position and a mesh, and the bricks the
+//        camera can see. They're gathered by mesh first so each mesh is
+//        drawn in one go.
 // ----------------------------------------------------------------------------
-D3DVECTOR CGame::VecNormalize( D3DVECTOR v )
+VOID CGame::RenderEntities()
 {
-	FLOAT		fMag;
-	D3DVECTOR	r;
+	const CBrickSet*	pBricks = m_pGameBoard->GetBricks();
+	ARCHETYPE*			p;
+	CObject*			pMesh;
+	D3DXVECTOR3			v, r;
+	FLOAT				fPixels;
+	int					n, x0, y0, x1, y1;
+
+	for( int m = 0; m < GAME_MESHES; m++ )
+	{
+		m_tPositions[m].clear();
+		m_tRotations[m].clear();
+	}
+
+	for( int t = 0; t < m_World.GetArchetypeCount(); t++ )
+	{
+		p = m_World.GetArchetype( t );
+		n = (int)p->tEntities.size();
+
+		if( (p->nMask & (COMP_POSITION | COMP_MESH)) != (COMP_POSITION | COMP_MESH) ) continue;
+
+		r = D3DXVECTOR3( 0.0f, 0.0f, 0.0f );
 
-	// The simple distance formula.
-	fMag = sqrt( pow( v.x, 2.0f ) + pow( v.y, 2.0f ) + pow( v.z, 2.0f ) );
+		for( int i = 0; i < n; i++ )
+		{
+			if( (p->tMesh[i] <= 0) || (p->tMesh[i] >= GAME_MESHES) ) continue;
+
+			v = D3DXVECTOR3( p->tPosition[i].x, p->tPosition[i].y, p->tPosition[i].z );
+			if( p->nMask & COMP_ROTATION ) r = D3DXVECTOR3( p->tRotation[i].x, p->tRotation[i].y, p->tRotation[i].z );
+
+			m_tPositions[p->tMesh[i]].push_back( v );
+			m_tRotations[p->tMesh[i]].push_back( r );
+		}
+	}
 
-	// Normal of a vector is the components divided by the magnitude.
-	if( fMag )
+	// The remaining bricks the camera can see. The board already keeps them
+	// packed, so they aren't entities.
+	if( pBricks->IsAnimated() )
+	{
+		// Bricks that move aren't in their slots, so they're found with the
+		// tree and drawn turned however they are.
+		n = pBricks->FindInBox( m_fViewX - m_fViewHalfWidth, m_fViewY - m_fViewHalfHeight,
+								m_fViewX + m_fViewHalfWidth, m_fViewY + m_fViewHalfHeight, &m_tVisible );
+
+		for( int i = 0; i < n; i++ )
+		{
+			v = D3DXVECTOR3( pBricks->GetCenterX( m_tVisible[i] ), pBricks->GetCenterY( m_tVisible[i] ), 0.0f );
+			r = D3DXVECTOR3( 0.0f, 0.0f, pBricks->GetAngle( m_tVisible[i] ) );
+
+			m_tPositions[pBricks->GetType( m_tVisible[i] )].push_back( v );
+			m_tRotations[pBricks->GetType( m_tVisible[i] )].push_back( r );
+		}
+	}
+	else if( m_pGameBoard->GetCellRange( m_fViewX - m_fViewHalfWidth, m_fViewY - m_fViewHalfHeight,
+										 m_fViewX + m_fViewHalfWidth, m_fViewY + m_fViewHalfHeight, &x0, &y0, &x1, &y1 ) )
 	{
-		r.x = v.x / fMag;
-		r.y = v.y / fMag;
-		r.z = v.z / fMag;
+		// Otherwise one color at a time. Only the bricks that are left get
+		// looked at, and empty chunks of the level are skipped.
+		m_tVisible.resize( x1 - x0 + 1 );
+
+		r = D3DXVECTOR3( 0.0f, 0.0f, 0.0f );
+
+		for( int t = BrickRed; t <= BrickBlue; t++ )
+		{
+			for( int y = y0; y <= y1; y++ )
+			{
+				n = pBricks->ListSpan( t, y, x0, x1, &m_tVisible[0] );
+
+				for( int i = 0; i < n; i++ )
+				{
+					v = D3DXVECTOR3( pBricks->GetCenterX( m_tVisible[i] ), pBricks->GetCenterY( m_tVisible[i] ), 0.0f );
+
+					m_tPositions[t].push_back( v );
+					m_tRotations[t].push_back( r );
+				}
+			}
+		}
 	}
 
-	return r;
+	// Everything is drawn on the field, so one unit there is the same number
+	// of pixels wherever it is.
+	fPixels = (m_dwWinHeight * 0.5f) / m_fViewHalfHeight;
+
+	for( int m = 1; m < GAME_MESHES; m++ )
+	{
+		if( m_tPositions[m].empty() ) continue;
+
+		pMesh = m_pMeshes[m];
+
+		if( m == MeshBall )
+		{
+			for( int i = 0; (i < GAME_BALL_LODS) && ((m_fBallLodError[i] * fPixels) <= GAME_LOD_PIXELS); i++ )
+			{
+				pMesh = m_pBallLods[i];
+			}
+		}
+
+		pMesh->RenderInstances( m_pDevice, &m_tPositions[m][0], &m_tRotations[m][0], (int)m_tPositions[m].size() );
+	}
 }
 
 
 
 
 // ----------------------------------------------------------------------------
-//  Name: VecDot
+//  Name: RenderParticles
 //
-//  Desc: Computes the dot product of two vectors.
+//  Desc: Renders every particle in a single draw call. They're written into
+//        the dynamic vertex buffer as points, fading out as they die.
 // ----------------------------------------------------------------------------
-FLOAT CGame::VecDot( D3DVECTOR v1, D3DVECTOR v2 )
+VOID CGame::RenderParticles()
 {
-	// Can't any simpler than this.
-	return (v1.x * v2.x) + (v1.y * v2.y) + (v1.z * v2.z);
+	D3DXMATRIX matWorld;
+	VERTEX* v;
+	FLOAT fSize = 3.0f;
+	FLOAT f;
+	int n = m_Particles.GetCount();
+
+	const float*	pX = m_Particles.GetX();
+	const float*	pY = m_Particles.GetY();
+	const float*	pZ = m_Particles.GetZ();
+	const float*	pLife = m_Particles.GetLife();
+	const float*	pFade = m_Particles.GetFade();
+	const uint32_t*	pColor = m_Particles.GetColor();
+
+	if( !n ) return;
+
+	if( FAILED( m_pParticles->Lock( 0, n * sizeof(VERTEX), (void**)&v, D3DLOCK_DISCARD ) ) )
+	{
+		DbgPrint( "Failed to lock the particles." );
+		return;
+	}
+
+	for( int i = 0; i < n; i++ )
+	{
+		f = pLife[i] * pFade[i];
+
+		v[i].x = pX[i];
+		v[i].y = pY[i];
+		v[i].z = pZ[i];
+		v[i].color = (pColor[i] & 0x00FFFFFF) | ((DWORD)(f * 255.0f) << 24);
+	}
+
+	m_pParticles->Unlock();
+
+	D3DXMatrixIdentity( &matWorld );
+	m_pDevice->SetTransform( D3DTS_WORLD, &matWorld );
+
+	// Fixed size points, added on top of what's there so they glow, and not
+	// hiding each other.
+	m_pDevice->SetRenderState( D3DRS_POINTSIZE, *(DWORD*)&fSize );
+	m_pDevice->SetRenderState( D3DRS_DESTBLEND, D3DBLEND_ONE );
+	m_pDevice->SetRenderState( D3DRS_ZWRITEENABLE, FALSE );
+
+	m_pDevice->SetFVF( D3DFVF_VERTEX );
+	m_pDevice->SetStreamSource( 0, m_pParticles, 0, sizeof(VERTEX) );
+
+	if( FAILED( m_pDevice->DrawPrimitive( D3DPT_POINTLIST, 0, n ) ) )
+	{
+		DbgPrint( "Failed to draw the particles." );
+	}
+
+	m_pDevice->SetRenderState( D3DRS_ZWRITEENABLE, TRUE );
+	m_pDevice->SetRenderState( D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA );
 }
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: RenderScore
+//
+//  Desc: Render the game score.
+// ----------------------------------------------------------------------------
+VOID CGame::RenderScore()
+{
+	char sFPS[255];
+
+	sprintf( sFPS, "Score: %u", m_pGameBoard->GetScore() );
+
+	// X, Y, color (black at 100% opacity), text.
+	m_pText->Print( 700, (m_dwWinHeight) - 50, 0xFF000000, sFPS );
+}
+
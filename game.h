@@ -6,6 +6,64 @@
 // ----------------------------------------------------------------------------
 #pragma once
 
+// Most board steps run in one frame. If the game falls further behind than
+// this, say while the window is being dragged, the rest of the time is
+// dropped rather than played back all at once.
+#define GAME_MAX_STEPS		8
+
+// The camera pulls back to show the whole field of a big level, but no
+// further than this many times its usual distance. Past that it follows the
+// play.
+#define GAME_MAX_ZOOM		4.0f
+
+// Every game is recorded, and the last one is saved here when it ends so it
+// can be played back with Tools/replay.
+#define GAME_REPLAY_FILE	"Data\\last.rpl"
+
+// Holding R runs the game backwards through the last few minutes, and F
+// forwards again through what was rewound, this many steps at a time.
+#define GAME_SEEK_SPEED		2
+
+// G toggles an aim guide showing where the first ball will bounce next, this
+// many bounces ahead. P hands the paddle over to the autopilot.
+#define GAME_GUIDE_BOUNCES	4
+
+// Destroyed bricks burst into this many particles, out of a pool of them
+// all drawn in one go.
+#define GAME_BURST_PARTICLES	40
+#define GAME_MAX_PARTICLES		16384
+
+// The meshes entities are drawn with. The brick meshes are numbered the same
+// as the brick types.
+enum GameMesh
+{
+	MeshRedBrick = BrickRed,
+	MeshGreenBrick = BrickGreen,
+	MeshBlueBrick = BrickBlue,
+	MeshBall,
+	MeshPaddle
+};
+
+#define GAME_MESHES			(MeshPaddle + 1)
+
+// The ball is also made in GAME_BALL_LODS simpler versions, each with half
+// the triangles of the one before. Each frame it's drawn with the simplest
+// that's no further than GAME_LOD_PIXELS from the real shape on screen.
+#define GAME_BALL_LODS		4
+#define GAME_LOD_PIXELS		1.0f
+
+// The order levels are played in, one name to a line. Without it there's
+// only GAME_FIRST_LEVEL.
+#define GAME_LEVEL_SEQUENCE	"Data\\Levels\\levels.txt"
+#define GAME_FIRST_LEVEL	"Data\\Levels\\level1"
+
+// Every asset packed into one file, see CAssetPack. Looked in first if it's
+// there, otherwise everything is loaded from the loose files under Data.
+#define GAME_PACK_FILE		"Data.pak"
+
+// Aim guide markers spin this many degrees a second.
+#define GAME_MARKER_SPIN	180.0f
+
 class CGame
 {
 protected:
@@ -33,15 +91,17 @@ protected:
 	FLOAT		m_dwMouseX;
 	FLOAT		m_dwMouseY;
 
-	FLOAT		m_fOldTime;
-	FLOAT		m_fNewTime;
+	CTimer		m_Timer;
 	FLOAT		m_fDeltaTime;
 
-	CObject*	m_pRedBrick;
-	CObject*	m_pBlueBrick;
-	CObject*	m_pGreenBrick;
-	CObject*	m_pBall;
-	CObject*	m_pPaddle;
+	// Every mesh, by GameMesh, and where each is drawn this frame.
+	CObject*			m_pMeshes[GAME_MESHES];
+	vector<D3DXVECTOR3>	m_tPositions[GAME_MESHES];
+	vector<D3DXVECTOR3>	m_tRotations[GAME_MESHES];
+
+	// Simpler balls, and how far each is from the real one at most.
+	CObject*			m_pBallLods[GAME_BALL_LODS];
+	FLOAT				m_fBallLodError[GAME_BALL_LODS];
 
 	BOOL		m_bEscape;
 	BOOL		m_bMouseL;
@@ -52,19 +112,42 @@ protected:
 	BOOL	m_bExitGameSelected;
 
 protected:
-	CHAR		m_tMap[105];
+	CLevel*		m_pLevel;
+	CBoard*		m_pGameBoard;
+	string		m_sLevelFile;		// What m_pLevel was loaded from, for the replay.
+
+	// The next level loads while this one is played.
+	CLevelLoader	m_Loader;
+	int				m_nLevel;
+
+	double		m_dStepTime;
+	FLOAT		m_fAlpha;
+	LONG		m_nMouseX;
 
-	DWORD		m_dwTotalBricks;
+	// What part of the field the camera can see.
+	FLOAT		m_fViewX;
+	FLOAT		m_fViewY;
+	FLOAT		m_fViewHalfWidth;
+	FLOAT		m_fViewHalfHeight;
 
-	D3DVECTOR	m_vPaddlePos;
-	D3DVECTOR	m_vBallPos;
-	D3DVECTOR	m_vBallVel;
+	vector<int>	m_tVisible;
 
-	FLOAT		m_fBallRadius;
+	CReplay		m_Replay;
+	CSnapshotRing	m_Rewind;
+	UINT		m_nEdges;		// Edges seen since the last step.
 
-	DWORD		m_dwBallTimer;
+	BOOL		m_bGuideKey;
+	BOOL		m_bPilotKey;
+	BOOL		m_bGuide;
+	BOOL		m_bAutoPilot;
+	PATHPOINT	m_tGuide[GAME_GUIDE_BOUNCES];
+	int			m_nGuide;
 
-	DWORD		m_dwScore;
+	CWorld					m_World;
+
+	CParticlePool			m_Particles;
+	CRandom					m_Sparks;
+	IDirect3DVertexBuffer9*	m_pParticles;
 
 	DWORD		m_dwOldFPS;
 	DWORD		m_dwNewFPS;
@@ -91,13 +174,11 @@ public:
 	GameState	UpdateGameScreen( FLOAT fElapsedTime );
 	HRESULT		RenderGameScreen();
 
-	VOID		CheckForCollisions( FLOAT fElapsedTime );
-
 	VOID		RenderMouse();
 	VOID		RenderBackground();
 	VOID		RenderBoard();
 	VOID		RenderScore();
-
-	D3DVECTOR	VecNormalize( D3DVECTOR v );
-	FLOAT		VecDot( D3DVECTOR v1, D3DVECTOR v2 );
+	VOID		RenderParticles();
+	VOID		RenderEntities();
+	VOID		SyncEntities( FLOAT fElapsedTime );
 };
@@ -137,3 +137,23 @@ IDirect3DDevice9* CGraphics::GetDevice()
 {
 	return m_pD3DDevice;
 }
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: LoadTexture
+//
+//  Desc: Loads a texture through CMappedFile, so it can come out of the
+//        mounted pack, rather than having D3DX open the file itself.
+// ----------------------------------------------------------------------------
+HRESULT CGraphics::LoadTexture( IDirect3DDevice9* pDevice, const char* sFileName, IDirect3DTexture9** ppTexture )
+{
+	CMappedFile file;
+
+	*ppTexture = NULL;
+
+	if( !file.Open( sFileName ) || !file.GetSize() ) return E_FAIL;
+
+	return D3DXCreateTextureFromFileInMemory( pDevice, file.GetData(), (UINT)file.GetSize(), ppTexture );
+}
@@ -22,4 +22,6 @@ public:
 	void	Destroy();
 
 	IDirect3DDevice9*	GetDevice();
+
+	static HRESULT	LoadTexture( IDirect3DDevice9* pDevice, const char* sFileName, IDirect3DTexture9** ppTexture );
 };
@@ -0,0 +1,682 @@
+// ----------------------------------------------------------------------------
+//  Filename: level.cpp
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+
+
+
+
+// Preprocessor directives.
+#include "sim.h"
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CLevel
+//
+//  Desc: Constructor
+// ----------------------------------------------------------------------------
+CLevel::CLevel()
+{
+	m_pHeader = NULL;
+	m_pFileChunks = NULL;
+	m_pFileBands = NULL;
+
+	Clear( LEVEL_COLUMNS, LEVEL_ROWS );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: ~CLevel
+//
+//  Desc: Destructor
+// ----------------------------------------------------------------------------
+CLevel::~CLevel()
+{
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Clear
+//
+//  Desc: Empties the level and sets its size.
+// ----------------------------------------------------------------------------
+void CLevel::Clear( int nColumns, int nRows )
+{
+	m_nColumns = nColumns;
+	m_nRows = nRows;
+
+	m_tChunks.clear();
+	m_tMotions.clear();
+	m_tBands.assign( ((nRows + LEVEL_CHUNK_SIZE - 1) >> LEVEL_CHUNK_SHIFT) + 1, 0 );
+
+	m_pFile.reset();
+	m_pHeader = NULL;
+	m_pFileChunks = NULL;
+	m_pFileBands = NULL;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Load
+//
+//  Desc: Loads a level file from disk, either a compiled one or the text
+//        LoadFromMemory reads. Text is parsed straight out of the mapped
+//        file, which is let go of afterwards.
+// ----------------------------------------------------------------------------
+bool CLevel::Load( const char* sFileName )
+{
+	shared_ptr<CMappedFile>	pFile( new CMappedFile() );
+	const unsigned char*	pData;
+	uint32_t				nMagic;
+
+	if( !pFile->Open( sFileName ) ) return false;
+
+	pData = pFile->GetData();
+
+	if( pFile->GetSize() >= sizeof(LEVELFILEHEADER) )
+	{
+		memcpy( &nMagic, pData, sizeof(nMagic) );
+		if( nMagic == LEVEL_FILE_MAGIC ) return LoadCompiled( pFile );
+	}
+
+	return LoadFromMemory( (const char*)pData, pFile->GetSize() );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: LoadCache
+//
+//  Desc: Loads a compiled level only if it was compiled from text that
+//        hashes to nSourceHash and is nSourceSize bytes, so a level whose
+//        text has been edited since is never used. Returns false for one
+//        that's out of date, damaged or missing, for the text to be loaded
+//        instead.
+// ----------------------------------------------------------------------------
+bool CLevel::LoadCache( const char* sFileName, uint64_t nSourceHash, uint64_t nSourceSize )
+{
+	shared_ptr<CMappedFile>	pFile( new CMappedFile() );
+	const LEVELFILEHEADER*	pHeader;
+
+	if( !pFile->Open( sFileName ) || (pFile->GetSize() < sizeof(LEVELFILEHEADER)) ) return false;
+
+	pHeader = (const LEVELFILEHEADER*)pFile->GetData();
+
+	if( (pHeader->nMagic != LEVEL_FILE_MAGIC) || (pHeader->nVersion != LEVEL_FILE_VERSION) ) return false;
+	if( (pHeader->nSourceHash != nSourceHash) || (pHeader->nSourceSize != nSourceSize) ) return false;
+
+	return LoadCompiled( pFile );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: LoadCompiled
+//
+//  Desc: Takes a compiled level file as it sits in memory. Nothing is copied
+//        out of it but the motions, and the only thing gone over is the
+//        chunks, to be sure every one is where the bands say and has no
+//        bricks outside the level.
+// ----------------------------------------------------------------------------
+bool CLevel::LoadCompiled( const shared_ptr<CMappedFile>& pFile )
+{
+	const LEVELFILEHEADER*	pHeader = (const LEVELFILEHEADER*)pFile->GetData();
+	const unsigned char*	pData = pFile->GetData();
+	const LEVELCHUNK*		pChunks;
+	const LEVELMOTION*		pMotions;
+	const int*				pBands;
+	uint64_t				tLength[LEVEL_FILE_SECTIONS];
+	uint64_t				nBits, nInside;
+	int						i, c, nBands, nBricks = 0;
+	int						nRowsLeft, nColumnsLeft;
+
+	Clear( LEVEL_COLUMNS, LEVEL_ROWS );
+
+	if( (pHeader->nVersion != LEVEL_FILE_VERSION) || (pHeader->nSize > pFile->GetSize()) ) return false;
+	if( (pHeader->nColumns <= 0) || (pHeader->nColumns > LEVEL_MAX_SIZE) ) return false;
+	if( (pHeader->nRows <= 0) || (pHeader->nRows > LEVEL_MAX_SIZE) ) return false;
+	if( (pHeader->nChunks < 0) || (pHeader->nBricks < 0) || (pHeader->nMotions < 0) ) return false;
+
+	nBands = (pHeader->nRows + LEVEL_CHUNK_SIZE - 1) >> LEVEL_CHUNK_SHIFT;
+
+	tLength[SectionChunks] = (uint64_t)pHeader->nChunks * sizeof(LEVELCHUNK);
+	tLength[SectionBands] = (uint64_t)(nBands + 1) * sizeof(int);
+	tLength[SectionMotions] = (uint64_t)pHeader->nMotions * sizeof(LEVELMOTION);
+
+	for( i = SectionCenterX; i < LEVEL_FILE_SECTIONS; i++ )
+	{
+		tLength[i] = (uint64_t)pHeader->nBricks * sizeof(float);
+	}
+
+	for( i = 0; i < LEVEL_FILE_SECTIONS; i++ )
+	{
+		if( pHeader->nOffset[i] & 7 ) return false;
+		if( (pHeader->nOffset[i] + tLength[i]) > pHeader->nSize ) return false;
+	}
+
+	pChunks = (const LEVELCHUNK*)(pData + pHeader->nOffset[SectionChunks]);
+	pBands = (const int*)(pData + pHeader->nOffset[SectionBands]);
+	pMotions = (const LEVELMOTION*)(pData + pHeader->nOffset[SectionMotions]);
+
+	// Everything else trusts the bands and chunks, so they get checked.
+	if( pBands[0] || (pBands[nBands] != pHeader->nChunks) ) return false;
+
+	for( i = 0; i < nBands; i++ )
+	{
+		if( pBands[i + 1] < pBands[i] ) return false;
+
+		for( c = pBands[i]; c < pBands[i + 1]; c++ )
+		{
+			if( pChunks[c].nY != i ) return false;
+			if( (pChunks[c].nX < 0) || ((pChunks[c].nX << LEVEL_CHUNK_SHIFT) >= pHeader->nColumns) ) return false;
+			if( (c > pBands[i]) && (pChunks[c].nX <= pChunks[c - 1].nX) ) return false;
+
+			if( pChunks[c].nBits[0] != (pChunks[c].nBits[1] | pChunks[c].nBits[2] | pChunks[c].nBits[3]) ) return false;
+
+			// Chunks on the right and bottom edges run past the level, and
+			// nothing may be set out there.
+			nRowsLeft = pHeader->nRows - (i << LEVEL_CHUNK_SHIFT);
+			nColumnsLeft = pHeader->nColumns - (pChunks[c].nX << LEVEL_CHUNK_SHIFT);
+
+			nInside = (nColumnsLeft >= LEVEL_CHUNK_SIZE) ? 0xFF : (((uint64_t)1 << nColumnsLeft) - 1);
+			nInside *= 0x0101010101010101ull;
+			if( nRowsLeft < LEVEL_CHUNK_SIZE ) nInside &= ((uint64_t)1 << (nRowsLeft * LEVEL_CHUNK_SIZE)) - 1;
+
+			if( pChunks[c].nBits[0] & ~nInside ) return false;
+
+			for( nBits = pChunks[c].nBits[0]; nBits; nBits &= nBits - 1 ) nBricks++;
+		}
+	}
+
+	if( nBricks != pHeader->nBricks ) return false;
+
+	m_nColumns = pHeader->nColumns;
+	m_nRows = pHeader->nRows;
+	m_tMotions.assign( pMotions, pMotions + pHeader->nMotions );
+
+	m_pFile = pFile;
+	m_pHeader = pHeader;
+	m_pFileChunks = pChunks;
+	m_pFileBands = pBands;
+
+	m_Extents.fOriginX = pHeader->fOriginX;
+	m_Extents.fOriginY = pHeader->fOriginY;
+	m_Extents.nBricks = pHeader->nBricks;
+	m_Extents.pCenterX = (const float*)(pData + pHeader->nOffset[SectionCenterX]);
+	m_Extents.pCenterY = (const float*)(pData + pHeader->nOffset[SectionCenterY]);
+	m_Extents.pHalfWidth = (const float*)(pData + pHeader->nOffset[SectionHalfWidth]);
+	m_Extents.pHalfHeight = (const float*)(pData + pHeader->nOffset[SectionHalfHeight]);
+
+	return true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: LoadFromMemory
+//
+//  Desc: Parses a level held in memory. Level files are a grid of numbers
+//        0-3, one line per row of bricks, optionally separated by spaces.
+//        Anything that isn't a 1, 2 or 3 is an empty slot. The level is as
+//        wide as its longest row and blank lines are skipped.
+//
+//        A line starting with ~ sets how the row above it moves, as
+//
+//            ~ <amplitude x> <amplitude y> <period> [<phase> [<spin>]]
+//
+//        See LEVELMOTION.
+// ----------------------------------------------------------------------------
+bool CLevel::LoadFromMemory( const char* pData, size_t nSize )
+{
+	vector<LEVELCHUNK>	tBand;		// Chunks of the row of chunks being read.
+	vector<int>			tColumn;	// Where each column of chunks is in tBand, or -1.
+	LEVELCHUNK			chunk;
+	LEVELMOTION			motion;
+	char				sLine[128];
+	uint64_t			nBit;
+	size_t				i;
+	int					x = 0, y = 0, cx, n;
+	bool				bRow;
+
+	Clear( 0, 0 );
+
+	tColumn.assign( LEVEL_MAX_SIZE >> LEVEL_CHUNK_SHIFT, -1 );
+
+	for( i = 0; i <= nSize; i++ )
+	{
+		bRow = false;
+
+		if( (i < nSize) && (pData[i] != '\n') )
+		{
+			if( isspace( (unsigned char)pData[i] ) ) continue;
+
+			// A motion line. It isn't a row itself.
+			if( (pData[i] == '~') && !x )
+			{
+				for( n = 0; ((i + 1) < nSize) && (pData[i + 1] != '\n'); i++ )
+				{
+					if( n < (int)(sizeof(sLine) - 1) ) sLine[n++] = pData[i + 1];
+				}
+
+				sLine[n] = 0;
+
+				memset( &motion, 0, sizeof(motion) );
+				motion.nRow = y - 1;
+
+				if( y && (sscanf( sLine, "%f %f %f %f %f", &motion.fAmpX, &motion.fAmpY, &motion.fPeriod, &motion.fPhase, &motion.fSpin ) >= 3) )
+				{
+					AddMotion( motion );
+				}
+
+				continue;
+			}
+
+			if( x >= LEVEL_MAX_SIZE ) break;
+
+			if( (pData[i] > '0') && (pData[i] < '4') )
+			{
+				cx = x >> LEVEL_CHUNK_SHIFT;
+
+				if( tColumn[cx] < 0 )
+				{
+					memset( &chunk, 0, sizeof(chunk) );
+					chunk.nX = cx;
+					chunk.nY = y >> LEVEL_CHUNK_SHIFT;
+
+					tColumn[cx] = (int)tBand.size();
+					tBand.push_back( chunk );
+				}
+
+				nBit = (uint64_t)1 << (((y & (LEVEL_CHUNK_SIZE - 1)) * LEVEL_CHUNK_SIZE) + (x & (LEVEL_CHUNK_SIZE - 1)));
+
+				tBand[tColumn[cx]].nBits[0] |= nBit;
+				tBand[tColumn[cx]].nBits[pData[i] - '0'] |= nBit;
+			}
+
+			x++;
+			continue;
+		}
+
+		// End of a line. Lines with nothing on them don't count as rows.
+		if( x )
+		{
+			if( y >= LEVEL_MAX_SIZE ) break;
+
+			if( x > m_nColumns ) m_nColumns = x;
+
+			x = 0;
+			y++;
+
+			bRow = true;
+		}
+
+		// Once the last row of a band of chunks is in, or the data runs out,
+		// its chunks go on the end in column order.
+		if( (bRow && !(y & (LEVEL_CHUNK_SIZE - 1))) || ((i == nSize) && (y & (LEVEL_CHUNK_SIZE - 1))) )
+		{
+			for( cx = 0; cx < ((m_nColumns + LEVEL_CHUNK_SIZE - 1) >> LEVEL_CHUNK_SHIFT); cx++ )
+			{
+				if( tColumn[cx] < 0 ) continue;
+
+				m_tChunks.push_back( tBand[tColumn[cx]] );
+				tColumn[cx] = -1;
+			}
+
+			tBand.clear();
+			m_tBands.push_back( (int)m_tChunks.size() );
+		}
+	}
+
+	m_nRows = y;
+
+	// Too big, or nothing there at all.
+	if( (i <= nSize) || !m_nRows )
+	{
+		Clear( LEVEL_COLUMNS, LEVEL_ROWS );
+		return false;
+	}
+
+	return true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: SaveCompiled
+//
+//  Desc: Writes the level out compiled, with the extents of its bricks for a
+//        board laid out at fOriginX, fOriginY. They're worked out the same
+//        way the brick set does, so a set built from the file comes out the
+//        same as one built from the level. nSourceHash and nSourceSize are
+//        of the text it was compiled from, see LoadCache.
+// ----------------------------------------------------------------------------
+bool CLevel::SaveCompiled( const char* sFileName, float fOriginX, float fOriginY, uint64_t nSourceHash, uint64_t nSourceSize ) const
+{
+	LEVELFILEHEADER		header;
+	vector<char>		tFile;
+	vector<int>			tBands;
+	float*				pExtents[LEVEL_FILE_SECTIONS];
+	const LEVELCHUNK*	pChunk;
+	ofstream			file;
+	size_t				nEnd;
+	int					c, i, x, y, nSlot;
+
+	memset( &header, 0, sizeof(header) );
+	header.nMagic = LEVEL_FILE_MAGIC;
+	header.nVersion = LEVEL_FILE_VERSION;
+	header.nSourceHash = nSourceHash;
+	header.nSourceSize = nSourceSize;
+	header.nColumns = m_nColumns;
+	header.nRows = m_nRows;
+	header.nChunks = GetChunkCount();
+	header.nBricks = CountBricks();
+	header.nMotions = GetMotionCount();
+	header.fOriginX = fOriginX;
+	header.fOriginY = fOriginY;
+	header.fPitchX = BRICK_PITCH_X;
+	header.fPitchY = BRICK_PITCH_Y;
+	header.fHalfWidth = BRICK_HALF_WIDTH;
+	header.fHalfHeight = BRICK_HALF_HEIGHT;
+
+	// The bands are rebuilt from the chunks, the same way the brick set does
+	// it, so this works however the level was loaded.
+	tBands.assign( ((m_nRows + LEVEL_CHUNK_SIZE - 1) >> LEVEL_CHUNK_SHIFT) + 1, 0 );
+
+	for( c = 0; c < header.nChunks; c++ )
+	{
+		tBands[GetChunk( c )->nY + 1] = c + 1;
+	}
+
+	for( c = 1; c < (int)tBands.size(); c++ )
+	{
+		if( tBands[c] < tBands[c - 1] ) tBands[c] = tBands[c - 1];
+	}
+
+	// Lay the sections out one after the other.
+	nEnd = (sizeof(header) + 7) & ~(size_t)7;
+
+	for( i = 0; i < LEVEL_FILE_SECTIONS; i++ )
+	{
+		header.nOffset[i] = (uint32_t)nEnd;
+
+		if( i == SectionChunks ) nEnd += header.nChunks * sizeof(LEVELCHUNK);
+		else if( i == SectionBands ) nEnd += tBands.size() * sizeof(int);
+		else if( i == SectionMotions ) nEnd += header.nMotions * sizeof(LEVELMOTION);
+		else nEnd += header.nBricks * sizeof(float);
+
+		nEnd = (nEnd + 7) & ~(size_t)7;
+	}
+
+	if( nEnd > UINT32_MAX ) return false;
+
+	header.nSize = (uint32_t)nEnd;
+
+	tFile.assign( nEnd, 0 );
+	memcpy( &tFile[0], &header, sizeof(header) );
+	memcpy( &tFile[header.nOffset[SectionBands]], &tBands[0], tBands.size() * sizeof(int) );
+
+	for( c = 0; c < header.nChunks; c++ )
+	{
+		memcpy( &tFile[header.nOffset[SectionChunks] + (c * sizeof(LEVELCHUNK))], GetChunk( c ), sizeof(LEVELCHUNK) );
+	}
+
+	for( i = 0; i < header.nMotions; i++ )
+	{
+		memcpy( &tFile[header.nOffset[SectionMotions] + (i * sizeof(LEVELMOTION))], GetMotion( i ), sizeof(LEVELMOTION) );
+	}
+
+	for( i = SectionCenterX; i < LEVEL_FILE_SECTIONS; i++ )
+	{
+		pExtents[i] = (float*)&tFile[header.nOffset[i]];
+	}
+
+	// Bricks in chunk order, and slot order within a chunk.
+	for( c = 0, i = 0; c < header.nChunks; c++ )
+	{
+		pChunk = GetChunk( c );
+
+		for( nSlot = 0; nSlot < (LEVEL_CHUNK_SIZE * LEVEL_CHUNK_SIZE); nSlot++ )
+		{
+			if( !((pChunk->nBits[0] >> nSlot) & 1) ) continue;
+
+			x = (pChunk->nX << LEVEL_CHUNK_SHIFT) + (nSlot & (LEVEL_CHUNK_SIZE - 1));
+			y = (pChunk->nY << LEVEL_CHUNK_SHIFT) + (nSlot >> LEVEL_CHUNK_SHIFT);
+
+			pExtents[SectionCenterX][i] = fOriginX + (BRICK_PITCH_X * x);
+			pExtents[SectionCenterY][i] = fOriginY - (BRICK_PITCH_Y * y);
+			pExtents[SectionHalfWidth][i] = BRICK_HALF_WIDTH;
+			pExtents[SectionHalfHeight][i] = BRICK_HALF_HEIGHT;
+
+			i++;
+		}
+	}
+
+	file.open( sFileName, ios::out | ios::binary | ios::trunc );
+	if( !file.is_open() ) return false;
+
+	file.write( &tFile[0], tFile.size() );
+	file.close();
+
+	return !file.fail();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: FindChunk
+//
+//  Desc: Returns the index of the chunk at cx, cy, or -1 if it has no bricks.
+// ----------------------------------------------------------------------------
+int CLevel::FindChunk( int cx, int cy ) const
+{
+	const int*	pBands = m_pFileBands ? m_pFileBands : &m_tBands[0];
+	int			lo, hi, mid;
+
+	if( (cy < 0) || (cy >= ((m_nRows + LEVEL_CHUNK_SIZE - 1) >> LEVEL_CHUNK_SHIFT)) ) return -1;
+
+	lo = pBands[cy];
+	hi = pBands[cy + 1];
+
+	while( lo < hi )
+	{
+		mid = (lo + hi) / 2;
+
+		if( GetChunk( mid )->nX < cx ) lo = mid + 1;
+		else hi = mid;
+	}
+
+	if( (lo < pBands[cy + 1]) && (GetChunk( lo )->nX == cx) ) return lo;
+
+	return -1;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetColumns
+//
+//  Desc: Returns the width of the level in bricks.
+// ----------------------------------------------------------------------------
+int CLevel::GetColumns() const
+{
+	return m_nColumns;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetRows
+//
+//  Desc: Returns the height of the level in bricks.
+// ----------------------------------------------------------------------------
+int CLevel::GetRows() const
+{
+	return m_nRows;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetBrick
+//
+//  Desc: Returns the type of brick in the given slot.
+// ----------------------------------------------------------------------------
+int CLevel::GetBrick( int x, int y ) const
+{
+	uint64_t	nBit;
+	int			i;
+
+	if( (x < 0) || (x >= m_nColumns) || (y < 0) || (y >= m_nRows) ) return BrickNone;
+
+	i = FindChunk( x >> LEVEL_CHUNK_SHIFT, y >> LEVEL_CHUNK_SHIFT );
+	if( i < 0 ) return BrickNone;
+
+	nBit = (uint64_t)1 << (((y & (LEVEL_CHUNK_SIZE - 1)) * LEVEL_CHUNK_SIZE) + (x & (LEVEL_CHUNK_SIZE - 1)));
+
+	for( int t = 1; t <= BRICK_TYPES; t++ )
+	{
+		if( GetChunk( i )->nBits[t] & nBit ) return t;
+	}
+
+	return BrickNone;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CountBricks
+//
+//  Desc: Returns how many bricks the level starts with.
+// ----------------------------------------------------------------------------
+int CLevel::CountBricks() const
+{
+	uint64_t	nBits;
+	int			n = 0;
+
+	if( m_pHeader ) return m_pHeader->nBricks;
+
+	for( size_t i = 0; i < m_tChunks.size(); i++ )
+	{
+		for( nBits = m_tChunks[i].nBits[0]; nBits; nBits &= nBits - 1 ) n++;
+	}
+
+	return n;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: AddMotion
+//
+//  Desc: Sets how a row of bricks moves. A later motion for the same row
+//        takes the place of an earlier one.
+// ----------------------------------------------------------------------------
+void CLevel::AddMotion( const LEVELMOTION& motion )
+{
+	for( size_t i = 0; i < m_tMotions.size(); i++ )
+	{
+		if( m_tMotions[i].nRow != motion.nRow ) continue;
+
+		m_tMotions[i] = motion;
+		return;
+	}
+
+	m_tMotions.push_back( motion );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetChunkCount
+//
+//  Desc: Returns how many chunks of the level have bricks in them.
+// ----------------------------------------------------------------------------
+int CLevel::GetChunkCount() const
+{
+	if( m_pHeader ) return m_pHeader->nChunks;
+
+	return (int)m_tChunks.size();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetChunk
+//
+//  Desc: Returns one of the chunks with bricks in it. They run along each
+//        row of chunks in turn, from the top.
+// ----------------------------------------------------------------------------
+const LEVELCHUNK* CLevel::GetChunk( int i ) const
+{
+	if( m_pFileChunks ) return &m_pFileChunks[i];
+
+	return &m_tChunks[i];
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetMotionCount
+//
+//  Desc: Returns how many rows of the level move.
+// ----------------------------------------------------------------------------
+int CLevel::GetMotionCount() const
+{
+	return (int)m_tMotions.size();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetMotion
+//
+//  Desc: Returns how one of the rows that move does so.
+// ----------------------------------------------------------------------------
+const LEVELMOTION* CLevel::GetMotion( int i ) const
+{
+	return &m_tMotions[i];
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetExtents
+//
+//  Desc: Returns where the bricks of a compiled level are, or NULL if the
+//        level wasn't loaded from one or was compiled for bricks of another
+//        size.
+// ----------------------------------------------------------------------------
+const LEVELEXTENTS* CLevel::GetExtents() const
+{
+	if( !m_pHeader ) return NULL;
+
+	if( (m_pHeader->fPitchX != BRICK_PITCH_X) || (m_pHeader->fPitchY != BRICK_PITCH_Y) ) return NULL;
+	if( (m_pHeader->fHalfWidth != BRICK_HALF_WIDTH) || (m_pHeader->fHalfHeight != BRICK_HALF_HEIGHT) ) return NULL;
+
+	return &m_Extents;
+}
@@ -0,0 +1,159 @@
+// ----------------------------------------------------------------------------
+//  Filename: level.h
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+#pragma once
+
+// Size of the standard level. The playing field is laid out to fit one of
+// these exactly and grows for anything bigger.
+#define LEVEL_COLUMNS		10
+#define LEVEL_ROWS			10
+
+// Largest level, in bricks each way.
+#define LEVEL_MAX_SIZE		4096
+
+// Levels are kept in square chunks of LEVEL_CHUNK_SIZE slots each way, so a
+// chunk fits in one 64-bit word. Bit (y * 8) + x of a chunk is its slot
+// (x, y).
+#define LEVEL_CHUNK_SIZE	8
+#define LEVEL_CHUNK_SHIFT	3
+
+// Brick types 1 to BRICK_TYPES, see BrickType.
+#define BRICK_TYPES			3
+
+// Brick types, as they appear in a level file ('0' through '3').
+enum BrickType
+{
+	BrickNone = 0,
+	BrickRed,
+	BrickGreen,
+	BrickBlue
+};
+
+// One chunk of a level with at least one brick in it.
+struct LEVELCHUNK
+{
+	int			nX, nY;						// Position, in chunks.
+	uint64_t	nBits[BRICK_TYPES + 1];		// Slots of each type, [0] is every type.
+};
+
+// How the bricks of a row move. Each one swings fAmpX, fAmpY either way of
+// its slot and back every fPeriod seconds, starting fPhase of the way into
+// the swing, and turns about its center fSpin degrees a second. A period of
+// 0 leaves it in its slot.
+struct LEVELMOTION
+{
+	int		nRow;
+	float	fAmpX, fAmpY;
+	float	fPeriod;
+	float	fPhase;
+	float	fSpin;
+};
+
+// Compiled level files. A header, then each section it points to, every one
+// starting on an 8 byte boundary so it can be used straight out of the file
+// once it's mapped into memory. Everything is little endian, as written by
+// the machine that compiled it. Like a mesh cache, a compiled level holds
+// a hash of the text it was compiled from, and is only used in place of
+// that text while it still hashes the same, see CLevel::LoadCache.
+#define LEVEL_FILE_MAGIC	0x4C443342		// "B3DL"
+#define LEVEL_FILE_VERSION	2
+
+// Sections of a compiled level. Brick types are in the chunks, as they are
+// in memory. The extents are one entry per brick, in the order the brick set
+// numbers them, and are only worth anything to a board laid out with the
+// same origin and brick sizes as the header.
+enum LevelSection
+{
+	SectionChunks = 0,		// LEVELCHUNK, nChunks of them.
+	SectionBands,			// int, one per row of chunks and the end.
+	SectionMotions,			// LEVELMOTION, nMotions of them.
+	SectionCenterX,			// float, nBricks of each of these.
+	SectionCenterY,
+	SectionHalfWidth,
+	SectionHalfHeight,
+	LEVEL_FILE_SECTIONS
+};
+
+struct LEVELFILEHEADER
+{
+	uint32_t	nMagic;
+	uint32_t	nVersion;
+	uint64_t	nSourceHash;						// See CMeshData::HashSource.
+	uint64_t	nSourceSize;
+	int32_t		nColumns, nRows;
+	int32_t		nChunks;
+	int32_t		nBricks;
+	int32_t		nMotions;
+	float		fOriginX, fOriginY;
+	float		fPitchX, fPitchY;
+	float		fHalfWidth, fHalfHeight;
+	uint32_t	nSize;								// Of the whole file.
+	uint32_t	nOffset[LEVEL_FILE_SECTIONS];		// From the start of the file.
+};
+
+// Where every brick of a compiled level is, for a board laid out at
+// fOriginX, fOriginY. The arrays point into the level file.
+struct LEVELEXTENTS
+{
+	float			fOriginX, fOriginY;
+	int				nBricks;
+	const float*	pCenterX;
+	const float*	pCenterY;
+	const float*	pHalfWidth;
+	const float*	pHalfHeight;
+};
+
+class CMappedFile;
+
+// A level of any size up to LEVEL_MAX_SIZE each way. Only the chunks that
+// have bricks in them are kept, sorted by row and then by column, so a
+// level takes memory for its bricks rather than for its area.
+//
+// A compiled level is used where it sits in its mapped file rather than
+// copied out, so loading one takes the same time however big it is. Copies
+// of the level share the file.
+class CLevel
+{
+protected:
+	int						m_nColumns;
+	int						m_nRows;
+
+	vector<LEVELCHUNK>		m_tChunks;
+	vector<int>				m_tBands;		// First chunk of each row of chunks, and the end.
+	vector<LEVELMOTION>		m_tMotions;		// One for each row that moves.
+
+	shared_ptr<CMappedFile>	m_pFile;		// Only for a compiled level.
+	const LEVELFILEHEADER*	m_pHeader;
+	const LEVELCHUNK*		m_pFileChunks;
+	const int*				m_pFileBands;
+	LEVELEXTENTS			m_Extents;
+
+protected:
+	int		FindChunk( int cx, int cy ) const;
+	bool	LoadCompiled( const shared_ptr<CMappedFile>& pFile );
+
+public:
+	CLevel();
+	virtual ~CLevel();
+
+	void	Clear( int nColumns, int nRows );
+	bool	Load( const char* sFileName );
+	bool	LoadFromMemory( const char* pData, size_t nSize );
+	bool	LoadCache( const char* sFileName, uint64_t nSourceHash, uint64_t nSourceSize );
+	bool	SaveCompiled( const char* sFileName, float fOriginX, float fOriginY, uint64_t nSourceHash, uint64_t nSourceSize ) const;
+
+	int		GetColumns() const;
+	int		GetRows() const;
+	int		GetBrick( int x, int y ) const;
+	int		CountBricks() const;
+	void	AddMotion( const LEVELMOTION& motion );
+
+	int					GetChunkCount() const;
+	const LEVELCHUNK*	GetChunk( int i ) const;
+	int					GetMotionCount() const;
+	const LEVELMOTION*	GetMotion( int i ) const;
+	const LEVELEXTENTS*	GetExtents() const;
+};
@@ -0,0 +1,571 @@
+// ----------------------------------------------------------------------------
+//  Filename: loader.cpp
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+
+
+
+
+// Preprocessor directives.
+#include "sim.h"
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CLevelLoader
+//
+//  Desc: Constructor
+// ----------------------------------------------------------------------------
+CLevelLoader::CLevelLoader()
+{
+	m_nWanted = -1;
+	m_nLoading = -1;
+	m_bFailed = false;
+	m_bSaveFailed = false;
+	m_bQuit = false;
+
+	memset( &m_Settings, 0, sizeof(m_Settings) );
+
+	m_Ready.nIndex = -1;
+	m_Ready.pLevel = NULL;
+	m_Ready.pBoard = NULL;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: ~CLevelLoader
+//
+//  Desc: Destructor
+// ----------------------------------------------------------------------------
+CLevelLoader::~CLevelLoader()
+{
+	Destroy();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: LoadSequence
+//
+//  Desc: Reads the order levels are played in from a file with one level
+//        name to a line, relative to the file's own folder. Blank lines are
+//        skipped. Replaces whatever sequence there was. Goes through
+//        CMappedFile, so the file can be in the mounted pack.
+// ----------------------------------------------------------------------------
+bool CLevelLoader::LoadSequence( const char* sFileName )
+{
+	CMappedFile	file;
+	const char*	pText;
+	const char*	pEnd;
+	const char*	pLine;
+	string		sFolder, sLine;
+	size_t		nStart, nEnd;
+
+	if( !file.Open( sFileName ) ) return false;
+
+	sFolder = sFileName;
+	nEnd = sFolder.find_last_of( "\\/" );
+	sFolder = (nEnd == string::npos) ? "" : sFolder.substr( 0, nEnd + 1 );
+
+	m_tSequence.clear();
+
+	pText = (const char*)file.GetData();
+	pEnd = pText + file.GetSize();
+
+	while( pText < pEnd )
+	{
+		for( pLine = pText; (pText < pEnd) && (*pText != '\n'); pText++ );
+
+		sLine.assign( pLine, pText );
+		if( pText < pEnd ) pText++;
+
+		nStart = sLine.find_first_not_of( " \t\r" );
+		if( nStart == string::npos ) continue;
+
+		nEnd = sLine.find_last_not_of( " \t\r" );
+
+		m_tSequence.push_back( sFolder + sLine.substr( nStart, nEnd - nStart + 1 ) );
+	}
+
+	return !m_tSequence.empty();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: AddLevel
+//
+//  Desc: Puts a level on the end of the sequence. The name is the level's
+//        path without its extension, see LoadLevel.
+// ----------------------------------------------------------------------------
+void CLevelLoader::AddLevel( const char* sName )
+{
+	m_tSequence.push_back( sName );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Init
+//
+//  Desc: Starts the loader thread. The sequence can't change after this.
+// ----------------------------------------------------------------------------
+bool CLevelLoader::Init()
+{
+	Destroy();
+
+	m_bQuit = false;
+	m_Thread = thread( &CLevelLoader::LoaderMain, this );
+
+	return true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Destroy
+//
+//  Desc: Stops the loader thread once it's finished whatever level it's on,
+//        and frees everything it still holds.
+// ----------------------------------------------------------------------------
+void CLevelLoader::Destroy()
+{
+	if( m_Thread.joinable() )
+	{
+		{
+			lock_guard<mutex> lock( m_Lock );
+			m_bQuit = true;
+		}
+
+		m_Wake.notify_all();
+		m_Thread.join();
+	}
+
+	FreeReady();
+
+	// Replays still waiting are written out now rather than lost.
+	WriteReplays( &m_tReplays );
+
+	for( size_t i = 0; i < m_tOldLevels.size(); i++ )
+	{
+		delete m_tOldLevels[i];
+	}
+
+	for( size_t i = 0; i < m_tOldBoards.size(); i++ )
+	{
+		delete m_tOldBoards[i];
+	}
+
+	m_tOldLevels.clear();
+	m_tOldBoards.clear();
+
+	m_nWanted = -1;
+	m_nLoading = -1;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: FreeReady
+//
+//  Desc: Frees the level waiting to be taken, if there is one. The lock must
+//        be held, or the thread stopped.
+// ----------------------------------------------------------------------------
+void CLevelLoader::FreeReady()
+{
+	delete m_Ready.pLevel;
+	delete m_Ready.pBoard;
+
+	m_Ready.nIndex = -1;
+	m_Ready.pLevel = NULL;
+	m_Ready.pBoard = NULL;
+	m_bFailed = false;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Request
+//
+//  Desc: Asks for level nIndex of the sequence to be loaded, with a board set
+//        up the same way as pSettings. Does nothing if it's already loaded
+//        or being loaded. Only the last level asked for is loaded, so asking
+//        for another before the first is taken throws the first away.
+// ----------------------------------------------------------------------------
+void CLevelLoader::Request( int nIndex, const CBoard* pSettings )
+{
+	if( (nIndex < 0) || (nIndex >= (int)m_tSequence.size()) ) return;
+
+	{
+		lock_guard<mutex> lock( m_Lock );
+
+		m_Settings.Collision = pSettings->GetCollisionMode();
+		m_Settings.Phase = pSettings->GetBroadphase();
+		m_Settings.bBallCollisions = pSettings->GetBallCollisions();
+		m_Settings.fTimeStep = pSettings->GetTimeStep();
+		m_Settings.nLives = pSettings->GetLives();
+
+		if( (m_Ready.nIndex == nIndex) && m_Ready.pLevel )
+		{
+			m_nWanted = -1;
+			return;
+		}
+
+		if( m_nLoading == nIndex )
+		{
+			m_nWanted = -1;
+			return;
+		}
+
+		// One that failed gets another go.
+		if( m_Ready.nIndex == nIndex ) m_Ready.nIndex = -1;
+
+		m_nWanted = nIndex;
+	}
+
+	m_Wake.notify_all();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Take
+//
+//  Desc: Hands level nIndex over, waiting for it if it isn't loaded yet. It
+//        should have been asked for well before, so it usually is. Returns
+//        false if it couldn't be loaded. Without the thread running, the
+//        level is loaded here and now.
+// ----------------------------------------------------------------------------
+bool CLevelLoader::Take( int nIndex, const CBoard* pSettings, LOADEDLEVEL* pLoaded )
+{
+	LOADERSETTINGS settings;
+
+	pLoaded->nIndex = nIndex;
+	pLoaded->pLevel = NULL;
+	pLoaded->pBoard = NULL;
+
+	if( (nIndex < 0) || (nIndex >= (int)m_tSequence.size()) ) return false;
+
+	if( !m_Thread.joinable() )
+	{
+		Request( nIndex, pSettings );
+		settings = m_Settings;
+		m_nWanted = -1;
+
+		return LoadLevel( nIndex, settings, pLoaded );
+	}
+
+	Request( nIndex, pSettings );
+
+	unique_lock<mutex> lock( m_Lock );
+
+	while( (m_Ready.nIndex != nIndex) || (!m_Ready.pLevel && !m_bFailed) )
+	{
+		m_Done.wait( lock );
+	}
+
+	*pLoaded = m_Ready;
+
+	m_Ready.nIndex = -1;
+	m_Ready.pLevel = NULL;
+	m_Ready.pBoard = NULL;
+	m_bFailed = false;
+
+	return pLoaded->pLevel != NULL;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Retire
+//
+//  Desc: Hands back a level and board that are done with, to be freed on the
+//        loader thread. Either can be NULL.
+// ----------------------------------------------------------------------------
+void CLevelLoader::Retire( CLevel* pLevel, CBoard* pBoard )
+{
+	if( !m_Thread.joinable() )
+	{
+		delete pLevel;
+		delete pBoard;
+		return;
+	}
+
+	{
+		lock_guard<mutex> lock( m_Lock );
+
+		if( pLevel ) m_tOldLevels.push_back( pLevel );
+		if( pBoard ) m_tOldBoards.push_back( pBoard );
+	}
+
+	m_Wake.notify_all();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: SaveReplay
+//
+//  Desc: Hands a copy of a finished replay over to be written to sFileName
+//        on the loader thread, so going on to the next level doesn't wait
+//        on the disk. Without the thread running, it's written here and
+//        now. See SaveFailed.
+// ----------------------------------------------------------------------------
+void CLevelLoader::SaveReplay( const CReplay& replay, const char* sFileName )
+{
+	SAVEDREPLAY saved;
+
+	saved.pReplay = new CReplay( replay );
+	saved.sFileName = sFileName;
+
+	if( !m_Thread.joinable() )
+	{
+		vector<SAVEDREPLAY> tReplays( 1, saved );
+
+		WriteReplays( &tReplays );
+		return;
+	}
+
+	{
+		lock_guard<mutex> lock( m_Lock );
+
+		m_tReplays.push_back( saved );
+	}
+
+	m_Wake.notify_all();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: SaveFailed
+//
+//  Desc: Returns whether a replay handed over couldn't be written out since
+//        this was last asked.
+// ----------------------------------------------------------------------------
+bool CLevelLoader::SaveFailed()
+{
+	return m_bSaveFailed.exchange( false );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: WriteReplays
+//
+//  Desc: Writes out and frees the replays in pReplays, and empties it.
+// ----------------------------------------------------------------------------
+void CLevelLoader::WriteReplays( vector<SAVEDREPLAY>* pReplays )
+{
+	for( size_t i = 0; i < pReplays->size(); i++ )
+	{
+		if( !(*pReplays)[i].pReplay->Save( (*pReplays)[i].sFileName.c_str() ) ) m_bSaveFailed = true;
+
+		delete (*pReplays)[i].pReplay;
+	}
+
+	pReplays->clear();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: IsReady
+//
+//  Desc: Returns whether level nIndex is loaded and waiting to be taken.
+// ----------------------------------------------------------------------------
+bool CLevelLoader::IsReady( int nIndex )
+{
+	lock_guard<mutex> lock( m_Lock );
+
+	return (m_Ready.nIndex == nIndex) && (m_Ready.pLevel != NULL);
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: LoaderMain
+//
+//  Desc: The loader thread. Frees whatever has been retired and loads
+//        whatever has been asked for, until told to stop.
+// ----------------------------------------------------------------------------
+void CLevelLoader::LoaderMain()
+{
+	vector<CLevel*>		tLevels;
+	vector<CBoard*>		tBoards;
+	vector<SAVEDREPLAY>	tReplays;
+	LOADERSETTINGS		settings;
+	LOADEDLEVEL			loaded;
+	bool				bLoaded;
+	int					nIndex;
+
+	unique_lock<mutex> lock( m_Lock );
+
+	for( ;; )
+	{
+		while( !m_bQuit && (m_nWanted < 0) && m_tOldLevels.empty() && m_tOldBoards.empty() && m_tReplays.empty() )
+		{
+			m_Wake.wait( lock );
+		}
+
+		if( m_bQuit ) break;
+
+		// Write out replays and free what's been retired, outside the lock.
+		tLevels.swap( m_tOldLevels );
+		tBoards.swap( m_tOldBoards );
+		tReplays.swap( m_tReplays );
+
+		lock.unlock();
+
+		WriteReplays( &tReplays );
+
+		for( size_t i = 0; i < tLevels.size(); i++ )
+		{
+			delete tLevels[i];
+		}
+
+		for( size_t i = 0; i < tBoards.size(); i++ )
+		{
+			delete tBoards[i];
+		}
+
+		tLevels.clear();
+		tBoards.clear();
+
+		lock.lock();
+
+		if( m_bQuit ) break;
+		if( m_nWanted < 0 ) continue;
+
+		nIndex = m_nWanted;
+		settings = m_Settings;
+
+		m_nWanted = -1;
+		m_nLoading = nIndex;
+
+		lock.unlock();
+
+		bLoaded = LoadLevel( nIndex, settings, &loaded );
+
+		lock.lock();
+
+		m_nLoading = -1;
+
+		// Whatever was waiting to be taken has been passed over.
+		if( m_Ready.pLevel ) m_tOldLevels.push_back( m_Ready.pLevel );
+		if( m_Ready.pBoard ) m_tOldBoards.push_back( m_Ready.pBoard );
+
+		m_Ready = loaded;
+		m_bFailed = !bLoaded;
+
+		m_Done.notify_all();
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: LoadLevel
+//
+//  Desc: Loads level nIndex and sets a board up to play it. If there's text,
+//        <name>.lvl, the compiled level, <name>.lvb, is used instead only
+//        while it was compiled from that text as it is now. Without text,
+//        the compiled level is used as it is, then the name as it is.
+// ----------------------------------------------------------------------------
+bool CLevelLoader::LoadLevel( int nIndex, const LOADERSETTINGS& settings, LOADEDLEVEL* pLoaded )
+{
+	CMappedFile	source;
+	string		sName = m_tSequence[nIndex];
+	bool		bLoaded;
+
+	pLoaded->nIndex = nIndex;
+	pLoaded->pLevel = new CLevel();
+	pLoaded->pBoard = NULL;
+
+	if( source.Open( (sName + ".lvl").c_str() ) )
+	{
+		pLoaded->sFileName = sName + ".lvb";
+		bLoaded = pLoaded->pLevel->LoadCache( pLoaded->sFileName.c_str(), CMeshData::HashSource( source.GetData(), source.GetSize() ), source.GetSize() );
+
+		if( !bLoaded )
+		{
+			pLoaded->sFileName = sName + ".lvl";
+			bLoaded = pLoaded->pLevel->LoadFromMemory( (const char*)source.GetData(), source.GetSize() );
+		}
+	}
+	else
+	{
+		pLoaded->sFileName = sName + ".lvb";
+		bLoaded = pLoaded->pLevel->Load( pLoaded->sFileName.c_str() );
+
+		if( !bLoaded )
+		{
+			pLoaded->sFileName = sName;
+			bLoaded = pLoaded->pLevel->Load( pLoaded->sFileName.c_str() );
+		}
+	}
+
+	if( !bLoaded )
+	{
+		delete pLoaded->pLevel;
+		pLoaded->pLevel = NULL;
+
+		return false;
+	}
+
+	pLoaded->pBoard = new CBoard();
+
+	pLoaded->pBoard->SetCollisionMode( settings.Collision );
+	pLoaded->pBoard->SetBroadphase( settings.Phase );
+	pLoaded->pBoard->SetBallCollisions( settings.bBallCollisions );
+	pLoaded->pBoard->SetTimeStep( settings.fTimeStep );
+	pLoaded->pBoard->SetLives( settings.nLives );
+	pLoaded->pBoard->Reset( pLoaded->pLevel );
+
+	return true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetCount
+//
+//  Desc: Returns how many levels there are in the sequence.
+// ----------------------------------------------------------------------------
+int CLevelLoader::GetCount() const
+{
+	return (int)m_tSequence.size();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetName
+//
+//  Desc: Returns the name of level nIndex, without its extension.
+// ----------------------------------------------------------------------------
+const char* CLevelLoader::GetName( int nIndex ) const
+{
+	return m_tSequence[nIndex].c_str();
+}
@@ -0,0 +1,90 @@
+// ----------------------------------------------------------------------------
+//  Filename: loader.h
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+#pragma once
+
+// How a board the loader sets up is to be played, taken from the board it's
+// going to replace.
+struct LOADERSETTINGS
+{
+	CollisionMode	Collision;
+	Broadphase		Phase;
+	bool			bBallCollisions;
+	float			fTimeStep;
+	int				nLives;
+};
+
+// A level and a board set up to play it, ready to be swapped in. Whoever
+// takes it owns both.
+struct LOADEDLEVEL
+{
+	int			nIndex;			// Place in the sequence.
+	string		sFileName;		// File it came from, compiled or not.
+	CLevel*		pLevel;
+	CBoard*		pBoard;
+};
+
+// A finished replay handed to the loader to be written out.
+struct SAVEDREPLAY
+{
+	CReplay*	pReplay;
+	string		sFileName;
+};
+
+// Loads the levels of a sequence on a thread of its own, one ahead of the
+// one being played, and sets a board up for each. Going on to the next
+// level is then just swapping the pointers over. The level and board that
+// were swapped out are handed back to be freed on the loader's thread too,
+// since a big level takes a while to let go of, and the replay of the
+// level is written out there rather than holding up the switch.
+class CLevelLoader
+{
+protected:
+	vector<string>		m_tSequence;	// Level names, without the extension. Only
+										// changed before the thread starts.
+
+	thread				m_Thread;
+	mutex				m_Lock;
+	condition_variable	m_Wake;
+	condition_variable	m_Done;
+
+	int					m_nWanted;		// Level to load next, or -1.
+	int					m_nLoading;		// Level being loaded, or -1.
+	LOADERSETTINGS		m_Settings;
+	LOADEDLEVEL			m_Ready;		// pLevel is NULL until there's one.
+	bool				m_bFailed;		// The level in m_Ready couldn't be loaded.
+	vector<CLevel*>		m_tOldLevels;
+	vector<CBoard*>		m_tOldBoards;
+	vector<SAVEDREPLAY>	m_tReplays;		// Waiting to be written out.
+	atomic<bool>		m_bSaveFailed;	// A replay couldn't be, since last asked.
+	bool				m_bQuit;
+
+protected:
+	void	LoaderMain();
+	bool	LoadLevel( int nIndex, const LOADERSETTINGS& settings, LOADEDLEVEL* pLoaded );
+	void	FreeReady();
+	void	WriteReplays( vector<SAVEDREPLAY>* pReplays );
+
+public:
+	CLevelLoader();
+	virtual ~CLevelLoader();
+
+	bool	LoadSequence( const char* sFileName );
+	void	AddLevel( const char* sName );
+
+	bool	Init();
+	void	Destroy();
+
+	void	Request( int nIndex, const CBoard* pSettings );
+	bool	Take( int nIndex, const CBoard* pSettings, LOADEDLEVEL* pLoaded );
+	void	Retire( CLevel* pLevel, CBoard* pBoard );
+	void	SaveReplay( const CReplay& replay, const char* sFileName );
+	bool	SaveFailed();
+	bool	IsReady( int nIndex );
+
+	int			GetCount() const;
+	const char*	GetName( int nIndex ) const;
+};
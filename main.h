@@ -14,7 +14,9 @@
 using namespace std;
 
 #include "debug.h"
+#include "timer.h"
 #include "types.h"
+#include "sim.h"
 #include "graphics.h"
 #include "object.h"
 #include "camera.h"
@@ -0,0 +1,222 @@
+// ----------------------------------------------------------------------------
+//  Filename: mapfile.cpp
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+
+
+
+
+// Preprocessor directives.
+#include "sim.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CMappedFile
+//
+//  Desc: Constructor
+// ----------------------------------------------------------------------------
+CMappedFile::CMappedFile()
+{
+	m_pData = NULL;
+	m_nSize = 0;
+	m_bMapped = false;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: ~CMappedFile
+//
+//  Desc: Destructor
+// ----------------------------------------------------------------------------
+CMappedFile::~CMappedFile()
+{
+	Close();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Open
+//
+//  Desc: Opens a file out of the mounted pack, if there is one and the file
+//        is in it, or from the disk otherwise.
+// ----------------------------------------------------------------------------
+bool CMappedFile::Open( const char* sFileName )
+{
+	shared_ptr<CAssetPack>	pPack = CAssetPack::GetMounted();
+	int						nEntry;
+
+	Close();
+
+	nEntry = pPack ? pPack->Find( sFileName ) : -1;
+	if( nEntry < 0 ) return OpenFile( sFileName );
+
+	if( !pPack->IsCompressed( nEntry ) )
+	{
+		m_pSource = pPack->GetFile();
+		m_nSize = (size_t)pPack->GetSize( nEntry );
+		m_pData = m_nSize ? pPack->GetData( nEntry ) : NULL;
+
+		return true;
+	}
+
+	if( !pPack->Read( nEntry, &m_tBuffer ) )
+	{
+		m_tBuffer.clear();
+		return false;
+	}
+
+	m_nSize = m_tBuffer.size();
+	m_pData = m_nSize ? &m_tBuffer[0] : NULL;
+
+	return true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: OpenFile
+//
+//  Desc: Maps a file on the disk into memory, never out of a pack. An empty
+//        file opens fine, with no data. The file itself is closed again
+//        straight away, the mapping keeps what it needs of it.
+// ----------------------------------------------------------------------------
+bool CMappedFile::OpenFile( const char* sFileName )
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE			hFile, hMapping;
+	LARGE_INTEGER	nSize;
+
+	hFile = CreateFileA( sFileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if( hFile == INVALID_HANDLE_VALUE ) return false;
+
+	if( !GetFileSizeEx( hFile, &nSize ) || ((uint64_t)nSize.QuadPart > (uint64_t)SIZE_MAX) )
+	{
+		CloseHandle( hFile );
+		return false;
+	}
+
+	if( !nSize.QuadPart )
+	{
+		CloseHandle( hFile );
+		return true;
+	}
+
+	hMapping = CreateFileMappingA( hFile, NULL, PAGE_READONLY, 0, 0, NULL );
+	CloseHandle( hFile );
+
+	if( !hMapping ) return false;
+
+	m_pData = (const unsigned char*)MapViewOfFile( hMapping, FILE_MAP_READ, 0, 0, 0 );
+	CloseHandle( hMapping );
+
+	if( !m_pData ) return false;
+
+	m_nSize = (size_t)nSize.QuadPart;
+	m_bMapped = true;
+#else
+	struct stat	info;
+	void*		pView;
+	int			nFile;
+
+	nFile = open( sFileName, O_RDONLY );
+	if( nFile < 0 ) return false;
+
+	if( (fstat( nFile, &info ) != 0) || ((uint64_t)info.st_size > (uint64_t)SIZE_MAX) )
+	{
+		close( nFile );
+		return false;
+	}
+
+	if( !info.st_size )
+	{
+		close( nFile );
+		return true;
+	}
+
+	pView = mmap( NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, nFile, 0 );
+	close( nFile );
+
+	if( pView == MAP_FAILED ) return false;
+
+	m_pData = (const unsigned char*)pView;
+	m_nSize = (size_t)info.st_size;
+	m_bMapped = true;
+#endif
+
+	return true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Close
+//
+//  Desc: Lets go of the mapping. Anything still pointing into it is left
+//        dangling.
+// ----------------------------------------------------------------------------
+void CMappedFile::Close()
+{
+	if( m_bMapped )
+	{
+#ifdef _WIN32
+		UnmapViewOfFile( m_pData );
+#else
+		munmap( (void*)m_pData, m_nSize );
+#endif
+	}
+
+	m_pData = NULL;
+	m_nSize = 0;
+	m_bMapped = false;
+
+	m_pSource.reset();
+	vector<unsigned char>().swap( m_tBuffer );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetData
+//
+//  Desc: Returns the start of the file in memory, or NULL if it's empty or
+//        not open.
+// ----------------------------------------------------------------------------
+const unsigned char* CMappedFile::GetData() const
+{
+	return m_pData;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetSize
+//
+//  Desc: Returns the size of the file in bytes.
+// ----------------------------------------------------------------------------
+size_t CMappedFile::GetSize() const
+{
+	return m_nSize;
+}
@@ -0,0 +1,41 @@
+// ----------------------------------------------------------------------------
+//  Filename: mapfile.h
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+#pragma once
+
+// A whole file mapped into memory, read only. Nothing is read off the disk
+// until it's touched, and then only the pages that are. The mapping lasts
+// until the file is closed or the object goes away, so anything pointing
+// into it has to hold on to it. It can't be copied, share it instead.
+//
+// Open looks in the mounted asset pack first, see CAssetPack. A file kept
+// as it is there is used where it sits in the pack, which stays mapped as
+// long as the file is open. A compressed one is unpacked into memory.
+class CMappedFile
+{
+protected:
+	const unsigned char*	m_pData;
+	size_t					m_nSize;
+	bool					m_bMapped;		// Whether m_pData is a mapping of its own.
+
+	shared_ptr<CMappedFile>	m_pSource;		// The pack a file is in.
+	vector<unsigned char>	m_tBuffer;		// A file unpacked out of one.
+
+private:
+	CMappedFile( const CMappedFile& );
+	CMappedFile& operator=( const CMappedFile& );
+
+public:
+	CMappedFile();
+	virtual ~CMappedFile();
+
+	bool	Open( const char* sFileName );
+	bool	OpenFile( const char* sFileName );
+	void	Close();
+
+	const unsigned char*	GetData() const;
+	size_t					GetSize() const;
+};
@@ -0,0 +1,2426 @@
+// ----------------------------------------------------------------------------
+//  Filename: mesh.cpp
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+
+
+
+
+// Preprocessor directives.
+#include "sim.h"
+
+
+
+
+// What a token of a .x file is.
+enum XTokenType
+{
+	XTokenEnd = 0,
+	XTokenName,
+	XTokenNumber,
+	XTokenString,		// Without its quotes.
+	XTokenOpen,
+	XTokenClose,
+	XTokenOther			// Anything else, one character of it.
+};
+
+// A token, where it sits in the file. Nothing is copied out.
+struct XTOKEN
+{
+	XTokenType	Type;
+	const char*	p;
+	int			n;
+};
+
+// Where the parser has got to in a file.
+struct XREADER
+{
+	const char*	p;
+	const char*	pEnd;
+	bool		bFailed;
+};
+
+// One mesh of a file, as it's read and before it's added to the rest. Kept
+// from one mesh to the next so the arrays only grow.
+struct XMESH
+{
+	vector<float>		tPositions;		// Three to a vertex.
+	vector<float>		tNormals;		// Three to a normal.
+	vector<float>		tTexCoords;		// Two to a vertex.
+	vector<int>			tFaces;			// Corner count, then that many indices.
+	vector<int>			tNormalFaces;	// The same, into the normals.
+	vector<int>			tFaceMaterials;
+	vector<MESHMATERIAL>	tMaterials;
+
+	vector<int>			tFirst;			// First vertex made from each position.
+	vector<int>			tNext;			// Next vertex made from the same one.
+	vector<int>			tNormalOf;		// Normal each vertex was made with.
+	vector<MESHVERTEX>	tVertices;		// Vertices made.
+	vector<uint32_t>	tTriangles;		// Three corners and a material each.
+};
+
+// Orders vertex numbers by the vertices' bytes, so identical ones end up
+// next to each other, and the first of them first.
+struct VertexBelow
+{
+	const MESHVERTEX* pVertices;
+
+	VertexBelow( const MESHVERTEX* p ) : pVertices( p ) {}
+	bool operator()( int a, int b ) const { int n = memcmp( &pVertices[a], &pVertices[b], sizeof(MESHVERTEX) ); return (n < 0) || (!n && (a < b)); }
+};
+
+// Orders triangle numbers by their materials, keeping the order they were
+// in otherwise.
+struct MaterialBelow
+{
+	const uint32_t* pAttributes;
+
+	MaterialBelow( const uint32_t* p ) : pAttributes( p ) {}
+	bool operator()( int a, int b ) const { return (pAttributes[a] < pAttributes[b]) || ((pAttributes[a] == pAttributes[b]) && (a < b)); }
+};
+
+// Orders vertex numbers by the vertices' positions alone.
+struct PositionBelow
+{
+	const MESHVERTEX* pVertices;
+
+	PositionBelow( const MESHVERTEX* p ) : pVertices( p ) {}
+	bool operator()( int a, int b ) const { int n = memcmp( &pVertices[a], &pVertices[b], 3 * sizeof(float) ); return (n < 0) || (!n && (a < b)); }
+};
+
+// An edge collapse waiting its turn, moving every vertex at one position to
+// another.
+struct COLLAPSE
+{
+	double	dCost;
+	int		nFrom, nTo;
+};
+
+// Puts the cheapest collapse at the top of a heap.
+struct CostAbove
+{
+	bool operator()( const COLLAPSE& a, const COLLAPSE& b ) const { return a.dCost > b.dCost; }
+};
+
+// Powers of ten a double holds exactly.
+static const double s_dTens[] =
+{
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static void ParseObject( XREADER* pReader, const XTOKEN& token, XMESH* pMesh, CMeshData* pData, const float* pMatrix, int nDepth );
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: XNext
+//
+//  Desc: Reads the next token. Commas and semicolons only separate values,
+//        and everything is read in the order the templates give it, so
+//        they're skipped along with the white space and comments.
+// ----------------------------------------------------------------------------
+static void XNext( XREADER* pReader, XTOKEN* pToken )
+{
+	const char*	p = pReader->p;
+	const char*	pEnd = pReader->pEnd;
+	char		c;
+
+	while( p < pEnd )
+	{
+		c = *p;
+
+		if( (c == ' ') || (c == '\t') || (c == '\r') || (c == '\n') || (c == ',') || (c == ';') )
+		{
+			p++;
+		}
+		else if( (c == '#') || ((c == '/') && ((p + 1) < pEnd) && (p[1] == '/')) )
+		{
+			while( (p < pEnd) && (*p != '\n') ) p++;
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	pToken->p = p;
+	pToken->n = 1;
+
+	if( p == pEnd )
+	{
+		pToken->Type = XTokenEnd;
+		pToken->n = 0;
+	}
+	else if( *p == '{' )
+	{
+		pToken->Type = XTokenOpen;
+		p++;
+	}
+	else if( *p == '}' )
+	{
+		pToken->Type = XTokenClose;
+		p++;
+	}
+	else if( *p == '"' )
+	{
+		pToken->Type = XTokenString;
+		pToken->p = ++p;
+
+		while( (p < pEnd) && (*p != '"') ) p++;
+
+		pToken->n = (int)(p - pToken->p);
+		if( p < pEnd ) p++;
+	}
+	else if( isdigit( (unsigned char)*p ) || (*p == '-') || (*p == '+') || (*p == '.') )
+	{
+		pToken->Type = XTokenNumber;
+
+		for( p++; (p < pEnd) && (isdigit( (unsigned char)*p ) || (*p == '.') || (*p == 'e') || (*p == 'E') || (*p == '-') || (*p == '+')); p++ );
+
+		pToken->n = (int)(p - pToken->p);
+	}
+	else if( isalpha( (unsigned char)*p ) || (*p == '_') )
+	{
+		pToken->Type = XTokenName;
+
+		for( p++; (p < pEnd) && (isalnum( (unsigned char)*p ) || (*p == '_') || (*p == '-') || (*p == '.')); p++ );
+
+		pToken->n = (int)(p - pToken->p);
+	}
+	else
+	{
+		pToken->Type = XTokenOther;
+		p++;
+	}
+
+	pReader->p = p;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: XIs
+//
+//  Desc: Checks whether a token is the given name.
+// ----------------------------------------------------------------------------
+static inline bool XIs( const XTOKEN& token, const char* sName )
+{
+	return (token.Type == XTokenName) && ((int)strlen( sName ) == token.n) && !memcmp( token.p, sName, token.n );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: XFloat
+//
+//  Desc: Reads a number, straight out of the file. Up to 19 digits are kept
+//        exactly and scaled by a power of ten in one go, which is as close
+//        as a float can get for numbers written the way .x files have them.
+// ----------------------------------------------------------------------------
+static float XFloat( XREADER* pReader )
+{
+	XTOKEN		token;
+	const char*	p;
+	const char*	pEnd;
+	uint64_t	nMantissa = 0;
+	int			nDigits = 0, nExponent = 0, nPower = 0;
+	bool		bNegative = false, bNegativePower = false, bAny = false;
+	double		d;
+
+	XNext( pReader, &token );
+
+	if( token.Type != XTokenNumber )
+	{
+		pReader->bFailed = true;
+		return 0.0f;
+	}
+
+	p = token.p;
+	pEnd = token.p + token.n;
+
+	if( (*p == '-') || (*p == '+') ) bNegative = (*p++ == '-');
+
+	for( ; (p < pEnd) && isdigit( (unsigned char)*p ); p++, bAny = true )
+	{
+		if( nDigits < 19 )
+		{
+			nMantissa = (nMantissa * 10) + (*p - '0');
+			if( nMantissa ) nDigits++;
+		}
+		else
+		{
+			nExponent++;
+		}
+	}
+
+	if( (p < pEnd) && (*p == '.') )
+	{
+		for( p++; (p < pEnd) && isdigit( (unsigned char)*p ); p++, bAny = true )
+		{
+			if( nDigits < 19 )
+			{
+				nMantissa = (nMantissa * 10) + (*p - '0');
+				if( nMantissa ) nDigits++;
+				nExponent--;
+			}
+		}
+	}
+
+	if( (p < pEnd) && ((*p == 'e') || (*p == 'E')) )
+	{
+		p++;
+		if( (p < pEnd) && ((*p == '-') || (*p == '+')) ) bNegativePower = (*p++ == '-');
+
+		for( ; (p < pEnd) && isdigit( (unsigned char)*p ); p++ )
+		{
+			if( nPower < 1000 ) nPower = (nPower * 10) + (*p - '0');
+		}
+
+		nExponent += bNegativePower ? -nPower : nPower;
+	}
+
+	if( !bAny || (p != pEnd) )
+	{
+		pReader->bFailed = true;
+		return 0.0f;
+	}
+
+	d = (double)nMantissa;
+
+	if( (nExponent >= -22) && (nExponent <= 22) )
+	{
+		d = (nExponent < 0) ? (d / s_dTens[-nExponent]) : (d * s_dTens[nExponent]);
+	}
+	else
+	{
+		d *= pow( 10.0, nExponent );
+	}
+
+	return (float)(bNegative ? -d : d);
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: XInt
+//
+//  Desc: Reads a whole number, which has to be at least 0 and no more than
+//        nMax.
+// ----------------------------------------------------------------------------
+static int XInt( XREADER* pReader, int nMax )
+{
+	XTOKEN	token;
+	int64_t	n = 0;
+	int		i = 0;
+
+	XNext( pReader, &token );
+
+	if( (token.Type == XTokenNumber) && (token.p[0] == '+') ) i++;
+
+	if( (token.Type != XTokenNumber) || (i >= token.n) )
+	{
+		pReader->bFailed = true;
+		return 0;
+	}
+
+	for( ; i < token.n; i++ )
+	{
+		if( !isdigit( (unsigned char)token.p[i] ) || (n > nMax) )
+		{
+			pReader->bFailed = true;
+			return 0;
+		}
+
+		n = (n * 10) + (token.p[i] - '0');
+	}
+
+	if( n > nMax )
+	{
+		pReader->bFailed = true;
+		return 0;
+	}
+
+	return (int)n;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: XCount
+//
+//  Desc: Reads how many items of nValues numbers each follow. Every number
+//        takes at least two characters with its separator, so a count the
+//        rest of the file can't hold is caught before anything is made
+//        room for.
+// ----------------------------------------------------------------------------
+static int XCount( XREADER* pReader, int nValues )
+{
+	size_t nLeft = (size_t)(pReader->pEnd - pReader->p) / 2;
+
+	return XInt( pReader, (int)min( nLeft / nValues, (size_t)INT_MAX ) );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: XOpen
+//
+//  Desc: Reads the rest of the start of an object, after its template name:
+//        an optional name of its own and the brace.
+// ----------------------------------------------------------------------------
+static bool XOpen( XREADER* pReader )
+{
+	XTOKEN token;
+
+	XNext( pReader, &token );
+	if( token.Type == XTokenName ) XNext( pReader, &token );
+
+	if( token.Type != XTokenOpen ) pReader->bFailed = true;
+
+	return !pReader->bFailed;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: XSkip
+//
+//  Desc: Skips the rest of an object whose opening brace has been read,
+//        objects inside it and all.
+// ----------------------------------------------------------------------------
+static void XSkip( XREADER* pReader )
+{
+	XTOKEN	token;
+	int		nDepth = 1;
+
+	while( nDepth )
+	{
+		XNext( pReader, &token );
+
+		if( token.Type == XTokenOpen ) nDepth++;
+		else if( token.Type == XTokenClose ) nDepth--;
+		else if( token.Type == XTokenEnd ) break;
+	}
+
+	if( nDepth ) pReader->bFailed = true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: XFaces
+//
+//  Desc: Reads a list of nFaces polygons, each its corner count and then its
+//        indices, none of which may be nIndices or more.
+// ----------------------------------------------------------------------------
+static void XFaces( XREADER* pReader, int nFaces, int nIndices, vector<int>* pFaces )
+{
+	int i, j, n, nCorners;
+
+	pFaces->clear();
+
+	for( i = 0; (i < nFaces) && !pReader->bFailed; i++ )
+	{
+		nCorners = XCount( pReader, 1 );
+		pFaces->push_back( nCorners );
+
+		for( j = 0; j < nCorners; j++ )
+		{
+			n = XInt( pReader, INT_MAX );
+			if( n >= nIndices ) pReader->bFailed = true;
+
+			pFaces->push_back( n );
+		}
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: ParseMaterial
+//
+//  Desc: Reads a Material object, after its opening brace.
+// ----------------------------------------------------------------------------
+static void ParseMaterial( XREADER* pReader, MESHMATERIAL* pMaterial )
+{
+	XTOKEN	token;
+	int		i;
+
+	for( i = 0; i < 4; i++ ) pMaterial->fDiffuse[i] = XFloat( pReader );
+
+	pMaterial->fPower = XFloat( pReader );
+
+	for( i = 0; i < 3; i++ ) pMaterial->fSpecular[i] = XFloat( pReader );
+	for( i = 0; i < 3; i++ ) pMaterial->fEmissive[i] = XFloat( pReader );
+
+	pMaterial->sTexture.clear();
+
+	while( !pReader->bFailed )
+	{
+		XNext( pReader, &token );
+
+		if( token.Type == XTokenClose ) return;
+
+		if( XIs( token, "TextureFilename" ) || XIs( token, "TextureFileName" ) )
+		{
+			if( !XOpen( pReader ) ) return;
+
+			XNext( pReader, &token );
+			if( token.Type == XTokenString ) pMaterial->sTexture.assign( token.p, token.n );
+			else pReader->bFailed = true;
+
+			XNext( pReader, &token );
+			if( token.Type != XTokenClose ) pReader->bFailed = true;
+		}
+		else if( token.Type == XTokenName )
+		{
+			if( XOpen( pReader ) ) XSkip( pReader );
+		}
+		else if( token.Type == XTokenOpen )
+		{
+			XSkip( pReader );
+		}
+		else
+		{
+			pReader->bFailed = true;
+		}
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: DefaultMaterial
+//
+//  Desc: Fills in the material a mesh gets when the file gives it none.
+// ----------------------------------------------------------------------------
+static void DefaultMaterial( MESHMATERIAL* pMaterial )
+{
+	for( int i = 0; i < 4; i++ ) pMaterial->fDiffuse[i] = 1.0f;
+	for( int i = 0; i < 3; i++ ) pMaterial->fSpecular[i] = pMaterial->fEmissive[i] = 0.0f;
+
+	pMaterial->fPower = 0.0f;
+	pMaterial->sTexture.clear();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: ParseMaterialList
+//
+//  Desc: Reads a MeshMaterialList object, after its opening brace. A list of
+//        fewer face materials than faces means the last one goes on to the
+//        end.
+// ----------------------------------------------------------------------------
+static void ParseMaterialList( XREADER* pReader, XMESH* pMesh, int nFaces )
+{
+	MESHMATERIAL	material;
+	XTOKEN			token;
+	int				i, nMaterials, nIndices;
+
+	nMaterials = XCount( pReader, 1 );
+	nIndices = XCount( pReader, 1 );
+
+	if( nIndices > nFaces ) pReader->bFailed = true;
+
+	pMesh->tFaceMaterials.resize( nFaces );
+
+	for( i = 0; (i < nIndices) && !pReader->bFailed; i++ )
+	{
+		pMesh->tFaceMaterials[i] = XInt( pReader, nMaterials - 1 );
+	}
+
+	for( ; i < nFaces; i++ )
+	{
+		pMesh->tFaceMaterials[i] = i ? pMesh->tFaceMaterials[i - 1] : 0;
+	}
+
+	pMesh->tMaterials.clear();
+
+	while( !pReader->bFailed )
+	{
+		XNext( pReader, &token );
+
+		if( token.Type == XTokenClose ) break;
+
+		if( XIs( token, "Material" ) )
+		{
+			if( !XOpen( pReader ) ) break;
+
+			ParseMaterial( pReader, &material );
+			pMesh->tMaterials.push_back( material );
+		}
+		else if( token.Type == XTokenOpen )
+		{
+			// A reference to a material named elsewhere. They aren't kept, so
+			// it gets the default.
+			XSkip( pReader );
+
+			DefaultMaterial( &material );
+			pMesh->tMaterials.push_back( material );
+		}
+		else if( token.Type == XTokenName )
+		{
+			if( XOpen( pReader ) ) XSkip( pReader );
+		}
+		else
+		{
+			pReader->bFailed = true;
+		}
+	}
+
+	// Any the file is short of get the default too.
+	DefaultMaterial( &material );
+
+	while( (int)pMesh->tMaterials.size() < nMaterials )
+	{
+		pMesh->tMaterials.push_back( material );
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Transform
+//
+//  Desc: Moves a point, or turns a direction, by a .x frame matrix. They
+//        multiply row vectors, so the translation is the bottom row.
+// ----------------------------------------------------------------------------
+static inline void Transform( const float* m, const float* v, float* pOut, bool bPoint )
+{
+	float x = v[0], y = v[1], z = v[2];
+
+	pOut[0] = (x * m[0]) + (y * m[4]) + (z * m[8]) + (bPoint ? m[12] : 0.0f);
+	pOut[1] = (x * m[1]) + (y * m[5]) + (z * m[9]) + (bPoint ? m[13] : 0.0f);
+	pOut[2] = (x * m[2]) + (y * m[6]) + (z * m[10]) + (bPoint ? m[14] : 0.0f);
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: AddMesh
+//
+//  Desc: Adds a mesh that has been read to the rest, moved by pMatrix. Each
+//        corner's vertex is the one made from its position and normal, if
+//        there is one already.
+// ----------------------------------------------------------------------------
+static void AddMesh( XMESH* pMesh, CMeshData* pData, const float* pMatrix )
+{
+	MESHVERTEX	vertex;
+	MESHVERTEX*	pCorner[3];
+	float		e1[3], e2[3], n[3], fLength;
+	int			nPositions = (int)pMesh->tPositions.size() / 3;
+	int			nFirstMaterial = pData->GetMaterialCount();
+	int			nBase = pData->GetVertexCount();
+	int			nFace, nCorners, nFaces = 0, nNormalFace = 0;
+	int			i, j, v, p, nNormal;
+	uint32_t	tCorner[3];
+	bool		bNormals = !pMesh->tNormalFaces.empty();
+
+	if( pMesh->tMaterials.empty() )
+	{
+		pMesh->tMaterials.resize( 1 );
+		DefaultMaterial( &pMesh->tMaterials[0] );
+	}
+
+	for( i = 0; i < (int)pMesh->tMaterials.size(); i++ )
+	{
+		pData->AddMaterial( pMesh->tMaterials[i] );
+	}
+
+	pMesh->tFirst.assign( nPositions, -1 );
+	pMesh->tNext.clear();
+	pMesh->tNormalOf.clear();
+	pMesh->tVertices.clear();
+	pMesh->tTriangles.clear();
+
+	for( nFace = 0; nFace < (int)pMesh->tFaces.size(); nFace += nCorners + 1, nFaces++ )
+	{
+		nCorners = pMesh->tFaces[nFace];
+
+		for( i = 0; i < nCorners; i++ )
+		{
+			p = pMesh->tFaces[nFace + 1 + i];
+			nNormal = bNormals ? pMesh->tNormalFaces[nNormalFace + 1 + i] : -1;
+
+			for( v = pMesh->tFirst[p]; v >= 0; v = pMesh->tNext[v] )
+			{
+				if( pMesh->tNormalOf[v] == nNormal ) break;
+			}
+
+			if( v < 0 )
+			{
+				memset( &vertex, 0, sizeof(vertex) );
+
+				Transform( pMatrix, &pMesh->tPositions[p * 3], &vertex.x, true );
+				if( bNormals ) Transform( pMatrix, &pMesh->tNormals[nNormal * 3], &vertex.nx, false );
+
+				if( !pMesh->tTexCoords.empty() )
+				{
+					vertex.u = pMesh->tTexCoords[p * 2];
+					vertex.v = pMesh->tTexCoords[(p * 2) + 1];
+				}
+
+				v = (int)pMesh->tVertices.size();
+				pMesh->tVertices.push_back( vertex );
+				pMesh->tNext.push_back( pMesh->tFirst[p] );
+				pMesh->tNormalOf.push_back( nNormal );
+				pMesh->tFirst[p] = v;
+			}
+
+			// Polygons are split into a fan from their first corner.
+			if( i < 2 )
+			{
+				tCorner[i] = v;
+				continue;
+			}
+
+			tCorner[2] = v;
+
+			pMesh->tTriangles.push_back( tCorner[0] );
+			pMesh->tTriangles.push_back( tCorner[1] );
+			pMesh->tTriangles.push_back( tCorner[2] );
+			pMesh->tTriangles.push_back( nFirstMaterial + (pMesh->tFaceMaterials.empty() ? 0 : pMesh->tFaceMaterials[nFaces]) );
+
+			tCorner[1] = tCorner[2];
+		}
+
+		if( bNormals ) nNormalFace += pMesh->tNormalFaces[nNormalFace] + 1;
+	}
+
+	// Without normals in the file, each vertex gets the sum of the faces
+	// around it, which weights them by their area.
+	if( !bNormals )
+	{
+		for( i = 0; i < (int)pMesh->tTriangles.size(); i += 4 )
+		{
+			for( j = 0; j < 3; j++ ) pCorner[j] = &pMesh->tVertices[pMesh->tTriangles[i + j]];
+
+			e1[0] = pCorner[1]->x - pCorner[0]->x;
+			e1[1] = pCorner[1]->y - pCorner[0]->y;
+			e1[2] = pCorner[1]->z - pCorner[0]->z;
+			e2[0] = pCorner[2]->x - pCorner[0]->x;
+			e2[1] = pCorner[2]->y - pCorner[0]->y;
+			e2[2] = pCorner[2]->z - pCorner[0]->z;
+
+			// Which way this points is the same as the normals the shipped
+			// models come with.
+			n[0] = (e1[1] * e2[2]) - (e1[2] * e2[1]);
+			n[1] = (e1[2] * e2[0]) - (e1[0] * e2[2]);
+			n[2] = (e1[0] * e2[1]) - (e1[1] * e2[0]);
+
+			for( j = 0; j < 3; j++ )
+			{
+				pCorner[j]->nx += n[0];
+				pCorner[j]->ny += n[1];
+				pCorner[j]->nz += n[2];
+			}
+		}
+	}
+
+	// Frames can scale, so normals are made unit length again.
+	for( i = 0; i < (int)pMesh->tVertices.size(); i++ )
+	{
+		vertex = pMesh->tVertices[i];
+		fLength = sqrtf( (vertex.nx * vertex.nx) + (vertex.ny * vertex.ny) + (vertex.nz * vertex.nz) );
+
+		if( fLength > 0.0f )
+		{
+			vertex.nx /= fLength;
+			vertex.ny /= fLength;
+			vertex.nz /= fLength;
+		}
+
+		pData->AddVertex( vertex );
+	}
+
+	for( i = 0; i < (int)pMesh->tTriangles.size(); i += 4 )
+	{
+		pData->AddTriangle( nBase + pMesh->tTriangles[i], nBase + pMesh->tTriangles[i + 1], nBase + pMesh->tTriangles[i + 2], pMesh->tTriangles[i + 3] );
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: ParseMesh
+//
+//  Desc: Reads a Mesh object, after its opening brace, and adds it to the
+//        rest.
+// ----------------------------------------------------------------------------
+static void ParseMesh( XREADER* pReader, XMESH* pMesh, CMeshData* pData, const float* pMatrix )
+{
+	XTOKEN	token;
+	int		i, nPositions, nFaces, nNormals, nCount;
+	size_t	nFaceIndices;
+
+	pMesh->tNormals.clear();
+	pMesh->tTexCoords.clear();
+	pMesh->tNormalFaces.clear();
+	pMesh->tFaceMaterials.clear();
+	pMesh->tMaterials.clear();
+
+	nPositions = XCount( pReader, 3 );
+	pMesh->tPositions.resize( nPositions * 3 );
+
+	for( i = 0; (i < (nPositions * 3)) && !pReader->bFailed; i++ )
+	{
+		pMesh->tPositions[i] = XFloat( pReader );
+	}
+
+	nFaces = XCount( pReader, 4 );
+	XFaces( pReader, nFaces, nPositions, &pMesh->tFaces );
+
+	while( !pReader->bFailed )
+	{
+		XNext( pReader, &token );
+
+		if( token.Type == XTokenClose ) break;
+
+		if( XIs( token, "MeshNormals" ) )
+		{
+			if( !XOpen( pReader ) ) break;
+
+			nNormals = XCount( pReader, 3 );
+			pMesh->tNormals.resize( nNormals * 3 );
+
+			for( i = 0; (i < (nNormals * 3)) && !pReader->bFailed; i++ )
+			{
+				pMesh->tNormals[i] = XFloat( pReader );
+			}
+
+			// The normals' faces have to match the mesh's corner for corner.
+			nCount = XCount( pReader, 4 );
+			if( nCount != nFaces ) pReader->bFailed = true;
+
+			XFaces( pReader, nCount, nNormals, &pMesh->tNormalFaces );
+
+			nFaceIndices = 0;
+
+			while( (nFaceIndices < pMesh->tFaces.size()) && !pReader->bFailed )
+			{
+				if( pMesh->tFaces[nFaceIndices] != pMesh->tNormalFaces[nFaceIndices] ) pReader->bFailed = true;
+
+				nFaceIndices += pMesh->tFaces[nFaceIndices] + 1;
+			}
+
+			XNext( pReader, &token );
+			if( token.Type != XTokenClose ) pReader->bFailed = true;
+		}
+		else if( XIs( token, "MeshTextureCoords" ) )
+		{
+			if( !XOpen( pReader ) ) break;
+
+			nCount = XCount( pReader, 2 );
+			if( nCount != nPositions ) pReader->bFailed = true;
+
+			pMesh->tTexCoords.resize( nCount * 2 );
+
+			for( i = 0; (i < (nCount * 2)) && !pReader->bFailed; i++ )
+			{
+				pMesh->tTexCoords[i] = XFloat( pReader );
+			}
+
+			XNext( pReader, &token );
+			if( token.Type != XTokenClose ) pReader->bFailed = true;
+		}
+		else if( XIs( token, "MeshMaterialList" ) )
+		{
+			if( !XOpen( pReader ) ) break;
+
+			ParseMaterialList( pReader, pMesh, nFaces );
+		}
+		else if( token.Type == XTokenName )
+		{
+			// Vertex colors, skinning, duplication indices and the like.
+			if( XOpen( pReader ) ) XSkip( pReader );
+		}
+		else if( token.Type == XTokenOpen )
+		{
+			XSkip( pReader );
+		}
+		else
+		{
+			pReader->bFailed = true;
+		}
+	}
+
+	if( !pReader->bFailed ) AddMesh( pMesh, pData, pMatrix );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: ParseFrame
+//
+//  Desc: Reads a Frame object, after its opening brace. Everything in it is
+//        moved by its matrix and then by pParent.
+// ----------------------------------------------------------------------------
+static void ParseFrame( XREADER* pReader, XMESH* pMesh, CMeshData* pData, const float* pParent, int nDepth )
+{
+	XTOKEN	token;
+	float	tLocal[16], tWorld[16];
+	int		i, j;
+
+	memcpy( tWorld, pParent, sizeof(tWorld) );
+
+	while( !pReader->bFailed )
+	{
+		XNext( pReader, &token );
+
+		if( token.Type == XTokenClose ) return;
+
+		if( XIs( token, "FrameTransformMatrix" ) )
+		{
+			if( !XOpen( pReader ) ) return;
+
+			for( i = 0; i < 16; i++ ) tLocal[i] = XFloat( pReader );
+
+			XNext( pReader, &token );
+			if( token.Type != XTokenClose ) pReader->bFailed = true;
+
+			for( i = 0; i < 4; i++ )
+			{
+				for( j = 0; j < 4; j++ )
+				{
+					tWorld[(i * 4) + j] = (tLocal[(i * 4) + 0] * pParent[j]) + (tLocal[(i * 4) + 1] * pParent[4 + j]) +
+										  (tLocal[(i * 4) + 2] * pParent[8 + j]) + (tLocal[(i * 4) + 3] * pParent[12 + j]);
+				}
+			}
+		}
+		else if( token.Type == XTokenOpen )
+		{
+			XSkip( pReader );
+		}
+		else
+		{
+			ParseObject( pReader, token, pMesh, pData, tWorld, nDepth );
+		}
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: ParseObject
+//
+//  Desc: Reads an object whose template name is token. Frames and meshes are
+//        taken, template definitions and anything else are skipped.
+// ----------------------------------------------------------------------------
+static void ParseObject( XREADER* pReader, const XTOKEN& token, XMESH* pMesh, CMeshData* pData, const float* pMatrix, int nDepth )
+{
+	if( token.Type != XTokenName )
+	{
+		pReader->bFailed = true;
+		return;
+	}
+
+	if( !XOpen( pReader ) ) return;
+
+	if( XIs( token, "Frame" ) )
+	{
+		if( nDepth >= MESH_MAX_FRAME_DEPTH )
+		{
+			pReader->bFailed = true;
+			return;
+		}
+
+		ParseFrame( pReader, pMesh, pData, pMatrix, nDepth + 1 );
+	}
+	else if( XIs( token, "Mesh" ) )
+	{
+		ParseMesh( pReader, pMesh, pData, pMatrix );
+	}
+	else
+	{
+		XSkip( pReader );
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: QuadricError
+//
+//  Desc: Returns the sum of squared distances from p to the planes a
+//        quadric was added up from, each weighted by its triangle's area.
+//        The quadric is the upper triangle of a symmetric 4x4 matrix, a2 ab
+//        ac ad b2 bc bd c2 cd d2, then the area it was added up from.
+// ----------------------------------------------------------------------------
+static double QuadricError( const double* q, const float* p )
+{
+	double x = p[0], y = p[1], z = p[2];
+
+	return (q[0] * x * x) + (2.0 * q[1] * x * y) + (2.0 * q[2] * x * z) + (2.0 * q[3] * x) +
+		   (q[4] * y * y) + (2.0 * q[5] * y * z) + (2.0 * q[6] * y) +
+		   (q[7] * z * z) + (2.0 * q[8] * z) + q[9];
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: VertexScore
+//
+//  Desc: How much a vertex wants its triangles drawn next, from Tom
+//        Forsyth's "Linear-Speed Vertex Cache Optimisation". Vertices of the
+//        last triangle score a little lower than the rest of the cache, so
+//        the next triangle doesn't just go back over the same edge, and the
+//        score falls off towards the end of the cache. Vertices with only a
+//        few triangles left get a boost, to finish them off rather than
+//        leave them stranded. nPosition is -1 for a vertex not in the cache.
+// ----------------------------------------------------------------------------
+static float VertexScore( int nPosition, int nTriangles )
+{
+	float fScore;
+
+	if( !nTriangles ) return -1.0f;
+
+	if( nPosition < 0 ) fScore = 0.0f;
+	else if( nPosition < 3 ) fScore = 0.75f;
+	else fScore = powf( 1.0f - ((float)(nPosition - 3) / (MESH_ORDER_CACHE_SIZE - 3)), 1.5f );
+
+	return fScore + (2.0f / sqrtf( (float)nTriangles ));
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CMeshData
+//
+//  Desc: Constructor
+// ----------------------------------------------------------------------------
+CMeshData::CMeshData()
+{
+	m_pFileVertices = NULL;
+	m_pFileIndices = NULL;
+	m_pFileAttributes = NULL;
+	m_nFileVertices = 0;
+	m_nFileTriangles = 0;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: ~CMeshData
+//
+//  Desc: Destructor
+// ----------------------------------------------------------------------------
+CMeshData::~CMeshData()
+{
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Clear
+//
+//  Desc: Empties the mesh.
+// ----------------------------------------------------------------------------
+void CMeshData::Clear()
+{
+	m_tVertices.clear();
+	m_tIndices.clear();
+	m_tAttributes.clear();
+	m_tMaterials.clear();
+
+	m_pFile.reset();
+	m_pFileVertices = NULL;
+	m_pFileIndices = NULL;
+	m_pFileAttributes = NULL;
+	m_nFileVertices = 0;
+	m_nFileTriangles = 0;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CopyOut
+//
+//  Desc: Copies a cached mesh out of its file, so it can be added to. Does
+//        nothing to any other mesh.
+// ----------------------------------------------------------------------------
+void CMeshData::CopyOut()
+{
+	if( !m_pFile ) return;
+
+	m_tVertices.assign( m_pFileVertices, m_pFileVertices + m_nFileVertices );
+	m_tIndices.assign( m_pFileIndices, m_pFileIndices + (m_nFileTriangles * 3) );
+	m_tAttributes.assign( m_pFileAttributes, m_pFileAttributes + m_nFileTriangles );
+
+	m_pFile.reset();
+	m_pFileVertices = NULL;
+	m_pFileIndices = NULL;
+	m_pFileAttributes = NULL;
+	m_nFileVertices = 0;
+	m_nFileTriangles = 0;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Load
+//
+//  Desc: Loads a model the quickest way it can. If there's a cache made from
+//        a file the same as this one, it's used as it sits, otherwise the
+//        model is parsed, optimized and a cache written for next time.
+//        Changing the model changes its hash, so its cache is passed over
+//        and made again without anything else having to be done.
+// ----------------------------------------------------------------------------
+bool CMeshData::Load( const char* sFileName )
+{
+	CMappedFile	source;
+	string		sCache;
+	uint64_t	nHash;
+
+	Clear();
+
+	if( !source.Open( sFileName ) ) return false;
+
+	sCache = GetCacheName( sFileName );
+	nHash = HashSource( source.GetData(), source.GetSize() );
+
+	if( LoadCache( sCache.c_str(), nHash, source.GetSize() ) ) return true;
+
+	if( !ParseX( (const char*)source.GetData(), source.GetSize() ) ) return false;
+
+	Optimize();
+
+	// Not being able to write it only means parsing again next time.
+	SaveCache( sCache.c_str(), nHash, source.GetSize() );
+
+	return true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: LoadX
+//
+//  Desc: Loads a text .x file from disk. It's mapped into memory and parsed
+//        where it sits.
+// ----------------------------------------------------------------------------
+bool CMeshData::LoadX( const char* sFileName )
+{
+	CMappedFile file;
+
+	Clear();
+
+	if( !file.Open( sFileName ) ) return false;
+
+	return ParseX( (const char*)file.GetData(), file.GetSize() );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: ParseX
+//
+//  Desc: Parses a text .x file held in memory. Every mesh in it is taken,
+//        with its normals, texture coordinates and materials, and moved by
+//        the frames it's in. Binary and compressed files aren't read. The
+//        tokens are read where they sit and nothing is allocated for them.
+// ----------------------------------------------------------------------------
+bool CMeshData::ParseX( const char* pData, size_t nSize )
+{
+	static const float tIdentity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+
+	XREADER	reader;
+	XTOKEN	token;
+	XMESH	mesh;
+
+	Clear();
+
+	// "xof 0302txt 0064", the version and float size can be anything.
+	if( (nSize < 16) || memcmp( pData, "xof ", 4 ) || memcmp( pData + 8, "txt ", 4 ) ) return false;
+
+	reader.p = pData + 16;
+	reader.pEnd = pData + nSize;
+	reader.bFailed = false;
+
+	while( !reader.bFailed )
+	{
+		XNext( &reader, &token );
+
+		if( token.Type == XTokenEnd ) break;
+
+		ParseObject( &reader, token, &mesh, this, tIdentity, 0 );
+	}
+
+	if( reader.bFailed || m_tIndices.empty() )
+	{
+		Clear();
+		return false;
+	}
+
+	return true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: LoadCache
+//
+//  Desc: Takes a mesh cache as it sits in memory, as long as it was made
+//        from a model that hashed to nSourceHash and was nSourceSize bytes.
+//        Only the materials are copied out. Every index and material number
+//        is checked, since whatever draws the mesh trusts them.
+// ----------------------------------------------------------------------------
+bool CMeshData::LoadCache( const char* sFileName, uint64_t nSourceHash, uint64_t nSourceSize )
+{
+	shared_ptr<CMappedFile>		pFile( new CMappedFile() );
+	const MESHCACHEHEADER*		pHeader;
+	const MESHFILEMATERIAL*		pFileMaterials;
+	const unsigned char*		pData;
+	const uint32_t*				pIndices;
+	const uint32_t*				pAttributes;
+	const char*					pNames;
+	uint64_t					tLength[MESH_CACHE_SECTIONS];
+	MESHMATERIAL				material;
+	int							i;
+
+	Clear();
+
+	if( !pFile->Open( sFileName ) || (pFile->GetSize() < sizeof(MESHCACHEHEADER)) ) return false;
+
+	pData = pFile->GetData();
+	pHeader = (const MESHCACHEHEADER*)pData;
+
+	if( (pHeader->nMagic != MESH_CACHE_MAGIC) || (pHeader->nVersion != MESH_CACHE_VERSION) ) return false;
+	if( (pHeader->nSourceHash != nSourceHash) || (pHeader->nSourceSize != nSourceSize) ) return false;
+	if( pHeader->nSize > pFile->GetSize() ) return false;
+	if( (pHeader->nVertices <= 0) || (pHeader->nTriangles <= 0) || (pHeader->nMaterials <= 0) ) return false;
+
+	tLength[MeshSectionVertices] = (uint64_t)pHeader->nVertices * sizeof(MESHVERTEX);
+	tLength[MeshSectionIndices] = (uint64_t)pHeader->nTriangles * 3 * sizeof(uint32_t);
+	tLength[MeshSectionAttributes] = (uint64_t)pHeader->nTriangles * sizeof(uint32_t);
+	tLength[MeshSectionMaterials] = (uint64_t)pHeader->nMaterials * sizeof(MESHFILEMATERIAL);
+	tLength[MeshSectionNames] = pHeader->nNamesSize;
+
+	for( i = 0; i < MESH_CACHE_SECTIONS; i++ )
+	{
+		if( pHeader->nOffset[i] & 7 ) return false;
+		if( (pHeader->nOffset[i] + tLength[i]) > pHeader->nSize ) return false;
+	}
+
+	pIndices = (const uint32_t*)(pData + pHeader->nOffset[MeshSectionIndices]);
+	pAttributes = (const uint32_t*)(pData + pHeader->nOffset[MeshSectionAttributes]);
+	pFileMaterials = (const MESHFILEMATERIAL*)(pData + pHeader->nOffset[MeshSectionMaterials]);
+	pNames = (const char*)(pData + pHeader->nOffset[MeshSectionNames]);
+
+	for( i = 0; i < (pHeader->nTriangles * 3); i++ )
+	{
+		if( pIndices[i] >= (uint32_t)pHeader->nVertices ) return false;
+	}
+
+	for( i = 0; i < pHeader->nTriangles; i++ )
+	{
+		if( pAttributes[i] >= (uint32_t)pHeader->nMaterials ) return false;
+	}
+
+	for( i = 0; i < pHeader->nMaterials; i++ )
+	{
+		if( ((uint64_t)pFileMaterials[i].nTexture + pFileMaterials[i].nTextureLength) > pHeader->nNamesSize ) return false;
+	}
+
+	for( i = 0; i < pHeader->nMaterials; i++ )
+	{
+		memcpy( material.fDiffuse, pFileMaterials[i].fDiffuse, sizeof(material.fDiffuse) );
+		material.fPower = pFileMaterials[i].fPower;
+		memcpy( material.fSpecular, pFileMaterials[i].fSpecular, sizeof(material.fSpecular) );
+		memcpy( material.fEmissive, pFileMaterials[i].fEmissive, sizeof(material.fEmissive) );
+		material.sTexture.assign( pNames + pFileMaterials[i].nTexture, pFileMaterials[i].nTextureLength );
+
+		m_tMaterials.push_back( material );
+	}
+
+	m_pFile = pFile;
+	m_pFileVertices = (const MESHVERTEX*)(pData + pHeader->nOffset[MeshSectionVertices]);
+	m_pFileIndices = pIndices;
+	m_pFileAttributes = pAttributes;
+	m_nFileVertices = pHeader->nVertices;
+	m_nFileTriangles = pHeader->nTriangles;
+
+	return true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: SaveCache
+//
+//  Desc: Writes the mesh out as a cache of a model that hashed to
+//        nSourceHash and was nSourceSize bytes, see LoadCache.
+// ----------------------------------------------------------------------------
+bool CMeshData::SaveCache( const char* sFileName, uint64_t nSourceHash, uint64_t nSourceSize ) const
+{
+	MESHCACHEHEADER		header;
+	MESHFILEMATERIAL	material;
+	vector<char>		tFile;
+	string				sNames;
+	const MESHMATERIAL*	pMaterial;
+	ofstream			file;
+	size_t				nEnd;
+	int					i;
+
+	if( !GetTriangleCount() ) return false;
+
+	for( i = 0; i < GetMaterialCount(); i++ )
+	{
+		sNames += GetMaterial( i )->sTexture;
+	}
+
+	memset( &header, 0, sizeof(header) );
+	header.nMagic = MESH_CACHE_MAGIC;
+	header.nVersion = MESH_CACHE_VERSION;
+	header.nSourceHash = nSourceHash;
+	header.nSourceSize = nSourceSize;
+	header.nVertices = GetVertexCount();
+	header.nTriangles = GetTriangleCount();
+	header.nMaterials = GetMaterialCount();
+	header.nNamesSize = (uint32_t)sNames.size();
+
+	// Lay the sections out one after the other.
+	nEnd = (sizeof(header) + 7) & ~(size_t)7;
+
+	for( i = 0; i < MESH_CACHE_SECTIONS; i++ )
+	{
+		header.nOffset[i] = (uint32_t)nEnd;
+
+		if( i == MeshSectionVertices ) nEnd += header.nVertices * sizeof(MESHVERTEX);
+		else if( i == MeshSectionIndices ) nEnd += header.nTriangles * 3 * sizeof(uint32_t);
+		else if( i == MeshSectionAttributes ) nEnd += header.nTriangles * sizeof(uint32_t);
+		else if( i == MeshSectionMaterials ) nEnd += header.nMaterials * sizeof(MESHFILEMATERIAL);
+		else nEnd += sNames.size();
+
+		nEnd = (nEnd + 7) & ~(size_t)7;
+	}
+
+	if( nEnd > UINT32_MAX ) return false;
+
+	header.nSize = (uint32_t)nEnd;
+
+	tFile.assign( nEnd, 0 );
+	memcpy( &tFile[0], &header, sizeof(header) );
+	memcpy( &tFile[header.nOffset[MeshSectionVertices]], GetVertices(), header.nVertices * sizeof(MESHVERTEX) );
+	memcpy( &tFile[header.nOffset[MeshSectionIndices]], GetIndices(), header.nTriangles * 3 * sizeof(uint32_t) );
+	memcpy( &tFile[header.nOffset[MeshSectionAttributes]], GetAttributes(), header.nTriangles * sizeof(uint32_t) );
+	if( !sNames.empty() ) memcpy( &tFile[header.nOffset[MeshSectionNames]], sNames.c_str(), sNames.size() );
+
+	for( i = 0, nEnd = 0; i < header.nMaterials; i++ )
+	{
+		pMaterial = GetMaterial( i );
+
+		memset( &material, 0, sizeof(material) );
+		memcpy( material.fDiffuse, pMaterial->fDiffuse, sizeof(material.fDiffuse) );
+		material.fPower = pMaterial->fPower;
+		memcpy( material.fSpecular, pMaterial->fSpecular, sizeof(material.fSpecular) );
+		memcpy( material.fEmissive, pMaterial->fEmissive, sizeof(material.fEmissive) );
+		material.nTexture = (uint32_t)nEnd;
+		material.nTextureLength = (uint32_t)pMaterial->sTexture.size();
+
+		nEnd += pMaterial->sTexture.size();
+
+		memcpy( &tFile[header.nOffset[MeshSectionMaterials] + (i * sizeof(MESHFILEMATERIAL))], &material, sizeof(material) );
+	}
+
+	file.open( sFileName, ios::out | ios::binary | ios::trunc );
+	if( !file.is_open() ) return false;
+
+	file.write( &tFile[0], tFile.size() );
+	file.close();
+
+	return !file.fail();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: IsCached
+//
+//  Desc: Returns whether the mesh is being used out of a cache.
+// ----------------------------------------------------------------------------
+bool CMeshData::IsCached() const
+{
+	return m_pFile != NULL;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: HashSource
+//
+//  Desc: Hashes a model file to tell whether it's changed since its cache
+//        was made. FNV-1a taken eight bytes at a time rather than one, then
+//        mixed so a change anywhere in the file shows across the hash.
+//        Hashing is all that's done to the model when its cache is good, so
+//        it has to be a good deal quicker than parsing.
+// ----------------------------------------------------------------------------
+uint64_t CMeshData::HashSource( const void* pData, size_t nSize )
+{
+	const unsigned char*	p = (const unsigned char*)pData;
+	uint64_t				nHash = 14695981039346656037ull ^ nSize;
+	uint64_t				n;
+	size_t					i;
+
+	for( i = 0; (i + 8) <= nSize; i += 8 )
+	{
+		memcpy( &n, p + i, sizeof(n) );
+		nHash = (nHash ^ n) * 1099511628211ull;
+	}
+
+	for( ; i < nSize; i++ )
+	{
+		nHash = (nHash ^ p[i]) * 1099511628211ull;
+	}
+
+	nHash ^= nHash >> 33;
+	nHash *= 0xFF51AFD7ED558CCDull;
+	nHash ^= nHash >> 33;
+	nHash *= 0xC4CEB9FE1A85EC53ull;
+	nHash ^= nHash >> 33;
+
+	return nHash;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetCacheName
+//
+//  Desc: Returns the name of a model's cache, the model's own with
+//        MESH_CACHE_EXTENSION in place of ".x", or on the end if it doesn't
+//        have one.
+// ----------------------------------------------------------------------------
+string CMeshData::GetCacheName( const char* sFileName )
+{
+	string	sName = sFileName;
+	size_t	n = sName.size();
+
+	if( (n > 2) && (sName[n - 2] == '.') && ((sName[n - 1] == 'x') || (sName[n - 1] == 'X')) ) sName.resize( n - 2 );
+
+	return sName + MESH_CACHE_EXTENSION;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Optimize
+//
+//  Desc: Gets the mesh ready to be drawn as cheaply as it can be. Identical
+//        vertices are welded, the triangles ordered for the vertex cache,
+//        and the vertices ordered the way the triangles first use them.
+// ----------------------------------------------------------------------------
+void CMeshData::Optimize()
+{
+	Weld();
+	OptimizeVertexCache();
+	OptimizeFetch();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Weld
+//
+//  Desc: Makes every set of vertices that are exactly the same, position,
+//        normal and texture coordinates, into one. Vertices that only share
+//        a position are left alone, since they're drawn differently.
+//        Triangles left with two corners on the same vertex are dropped, and
+//        so is any vertex no triangle uses. Returns how many vertices went.
+// ----------------------------------------------------------------------------
+int CMeshData::Weld()
+{
+	vector<int>			tOrder;
+	vector<int>			tRemap;
+	vector<MESHVERTEX>	tVertices;
+	uint32_t*			pIndex;
+	int					nVertices, nTriangles, i, n;
+
+	CopyOut();
+
+	nVertices = GetVertexCount();
+	nTriangles = GetTriangleCount();
+
+	if( !nVertices ) return 0;
+
+	tOrder.resize( nVertices );
+
+	for( i = 0; i < nVertices; i++ )
+	{
+		tOrder[i] = i;
+	}
+
+	sort( tOrder.begin(), tOrder.end(), VertexBelow( &m_tVertices[0] ) );
+
+	// Each vertex goes to the first one the same as it.
+	tRemap.resize( nVertices );
+
+	for( i = 0; i < nVertices; i++ )
+	{
+		if( i && !memcmp( &m_tVertices[tOrder[i]], &m_tVertices[tOrder[i - 1]], sizeof(MESHVERTEX) ) )
+		{
+			tRemap[tOrder[i]] = tRemap[tOrder[i - 1]];
+		}
+		else
+		{
+			tRemap[tOrder[i]] = tOrder[i];
+		}
+	}
+
+	for( i = 0, n = 0; i < nTriangles; i++ )
+	{
+		pIndex = &m_tIndices[i * 3];
+
+		pIndex[0] = tRemap[pIndex[0]];
+		pIndex[1] = tRemap[pIndex[1]];
+		pIndex[2] = tRemap[pIndex[2]];
+
+		if( (pIndex[0] == pIndex[1]) || (pIndex[1] == pIndex[2]) || (pIndex[2] == pIndex[0]) ) continue;
+
+		memmove( &m_tIndices[n * 3], pIndex, 3 * sizeof(uint32_t) );
+		m_tAttributes[n++] = m_tAttributes[i];
+	}
+
+	m_tIndices.resize( n * 3 );
+	m_tAttributes.resize( n );
+
+	// Keep what's used, in the order it was in.
+	tRemap.assign( nVertices, -1 );
+
+	for( i = 0; i < (int)m_tIndices.size(); i++ )
+	{
+		tRemap[m_tIndices[i]] = 0;
+	}
+
+	for( i = 0; i < nVertices; i++ )
+	{
+		if( tRemap[i] < 0 ) continue;
+
+		tRemap[i] = (int)tVertices.size();
+		tVertices.push_back( m_tVertices[i] );
+	}
+
+	for( i = 0; i < (int)m_tIndices.size(); i++ )
+	{
+		m_tIndices[i] = tRemap[m_tIndices[i]];
+	}
+
+	m_tVertices.swap( tVertices );
+
+	return nVertices - (int)m_tVertices.size();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: OptimizeVertexCache
+//
+//  Desc: Puts the triangles in an order that finds as many of their
+//        vertices as it can still in the post-transform cache, so fewer are
+//        run through the vertex shader again. Triangles are grouped by
+//        material first, since each material is drawn on its own, then each
+//        group is ordered by Tom Forsyth's method: the next triangle is
+//        always the best scoring one of those using a vertex in the cache,
+//        see VertexScore. Only ever looks at the triangles of the vertices
+//        in the cache, so it takes time in line with the triangles.
+// ----------------------------------------------------------------------------
+void CMeshData::OptimizeVertexCache()
+{
+	vector<int>			tOrder;
+	vector<uint32_t>	tIndices, tAttributes;
+	vector<int>			tFirst, tUsed, tTriangles;
+	vector<float>		tScore, tTriangleScore;
+	vector<bool>		tDrawn;
+	int					tCache[MESH_ORDER_CACHE_SIZE + 3], tNewCache[MESH_ORDER_CACHE_SIZE + 3];
+	const uint32_t*		pIndex;
+	float				fScore, fBest;
+	int					nVertices, nTriangles, nStart, nEnd, nCached, nNewCached;
+	int					nBest, nNext, t, i, j, k, v;
+
+	CopyOut();
+
+	nVertices = GetVertexCount();
+	nTriangles = GetTriangleCount();
+
+	if( !nTriangles ) return;
+
+	tOrder.resize( nTriangles );
+
+	for( t = 0; t < nTriangles; t++ )
+	{
+		tOrder[t] = t;
+	}
+
+	sort( tOrder.begin(), tOrder.end(), MaterialBelow( &m_tAttributes[0] ) );
+
+	tIndices.reserve( nTriangles * 3 );
+	tAttributes.reserve( nTriangles );
+
+	tFirst.resize( nVertices + 1 );
+	tUsed.resize( nVertices );
+	tScore.resize( nVertices );
+
+	for( nStart = 0; nStart < nTriangles; nStart = nEnd )
+	{
+		for( nEnd = nStart + 1; (nEnd < nTriangles) && (m_tAttributes[tOrder[nEnd]] == m_tAttributes[tOrder[nStart]]); nEnd++ );
+
+		// Which triangles of the group each vertex is used by, as a list a
+		// vertex at a time. The first tUsed of a vertex's list are the ones
+		// not drawn yet.
+		tFirst.assign( nVertices + 1, 0 );
+		tUsed.assign( nVertices, 0 );
+
+		for( t = nStart; t < nEnd; t++ )
+		{
+			pIndex = &m_tIndices[tOrder[t] * 3];
+
+			for( k = 0; k < 3; k++ )
+			{
+				tFirst[pIndex[k] + 1]++;
+			}
+		}
+
+		for( v = 0; v < nVertices; v++ )
+		{
+			tFirst[v + 1] += tFirst[v];
+		}
+
+		tTriangles.resize( tFirst[nVertices] );
+
+		for( t = nStart; t < nEnd; t++ )
+		{
+			pIndex = &m_tIndices[tOrder[t] * 3];
+
+			for( k = 0; k < 3; k++ )
+			{
+				tTriangles[tFirst[pIndex[k]] + tUsed[pIndex[k]]++] = t - nStart;
+			}
+		}
+
+		for( v = 0; v < nVertices; v++ )
+		{
+			tScore[v] = VertexScore( -1, tUsed[v] );
+		}
+
+		tTriangleScore.resize( nEnd - nStart );
+		tDrawn.assign( nEnd - nStart, false );
+
+		nBest = 0;
+		fBest = -1.0f;
+
+		for( t = 0; t < (nEnd - nStart); t++ )
+		{
+			pIndex = &m_tIndices[tOrder[nStart + t] * 3];
+			tTriangleScore[t] = tScore[pIndex[0]] + tScore[pIndex[1]] + tScore[pIndex[2]];
+
+			if( tTriangleScore[t] > fBest )
+			{
+				fBest = tTriangleScore[t];
+				nBest = t;
+			}
+		}
+
+		nCached = 0;
+		nNext = 0;
+
+		for( i = 0; i < (nEnd - nStart); i++ )
+		{
+			// Nothing in the cache has a triangle left, so take the next one
+			// not drawn. Doesn't happen much on a connected mesh.
+			if( nBest < 0 )
+			{
+				while( tDrawn[nNext] ) nNext++;
+
+				nBest = nNext;
+				fBest = tTriangleScore[nBest];
+
+				for( t = nNext + 1; t < (nEnd - nStart); t++ )
+				{
+					if( !tDrawn[t] && (tTriangleScore[t] > fBest) )
+					{
+						fBest = tTriangleScore[t];
+						nBest = t;
+					}
+				}
+			}
+
+			pIndex = &m_tIndices[tOrder[nStart + nBest] * 3];
+
+			tIndices.push_back( pIndex[0] );
+			tIndices.push_back( pIndex[1] );
+			tIndices.push_back( pIndex[2] );
+			tAttributes.push_back( m_tAttributes[tOrder[nStart + nBest]] );
+
+			tDrawn[nBest] = true;
+
+			// Take the triangle off its vertices' lists, and put them at the
+			// front of the cache.
+			nNewCached = 0;
+
+			for( k = 0; k < 3; k++ )
+			{
+				v = pIndex[k];
+
+				for( j = tFirst[v]; tTriangles[j] != nBest; j++ );
+
+				swap( tTriangles[j], tTriangles[tFirst[v] + tUsed[v] - 1] );
+				tUsed[v]--;
+
+				tNewCache[nNewCached++] = v;
+			}
+
+			for( j = 0; j < nCached; j++ )
+			{
+				v = tCache[j];
+
+				if( (v != (int)pIndex[0]) && (v != (int)pIndex[1]) && (v != (int)pIndex[2]) ) tNewCache[nNewCached++] = v;
+			}
+
+			// Rescore everything that was or is in the cache, and pass the
+			// change on to the triangles left. The best of those is next.
+			nBest = -1;
+			fBest = -1.0f;
+
+			for( j = 0; j < nNewCached; j++ )
+			{
+				v = tNewCache[j];
+
+				fScore = VertexScore( (j < MESH_ORDER_CACHE_SIZE) ? j : -1, tUsed[v] );
+
+				for( k = tFirst[v]; k < (tFirst[v] + tUsed[v]); k++ )
+				{
+					t = tTriangles[k];
+					tTriangleScore[t] += fScore - tScore[v];
+
+					if( (j < MESH_ORDER_CACHE_SIZE) && (tTriangleScore[t] > fBest) )
+					{
+						fBest = tTriangleScore[t];
+						nBest = t;
+					}
+				}
+
+				tScore[v] = fScore;
+			}
+
+			nCached = min( nNewCached, MESH_ORDER_CACHE_SIZE );
+			memcpy( tCache, tNewCache, nCached * sizeof(int) );
+		}
+	}
+
+	m_tIndices.swap( tIndices );
+	m_tAttributes.swap( tAttributes );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: OptimizeFetch
+//
+//  Desc: Numbers the vertices in the order the triangles first use them, and
+//        lays them out that way, so fetching them walks forwards through
+//        memory. Any vertex no triangle uses is dropped. Done after the
+//        triangles are ordered, since it goes by their order.
+// ----------------------------------------------------------------------------
+void CMeshData::OptimizeFetch()
+{
+	vector<int>			tRemap;
+	vector<MESHVERTEX>	tVertices;
+	int					i;
+
+	CopyOut();
+
+	tRemap.assign( GetVertexCount(), -1 );
+	tVertices.reserve( GetVertexCount() );
+
+	for( i = 0; i < (int)m_tIndices.size(); i++ )
+	{
+		if( tRemap[m_tIndices[i]] < 0 )
+		{
+			tRemap[m_tIndices[i]] = (int)tVertices.size();
+			tVertices.push_back( m_tVertices[m_tIndices[i]] );
+		}
+
+		m_tIndices[i] = tRemap[m_tIndices[i]];
+	}
+
+	m_tVertices.swap( tVertices );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Simplify
+//
+//  Desc: Takes the mesh down to about nTriangles by collapsing edges, the
+//        cheapest first, after Garland and Heckbert's "Surface
+//        Simplification Using Quadric Error Metrics". Every vertex at one
+//        position moves onto a neighboring position, so nothing new is made
+//        and texture seams stay closed. Each vertex moved takes the vertex
+//        at the new position most like it. Positions where the normals
+//        differ, hard edges, and the edges of open meshes are kept where
+//        they are, and no collapse is made that would turn a triangle over.
+//        Optimizes what's left, see Optimize.
+//
+//        Returns about how far the simplified surface is from the one it
+//        started as, at most, in the mesh's own units. It's the worst of
+//        the collapses' root mean square distances to the planes they moved
+//        off, so a good deal less than the worst case, for a sphere about
+//        how far the middles of the new triangles sink.
+// ----------------------------------------------------------------------------
+float CMeshData::Simplify( int nTriangles )
+{
+	vector<int>				tOrder;
+	vector<int>				tGroup;			// Position each vertex is at.
+	vector<int>				tFirst;			// First of each position's vertices in tOrder, and the end.
+	vector<double>			tQuadric;		// Eleven to a position, see QuadricError.
+	vector<bool>			tLocked, tGone, tDead;
+	vector< vector<int> >	tTriangles;		// Triangles at each position, some dead.
+	vector< pair<int, int> >	tEdges;
+	vector<int>				tNear, tFar;
+	vector<COLLAPSE>		tHeap;
+	vector<uint32_t>		tIndices, tAttributes;
+	COLLAPSE				collapse;
+	const MESHVERTEX*		p[3];
+	const float*			pTo;
+	const float*			pCorner[3];
+	uint32_t*				pIndex;
+	double*					pQ;
+	double					e1[3], e2[3], n[3], q[4], dLength, dArea, dError, dMax = 0.0;
+	float					fOld[3], fNew[3], o1[3], o2[3], fBest, fDistance;
+	int						nVertices, nLive, nGroups, nShared, nBest;
+	int						a, b, g, i, j, k, t, v;
+	bool					bEdge, bOk;
+
+	CopyOut();
+
+	nVertices = GetVertexCount();
+	nLive = GetTriangleCount();
+
+	if( nLive <= nTriangles ) return 0.0f;
+
+	// Vertices at the same position are one as far as the shape goes.
+	tOrder.resize( nVertices );
+
+	for( i = 0; i < nVertices; i++ )
+	{
+		tOrder[i] = i;
+	}
+
+	sort( tOrder.begin(), tOrder.end(), PositionBelow( &m_tVertices[0] ) );
+
+	tGroup.resize( nVertices );
+	tFirst.clear();
+
+	for( i = 0, nGroups = 0; i < nVertices; i++ )
+	{
+		if( !i || memcmp( &m_tVertices[tOrder[i]], &m_tVertices[tOrder[i - 1]], 3 * sizeof(float) ) )
+		{
+			tFirst.push_back( i );
+			nGroups++;
+		}
+
+		tGroup[tOrder[i]] = nGroups - 1;
+	}
+
+	tFirst.push_back( nVertices );
+
+	// A quadric for each position from the planes of the triangles around
+	// it, and the triangles around it.
+	tQuadric.assign( nGroups * 11, 0.0 );
+	tTriangles.resize( nGroups );
+	tDead.assign( nLive, false );
+
+	for( t = 0; t < nLive; t++ )
+	{
+		for( k = 0; k < 3; k++ )
+		{
+			p[k] = &m_tVertices[m_tIndices[(t * 3) + k]];
+		}
+
+		e1[0] = p[1]->x - p[0]->x; e1[1] = p[1]->y - p[0]->y; e1[2] = p[1]->z - p[0]->z;
+		e2[0] = p[2]->x - p[0]->x; e2[1] = p[2]->y - p[0]->y; e2[2] = p[2]->z - p[0]->z;
+
+		n[0] = (e1[1] * e2[2]) - (e1[2] * e2[1]);
+		n[1] = (e1[2] * e2[0]) - (e1[0] * e2[2]);
+		n[2] = (e1[0] * e2[1]) - (e1[1] * e2[0]);
+
+		dLength = sqrt( (n[0] * n[0]) + (n[1] * n[1]) + (n[2] * n[2]) );
+
+		for( k = 0; k < 3; k++ )
+		{
+			g = tGroup[m_tIndices[(t * 3) + k]];
+
+			tTriangles[g].push_back( t );
+
+			if( dLength <= 0.0 ) continue;
+
+			q[0] = n[0] / dLength;
+			q[1] = n[1] / dLength;
+			q[2] = n[2] / dLength;
+			q[3] = -((q[0] * p[0]->x) + (q[1] * p[0]->y) + (q[2] * p[0]->z));
+
+			// Half the cross product is the area.
+			dArea = dLength * 0.5;
+
+			pQ = &tQuadric[g * 11];
+			pQ[0] += dArea * q[0] * q[0]; pQ[1] += dArea * q[0] * q[1]; pQ[2] += dArea * q[0] * q[2]; pQ[3] += dArea * q[0] * q[3];
+			pQ[4] += dArea * q[1] * q[1]; pQ[5] += dArea * q[1] * q[2]; pQ[6] += dArea * q[1] * q[3];
+			pQ[7] += dArea * q[2] * q[2]; pQ[8] += dArea * q[2] * q[3];
+			pQ[9] += dArea * q[3] * q[3];
+			pQ[10] += dArea;
+		}
+	}
+
+	// Hard edges stay put. So do the edges of an open mesh, and anywhere
+	// more than two triangles meet along an edge: an edge between two
+	// positions is found once for each triangle along it.
+	tLocked.assign( nGroups, false );
+	tGone.assign( nGroups, false );
+
+	for( g = 0; g < nGroups; g++ )
+	{
+		p[0] = &m_tVertices[tOrder[tFirst[g]]];
+
+		for( i = tFirst[g] + 1; i < tFirst[g + 1]; i++ )
+		{
+			p[1] = &m_tVertices[tOrder[i]];
+
+			if( ((p[0]->nx * p[1]->nx) + (p[0]->ny * p[1]->ny) + (p[0]->nz * p[1]->nz)) < 0.999f ) tLocked[g] = true;
+		}
+	}
+
+	for( t = 0; t < nLive; t++ )
+	{
+		for( k = 0; k < 3; k++ )
+		{
+			a = tGroup[m_tIndices[(t * 3) + k]];
+			b = tGroup[m_tIndices[(t * 3) + ((k + 1) % 3)]];
+
+			tEdges.push_back( make_pair( min( a, b ), max( a, b ) ) );
+		}
+	}
+
+	sort( tEdges.begin(), tEdges.end() );
+
+	for( i = 0; i < (int)tEdges.size(); i = j )
+	{
+		for( j = i + 1; (j < (int)tEdges.size()) && (tEdges[j] == tEdges[i]); j++ );
+
+		if( (j - i) != 2 )
+		{
+			tLocked[tEdges[i].first] = true;
+			tLocked[tEdges[i].second] = true;
+		}
+	}
+
+	// Every edge, both ways, with what it costs to move one end onto the
+	// other: the error of the new position against both ends' planes.
+	for( t = 0; t < nLive; t++ )
+	{
+		for( k = 0; k < 3; k++ )
+		{
+			a = tGroup[m_tIndices[(t * 3) + k]];
+			b = tGroup[m_tIndices[(t * 3) + ((k + 1) % 3)]];
+
+			for( i = 0; i < 2; i++ )
+			{
+				collapse.nFrom = i ? b : a;
+				collapse.nTo = i ? a : b;
+
+				if( tLocked[collapse.nFrom] ) continue;
+
+				pTo = &m_tVertices[tOrder[tFirst[collapse.nTo]]].x;
+				collapse.dCost = QuadricError( &tQuadric[collapse.nFrom * 11], pTo ) + QuadricError( &tQuadric[collapse.nTo * 11], pTo );
+
+				tHeap.push_back( collapse );
+			}
+		}
+	}
+
+	make_heap( tHeap.begin(), tHeap.end(), CostAbove() );
+
+	while( (nLive > nTriangles) && !tHeap.empty() )
+	{
+		pop_heap( tHeap.begin(), tHeap.end(), CostAbove() );
+		collapse = tHeap.back();
+		tHeap.pop_back();
+
+		a = collapse.nFrom;
+		b = collapse.nTo;
+
+		if( tGone[a] || tGone[b] ) continue;
+
+		// The positions around each end, and whether they still share an
+		// edge. The ends should only have in common the corners opposite
+		// the edge, or the collapse would pinch the mesh.
+		tNear.clear();
+		tFar.clear();
+		bEdge = false;
+		nShared = 0;
+
+		for( i = 0; i < (int)tTriangles[a].size(); i++ )
+		{
+			t = tTriangles[a][i];
+			if( tDead[t] ) continue;
+
+			bOk = false;
+
+			for( k = 0; k < 3; k++ )
+			{
+				g = tGroup[m_tIndices[(t * 3) + k]];
+
+				if( g == b ) bOk = true;
+				if( (g != a) && (g != b) ) tNear.push_back( g );
+			}
+
+			if( bOk )
+			{
+				bEdge = true;
+				nShared++;
+			}
+		}
+
+		if( !bEdge ) continue;
+
+		for( i = 0; i < (int)tTriangles[b].size(); i++ )
+		{
+			t = tTriangles[b][i];
+			if( tDead[t] ) continue;
+
+			for( k = 0; k < 3; k++ )
+			{
+				g = tGroup[m_tIndices[(t * 3) + k]];
+				if( (g != a) && (g != b) ) tFar.push_back( g );
+			}
+		}
+
+		sort( tNear.begin(), tNear.end() );
+		tNear.erase( unique( tNear.begin(), tNear.end() ), tNear.end() );
+		sort( tFar.begin(), tFar.end() );
+		tFar.erase( unique( tFar.begin(), tFar.end() ), tFar.end() );
+
+		for( i = 0, j = 0, k = 0; (i < (int)tNear.size()) && (j < (int)tFar.size()); )
+		{
+			if( tNear[i] < tFar[j] ) i++;
+			else if( tFar[j] < tNear[i] ) j++;
+			else { k++; i++; j++; }
+		}
+
+		if( k != nShared ) continue;
+
+		// Earlier collapses only ever add to a quadric, so a collapse that
+		// costs more now than when it was queued goes back to wait its turn.
+		pTo = &m_tVertices[tOrder[tFirst[b]]].x;
+
+		collapse.dCost = QuadricError( &tQuadric[a * 11], pTo ) + QuadricError( &tQuadric[b * 11], pTo );
+
+		if( !tHeap.empty() && (collapse.dCost > tHeap.front().dCost) )
+		{
+			tHeap.push_back( collapse );
+			push_heap( tHeap.begin(), tHeap.end(), CostAbove() );
+			continue;
+		}
+
+		// None of the triangles that stay may turn over.
+		bOk = true;
+
+		for( i = 0; bOk && (i < (int)tTriangles[a].size()); i++ )
+		{
+			t = tTriangles[a][i];
+			if( tDead[t] ) continue;
+
+			bEdge = false;
+
+			for( k = 0; k < 3; k++ )
+			{
+				if( tGroup[m_tIndices[(t * 3) + k]] == b ) bEdge = true;
+			}
+
+			if( bEdge ) continue;
+
+			for( k = 0; k < 3; k++ )
+			{
+				p[k] = &m_tVertices[m_tIndices[(t * 3) + k]];
+			}
+
+			o1[0] = p[1]->x - p[0]->x; o1[1] = p[1]->y - p[0]->y; o1[2] = p[1]->z - p[0]->z;
+			o2[0] = p[2]->x - p[0]->x; o2[1] = p[2]->y - p[0]->y; o2[2] = p[2]->z - p[0]->z;
+
+			fOld[0] = (o1[1] * o2[2]) - (o1[2] * o2[1]);
+			fOld[1] = (o1[2] * o2[0]) - (o1[0] * o2[2]);
+			fOld[2] = (o1[0] * o2[1]) - (o1[1] * o2[0]);
+
+			for( k = 0; k < 3; k++ )
+			{
+				pCorner[k] = (tGroup[m_tIndices[(t * 3) + k]] == a) ? pTo : &p[k]->x;
+			}
+
+			o1[0] = pCorner[1][0] - pCorner[0][0]; o1[1] = pCorner[1][1] - pCorner[0][1]; o1[2] = pCorner[1][2] - pCorner[0][2];
+			o2[0] = pCorner[2][0] - pCorner[0][0]; o2[1] = pCorner[2][1] - pCorner[0][1]; o2[2] = pCorner[2][2] - pCorner[0][2];
+
+			fNew[0] = (o1[1] * o2[2]) - (o1[2] * o2[1]);
+			fNew[1] = (o1[2] * o2[0]) - (o1[0] * o2[2]);
+			fNew[2] = (o1[0] * o2[1]) - (o1[1] * o2[0]);
+
+			if( ((fOld[0] * fNew[0]) + (fOld[1] * fNew[1]) + (fOld[2] * fNew[2])) <= 0.0f ) bOk = false;
+		}
+
+		if( !bOk ) continue;
+
+		// Collapse. Triangles along the edge go, the rest take the vertex
+		// at b most like the one they had at a.
+		for( i = 0; i < (int)tTriangles[a].size(); i++ )
+		{
+			t = tTriangles[a][i];
+			if( tDead[t] ) continue;
+
+			pIndex = &m_tIndices[t * 3];
+
+			for( k = 0; (k < 3) && (tGroup[pIndex[k]] != b); k++ );
+
+			if( k < 3 )
+			{
+				tDead[t] = true;
+				nLive--;
+				continue;
+			}
+
+			for( k = 0; k < 3; k++ )
+			{
+				if( tGroup[pIndex[k]] != a ) continue;
+
+				p[0] = &m_tVertices[pIndex[k]];
+
+				nBest = tOrder[tFirst[b]];
+				fBest = 1e30f;
+
+				for( j = tFirst[b]; j < tFirst[b + 1]; j++ )
+				{
+					p[1] = &m_tVertices[tOrder[j]];
+
+					fDistance = ((p[0]->nx - p[1]->nx) * (p[0]->nx - p[1]->nx)) + ((p[0]->ny - p[1]->ny) * (p[0]->ny - p[1]->ny)) +
+								((p[0]->nz - p[1]->nz) * (p[0]->nz - p[1]->nz)) + ((p[0]->u - p[1]->u) * (p[0]->u - p[1]->u)) +
+								((p[0]->v - p[1]->v) * (p[0]->v - p[1]->v));
+
+					if( fDistance < fBest )
+					{
+						fBest = fDistance;
+						nBest = tOrder[j];
+					}
+				}
+
+				pIndex[k] = nBest;
+			}
+
+			tTriangles[b].push_back( t );
+		}
+
+		tGone[a] = true;
+		tTriangles[a].clear();
+
+		// The error is the distance to the planes around a and b on average
+		// over their area.
+		dArea = tQuadric[(a * 11) + 10] + tQuadric[(b * 11) + 10];
+		dError = (dArea > 0.0) ? (collapse.dCost / dArea) : 0.0;
+
+		if( dError > dMax ) dMax = dError;
+
+		for( k = 0; k < 11; k++ )
+		{
+			tQuadric[(b * 11) + k] += tQuadric[(a * 11) + k];
+		}
+
+		// Let go of b's dead triangles, and queue its edges again at what
+		// they cost now.
+		for( i = 0, j = 0; i < (int)tTriangles[b].size(); i++ )
+		{
+			if( !tDead[tTriangles[b][i]] ) tTriangles[b][j++] = tTriangles[b][i];
+		}
+
+		tTriangles[b].resize( j );
+
+		for( i = 0; i < (int)tTriangles[b].size(); i++ )
+		{
+			t = tTriangles[b][i];
+
+			for( k = 0; k < 3; k++ )
+			{
+				g = tGroup[m_tIndices[(t * 3) + k]];
+				if( g == b ) continue;
+
+				for( v = 0; v < 2; v++ )
+				{
+					collapse.nFrom = v ? g : b;
+					collapse.nTo = v ? b : g;
+
+					if( tLocked[collapse.nFrom] ) continue;
+
+					pTo = &m_tVertices[tOrder[tFirst[collapse.nTo]]].x;
+					collapse.dCost = QuadricError( &tQuadric[collapse.nFrom * 11], pTo ) + QuadricError( &tQuadric[collapse.nTo * 11], pTo );
+
+					tHeap.push_back( collapse );
+					push_heap( tHeap.begin(), tHeap.end(), CostAbove() );
+				}
+			}
+		}
+	}
+
+	// Keep what's left, and get it ready to draw.
+	tIndices.reserve( nLive * 3 );
+	tAttributes.reserve( nLive );
+
+	for( t = 0; t < (int)tDead.size(); t++ )
+	{
+		if( tDead[t] ) continue;
+
+		tIndices.insert( tIndices.end(), &m_tIndices[t * 3], &m_tIndices[t * 3] + 3 );
+		tAttributes.push_back( m_tAttributes[t] );
+	}
+
+	m_tIndices.swap( tIndices );
+	m_tAttributes.swap( tAttributes );
+
+	Optimize();
+
+	return (float)sqrt( dMax );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetACMR
+//
+//  Desc: Returns the average cache miss ratio of the mesh as it's ordered,
+//        how many vertices a triangle has to run through the vertex shader,
+//        for a FIFO cache of nCacheSize vertices. 3 is every corner of every
+//        triangle, and about 0.5 is as good as a big closed mesh gets.
+// ----------------------------------------------------------------------------
+float CMeshData::GetACMR( int nCacheSize ) const
+{
+	vector<int>		tMissed;
+	const uint32_t*	pIndices = GetIndices();
+	int				nTriangles = GetTriangleCount();
+	int				nMisses = 0;
+
+	if( !nTriangles ) return 0.0f;
+
+	// When each vertex last missed. It's still in the cache until
+	// nCacheSize more have missed after it.
+	tMissed.assign( GetVertexCount(), -nCacheSize - 1 );
+
+	for( int i = 0; i < (nTriangles * 3); i++ )
+	{
+		if( (nMisses - tMissed[pIndices[i]]) <= nCacheSize ) continue;
+
+		tMissed[pIndices[i]] = nMisses++;
+	}
+
+	return (float)nMisses / nTriangles;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: AddVertex
+//
+//  Desc: Adds a vertex. Returns its number.
+// ----------------------------------------------------------------------------
+int CMeshData::AddVertex( const MESHVERTEX& vertex )
+{
+	CopyOut();
+
+	m_tVertices.push_back( vertex );
+
+	return (int)m_tVertices.size() - 1;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: AddTriangle
+//
+//  Desc: Adds a triangle between three vertices, drawn with the given
+//        material.
+// ----------------------------------------------------------------------------
+void CMeshData::AddTriangle( uint32_t a, uint32_t b, uint32_t c, uint32_t nMaterial )
+{
+	CopyOut();
+
+	m_tIndices.push_back( a );
+	m_tIndices.push_back( b );
+	m_tIndices.push_back( c );
+	m_tAttributes.push_back( nMaterial );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: AddMaterial
+//
+//  Desc: Adds a material. Returns its number.
+// ----------------------------------------------------------------------------
+int CMeshData::AddMaterial( const MESHMATERIAL& material )
+{
+	m_tMaterials.push_back( material );
+
+	return (int)m_tMaterials.size() - 1;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetVertexCount
+//
+//  Desc: Returns how many vertices the mesh has.
+// ----------------------------------------------------------------------------
+int CMeshData::GetVertexCount() const
+{
+	if( m_pFile ) return m_nFileVertices;
+
+	return (int)m_tVertices.size();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetTriangleCount
+//
+//  Desc: Returns how many triangles the mesh has.
+// ----------------------------------------------------------------------------
+int CMeshData::GetTriangleCount() const
+{
+	if( m_pFile ) return m_nFileTriangles;
+
+	return (int)m_tAttributes.size();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetMaterialCount
+//
+//  Desc: Returns how many materials the mesh has. Every mesh has at least
+//        one.
+// ----------------------------------------------------------------------------
+int CMeshData::GetMaterialCount() const
+{
+	return (int)m_tMaterials.size();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetBytes
+//
+//  Desc: Returns about how much memory the mesh is using, counting the whole
+//        of a cache it's mapped.
+// ----------------------------------------------------------------------------
+size_t CMeshData::GetBytes() const
+{
+	return (m_pFile ? m_pFile->GetSize() : 0) + (m_tVertices.capacity() * sizeof(MESHVERTEX)) + (m_tIndices.capacity() * sizeof(uint32_t)) +
+		   (m_tAttributes.capacity() * sizeof(uint32_t)) + (m_tMaterials.capacity() * sizeof(MESHMATERIAL));
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetVertices
+//
+//  Desc: Returns the vertices, or NULL if there are none.
+// ----------------------------------------------------------------------------
+const MESHVERTEX* CMeshData::GetVertices() const
+{
+	if( m_pFile ) return m_pFileVertices;
+
+	return m_tVertices.empty() ? NULL : &m_tVertices[0];
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetIndices
+//
+//  Desc: Returns the triangles' corners, three to a triangle.
+// ----------------------------------------------------------------------------
+const uint32_t* CMeshData::GetIndices() const
+{
+	if( m_pFile ) return m_pFileIndices;
+
+	return m_tIndices.empty() ? NULL : &m_tIndices[0];
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetAttributes
+//
+//  Desc: Returns the material each triangle is drawn with.
+// ----------------------------------------------------------------------------
+const uint32_t* CMeshData::GetAttributes() const
+{
+	if( m_pFile ) return m_pFileAttributes;
+
+	return m_tAttributes.empty() ? NULL : &m_tAttributes[0];
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetMaterial
+//
+//  Desc: Returns material i.
+// ----------------------------------------------------------------------------
+const MESHMATERIAL* CMeshData::GetMaterial( int i ) const
+{
+	return &m_tMaterials[i];
+}
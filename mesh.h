@@ -0,0 +1,148 @@
+// ----------------------------------------------------------------------------
+//  Filename: mesh.h
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+#pragma once
+
+// Deepest frames can nest in a .x file before it's given up on.
+#define MESH_MAX_FRAME_DEPTH	32
+
+// Post-transform vertex caches. Triangles are ordered for an LRU cache of
+// MESH_ORDER_CACHE_SIZE vertices, see CMeshData::OptimizeVertexCache, which
+// does well on the FIFO caches of 12 to 24 entries cards actually have.
+// Miss ratios are reported for a FIFO of MESH_FIFO_CACHE_SIZE.
+#define MESH_ORDER_CACHE_SIZE	32
+#define MESH_FIFO_CACHE_SIZE	16
+
+// A vertex of a mesh. Laid out the same as TLVERTEX, so the whole array can
+// go into a vertex buffer as it is.
+struct MESHVERTEX
+{
+	float	x, y, z;
+	float	nx, ny, nz;
+	float	u, v;
+};
+
+// How a part of a mesh is lit and textured. Colors are red, green, blue and
+// then alpha for the diffuse. The texture is named relative to the mesh.
+struct MESHMATERIAL
+{
+	float	fDiffuse[4];
+	float	fPower;
+	float	fSpecular[3];
+	float	fEmissive[3];
+	string	sTexture;
+};
+
+// Mesh caches. A model is parsed once and what came out of it written next
+// to it, named as the model with MESH_CACHE_EXTENSION in place of ".x". The
+// cache is only used while the model hashes the same as the one it was made
+// from. Laid out like a compiled level: a header, then each section it
+// points to on an 8 byte boundary, little endian. The version goes up
+// whenever the parser would make something different of the same file.
+#define MESH_CACHE_MAGIC		0x4D443342		// "B3DM"
+#define MESH_CACHE_VERSION		2
+#define MESH_CACHE_EXTENSION	".xb"
+
+enum MeshSection
+{
+	MeshSectionVertices = 0,	// MESHVERTEX, nVertices of them.
+	MeshSectionIndices,			// uint32_t, three to a triangle.
+	MeshSectionAttributes,		// uint32_t, one to a triangle.
+	MeshSectionMaterials,		// MESHFILEMATERIAL, nMaterials of them.
+	MeshSectionNames,			// Texture names, one after the other.
+	MESH_CACHE_SECTIONS
+};
+
+// A material in a cache. The texture name is nTextureLength characters
+// from nTexture into the names.
+struct MESHFILEMATERIAL
+{
+	float		fDiffuse[4];
+	float		fPower;
+	float		fSpecular[3];
+	float		fEmissive[3];
+	uint32_t	nTexture;
+	uint32_t	nTextureLength;
+};
+
+struct MESHCACHEHEADER
+{
+	uint32_t	nMagic;
+	uint32_t	nVersion;
+	uint64_t	nSourceHash;						// See CMeshData::HashSource.
+	uint64_t	nSourceSize;
+	int32_t		nVertices;
+	int32_t		nTriangles;
+	int32_t		nMaterials;
+	uint32_t	nNamesSize;
+	uint32_t	nSize;								// Of the whole file.
+	uint32_t	nOffset[MESH_CACHE_SECTIONS];		// From the start of the file.
+};
+
+class CMappedFile;
+
+// A mesh as it comes out of a model file, not tied to any renderer. Every
+// polygon is split into triangles, each with the material it's drawn with,
+// and vertices are split wherever a corner has a normal of its own. Every
+// mesh of a file is put together into one, moved by the frames it's in.
+//
+// A mesh loaded from a cache is used where it sits in the mapped file, the
+// same as a compiled level. It's copied out the first time anything is
+// added to it or it's optimized.
+class CMeshData
+{
+protected:
+	vector<MESHVERTEX>		m_tVertices;
+	vector<uint32_t>		m_tIndices;			// Three to a triangle.
+	vector<uint32_t>		m_tAttributes;		// Material of each triangle.
+	vector<MESHMATERIAL>	m_tMaterials;
+
+	shared_ptr<CMappedFile>	m_pFile;			// Only for a cached mesh.
+	const MESHVERTEX*		m_pFileVertices;
+	const uint32_t*			m_pFileIndices;
+	const uint32_t*			m_pFileAttributes;
+	int						m_nFileVertices;
+	int						m_nFileTriangles;
+
+protected:
+	void	CopyOut();
+
+public:
+	CMeshData();
+	virtual ~CMeshData();
+
+	void	Clear();
+	bool	Load( const char* sFileName );
+	bool	LoadX( const char* sFileName );
+	bool	ParseX( const char* pData, size_t nSize );
+	bool	LoadCache( const char* sFileName, uint64_t nSourceHash, uint64_t nSourceSize );
+	bool	SaveCache( const char* sFileName, uint64_t nSourceHash, uint64_t nSourceSize ) const;
+	bool	IsCached() const;
+
+	void	Optimize();
+	int		Weld();
+	void	OptimizeVertexCache();
+	void	OptimizeFetch();
+	float	Simplify( int nTriangles );
+	float	GetACMR( int nCacheSize ) const;
+
+	static uint64_t	HashSource( const void* pData, size_t nSize );
+	static string	GetCacheName( const char* sFileName );
+
+	int		AddVertex( const MESHVERTEX& vertex );
+	void	AddTriangle( uint32_t a, uint32_t b, uint32_t c, uint32_t nMaterial );
+	int		AddMaterial( const MESHMATERIAL& material );
+
+	int		GetVertexCount() const;
+	int		GetTriangleCount() const;
+	int		GetMaterialCount() const;
+	size_t	GetBytes() const;
+
+	const MESHVERTEX*	GetVertices() const;
+	const uint32_t*		GetIndices() const;
+	const uint32_t*		GetAttributes() const;
+	const MESHMATERIAL*	GetMaterial( int i ) const;
+};
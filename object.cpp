@@ -49,26 +49,67 @@ CObject::~CObject()
 // ----------------------------------------------------------------------------
 //  Name: LoadX
 //
-//  Desc: Loads an object from an x file.
+//  Desc: Loads an object from an x file, parsed by CMeshData rather than
+//        D3DX, or from the cache of it.
 // ----------------------------------------------------------------------------
 HRESULT CObject::LoadX( IDirect3DDevice9* pDevice, string sPath, string sFileName )
 {
-	string			sMsg;
-	ID3DXBuffer*	pMtrlBuffer;
-	D3DXMATERIAL*	pMaterials;
-	string			sTextureName;
-	HRESULT			hr;
+	CMeshData	mesh;
+	string		sFullName;
+
+	sFullName = sPath + sFileName;
+
+	// Parse the file ourselves, or take what it was parsed into last time,
+	// see CMeshData::Load.
+	if( !mesh.Load( sFullName.c_str() ) )
+	{
+		DbgPrint( "Undetermined error loading .x file." );
+		DbgPrint( "Unable to load: " + sFullName );
+		return E_FAIL;
+	}
+
+	return LoadMesh( pDevice, sPath, mesh );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: LoadMesh
+//
+//  Desc: Makes an object out of a mesh that's already been loaded. Textures
+//        are loaded from sPath.
+// ----------------------------------------------------------------------------
+HRESULT CObject::LoadMesh( IDirect3DDevice9* pDevice, string sPath, const CMeshData& mesh )
+{
+	const MESHMATERIAL*		pMaterial;
+	const uint32_t*			pIndices;
+	const uint32_t*			pAttributes;
+	D3DXATTRIBUTERANGE*		pRanges;
+	vector<DWORD>			tStart;
+	VOID*					pVertices;
+	VOID*					pBuffer;
+	DWORD*					pAttributeBuffer;
+	string					sTextureName;
+	DWORD					nVertices, nTriangles, nFace;
+	HRESULT					hr;
+
+	Release();
 
-	sTextureName = sPath + sFileName;
+	if( mesh.GetTriangleCount() == 0 ) return E_FAIL;
 
-	// Attempt to load the mesh from a file.
-	hr = D3DXLoadMeshFromX( sTextureName.c_str(), D3DXMESH_SYSTEMMEM, pDevice, NULL, &pMtrlBuffer, NULL, &m_nNumberOfMaterials, &m_pMesh );
+	nVertices = mesh.GetVertexCount();
+	nTriangles = mesh.GetTriangleCount();
+	m_nNumberOfMaterials = mesh.GetMaterialCount();
+
+	hr = D3DXCreateMeshFVF( nTriangles, nVertices, D3DXMESH_SYSTEMMEM | ((nVertices > 0xFFFF) ? D3DXMESH_32BIT : 0),
+							D3DFVF_TLVERTEX, pDevice, &m_pMesh );
 	if( FAILED( hr ) )
 	{
 		switch( hr )
 		{
 		case D3DERR_INVALIDCALL:
-			DbgPrint( "Invalid call to D3DXLoadMeshFromX in file object.cpp" );
+			DbgPrint( "Invalid call to D3DXCreateMeshFVF in file object.cpp" );
 			break;
 
 		case E_OUTOFMEMORY:
@@ -76,35 +117,109 @@ HRESULT CObject::LoadX( IDirect3DDevice9* pDevice, string sPath, string sFileNam
 			break;
 
 		default:
-			DbgPrint( "Undetermined error loading .x file." );
+			DbgPrint( "Undetermined error creating mesh." );
 		}
-		
-		DbgPrint( "Unable to load: " + sTextureName );
+
+		m_pMesh = NULL;
+		m_nNumberOfMaterials = 0;
 		return hr;
 	}
 
-	// Load the materials and textures.
-	pMaterials = (D3DXMATERIAL*)pMtrlBuffer->GetBufferPointer();
+	// MESHVERTEX is laid out the same as TLVERTEX.
+	m_pMesh->LockVertexBuffer( 0, &pVertices );
+	memcpy( pVertices, mesh.GetVertices(), nVertices * sizeof(TLVERTEX) );
+	m_pMesh->UnlockVertexBuffer();
+
+	// The triangles go in a material at a time, so each subset is one range
+	// of the index buffer.
+	pIndices = mesh.GetIndices();
+	pAttributes = mesh.GetAttributes();
+
+	tStart.assign( m_nNumberOfMaterials + 1, 0 );
 
+	for( DWORD i = 0; i < nTriangles; i++ )
+	{
+		tStart[pAttributes[i] + 1]++;
+	}
+
+	for( DWORD i = 0; i < m_nNumberOfMaterials; i++ )
+	{
+		tStart[i + 1] += tStart[i];
+	}
+
+	pRanges = new D3DXATTRIBUTERANGE[m_nNumberOfMaterials];
+
+	for( DWORD i = 0; i < m_nNumberOfMaterials; i++ )
+	{
+		pRanges[i].AttribId = i;
+		pRanges[i].FaceStart = tStart[i];
+		pRanges[i].FaceCount = tStart[i + 1] - tStart[i];
+		pRanges[i].VertexStart = 0;
+		pRanges[i].VertexCount = nVertices;
+	}
+
+	m_pMesh->LockIndexBuffer( 0, &pBuffer );
+	m_pMesh->LockAttributeBuffer( 0, &pAttributeBuffer );
+
+	for( DWORD i = 0; i < nTriangles; i++ )
+	{
+		nFace = tStart[pAttributes[i]]++;
+
+		pAttributeBuffer[nFace] = pAttributes[i];
+
+		for( int j = 0; j < 3; j++ )
+		{
+			if( nVertices > 0xFFFF )
+			{
+				((DWORD*)pBuffer)[(nFace * 3) + j] = pIndices[(i * 3) + j];
+			}
+			else
+			{
+				((WORD*)pBuffer)[(nFace * 3) + j] = (WORD)pIndices[(i * 3) + j];
+			}
+		}
+	}
+
+	m_pMesh->UnlockAttributeBuffer();
+	m_pMesh->UnlockIndexBuffer();
+
+	m_pMesh->SetAttributeTable( pRanges, m_nNumberOfMaterials );
+	delete[] pRanges;
+
+	// Load the materials and textures.
 	m_pMaterials = new D3DMATERIAL9[m_nNumberOfMaterials];
 	m_pTextures = new IDirect3DTexture9*[m_nNumberOfMaterials];
 
 	for( DWORD i = 0; i < m_nNumberOfMaterials; i++ )
 	{
-		// Copy each material and set the ambient reflectivity.
+		pMaterial = mesh.GetMaterial( i );
+
+		memset( &m_pMaterials[i], 0, sizeof(D3DMATERIAL9) );
+
+		m_pMaterials[i].Diffuse.r = pMaterial->fDiffuse[0];
+		m_pMaterials[i].Diffuse.g = pMaterial->fDiffuse[1];
+		m_pMaterials[i].Diffuse.b = pMaterial->fDiffuse[2];
+		m_pMaterials[i].Power = pMaterial->fPower;
+		m_pMaterials[i].Specular.r = pMaterial->fSpecular[0];
+		m_pMaterials[i].Specular.g = pMaterial->fSpecular[1];
+		m_pMaterials[i].Specular.b = pMaterial->fSpecular[2];
+		m_pMaterials[i].Emissive.r = pMaterial->fEmissive[0];
+		m_pMaterials[i].Emissive.g = pMaterial->fEmissive[1];
+		m_pMaterials[i].Emissive.b = pMaterial->fEmissive[2];
+
+		// Set the ambient reflectivity.
 		// TODO: Fix the meshes so that the alpha channel is copied
 		// properly, having to hardcode it is not good practice.
-		m_pMaterials[i] = pMaterials->MatD3D;
 		m_pMaterials[i].Diffuse.a = 0.75;
 		m_pMaterials[i].Ambient = m_pMaterials[i].Diffuse;
 
-		if( pMaterials->pTextureFilename )
+		if( !pMaterial->sTexture.empty() )
 		{
 			// If a texture file name was specified for this material,
 			// load it.
-			sTextureName = sPath + pMaterials->pTextureFilename;
+			sTextureName = sPath + pMaterial->sTexture;
 
-			if( FAILED( D3DXCreateTextureFromFile( pDevice, sTextureName.c_str(), &m_pTextures[i] ) ) )
+			if( FAILED( CGraphics::LoadTexture( pDevice, sTextureName.c_str(), &m_pTextures[i] ) ) )
 			{
 				DbgPrint( "A texture could not be loaded." );
 				m_pTextures[i] = NULL;
@@ -116,8 +231,6 @@ HRESULT CObject::LoadX( IDirect3DDevice9* pDevice, string sPath, string sFileNam
 		}
 	}
 
-	pMtrlBuffer->Release();
-
 	m_bVisible = TRUE;
 
 	return D3D_OK;
@@ -226,6 +339,62 @@ HRESULT CObject::Render( IDirect3DDevice9* pDevice )
 
 
 
+// ----------------------------------------------------------------------------
+//  Name: RenderInstances
+//
+//  Desc: Renders the object once at each of a list of positions, rotated by
+//        the matching rotation. pRotations can be NULL if none are rotated.
+//        Each material is set only once for the whole list.
+// ----------------------------------------------------------------------------
+HRESULT CObject::RenderInstances( IDirect3DDevice9* pDevice, const D3DXVECTOR3* pPositions, const D3DXVECTOR3* pRotations, int nCount )
+{
+	D3DXMATRIX matRx, matRy, matRz;
+	D3DXMATRIX matTranslation, matRotation;
+	D3DXMATRIX matWorld;
+
+	if( !m_bVisible || (nCount <= 0) ) return D3D_OK;
+
+	// Turn on lighting temporarily.
+	pDevice->SetRenderState( D3DRS_LIGHTING, TRUE );
+
+	for( DWORD i = 0; i < m_nNumberOfMaterials; i++ )
+	{
+		pDevice->SetMaterial( &m_pMaterials[i] );
+		pDevice->SetTexture( 0, m_pTextures[i] );
+
+		for( int n = 0; n < nCount; n++ )
+		{
+			D3DXMatrixTranslation( &matWorld, pPositions[n].x, pPositions[n].y, pPositions[n].z );
+
+			// Same order as Render, rotations first.
+			if( pRotations && ((pRotations[n].x != 0.0f) || (pRotations[n].y != 0.0f) || (pRotations[n].z != 0.0f)) )
+			{
+				D3DXMatrixRotationX( &matRx, pRotations[n].x * (D3DX_PI / 180) );
+				D3DXMatrixRotationY( &matRy, pRotations[n].y * (D3DX_PI / 180) );
+				D3DXMatrixRotationZ( &matRz, pRotations[n].z * (D3DX_PI / 180) );
+
+				matTranslation = matWorld;
+				matRotation = matRx;
+				D3DXMatrixMultiply( &matRotation, &matRotation, &matRy );
+				D3DXMatrixMultiply( &matRotation, &matRotation, &matRz );
+				D3DXMatrixMultiply( &matWorld, &matRotation, &matTranslation );
+			}
+
+			pDevice->SetTransform( D3DTS_WORLD, &matWorld );
+
+			m_pMesh->DrawSubset( i );
+		}
+	}
+
+	// Turn off lighting.
+	pDevice->SetRenderState( D3DRS_LIGHTING, FALSE );
+
+	return D3D_OK;
+}
+
+
+
+
 // ----------------------------------------------------------------------------
 //  Name: SetPosition
 //
@@ -32,11 +32,13 @@ public:
 	VOID	GetRotation( D3DXVECTOR3* p );
 
 	HRESULT	LoadX( IDirect3DDevice9* pDevice, string sPath, string FileName );
+	HRESULT	LoadMesh( IDirect3DDevice9* pDevice, string sPath, const CMeshData& mesh );
 	HRESULT CreateBox( FLOAT fWidth, FLOAT fLength, FLOAT fDepth );
 	HRESULT CreateSphere( FLOAT fRadius, DWORD nLong, DWORD nLat );
 
 	HRESULT	Release();
 	HRESULT	Render( IDirect3DDevice9* pDevice );
+	HRESULT	RenderInstances( IDirect3DDevice9* pDevice, const D3DXVECTOR3* pPositions, const D3DXVECTOR3* pRotations, int nCount );
 
 	HRESULT	SetPosition( FLOAT x, FLOAT y, FLOAT z );
 	HRESULT SetRotation( FLOAT x, FLOAT y, FLOAT z );
@@ -0,0 +1,742 @@
+// ----------------------------------------------------------------------------
+//  Filename: pack.cpp
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+
+
+
+
+// Preprocessor directives.
+#include "sim.h"
+
+
+
+
+// Compression. A run of sequences, each a token byte, then any literals,
+// then where to copy a match from. The token's high four bits are how many
+// literals there are and its low four bits how long the match is, less
+// PACK_MIN_MATCH. Either at 15 goes on in the bytes after it, adding each
+// until one isn't 255. The literals come next, then the match as a two
+// byte distance back into what's been unpacked, then the rest of its
+// length. The last sequence stops after its literals.
+#define PACK_MIN_MATCH		4
+#define PACK_MAX_DISTANCE	0xFFFF
+#define PACK_HASH_BITS		14
+
+// Sorts entries into buckets for Write, and by hash within a bucket so the
+// same name twice ends up side by side.
+struct EntryBucket
+{
+	const vector<PACKENTRY>* pEntries;
+	uint32_t nMask;
+
+	EntryBucket( const vector<PACKENTRY>* p, uint32_t n ) : pEntries( p ), nMask( n ) {}
+	bool operator()( int a, int b ) const
+	{
+		const PACKENTRY& ea = (*pEntries)[a];
+		const PACKENTRY& eb = (*pEntries)[b];
+
+		if( (ea.nHash & nMask) != (eb.nHash & nMask) ) return (ea.nHash & nMask) < (eb.nHash & nMask);
+		if( ea.nHash != eb.nHash ) return ea.nHash < eb.nHash;
+
+		return a < b;
+	}
+};
+
+shared_ptr<CAssetPack> CAssetPack::s_pMounted;
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: SkipDots
+//
+//  Desc: Skips any "./" a name starts with, which doesn't change what file
+//        it is.
+// ----------------------------------------------------------------------------
+static const char* SkipDots( const char* sName )
+{
+	while( (sName[0] == '.') && ((sName[1] == '/') || (sName[1] == '\\')) ) sName += 2;
+
+	return sName;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: NameChar
+//
+//  Desc: Returns a character of a name the way it's kept in a pack, lower
+//        case and with / for \.
+// ----------------------------------------------------------------------------
+static inline char NameChar( char c )
+{
+	if( c == '\\' ) return '/';
+	if( (c >= 'A') && (c <= 'Z') ) return c - 'A' + 'a';
+
+	return c;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: PutLength
+//
+//  Desc: Writes the rest of a length that didn't fit in its token.
+// ----------------------------------------------------------------------------
+static void PutLength( vector<unsigned char>* pPacked, size_t nLength )
+{
+	while( nLength >= 255 )
+	{
+		pPacked->push_back( 255 );
+		nLength -= 255;
+	}
+
+	pPacked->push_back( (unsigned char)nLength );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: PutSequence
+//
+//  Desc: Writes a sequence: the literals from pLiterals, then a match of
+//        nMatch bytes from nDistance back, if nMatch isn't 0.
+// ----------------------------------------------------------------------------
+static void PutSequence( vector<unsigned char>* pPacked, const unsigned char* pLiterals, size_t nLiterals, size_t nDistance, size_t nMatch )
+{
+	size_t nToken;
+
+	nToken = ((nLiterals < 15) ? nLiterals : 15) << 4;
+	if( nMatch ) nToken |= ((nMatch - PACK_MIN_MATCH) < 15) ? (nMatch - PACK_MIN_MATCH) : 15;
+
+	pPacked->push_back( (unsigned char)nToken );
+
+	if( nLiterals >= 15 ) PutLength( pPacked, nLiterals - 15 );
+
+	pPacked->insert( pPacked->end(), pLiterals, pLiterals + nLiterals );
+
+	if( !nMatch ) return;
+
+	pPacked->push_back( (unsigned char)(nDistance & 0xFF) );
+	pPacked->push_back( (unsigned char)(nDistance >> 8) );
+
+	if( (nMatch - PACK_MIN_MATCH) >= 15 ) PutLength( pPacked, nMatch - PACK_MIN_MATCH - 15 );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetLength
+//
+//  Desc: Reads the rest of a length that didn't fit in its token. Returns
+//        false if it runs off the end.
+// ----------------------------------------------------------------------------
+static bool GetLength( const unsigned char** pp, const unsigned char* pEnd, size_t* pnLength )
+{
+	unsigned char n;
+
+	do
+	{
+		if( *pp >= pEnd ) return false;
+
+		n = *(*pp)++;
+		*pnLength += n;
+	}
+	while( n == 255 );
+
+	return true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CAssetPack
+//
+//  Desc: Constructor
+// ----------------------------------------------------------------------------
+CAssetPack::CAssetPack()
+{
+	m_pHeader = NULL;
+	m_pBuckets = NULL;
+	m_pEntries = NULL;
+	m_pNames = NULL;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: ~CAssetPack
+//
+//  Desc: Destructor
+// ----------------------------------------------------------------------------
+CAssetPack::~CAssetPack()
+{
+	Close();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Open
+//
+//  Desc: Maps a pack into memory. Nothing is read but the table of contents,
+//        which is checked over, since everything after trusts it. Always
+//        opens the pack from the disk, never out of the mounted one.
+// ----------------------------------------------------------------------------
+bool CAssetPack::Open( const char* sFileName )
+{
+	shared_ptr<CMappedFile>	pFile( new CMappedFile() );
+	const PACKHEADER*		pHeader;
+	const PACKENTRY*		pEntries;
+	const uint32_t*			pBuckets;
+	const unsigned char*	pData;
+	uint32_t				b, e;
+
+	Close();
+
+	if( !pFile->OpenFile( sFileName ) || (pFile->GetSize() < sizeof(PACKHEADER)) ) return false;
+
+	pData = pFile->GetData();
+	pHeader = (const PACKHEADER*)pData;
+
+	if( (pHeader->nMagic != PACK_MAGIC) || (pHeader->nVersion != PACK_VERSION) ) return false;
+	if( pHeader->nSize > pFile->GetSize() ) return false;
+	if( !pHeader->nBuckets || (pHeader->nBuckets & (pHeader->nBuckets - 1)) ) return false;
+	if( (pHeader->nBucketOffset & 7) || (pHeader->nEntryOffset & 7) ) return false;
+
+	if( (pHeader->nBucketOffset > pHeader->nSize) || (((uint64_t)pHeader->nBuckets + 1) * sizeof(uint32_t) > (pHeader->nSize - pHeader->nBucketOffset)) ) return false;
+	if( (pHeader->nEntryOffset > pHeader->nSize) || ((uint64_t)pHeader->nEntries * sizeof(PACKENTRY) > (pHeader->nSize - pHeader->nEntryOffset)) ) return false;
+	if( (pHeader->nNameOffset > pHeader->nSize) || (pHeader->nNamesSize > (pHeader->nSize - pHeader->nNameOffset)) ) return false;
+
+	pBuckets = (const uint32_t*)(pData + pHeader->nBucketOffset);
+	pEntries = (const PACKENTRY*)(pData + pHeader->nEntryOffset);
+
+	if( pBuckets[0] || (pBuckets[pHeader->nBuckets] != pHeader->nEntries) ) return false;
+
+	for( b = 0; b < pHeader->nBuckets; b++ )
+	{
+		if( pBuckets[b + 1] < pBuckets[b] ) return false;
+
+		for( e = pBuckets[b]; e < pBuckets[b + 1]; e++ )
+		{
+			if( (pEntries[e].nHash & (pHeader->nBuckets - 1)) != b ) return false;
+			if( ((uint64_t)pEntries[e].nName + pEntries[e].nNameLength) > pHeader->nNamesSize ) return false;
+			if( (pEntries[e].nOffset > pHeader->nSize) || (pEntries[e].nPackedSize > (pHeader->nSize - pEntries[e].nOffset)) ) return false;
+			if( pEntries[e].nSize > (uint64_t)SIZE_MAX ) return false;
+			if( !(pEntries[e].nFlags & PACK_COMPRESSED) && (pEntries[e].nPackedSize != pEntries[e].nSize) ) return false;
+
+			// No byte packed unpacks to more than 255, so a bigger size is
+			// damage, and not worth trying to allocate.
+			if( (pEntries[e].nFlags & PACK_COMPRESSED) && ((pEntries[e].nSize / 255) > pEntries[e].nPackedSize) ) return false;
+		}
+	}
+
+	m_pFile = pFile;
+	m_pHeader = pHeader;
+	m_pBuckets = pBuckets;
+	m_pEntries = pEntries;
+	m_pNames = (const char*)(pData + pHeader->nNameOffset);
+
+	return true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Close
+//
+//  Desc: Lets go of the pack. Files opened out of it keep it mapped until
+//        they're closed too.
+// ----------------------------------------------------------------------------
+void CAssetPack::Close()
+{
+	m_pFile.reset();
+	m_pHeader = NULL;
+	m_pBuckets = NULL;
+	m_pEntries = NULL;
+	m_pNames = NULL;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: IsOpen
+//
+//  Desc: Returns whether there's a pack open.
+// ----------------------------------------------------------------------------
+bool CAssetPack::IsOpen() const
+{
+	return m_pHeader != NULL;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Find
+//
+//  Desc: Returns the entry for a file, or -1 if it isn't in the pack. The
+//        name is hashed and compared as it is, nothing is allocated.
+// ----------------------------------------------------------------------------
+int CAssetPack::Find( const char* sName ) const
+{
+	const PACKENTRY*	pEntry;
+	const char*			sCompare;
+	uint64_t			nHash;
+	uint32_t			i, b, c;
+
+	if( !m_pHeader ) return -1;
+
+	nHash = HashName( sName );
+	b = (uint32_t)(nHash & (m_pHeader->nBuckets - 1));
+	sCompare = SkipDots( sName );
+
+	for( i = m_pBuckets[b]; i < m_pBuckets[b + 1]; i++ )
+	{
+		pEntry = &m_pEntries[i];
+		if( pEntry->nHash != nHash ) continue;
+
+		for( c = 0; (c < pEntry->nNameLength) && sCompare[c] && (NameChar( sCompare[c] ) == m_pNames[pEntry->nName + c]); c++ );
+
+		if( (c == pEntry->nNameLength) && !sCompare[c] ) return (int)i;
+	}
+
+	return -1;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Read
+//
+//  Desc: Copies a file out of the pack, unpacking it if it's compressed.
+//        Returns false if it doesn't unpack to what it should.
+// ----------------------------------------------------------------------------
+bool CAssetPack::Read( int nEntry, vector<unsigned char>* pData ) const
+{
+	const PACKENTRY*		pEntry = &m_pEntries[nEntry];
+	const unsigned char*	pPacked = m_pFile->GetData() + pEntry->nOffset;
+
+	pData->resize( (size_t)pEntry->nSize );
+
+	if( !pEntry->nSize ) return true;
+
+	if( pEntry->nFlags & PACK_COMPRESSED )
+	{
+		return Decompress( pPacked, (size_t)pEntry->nPackedSize, &(*pData)[0], (size_t)pEntry->nSize );
+	}
+
+	memcpy( &(*pData)[0], pPacked, (size_t)pEntry->nSize );
+
+	return true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetCount
+//
+//  Desc: Returns how many files are in the pack.
+// ----------------------------------------------------------------------------
+int CAssetPack::GetCount() const
+{
+	return m_pHeader ? (int)m_pHeader->nEntries : 0;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetName
+//
+//  Desc: Returns the name of a file, as it's kept.
+// ----------------------------------------------------------------------------
+string CAssetPack::GetName( int nEntry ) const
+{
+	return string( m_pNames + m_pEntries[nEntry].nName, m_pEntries[nEntry].nNameLength );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetSize
+//
+//  Desc: Returns the size of a file once it's unpacked.
+// ----------------------------------------------------------------------------
+uint64_t CAssetPack::GetSize( int nEntry ) const
+{
+	return m_pEntries[nEntry].nSize;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetPackedSize
+//
+//  Desc: Returns the size of a file as it's kept in the pack.
+// ----------------------------------------------------------------------------
+uint64_t CAssetPack::GetPackedSize( int nEntry ) const
+{
+	return m_pEntries[nEntry].nPackedSize;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: IsCompressed
+//
+//  Desc: Returns whether a file is kept compressed.
+// ----------------------------------------------------------------------------
+bool CAssetPack::IsCompressed( int nEntry ) const
+{
+	return (m_pEntries[nEntry].nFlags & PACK_COMPRESSED) != 0;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetData
+//
+//  Desc: Returns where a file kept as it is sits in the mapped pack, or NULL
+//        for a compressed one, see Read.
+// ----------------------------------------------------------------------------
+const unsigned char* CAssetPack::GetData( int nEntry ) const
+{
+	if( m_pEntries[nEntry].nFlags & PACK_COMPRESSED ) return NULL;
+
+	return m_pFile->GetData() + m_pEntries[nEntry].nOffset;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetFile
+//
+//  Desc: Returns the mapped pack, for whatever points into it to hold on to.
+// ----------------------------------------------------------------------------
+const shared_ptr<CMappedFile>& CAssetPack::GetFile() const
+{
+	return m_pFile;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Write
+//
+//  Desc: Packs files into one. With bCompress, each not marked to be stored
+//        is compressed if that takes it down to PACK_KEEP_EIGHTHS of its
+//        size, and kept as it is otherwise, so files that are compressed
+//        already cost nothing to unpack. Fails if two files have the same
+//        name.
+// ----------------------------------------------------------------------------
+bool CAssetPack::Write( const char* sFileName, const vector<PACKFILE>& tFiles, bool bCompress )
+{
+	static const char tZeros[PACK_ALIGN] = { 0 };
+
+	PACKHEADER						header;
+	vector<PACKENTRY>				tEntries, tSorted;
+	vector< vector<unsigned char> >	tPacked;
+	vector<uint32_t>				tBuckets;
+	vector<int>						tOrder;
+	string							sNames, sName;
+	ofstream						file;
+	uint64_t						nEnd;
+	size_t							nPacked;
+	uint32_t						b;
+	int								i;
+
+	memset( &header, 0, sizeof(header) );
+	header.nMagic = PACK_MAGIC;
+	header.nVersion = PACK_VERSION;
+	header.nEntries = (uint32_t)tFiles.size();
+
+	for( header.nBuckets = 1; header.nBuckets < header.nEntries; header.nBuckets <<= 1 );
+
+	tEntries.resize( tFiles.size() );
+	tPacked.resize( tFiles.size() );
+
+	nEnd = (sizeof(header) + PACK_ALIGN - 1) & ~(uint64_t)(PACK_ALIGN - 1);
+
+	for( i = 0; i < (int)tFiles.size(); i++ )
+	{
+		sName = NormalizeName( tFiles[i].sName.c_str() );
+
+		memset( &tEntries[i], 0, sizeof(PACKENTRY) );
+		tEntries[i].nHash = HashName( sName.c_str() );
+		tEntries[i].nName = (uint32_t)sNames.size();
+		tEntries[i].nNameLength = (uint32_t)sName.size();
+		tEntries[i].nSize = tFiles[i].tData.size();
+		tEntries[i].nPackedSize = tFiles[i].tData.size();
+
+		sNames += sName;
+
+		if( bCompress && !tFiles[i].bStore && !tFiles[i].tData.empty() )
+		{
+			nPacked = Compress( &tFiles[i].tData[0], tFiles[i].tData.size(), &tPacked[i] );
+
+			if( nPacked <= ((tFiles[i].tData.size() * PACK_KEEP_EIGHTHS) / 8) )
+			{
+				tEntries[i].nFlags |= PACK_COMPRESSED;
+				tEntries[i].nPackedSize = nPacked;
+			}
+			else
+			{
+				tPacked[i].clear();
+			}
+		}
+
+		tEntries[i].nOffset = nEnd;
+		nEnd = (nEnd + tEntries[i].nPackedSize + PACK_ALIGN - 1) & ~(uint64_t)(PACK_ALIGN - 1);
+	}
+
+	// The table of contents, each entry in its bucket.
+	tOrder.resize( tEntries.size() );
+
+	for( i = 0; i < (int)tEntries.size(); i++ )
+	{
+		tOrder[i] = i;
+	}
+
+	sort( tOrder.begin(), tOrder.end(), EntryBucket( &tEntries, header.nBuckets - 1 ) );
+
+	tBuckets.assign( header.nBuckets + 1, 0 );
+
+	for( i = 0; i < (int)tOrder.size(); i++ )
+	{
+		tSorted.push_back( tEntries[tOrder[i]] );
+		tBuckets[(tEntries[tOrder[i]].nHash & (header.nBuckets - 1)) + 1]++;
+
+		if( i && (tSorted[i].nHash == tSorted[i - 1].nHash) &&
+			!sNames.compare( tSorted[i].nName, tSorted[i].nNameLength, sNames, tSorted[i - 1].nName, tSorted[i - 1].nNameLength ) ) return false;
+	}
+
+	for( b = 0; b < header.nBuckets; b++ )
+	{
+		tBuckets[b + 1] += tBuckets[b];
+	}
+
+	header.nBucketOffset = nEnd;
+	nEnd = (nEnd + (tBuckets.size() * sizeof(uint32_t)) + 7) & ~(uint64_t)7;
+	header.nEntryOffset = nEnd;
+	nEnd += tSorted.size() * sizeof(PACKENTRY);
+	header.nNameOffset = nEnd;
+	header.nNamesSize = sNames.size();
+	nEnd += sNames.size();
+	header.nSize = nEnd;
+
+	file.open( sFileName, ios::out | ios::binary | ios::trunc );
+	if( !file.is_open() ) return false;
+
+	file.write( (const char*)&header, sizeof(header) );
+	file.write( tZeros, (size_t)(tEntries.empty() ? header.nBucketOffset : tEntries[0].nOffset) - sizeof(header) );
+
+	for( i = 0; i < (int)tFiles.size(); i++ )
+	{
+		if( tEntries[i].nFlags & PACK_COMPRESSED ) file.write( (const char*)&tPacked[i][0], tPacked[i].size() );
+		else if( !tFiles[i].tData.empty() ) file.write( (const char*)&tFiles[i].tData[0], tFiles[i].tData.size() );
+
+		nEnd = ((i + 1) < (int)tFiles.size()) ? tEntries[i + 1].nOffset : header.nBucketOffset;
+		file.write( tZeros, (size_t)(nEnd - tEntries[i].nOffset - tEntries[i].nPackedSize) );
+	}
+
+	file.write( (const char*)&tBuckets[0], tBuckets.size() * sizeof(uint32_t) );
+	file.write( tZeros, (size_t)(header.nEntryOffset - header.nBucketOffset - (tBuckets.size() * sizeof(uint32_t))) );
+	if( !tSorted.empty() ) file.write( (const char*)&tSorted[0], tSorted.size() * sizeof(PACKENTRY) );
+	file.write( sNames.c_str(), sNames.size() );
+	file.close();
+
+	return !file.fail();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: NormalizeName
+//
+//  Desc: Returns a name the way it's kept in a pack, lower case, with /
+//        for \ and without any "./" at the start.
+// ----------------------------------------------------------------------------
+string CAssetPack::NormalizeName( const char* sName )
+{
+	string sNormal;
+
+	for( sName = SkipDots( sName ); *sName; sName++ )
+	{
+		sNormal += NameChar( *sName );
+	}
+
+	return sNormal;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: HashName
+//
+//  Desc: Hashes a name as NormalizeName would leave it, with 64-bit FNV-1a.
+// ----------------------------------------------------------------------------
+uint64_t CAssetPack::HashName( const char* sName )
+{
+	uint64_t nHash = 14695981039346656037ull;
+
+	for( sName = SkipDots( sName ); *sName; sName++ )
+	{
+		nHash = (nHash ^ (unsigned char)NameChar( *sName )) * 1099511628211ull;
+	}
+
+	return nHash;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Compress
+//
+//  Desc: Compresses a file into pPacked and returns how big it came out.
+//        Finds matches through a table of where each hash of four bytes was
+//        last seen, and takes the first it finds, so it's quick rather than
+//        as small as it could be. Unpacking is what has to be quick.
+// ----------------------------------------------------------------------------
+size_t CAssetPack::Compress( const unsigned char* pData, size_t nSize, vector<unsigned char>* pPacked )
+{
+	vector<uint32_t>	tLast;
+	size_t				i, nLiterals, nMatch, nCandidate;
+	uint32_t			n, h;
+
+	pPacked->clear();
+	pPacked->reserve( nSize + (nSize / 255) + 16 );
+
+	tLast.assign( (size_t)1 << PACK_HASH_BITS, 0xFFFFFFFF );
+
+	for( i = 0, nLiterals = 0; (i + PACK_MIN_MATCH) <= nSize; )
+	{
+		memcpy( &n, pData + i, sizeof(n) );
+		h = (n * 2654435761u) >> (32 - PACK_HASH_BITS);
+
+		nCandidate = tLast[h];
+		tLast[h] = (uint32_t)i;
+
+		if( (nCandidate == 0xFFFFFFFF) || ((i - nCandidate) > PACK_MAX_DISTANCE) || memcmp( pData + nCandidate, pData + i, PACK_MIN_MATCH ) )
+		{
+			i++;
+			nLiterals++;
+			continue;
+		}
+
+		for( nMatch = PACK_MIN_MATCH; ((i + nMatch) < nSize) && (pData[nCandidate + nMatch] == pData[i + nMatch]); nMatch++ );
+
+		PutSequence( pPacked, pData + i - nLiterals, nLiterals, i - nCandidate, nMatch );
+
+		i += nMatch;
+		nLiterals = 0;
+	}
+
+	PutSequence( pPacked, pData + i - nLiterals, nLiterals + (nSize - i), 0, 0 );
+
+	return pPacked->size();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Decompress
+//
+//  Desc: Unpacks what Compress packed into exactly nSize bytes at pData.
+//        Every length and distance is checked, so a damaged pack fails
+//        rather than writing anywhere it shouldn't.
+// ----------------------------------------------------------------------------
+bool CAssetPack::Decompress( const unsigned char* pPacked, size_t nPackedSize, unsigned char* pData, size_t nSize )
+{
+	const unsigned char*	p = pPacked;
+	const unsigned char*	pEnd = pPacked + nPackedSize;
+	size_t					nOut = 0, nLiterals, nMatch, nDistance;
+	unsigned char			nToken;
+
+	while( p < pEnd )
+	{
+		nToken = *p++;
+
+		nLiterals = nToken >> 4;
+		if( (nLiterals == 15) && !GetLength( &p, pEnd, &nLiterals ) ) return false;
+
+		if( (nLiterals > (size_t)(pEnd - p)) || (nLiterals > (nSize - nOut)) ) return false;
+
+		if( nLiterals ) memcpy( pData + nOut, p, nLiterals );
+		p += nLiterals;
+		nOut += nLiterals;
+
+		// The last sequence has no match.
+		if( p == pEnd ) break;
+
+		if( (pEnd - p) < 2 ) return false;
+
+		nDistance = p[0] | ((size_t)p[1] << 8);
+		p += 2;
+
+		nMatch = nToken & 15;
+		if( (nMatch == 15) && !GetLength( &p, pEnd, &nMatch ) ) return false;
+		nMatch += PACK_MIN_MATCH;
+
+		if( !nDistance || (nDistance > nOut) || (nMatch > (nSize - nOut)) ) return false;
+
+		// Byte at a time, since a match can run on into itself.
+		for( ; nMatch; nMatch--, nOut++ )
+		{
+			pData[nOut] = pData[nOut - nDistance];
+		}
+	}
+
+	return nOut == nSize;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Mount
+//
+//  Desc: Makes a pack the one CMappedFile::Open looks in first. NULL takes
+//        it away again. Files already opened out of it keep it mapped.
+// ----------------------------------------------------------------------------
+void CAssetPack::Mount( const shared_ptr<CAssetPack>& pPack )
+{
+	s_pMounted = pPack;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetMounted
+//
+//  Desc: Returns the mounted pack, or NULL if there isn't one.
+// ----------------------------------------------------------------------------
+const shared_ptr<CAssetPack>& CAssetPack::GetMounted()
+{
+	return s_pMounted;
+}
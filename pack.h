@@ -0,0 +1,109 @@
+// ----------------------------------------------------------------------------
+//  Filename: pack.h
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+#pragma once
+
+// Asset packs. Every file the game reads in one, mapped into memory whole,
+// so there's one file to open however many assets there are. A header,
+// then the files, each starting on a PACK_ALIGN byte boundary so a mapped
+// format can be used straight out of the pack, then the table of contents.
+// Little endian, as written by the machine that packed it.
+#define PACK_MAGIC			0x50443342		// "B3DP"
+#define PACK_VERSION		1
+#define PACK_ALIGN			16
+
+// A file is only kept compressed if it comes out at most this many eighths
+// of its size.
+#define PACK_KEEP_EIGHTHS	7
+
+// Entry flags.
+#define PACK_COMPRESSED		0x1
+
+struct PACKHEADER
+{
+	uint32_t	nMagic;
+	uint32_t	nVersion;
+	uint32_t	nEntries;
+	uint32_t	nBuckets;			// A power of two.
+	uint64_t	nSize;				// Of the whole file.
+	uint64_t	nBucketOffset;		// uint32_t, first entry of each bucket and the end.
+	uint64_t	nEntryOffset;		// PACKENTRY, nEntries of them.
+	uint64_t	nNameOffset;		// Names, one after the other.
+	uint64_t	nNamesSize;
+};
+
+// A file in a pack. Entries are sorted by bucket, the low bits of the hash
+// of their names, so a bucket's entries are all together. Names are kept
+// as NormalizeName leaves them.
+struct PACKENTRY
+{
+	uint64_t	nHash;
+	uint64_t	nOffset;			// From the start of the pack.
+	uint64_t	nPackedSize;		// As it's kept.
+	uint64_t	nSize;				// Once it's unpacked.
+	uint32_t	nName;				// From the start of the names.
+	uint32_t	nNameLength;
+	uint32_t	nFlags;
+	uint32_t	nReserved;
+};
+
+// A file to be packed. Mapped formats, compiled levels and mesh caches,
+// should be kept as they are, so they're still used where they sit.
+struct PACKFILE
+{
+	string					sName;
+	vector<unsigned char>	tData;
+	bool					bStore;		// Never compressed.
+};
+
+// An asset pack, mapped into memory. Files kept as they are are used where
+// they sit, compressed ones are unpacked when they're opened. Names are
+// looked up without regard to case, and / and \ are the same.
+//
+// A pack that's mounted is looked in first by CMappedFile::Open, and so by
+// everything that loads through it. Files that aren't in it are read from
+// the disk as usual. Mount a pack before any thread that loads is started,
+// the pack can be read from any number of threads after that.
+class CAssetPack
+{
+protected:
+	shared_ptr<CMappedFile>	m_pFile;
+	const PACKHEADER*		m_pHeader;
+	const uint32_t*			m_pBuckets;
+	const PACKENTRY*		m_pEntries;
+	const char*				m_pNames;
+
+	static shared_ptr<CAssetPack>	s_pMounted;
+
+public:
+	CAssetPack();
+	virtual ~CAssetPack();
+
+	bool	Open( const char* sFileName );
+	void	Close();
+	bool	IsOpen() const;
+
+	int		Find( const char* sName ) const;
+	bool	Read( int nEntry, vector<unsigned char>* pData ) const;
+
+	int						GetCount() const;
+	string					GetName( int nEntry ) const;
+	uint64_t				GetSize( int nEntry ) const;
+	uint64_t				GetPackedSize( int nEntry ) const;
+	bool					IsCompressed( int nEntry ) const;
+	const unsigned char*	GetData( int nEntry ) const;
+	const shared_ptr<CMappedFile>&	GetFile() const;
+
+	static bool		Write( const char* sFileName, const vector<PACKFILE>& tFiles, bool bCompress );
+
+	static string	NormalizeName( const char* sName );
+	static uint64_t	HashName( const char* sName );
+	static size_t	Compress( const unsigned char* pData, size_t nSize, vector<unsigned char>* pPacked );
+	static bool		Decompress( const unsigned char* pPacked, size_t nPackedSize, unsigned char* pData, size_t nSize );
+
+	static void							Mount( const shared_ptr<CAssetPack>& pPack );
+	static const shared_ptr<CAssetPack>&	GetMounted();
+};
@@ -0,0 +1,410 @@
+// ----------------------------------------------------------------------------
+//  Filename: particles.cpp
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+
+
+
+
+// Preprocessor directives.
+#include "sim.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define PARTICLES_X86
+#include <xmmintrin.h>
+#endif
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CParticlePool
+//
+//  Desc: Constructor
+// ----------------------------------------------------------------------------
+CParticlePool::CParticlePool()
+{
+	m_nMax = 0;
+	m_nLive = 0;
+
+#ifdef PARTICLES_X86
+	m_bSIMD = true;
+#else
+	m_bSIMD = false;
+#endif
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: ~CParticlePool
+//
+//  Desc: Destructor
+// ----------------------------------------------------------------------------
+CParticlePool::~CParticlePool()
+{
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Init
+//
+//  Desc: Makes room for nMax particles. This is the only place the pool
+//        takes memory.
+// ----------------------------------------------------------------------------
+void CParticlePool::Init( int nMax )
+{
+	if( nMax < 0 ) nMax = 0;
+
+	m_nMax = nMax;
+
+	m_tPosX.assign( nMax + PARTICLES_PADDING, 0.0f );
+	m_tPosY.assign( nMax + PARTICLES_PADDING, 0.0f );
+	m_tPosZ.assign( nMax + PARTICLES_PADDING, 0.0f );
+	m_tVelX.assign( nMax + PARTICLES_PADDING, 0.0f );
+	m_tVelY.assign( nMax + PARTICLES_PADDING, 0.0f );
+	m_tVelZ.assign( nMax + PARTICLES_PADDING, 0.0f );
+	m_tLife.assign( nMax + PARTICLES_PADDING, 0.0f );
+	m_tFade.assign( nMax + PARTICLES_PADDING, 0.0f );
+	m_tColor.assign( nMax + PARTICLES_PADDING, 0 );
+
+	Clear();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Clear
+//
+//  Desc: Kills every particle.
+// ----------------------------------------------------------------------------
+void CParticlePool::Clear()
+{
+	m_nLive = 0;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: SetSIMD
+//
+//  Desc: Picks whether updates use SSE, where the processor has it. Only the
+//        benchmarks need to turn it off.
+// ----------------------------------------------------------------------------
+void CParticlePool::SetSIMD( bool bSIMD )
+{
+#ifdef PARTICLES_X86
+	m_bSIMD = bSIMD;
+#else
+	m_bSIMD = false;
+#endif
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Emit
+//
+//  Desc: Adds a particle. Returns its number, or -1 if the pool is full.
+//        Numbers only hold until the next update.
+// ----------------------------------------------------------------------------
+int CParticlePool::Emit( float x, float y, float z, float vx, float vy, float vz, float fLife, uint32_t nColor )
+{
+	int i = m_nLive;
+
+	if( (i >= m_nMax) || (fLife <= 0.0f) ) return -1;
+
+	m_tPosX[i] = x;
+	m_tPosY[i] = y;
+	m_tPosZ[i] = z;
+	m_tVelX[i] = vx;
+	m_tVelY[i] = vy;
+	m_tVelZ[i] = vz;
+	m_tLife[i] = fLife;
+	m_tFade[i] = 1.0f / fLife;
+	m_tColor[i] = nColor;
+
+	m_nLive++;
+
+	return i;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Burst
+//
+//  Desc: Breaks a box up into nCount particles flying off in every direction,
+//        pushed along a little by vx, vy. Returns how many fit in the pool.
+// ----------------------------------------------------------------------------
+int CParticlePool::Burst( float x, float y, float fHalfWidth, float fHalfHeight, float vx, float vy, int nCount, uint32_t nColor, CRandom* pRandom )
+{
+	float	a, s;
+	int		n;
+
+	for( n = 0; n < nCount; n++ )
+	{
+		a = pRandom->Float( 0.0f, 6.2831853f );
+		s = pRandom->Float( 0.5f, 2.0f );
+
+		if( Emit( x + pRandom->Float( -fHalfWidth, fHalfWidth ), y + pRandom->Float( -fHalfHeight, fHalfHeight ), 0.0f,
+				  (cosf( a ) * s) + (vx * 0.25f), (sinf( a ) * s) + (vy * 0.25f), pRandom->Float( -1.5f, 0.0f ),
+				  pRandom->Float( 0.4f, 1.0f ), nColor ) < 0 ) break;
+	}
+
+	return n;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Update
+//
+//  Desc: Moves every particle on by fElapsedTime and lets go of the ones
+//        that have run out of life.
+// ----------------------------------------------------------------------------
+void CParticlePool::Update( float fElapsedTime )
+{
+	float fDrag;
+
+	if( !m_nLive ) return;
+
+	// The same drag however the time is cut up.
+	fDrag = powf( PARTICLE_DRAG, fElapsedTime );
+
+	if( m_bSIMD )
+	{
+		UpdateSSE( fElapsedTime, fDrag );
+	}
+	else
+	{
+		UpdateScalar( fElapsedTime, fDrag );
+	}
+
+	RemoveDead();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: UpdateScalar
+//
+//  Desc: Moves the particles one at a time.
+// ----------------------------------------------------------------------------
+void CParticlePool::UpdateScalar( float fElapsedTime, float fDrag )
+{
+	const float fFall = PARTICLE_GRAVITY * fElapsedTime;
+
+	for( int i = 0; i < m_nLive; i++ )
+	{
+		m_tVelX[i] *= fDrag;
+		m_tVelY[i] = (m_tVelY[i] * fDrag) - fFall;
+		m_tVelZ[i] *= fDrag;
+
+		m_tPosX[i] += m_tVelX[i] * fElapsedTime;
+		m_tPosY[i] += m_tVelY[i] * fElapsedTime;
+		m_tPosZ[i] += m_tVelZ[i] * fElapsedTime;
+
+		m_tLife[i] -= fElapsedTime;
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: UpdateSSE
+//
+//  Desc: Same as the scalar update, 4 particles at a time. The padding at the
+//        end of the arrays takes whatever the last batch runs over.
+// ----------------------------------------------------------------------------
+void CParticlePool::UpdateSSE( float fElapsedTime, float fDrag )
+{
+#ifdef PARTICLES_X86
+	const __m128	vTime = _mm_set1_ps( fElapsedTime );
+	const __m128	vDrag = _mm_set1_ps( fDrag );
+	const __m128	vFall = _mm_set1_ps( PARTICLE_GRAVITY * fElapsedTime );
+	__m128			vx, vy, vz;
+
+	for( int i = 0; i < m_nLive; i += 4 )
+	{
+		vx = _mm_mul_ps( _mm_loadu_ps( &m_tVelX[i] ), vDrag );
+		vy = _mm_sub_ps( _mm_mul_ps( _mm_loadu_ps( &m_tVelY[i] ), vDrag ), vFall );
+		vz = _mm_mul_ps( _mm_loadu_ps( &m_tVelZ[i] ), vDrag );
+
+		_mm_storeu_ps( &m_tVelX[i], vx );
+		_mm_storeu_ps( &m_tVelY[i], vy );
+		_mm_storeu_ps( &m_tVelZ[i], vz );
+
+		_mm_storeu_ps( &m_tPosX[i], _mm_add_ps( _mm_loadu_ps( &m_tPosX[i] ), _mm_mul_ps( vx, vTime ) ) );
+		_mm_storeu_ps( &m_tPosY[i], _mm_add_ps( _mm_loadu_ps( &m_tPosY[i] ), _mm_mul_ps( vy, vTime ) ) );
+		_mm_storeu_ps( &m_tPosZ[i], _mm_add_ps( _mm_loadu_ps( &m_tPosZ[i] ), _mm_mul_ps( vz, vTime ) ) );
+
+		_mm_storeu_ps( &m_tLife[i], _mm_sub_ps( _mm_loadu_ps( &m_tLife[i] ), vTime ) );
+	}
+#else
+	UpdateScalar( fElapsedTime, fDrag );
+#endif
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: RemoveDead
+//
+//  Desc: Moves the last live particle into the place of each one that has
+//        died, keeping the live ones together at the front.
+// ----------------------------------------------------------------------------
+void CParticlePool::RemoveDead()
+{
+	int i = 0, j;
+
+	while( i < m_nLive )
+	{
+#ifdef PARTICLES_X86
+		// Skip 4 at a time while they're all still alive.
+		if( ((i + 4) <= m_nLive) && !_mm_movemask_ps( _mm_cmple_ps( _mm_loadu_ps( &m_tLife[i] ), _mm_setzero_ps() ) ) )
+		{
+			i += 4;
+			continue;
+		}
+#endif
+
+		if( m_tLife[i] > 0.0f )
+		{
+			i++;
+			continue;
+		}
+
+		j = --m_nLive;
+
+		m_tPosX[i] = m_tPosX[j];
+		m_tPosY[i] = m_tPosY[j];
+		m_tPosZ[i] = m_tPosZ[j];
+		m_tVelX[i] = m_tVelX[j];
+		m_tVelY[i] = m_tVelY[j];
+		m_tVelZ[i] = m_tVelZ[j];
+		m_tLife[i] = m_tLife[j];
+		m_tFade[i] = m_tFade[j];
+		m_tColor[i] = m_tColor[j];
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetCount
+//
+//  Desc: Returns how many particles are alive.
+// ----------------------------------------------------------------------------
+int CParticlePool::GetCount() const
+{
+	return m_nLive;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetMax
+//
+//  Desc: Returns how many particles the pool can hold.
+// ----------------------------------------------------------------------------
+int CParticlePool::GetMax() const
+{
+	return m_nMax;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetX
+//
+//  Desc: Returns the live particles' positions. The arrays run from 0 up to
+//        GetCount().
+// ----------------------------------------------------------------------------
+const float* CParticlePool::GetX() const
+{
+	return m_tPosX.empty() ? NULL : &m_tPosX[0];
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetY
+//
+//  Desc: See GetX.
+// ----------------------------------------------------------------------------
+const float* CParticlePool::GetY() const
+{
+	return m_tPosY.empty() ? NULL : &m_tPosY[0];
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetZ
+//
+//  Desc: See GetX. Particles start on the board, at 0, and fly out towards
+//        the camera.
+// ----------------------------------------------------------------------------
+const float* CParticlePool::GetZ() const
+{
+	return m_tPosZ.empty() ? NULL : &m_tPosZ[0];
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetLife
+//
+//  Desc: Returns the seconds each live particle has left.
+// ----------------------------------------------------------------------------
+const float* CParticlePool::GetLife() const
+{
+	return m_tLife.empty() ? NULL : &m_tLife[0];
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetFade
+//
+//  Desc: Returns one over the seconds each live particle started with. Life
+//        times fade goes from 1 down to 0 over a particle's life.
+// ----------------------------------------------------------------------------
+const float* CParticlePool::GetFade() const
+{
+	return m_tFade.empty() ? NULL : &m_tFade[0];
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetColor
+//
+//  Desc: Returns each live particle's color, as 0xAARRGGBB.
+// ----------------------------------------------------------------------------
+const uint32_t* CParticlePool::GetColor() const
+{
+	return m_tColor.empty() ? NULL : &m_tColor[0];
+}
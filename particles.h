@@ -0,0 +1,70 @@
+// ----------------------------------------------------------------------------
+//  Filename: particles.h
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+#pragma once
+
+// The arrays are padded so an update can always run a full batch past the
+// last particle.
+#define PARTICLES_PADDING	4
+
+// How fast particles fall, in units per second per second, and how much of
+// their speed they keep after a second.
+#define PARTICLE_GRAVITY	4.0f
+#define PARTICLE_DRAG		0.5f
+
+// A fixed number of particles, for effects. Each property is kept in its own
+// contiguous array, and the live particles are always the first ones, so an
+// update runs straight down the arrays 4 at a time. A particle that dies has
+// the last live one moved into its place, and new ones go on the end. All
+// memory is taken when the pool is made, and particles past the size of the
+// pool are dropped.
+//
+// Particles are only for show. They are not part of the board, so they are
+// not in replays or snapshots and need not come out the same everywhere.
+class CParticlePool
+{
+protected:
+	int				m_nMax;
+	int				m_nLive;
+	bool			m_bSIMD;
+
+	vector<float>		m_tPosX;
+	vector<float>		m_tPosY;
+	vector<float>		m_tPosZ;
+	vector<float>		m_tVelX;
+	vector<float>		m_tVelY;
+	vector<float>		m_tVelZ;
+	vector<float>		m_tLife;		// Seconds left.
+	vector<float>		m_tFade;		// One over the seconds it started with.
+	vector<uint32_t>	m_tColor;
+
+protected:
+	void	UpdateScalar( float fElapsedTime, float fDrag );
+	void	UpdateSSE( float fElapsedTime, float fDrag );
+	void	RemoveDead();
+
+public:
+	CParticlePool();
+	virtual ~CParticlePool();
+
+	void	Init( int nMax );
+	void	Clear();
+	void	SetSIMD( bool bSIMD );
+
+	int		Emit( float x, float y, float z, float vx, float vy, float vz, float fLife, uint32_t nColor );
+	int		Burst( float x, float y, float fHalfWidth, float fHalfHeight, float vx, float vy, int nCount, uint32_t nColor, CRandom* pRandom );
+	void	Update( float fElapsedTime );
+
+	int		GetCount() const;
+	int		GetMax() const;
+
+	const float*	GetX() const;
+	const float*	GetY() const;
+	const float*	GetZ() const;
+	const float*	GetLife() const;
+	const float*	GetFade() const;
+	const uint32_t*	GetColor() const;
+};
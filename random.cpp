@@ -0,0 +1,111 @@
+// ----------------------------------------------------------------------------
+//  Filename: random.cpp
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+
+
+
+
+// Preprocessor directives.
+#include "sim.h"
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CRandom
+//
+//  Desc: Constructor
+// ----------------------------------------------------------------------------
+CRandom::CRandom()
+{
+	Seed( 1 );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: ~CRandom
+//
+//  Desc: Destructor
+// ----------------------------------------------------------------------------
+CRandom::~CRandom()
+{
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Seed
+//
+//  Desc: Starts the sequence over from the given seed.
+// ----------------------------------------------------------------------------
+void CRandom::Seed( unsigned int nSeed )
+{
+	// Xorshift never gets out of 0, and nearby seeds should still give very
+	// different sequences.
+	m_nState = (nSeed * 2654435761u) ^ 0x9E3779B9u;
+	if( !m_nState ) m_nState = 1;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Next
+//
+//  Desc: Returns the next 32 random bits.
+// ----------------------------------------------------------------------------
+unsigned int CRandom::Next()
+{
+	m_nState ^= m_nState << 13;
+	m_nState ^= m_nState >> 17;
+	m_nState ^= m_nState << 5;
+
+	return m_nState;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Range
+//
+//  Desc: Returns a random whole number from nMin to nMax, inclusive.
+// ----------------------------------------------------------------------------
+int CRandom::Range( int nMin, int nMax )
+{
+	if( nMax <= nMin ) return nMin;
+
+	return nMin + (int)(Next() % (unsigned int)(nMax - nMin + 1));
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Float
+//
+//  Desc: Returns a random number from 0 up to, but not including, 1.
+// ----------------------------------------------------------------------------
+float CRandom::Float()
+{
+	return (Next() >> 8) * (1.0f / 16777216.0f);
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Float
+//
+//  Desc: Returns a random number from fMin up to fMax.
+// ----------------------------------------------------------------------------
+float CRandom::Float( float fMin, float fMax )
+{
+	return fMin + ((fMax - fMin) * Float());
+}
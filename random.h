@@ -0,0 +1,27 @@
+// ----------------------------------------------------------------------------
+//  Filename: random.h
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+#pragma once
+
+// Small random number generator. Every board or player that needs random
+// numbers has its own, so runs can be repeated from a seed no matter what
+// else is going on.
+class CRandom
+{
+protected:
+	unsigned int	m_nState;
+
+public:
+	CRandom();
+	virtual ~CRandom();
+
+	void			Seed( unsigned int nSeed );
+
+	unsigned int	Next();
+	int				Range( int nMin, int nMax );
+	float			Float();
+	float			Float( float fMin, float fMax );
+};
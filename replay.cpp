@@ -0,0 +1,691 @@
+// ----------------------------------------------------------------------------
+//  Filename: replay.cpp
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+
+
+
+
+// Preprocessor directives.
+#include "sim.h"
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: PutVarint
+//
+//  Desc: Appends a number seven bits at a time, low bits first. The top bit
+//        of each byte says whether another follows.
+// ----------------------------------------------------------------------------
+static void PutVarint( vector<unsigned char>* pData, uint32_t n )
+{
+	while( n >= 0x80 )
+	{
+		pData->push_back( (unsigned char)(n | 0x80) );
+		n >>= 7;
+	}
+
+	pData->push_back( (unsigned char)n );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetVarint
+//
+//  Desc: Reads a number written by PutVarint. Fails if it runs off the end
+//        of the data or is longer than 32 bits can hold.
+// ----------------------------------------------------------------------------
+static bool GetVarint( const unsigned char* pData, size_t nSize, size_t* pRead, uint32_t* pN )
+{
+	uint32_t n = 0;
+
+	for( int nShift = 0; nShift < 35; nShift += 7 )
+	{
+		if( *pRead >= nSize ) return false;
+
+		n |= (uint32_t)(pData[*pRead] & 0x7F) << nShift;
+
+		if( !(pData[(*pRead)++] & 0x80) )
+		{
+			*pN = n;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: PutU32
+//
+//  Desc: Appends a 32-bit number, low byte first.
+// ----------------------------------------------------------------------------
+static void PutU32( vector<unsigned char>* pData, uint32_t n )
+{
+	for( int i = 0; i < 4; i++ )
+	{
+		pData->push_back( (unsigned char)(n >> (i * 8)) );
+	}
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetU32
+//
+//  Desc: Reads a number written by PutU32.
+// ----------------------------------------------------------------------------
+static bool GetU32( const unsigned char* pData, size_t nSize, size_t* pRead, uint32_t* pN )
+{
+	if( (nSize - *pRead) < 4 ) return false;
+
+	*pN = 0;
+
+	for( int i = 0; i < 4; i++ )
+	{
+		*pN |= (uint32_t)pData[(*pRead)++] << (i * 8);
+	}
+
+	return true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: ZigZag
+//
+//  Desc: Folds a signed number into an unsigned one so small numbers either
+//        side of zero stay small: 0, -1, 1, -2, 2 become 0, 1, 2, 3, 4.
+// ----------------------------------------------------------------------------
+static uint32_t ZigZag( int n )
+{
+	return ((uint32_t)n << 1) ^ (uint32_t)(n >> 31);
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: UnZigZag
+//
+//  Desc: Undoes ZigZag.
+// ----------------------------------------------------------------------------
+static int UnZigZag( uint32_t n )
+{
+	return (int)(n >> 1) ^ -(int)(n & 1);
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: FloatBits
+//
+//  Desc: Returns the bits of a float, to hash it.
+// ----------------------------------------------------------------------------
+static inline uint32_t FloatBits( float f )
+{
+	uint32_t n;
+
+	memcpy( &n, &f, sizeof(n) );
+
+	return n;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: HashBits
+//
+//  Desc: Adds the low nBits bits of a number to an FNV-1a hash, a byte at a
+//        time, low byte first.
+// ----------------------------------------------------------------------------
+static uint32_t HashBits( uint32_t nHash, uint64_t n, int nBits )
+{
+	for( int i = 0; i < nBits; i += 8 )
+	{
+		nHash = (nHash ^ (uint32_t)((n >> i) & 0xFF)) * 16777619u;
+	}
+
+	return nHash;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CReplay
+//
+//  Desc: Constructor
+// ----------------------------------------------------------------------------
+CReplay::CReplay()
+{
+	m_nLevelHash	= 0;
+	m_CollisionMode	= CollideDiscrete;
+	m_Broadphase	= BroadphaseGrid;
+	m_bBallCollisions = true;
+	m_fTimeStep		= BOARD_TIMESTEP;
+	m_nLives		= 1;
+
+	m_nSteps		= 0;
+	m_nScore		= 0;
+	m_State			= BoardPlaying;
+
+	m_Run.nMouseX	= 0;
+	m_Run.nEdges	= 0;
+	m_nRunLength	= 0;
+	m_nRecorded		= 0;
+
+	Rewind();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: ~CReplay
+//
+//  Desc: Destructor
+// ----------------------------------------------------------------------------
+CReplay::~CReplay()
+{
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Begin
+//
+//  Desc: Starts recording a game. Call it right after the board has been
+//        reset, with the name the level was loaded from.
+// ----------------------------------------------------------------------------
+void CReplay::Begin( const CBoard* pBoard, const CLevel* pLevel, const char* sLevel )
+{
+	m_sLevel = sLevel ? sLevel : "";
+	m_nLevelHash = HashLevel( pLevel );
+	m_CollisionMode = pBoard->GetCollisionMode();
+	m_Broadphase = pBoard->GetBroadphase();
+	m_bBallCollisions = pBoard->GetBallCollisions();
+	m_fTimeStep = pBoard->GetTimeStep();
+	m_nLives = pBoard->GetLives();
+
+	m_nSteps = 0;
+	m_nScore = 0;
+	m_State = BoardPlaying;
+
+	m_tData.clear();
+	m_nRunLength = 0;
+	m_nRecorded = 0;
+
+	Rewind();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Record
+//
+//  Desc: Adds one board step. Call it with the same input the board is
+//        stepped with.
+// ----------------------------------------------------------------------------
+void CReplay::Record( const BOARDINPUT& input, unsigned int nEdges )
+{
+	m_nRecorded++;
+
+	if( m_nRunLength && (input.nMouseX == m_Run.nMouseX) && (nEdges == m_Run.nEdges) )
+	{
+		m_nRunLength++;
+		return;
+	}
+
+	FlushRun();
+
+	m_Run.nMouseX = input.nMouseX;
+	m_Run.nEdges = nEdges;
+	m_nRunLength = 1;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Truncate
+//
+//  Desc: Drops every step after the first nSteps, so recording can go on
+//        from a step the game was rewound to.
+// ----------------------------------------------------------------------------
+void CReplay::Truncate( unsigned int nSteps )
+{
+	REPLAYSTEP		step;
+	size_t			nStart;
+	unsigned int	n = 0;
+
+	if( nSteps >= m_nRecorded ) return;
+
+	FlushRun();
+	Rewind();
+
+	for( ;; )
+	{
+		nStart = m_nRead;
+
+		if( !Next( &step ) ) break;
+
+		// Next took the first step of a run. Cut the data where the run
+		// that holds the new end starts, and carry on recording that run.
+		if( (n + m_nReadLeft + 1) > nSteps )
+		{
+			m_tData.resize( nStart );
+
+			m_Run = step;
+			m_nRunLength = nSteps - n;
+			break;
+		}
+
+		n += m_nReadLeft + 1;
+		m_nReadLeft = 0;
+	}
+
+	m_nRecorded = nSteps;
+
+	Rewind();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: FlushRun
+//
+//  Desc: Writes out the run being recorded, if there is one.
+// ----------------------------------------------------------------------------
+void CReplay::FlushRun()
+{
+	if( !m_nRunLength ) return;
+
+	PutVarint( &m_tData, (ZigZag( m_Run.nMouseX ) << 3) | ((m_nRunLength <= 3) ? (m_nRunLength << 1) : 0) | (m_Run.nEdges ? 1 : 0) );
+	if( m_Run.nEdges ) m_tData.push_back( (unsigned char)m_Run.nEdges );
+	if( m_nRunLength > 3 ) PutVarint( &m_tData, m_nRunLength );
+
+	m_nRunLength = 0;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: End
+//
+//  Desc: Finishes recording and notes how the game came out, so playing it
+//        back can be checked against it.
+// ----------------------------------------------------------------------------
+void CReplay::End( const CBoard* pBoard )
+{
+	FlushRun();
+
+	m_nSteps = pBoard->GetSteps();
+	m_nScore = pBoard->GetScore();
+	m_State = pBoard->GetState();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Save
+//
+//  Desc: Writes the replay to a file.
+// ----------------------------------------------------------------------------
+bool CReplay::Save( const char* sFileName ) const
+{
+	vector<unsigned char>	tFile;
+	ofstream				file;
+	uint32_t				nTimeStep;
+
+	memcpy( &nTimeStep, &m_fTimeStep, sizeof(nTimeStep) );
+
+	PutU32( &tFile, REPLAY_MAGIC );
+	PutVarint( &tFile, REPLAY_VERSION );
+
+	PutVarint( &tFile, (uint32_t)m_sLevel.size() );
+	tFile.insert( tFile.end(), m_sLevel.begin(), m_sLevel.end() );
+	PutU32( &tFile, m_nLevelHash );
+
+	PutVarint( &tFile, m_CollisionMode );
+	PutVarint( &tFile, m_Broadphase );
+	PutVarint( &tFile, m_bBallCollisions ? 1 : 0 );
+	PutU32( &tFile, nTimeStep );
+	PutVarint( &tFile, m_nLives );
+
+	PutVarint( &tFile, m_nSteps );
+	PutVarint( &tFile, m_nScore );
+	PutVarint( &tFile, m_State );
+
+	PutVarint( &tFile, (uint32_t)m_tData.size() );
+	tFile.insert( tFile.end(), m_tData.begin(), m_tData.end() );
+
+	file.open( sFileName, ios::out | ios::binary | ios::trunc );
+	if( !file.is_open() ) return false;
+
+	file.write( (const char*)&tFile[0], tFile.size() );
+	file.close();
+
+	return !file.fail();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Load
+//
+//  Desc: Reads a replay written by Save.
+// ----------------------------------------------------------------------------
+bool CReplay::Load( const char* sFileName )
+{
+	ifstream				file;
+	string					sFile;
+	const unsigned char*	pData;
+	REPLAYSTEP				step;
+	size_t					nSize, nRead = 0;
+	uint32_t				n, nMagic, nVersion, nMode, nBroadphase, nBallCollisions, nTimeStep, nLives, nState, nLength;
+
+	file.open( sFileName, ios::in | ios::binary );
+	if( !file.is_open() ) return false;
+
+	sFile.assign( istreambuf_iterator<char>( file ), istreambuf_iterator<char>() );
+
+	file.close();
+
+	pData = (const unsigned char*)sFile.data();
+	nSize = sFile.size();
+
+	if( !GetU32( pData, nSize, &nRead, &nMagic ) || (nMagic != REPLAY_MAGIC) ) return false;
+	if( !GetVarint( pData, nSize, &nRead, &nVersion ) || (nVersion != REPLAY_VERSION) ) return false;
+
+	if( !GetVarint( pData, nSize, &nRead, &nLength ) || (nLength > (nSize - nRead)) ) return false;
+	m_sLevel.assign( (const char*)pData + nRead, nLength );
+	nRead += nLength;
+
+	if( !GetU32( pData, nSize, &nRead, &m_nLevelHash ) ) return false;
+
+	if( !GetVarint( pData, nSize, &nRead, &nMode ) ||
+		!GetVarint( pData, nSize, &nRead, &nBroadphase ) ||
+		!GetVarint( pData, nSize, &nRead, &nBallCollisions ) ||
+		!GetU32( pData, nSize, &nRead, &nTimeStep ) ||
+		!GetVarint( pData, nSize, &nRead, &nLives ) ||
+		!GetVarint( pData, nSize, &nRead, &m_nSteps ) ||
+		!GetVarint( pData, nSize, &nRead, &m_nScore ) ||
+		!GetVarint( pData, nSize, &nRead, &nState ) ) return false;
+
+	if( (nMode < CollideDiscrete) || (nMode > CollideFixed) ) return false;
+	if( (nBroadphase < BroadphaseLinear) || (nBroadphase > BroadphaseTree) ) return false;
+	if( nBallCollisions > 1 ) return false;
+	if( (nState < BoardPlaying) || (nState > BoardLost) ) return false;
+
+	m_CollisionMode = (CollisionMode)nMode;
+	m_Broadphase = (Broadphase)nBroadphase;
+	m_bBallCollisions = (nBallCollisions != 0);
+	memcpy( &m_fTimeStep, &nTimeStep, sizeof(m_fTimeStep) );
+	m_nLives = (int)nLives;
+	m_State = (BoardState)nState;
+
+	if( !GetVarint( pData, nSize, &nRead, &n ) || (n != (nSize - nRead)) ) return false;
+	m_tData.assign( pData + nRead, pData + nSize );
+
+	m_nRunLength = 0;
+	m_nRecorded = 0;
+
+	Rewind();
+
+	while( Next( &step ) ) m_nRecorded++;
+
+	Rewind();
+
+	return true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Rewind
+//
+//  Desc: Goes back to the first step.
+// ----------------------------------------------------------------------------
+void CReplay::Rewind()
+{
+	m_nRead = 0;
+	m_nReadLeft = 0;
+
+	m_ReadRun.nMouseX = 0;
+	m_ReadRun.nEdges = 0;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Next
+//
+//  Desc: Gets the next recorded step. Returns false at the end of the
+//        replay, or if the data is damaged.
+// ----------------------------------------------------------------------------
+bool CReplay::Next( REPLAYSTEP* pStep )
+{
+	uint32_t nHeader;
+
+	if( !m_nReadLeft )
+	{
+		if( m_nRead >= m_tData.size() ) return false;
+
+		if( !GetVarint( &m_tData[0], m_tData.size(), &m_nRead, &nHeader ) ) return false;
+
+		m_ReadRun.nMouseX = UnZigZag( nHeader >> 3 );
+		m_ReadRun.nEdges = 0;
+		m_nReadLeft = (nHeader >> 1) & 3;
+
+		if( nHeader & 1 )
+		{
+			if( m_nRead >= m_tData.size() ) return false;
+
+			m_ReadRun.nEdges = m_tData[m_nRead++];
+		}
+
+		if( !m_nReadLeft && (!GetVarint( &m_tData[0], m_tData.size(), &m_nRead, &m_nReadLeft ) || !m_nReadLeft) ) return false;
+	}
+
+	m_nReadLeft--;
+
+	*pStep = m_ReadRun;
+
+	return true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Play
+//
+//  Desc: Plays the whole replay out on a board, as fast as it will go. The
+//        board is set up as it was for the recording and reset with the
+//        level, which should be the one it was recorded on. Returns how the
+//        game came out, to compare with GetState and GetScore.
+// ----------------------------------------------------------------------------
+BoardState CReplay::Play( CBoard* pBoard, const CLevel* pLevel )
+{
+	REPLAYSTEP	step;
+	BOARDINPUT	input;
+
+	pBoard->SetCollisionMode( m_CollisionMode );
+	pBoard->SetBroadphase( m_Broadphase );
+	pBoard->SetBallCollisions( m_bBallCollisions );
+	pBoard->SetTimeStep( m_fTimeStep );
+	pBoard->SetLives( m_nLives );
+	pBoard->Reset( pLevel );
+
+	Rewind();
+
+	while( (pBoard->GetState() == BoardPlaying) && Next( &step ) )
+	{
+		input.nMouseX = step.nMouseX;
+
+		pBoard->Step( input );
+	}
+
+	return pBoard->GetState();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: HashLevel
+//
+//  Desc: Returns a 32-bit FNV-1a hash of a level's bricks, to tell whether a
+//        replay is being played on the level it was recorded on.
+// ----------------------------------------------------------------------------
+uint32_t CReplay::HashLevel( const CLevel* pLevel )
+{
+	const LEVELCHUNK*	pChunk;
+	const LEVELMOTION*	pMotion;
+	uint32_t			nHash = 2166136261u;
+
+	nHash = HashBits( nHash, (uint32_t)pLevel->GetColumns(), 32 );
+	nHash = HashBits( nHash, (uint32_t)pLevel->GetRows(), 32 );
+
+	for( int i = 0; i < pLevel->GetChunkCount(); i++ )
+	{
+		pChunk = pLevel->GetChunk( i );
+
+		nHash = HashBits( nHash, (uint32_t)pChunk->nX, 32 );
+		nHash = HashBits( nHash, (uint32_t)pChunk->nY, 32 );
+
+		for( int t = 0; t <= BRICK_TYPES; t++ )
+		{
+			nHash = HashBits( nHash, pChunk->nBits[t], 64 );
+		}
+	}
+
+	// And how its rows move, if they do. Levels that stand still hash the
+	// same as they always have.
+	for( int i = 0; i < pLevel->GetMotionCount(); i++ )
+	{
+		pMotion = pLevel->GetMotion( i );
+
+		nHash = HashBits( nHash, (uint32_t)pMotion->nRow, 32 );
+		nHash = HashBits( nHash, FloatBits( pMotion->fAmpX ), 32 );
+		nHash = HashBits( nHash, FloatBits( pMotion->fAmpY ), 32 );
+		nHash = HashBits( nHash, FloatBits( pMotion->fPeriod ), 32 );
+		nHash = HashBits( nHash, FloatBits( pMotion->fPhase ), 32 );
+		nHash = HashBits( nHash, FloatBits( pMotion->fSpin ), 32 );
+	}
+
+	return nHash;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetLevelName
+//
+//  Desc: Returns the name of the level file the game was recorded on.
+// ----------------------------------------------------------------------------
+const char* CReplay::GetLevelName() const
+{
+	return m_sLevel.c_str();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetLevelHash
+//
+//  Desc: Returns the hash of the level the game was recorded on.
+// ----------------------------------------------------------------------------
+uint32_t CReplay::GetLevelHash() const
+{
+	return m_nLevelHash;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetSteps
+//
+//  Desc: Returns how many steps the recorded game took.
+// ----------------------------------------------------------------------------
+unsigned int CReplay::GetSteps() const
+{
+	return m_nSteps;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetRecordedSteps
+//
+//  Desc: Returns how many steps have been recorded.
+// ----------------------------------------------------------------------------
+unsigned int CReplay::GetRecordedSteps() const
+{
+	return m_nRecorded;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetScore
+//
+//  Desc: Returns the score the recorded game ended with.
+// ----------------------------------------------------------------------------
+unsigned int CReplay::GetScore() const
+{
+	return m_nScore;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetState
+//
+//  Desc: Returns how the recorded game ended. Still playing means the player
+//        quit part way through.
+// ----------------------------------------------------------------------------
+BoardState CReplay::GetState() const
+{
+	return m_State;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetDataSize
+//
+//  Desc: Returns how many bytes the recorded steps take.
+// ----------------------------------------------------------------------------
+size_t CReplay::GetDataSize() const
+{
+	return m_tData.size();
+}
@@ -0,0 +1,92 @@
+// ----------------------------------------------------------------------------
+//  Filename: replay.h
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+#pragma once
+
+#define REPLAY_MAGIC		0x52443342		// "B3DR"
+#define REPLAY_VERSION		2
+
+// Button and key edges. A bit is set on the step where the button went down
+// or the key came back up, as the game reacts to them.
+#define REPLAY_MOUSE_L		0x01
+#define REPLAY_MOUSE_R		0x02
+#define REPLAY_ESCAPE		0x04
+
+// What the player did during a single board step.
+struct REPLAYSTEP
+{
+	int				nMouseX;
+	unsigned int	nEdges;
+};
+
+// A recorded game. Only what the player did is kept, one entry per board
+// step, along with the board settings and which level it was played on.
+// The board is deterministic, so that's enough to play the whole game out
+// again exactly.
+//
+// Steps are stored as runs of identical steps. Each run starts with a
+// varint holding the mouse movement, zigzag encoded, above a 2-bit run
+// length and a bit that says a byte of edges follows. Runs longer than 3
+// put 0 in the length and follow with the length as a varint. A step or
+// two of small movement takes a single byte, and a player holding still or
+// moving at a steady speed costs a few bytes however long they do it.
+class CReplay
+{
+protected:
+	string					m_sLevel;
+	uint32_t				m_nLevelHash;
+	CollisionMode			m_CollisionMode;
+	Broadphase				m_Broadphase;
+	bool					m_bBallCollisions;
+	float					m_fTimeStep;
+	int						m_nLives;
+
+	// How the game came out when it was recorded.
+	unsigned int			m_nSteps;
+	unsigned int			m_nScore;
+	BoardState				m_State;
+
+	vector<unsigned char>	m_tData;
+
+	// The run being recorded.
+	REPLAYSTEP				m_Run;
+	unsigned int			m_nRunLength;
+	unsigned int			m_nRecorded;
+
+	// Where playback is up to.
+	size_t					m_nRead;
+	REPLAYSTEP				m_ReadRun;
+	unsigned int			m_nReadLeft;
+
+protected:
+	void	FlushRun();
+
+public:
+	CReplay();
+	virtual ~CReplay();
+
+	void	Begin( const CBoard* pBoard, const CLevel* pLevel, const char* sLevel );
+	void	Record( const BOARDINPUT& input, unsigned int nEdges );
+	void	Truncate( unsigned int nSteps );
+	void	End( const CBoard* pBoard );
+
+	bool	Save( const char* sFileName ) const;
+	bool	Load( const char* sFileName );
+
+	void	Rewind();
+	bool	Next( REPLAYSTEP* pStep );
+	BoardState	Play( CBoard* pBoard, const CLevel* pLevel );
+
+	static uint32_t	HashLevel( const CLevel* pLevel );
+
+	const char*		GetLevelName() const;
+	uint32_t		GetLevelHash() const;
+	unsigned int	GetSteps() const;
+	unsigned int	GetRecordedSteps() const;
+	unsigned int	GetScore() const;
+	BoardState		GetState() const;
+	size_t			GetDataSize() const;
+};
@@ -0,0 +1,50 @@
+// ----------------------------------------------------------------------------
+//  Filename: sim.h
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+#pragma once
+
+// The simulation library. Everything included from here must stay free of
+// Direct3D, DirectInput and winmm so it builds on any platform and can be
+// run headless.
+#include <ctype.h>
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+#include "mapfile.h"
+#include "pack.h"
+#include "mesh.h"
+#include "level.h"
+#include "bvh.h"
+#include "bricks.h"
+#include "fixed.h"
+#include "balls.h"
+#include "board.h"
+#include "replay.h"
+#include "snapshot.h"
+#include "random.h"
+#include "particles.h"
+#include "entities.h"
+#include "threadpool.h"
+#include "batch.h"
+#include "loader.h"
@@ -0,0 +1,233 @@
+// ----------------------------------------------------------------------------
+//  Filename: snapshot.cpp
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+
+
+
+
+// Preprocessor directives.
+#include "sim.h"
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CSnapshotRing
+//
+//  Desc: Constructor
+// ----------------------------------------------------------------------------
+CSnapshotRing::CSnapshotRing()
+{
+	m_nInterval	= SNAPSHOT_INTERVAL;
+	m_nFirst	= 0;
+	m_nEnd		= 0;
+	m_bEmpty	= true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: ~CSnapshotRing
+//
+//  Desc: Destructor
+// ----------------------------------------------------------------------------
+CSnapshotRing::~CSnapshotRing()
+{
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Init
+//
+//  Desc: Sets how many snapshots are kept and how many steps apart they're
+//        taken. Together they say how far back the ring reaches.
+// ----------------------------------------------------------------------------
+void CSnapshotRing::Init( int nSnapshots, int nInterval )
+{
+	if( nSnapshots < 1 ) nSnapshots = 1;
+	if( nInterval < 1 ) nInterval = 1;
+
+	m_nInterval = nInterval;
+
+	m_tSnapshots.clear();
+	m_tSnapshots.resize( nSnapshots );
+	m_tInputs.assign( nSnapshots * nInterval, BOARDINPUT() );
+
+	Clear();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Clear
+//
+//  Desc: Forgets everything recorded. Call it whenever the board is reset.
+// ----------------------------------------------------------------------------
+void CSnapshotRing::Clear()
+{
+	for( size_t i = 0; i < m_tSnapshots.size(); i++ )
+	{
+		m_tSnapshots[i].nSteps = UINT_MAX;
+		m_tSnapshots[i].pBricks.reset();
+	}
+
+	m_nFirst = 0;
+	m_nEnd = 0;
+	m_bEmpty = true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Record
+//
+//  Desc: Adds the input for the board's next step, and a snapshot of it if
+//        one is due. Call it just before stepping the board. Recording from
+//        a step that was rewound to drops everything that came after it.
+// ----------------------------------------------------------------------------
+void CSnapshotRing::Record( CBoard* pBoard, const BOARDINPUT& input )
+{
+	unsigned int	nStep = pBoard->GetSteps();
+	unsigned int	nSlot, nCount;
+
+	if( m_tSnapshots.empty() ) Init( SNAPSHOT_COUNT, SNAPSHOT_INTERVAL );
+
+	nCount = (unsigned int)m_tSnapshots.size();
+
+	// Starting out, or the board isn't where it was left. Start again from
+	// here.
+	if( m_bEmpty || (nStep < m_nFirst) || (nStep > m_nEnd) )
+	{
+		Clear();
+
+		m_nFirst = nStep;
+		m_bEmpty = false;
+	}
+
+	m_nEnd = nStep;
+
+	nSlot = nStep / m_nInterval;
+
+	if( (nStep == m_nFirst) || !(nStep % m_nInterval) )
+	{
+		pBoard->SaveState( &m_tSnapshots[nSlot % nCount] );
+
+		// That took the place of the oldest snapshot.
+		if( nSlot >= nCount ) m_nFirst = max( m_nFirst, (nSlot - (nCount - 1)) * m_nInterval );
+	}
+
+	m_tInputs[nStep % m_tInputs.size()] = input;
+	m_nEnd = nStep + 1;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Seek
+//
+//  Desc: Puts the board back to how it was before the given step, as far as
+//        the recording reaches either way. Loads the snapshot before it and
+//        plays the recorded input forward from there.
+// ----------------------------------------------------------------------------
+bool CSnapshotRing::Seek( CBoard* pBoard, unsigned int nStep )
+{
+	const BOARDSNAPSHOT*	pSnapshot;
+	unsigned int			n;
+
+	if( m_bEmpty ) return false;
+
+	if( nStep < m_nFirst ) nStep = m_nFirst;
+	if( nStep > m_nEnd ) nStep = m_nEnd;
+
+	// The snapshot for the step just past the end may not have been taken
+	// yet, but the one before it has.
+	n = (nStep == m_nEnd) ? (nStep - 1) : nStep;
+
+	pSnapshot = &m_tSnapshots[(n / m_nInterval) % m_tSnapshots.size()];
+
+	if( pSnapshot->nSteps > nStep ) return false;
+
+	pBoard->LoadState( pSnapshot );
+
+	for( n = pSnapshot->nSteps; n < nStep; n++ )
+	{
+		pBoard->Step( m_tInputs[n % m_tInputs.size()] );
+	}
+
+	return true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetFirstStep
+//
+//  Desc: Returns the earliest step that can be gone back to.
+// ----------------------------------------------------------------------------
+unsigned int CSnapshotRing::GetFirstStep() const
+{
+	return m_nFirst;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetLastStep
+//
+//  Desc: Returns the latest step that can be gone forward to.
+// ----------------------------------------------------------------------------
+unsigned int CSnapshotRing::GetLastStep() const
+{
+	return m_nEnd;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetBytes
+//
+//  Desc: Returns about how much memory the ring takes up. Brick pages are
+//        counted once for each run of snapshots sharing them, and balls as
+//        allocated.
+// ----------------------------------------------------------------------------
+size_t CSnapshotRing::GetBytes() const
+{
+	const BOARDSNAPSHOT*	pSnapshot;
+	const BOARDSNAPSHOT*	pPrev;
+	size_t					nBytes;
+
+	nBytes = (m_tSnapshots.size() * sizeof(BOARDSNAPSHOT)) + (m_tInputs.size() * sizeof(BOARDINPUT));
+
+	for( size_t i = 0; i < m_tSnapshots.size(); i++ )
+	{
+		pSnapshot = &m_tSnapshots[i];
+		pPrev = &m_tSnapshots[(i + m_tSnapshots.size() - 1) % m_tSnapshots.size()];
+
+		nBytes += pSnapshot->Balls.GetBytes();
+
+		if( !pSnapshot->pBricks || (pSnapshot->pBricks == pPrev->pBricks) ) continue;
+
+		nBytes += pSnapshot->pBricks->size() * sizeof(BRICKPAGE);
+
+		for( size_t p = 0; p < pSnapshot->pBricks->size(); p++ )
+		{
+			if( pPrev->pBricks && ((*pPrev->pBricks)[p] == (*pSnapshot->pBricks)[p]) ) continue;
+
+			nBytes += (*pSnapshot->pBricks)[p]->size() * sizeof(uint64_t);
+		}
+	}
+
+	return nBytes;
+}
@@ -0,0 +1,47 @@
+// ----------------------------------------------------------------------------
+//  Filename: snapshot.h
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+#pragma once
+
+// By default a snapshot is taken every half second and the last five
+// minutes are kept.
+#define SNAPSHOT_INTERVAL	60
+#define SNAPSHOT_COUNT		600
+
+// Ring buffer of board snapshots for rewinding and fast forwarding. Every
+// step's input goes in, and every so many steps a snapshot of the board.
+// Any step in between can be got back to by loading the snapshot before it
+// and playing the recorded input forward from there, which is never more
+// than one interval of steps.
+//
+// Memory is fixed by the number of snapshots and the interval. Bricks are
+// shared between snapshots wherever none were destroyed in between.
+class CSnapshotRing
+{
+protected:
+	vector<BOARDSNAPSHOT>	m_tSnapshots;
+	vector<BOARDINPUT>		m_tInputs;
+	int						m_nInterval;
+
+	// Steps that can be got back to run from m_nFirst up to m_nEnd.
+	unsigned int			m_nFirst;
+	unsigned int			m_nEnd;
+	bool					m_bEmpty;
+
+public:
+	CSnapshotRing();
+	virtual ~CSnapshotRing();
+
+	void	Init( int nSnapshots, int nInterval );
+	void	Clear();
+
+	void	Record( CBoard* pBoard, const BOARDINPUT& input );
+	bool	Seek( CBoard* pBoard, unsigned int nStep );
+
+	unsigned int	GetFirstStep() const;
+	unsigned int	GetLastStep() const;
+	size_t			GetBytes() const;
+};
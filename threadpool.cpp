@@ -0,0 +1,251 @@
+// ----------------------------------------------------------------------------
+//  Filename: threadpool.cpp
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+
+
+
+
+// Preprocessor directives.
+#include "sim.h"
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CThreadPool
+//
+//  Desc: Constructor
+// ----------------------------------------------------------------------------
+CThreadPool::CThreadPool()
+{
+	m_nQueued	= 0;
+	m_nPending	= 0;
+	m_nNext		= 0;
+	m_bQuit		= false;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: ~CThreadPool
+//
+//  Desc: Destructor
+// ----------------------------------------------------------------------------
+CThreadPool::~CThreadPool()
+{
+	Destroy();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Init
+//
+//  Desc: Starts the worker threads. Pass 0 for one per processor.
+// ----------------------------------------------------------------------------
+bool CThreadPool::Init( int nThreads )
+{
+	Destroy();
+
+	if( nThreads <= 0 ) nThreads = (int)thread::hardware_concurrency();
+	if( nThreads <= 0 ) nThreads = 1;
+
+	m_bQuit = false;
+	m_nNext = 0;
+
+	for( int i = 0; i < nThreads; i++ )
+	{
+		m_tQueues.push_back( new WORKQUEUE );
+	}
+
+	for( int i = 0; i < nThreads; i++ )
+	{
+		m_tThreads.push_back( thread( &CThreadPool::WorkerMain, this, i ) );
+	}
+
+	return true;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Destroy
+//
+//  Desc: Finishes whatever has been submitted and stops the worker threads.
+// ----------------------------------------------------------------------------
+void CThreadPool::Destroy()
+{
+	if( m_tThreads.empty() ) return;
+
+	Wait();
+
+	{
+		lock_guard<mutex> lock( m_Lock );
+		m_bQuit = true;
+	}
+
+	m_Wake.notify_all();
+
+	for( size_t i = 0; i < m_tThreads.size(); i++ )
+	{
+		m_tThreads[i].join();
+	}
+
+	for( size_t i = 0; i < m_tQueues.size(); i++ )
+	{
+		delete m_tQueues[i];
+	}
+
+	m_tThreads.clear();
+	m_tQueues.clear();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Submit
+//
+//  Desc: Hands a task to the pool. Tasks are dealt out to the workers in
+//        turn, and the stealing evens out whatever that gets wrong.
+// ----------------------------------------------------------------------------
+void CThreadPool::Submit( const POOLTASK& task )
+{
+	WORKQUEUE* pQueue;
+
+	// No threads, no pool. Just do it here.
+	if( m_tQueues.empty() )
+	{
+		task();
+		return;
+	}
+
+	pQueue = m_tQueues[m_nNext++ % m_tQueues.size()];
+
+	m_nPending++;
+
+	{
+		lock_guard<mutex> lock( pQueue->Lock );
+		pQueue->tTasks.push_back( task );
+	}
+
+	// Count it under the pool lock, so a worker that's about to go to sleep
+	// either sees it or gets woken up.
+	{
+		lock_guard<mutex> lock( m_Lock );
+		m_nQueued++;
+	}
+
+	m_Wake.notify_one();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Wait
+//
+//  Desc: Blocks until every task submitted so far has finished.
+// ----------------------------------------------------------------------------
+void CThreadPool::Wait()
+{
+	unique_lock<mutex> lock( m_Lock );
+
+	while( m_nPending > 0 ) m_Done.wait( lock );
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetThreadCount
+//
+//  Desc: Returns how many worker threads there are.
+// ----------------------------------------------------------------------------
+int CThreadPool::GetThreadCount() const
+{
+	return (int)m_tThreads.size();
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: TakeTask
+//
+//  Desc: Finds the next task for a worker. Its own newest task first, then
+//        the oldest task of each of the other workers in turn.
+// ----------------------------------------------------------------------------
+bool CThreadPool::TakeTask( int nWorker, POOLTASK* pTask )
+{
+	int nQueues = (int)m_tQueues.size();
+
+	for( int i = 0; i < nQueues; i++ )
+	{
+		WORKQUEUE* pQueue = m_tQueues[(nWorker + i) % nQueues];
+
+		lock_guard<mutex> lock( pQueue->Lock );
+
+		if( pQueue->tTasks.empty() ) continue;
+
+		if( !i )
+		{
+			*pTask = pQueue->tTasks.back();
+			pQueue->tTasks.pop_back();
+		}
+		else
+		{
+			*pTask = pQueue->tTasks.front();
+			pQueue->tTasks.pop_front();
+		}
+
+		m_nQueued--;
+
+		return true;
+	}
+
+	return false;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: WorkerMain
+//
+//  Desc: What each worker thread runs. Takes tasks until there are none
+//        left, then sleeps until there are more or the pool shuts down.
+// ----------------------------------------------------------------------------
+void CThreadPool::WorkerMain( int nWorker )
+{
+	POOLTASK task;
+
+	for( ;; )
+	{
+		if( TakeTask( nWorker, &task ) )
+		{
+			task();
+			task = POOLTASK();
+
+			if( --m_nPending == 0 )
+			{
+				lock_guard<mutex> lock( m_Lock );
+				m_Done.notify_all();
+			}
+
+			continue;
+		}
+
+		unique_lock<mutex> lock( m_Lock );
+
+		while( !m_bQuit && (m_nQueued <= 0) ) m_Wake.wait( lock );
+
+		if( m_bQuit ) return;
+	}
+}
@@ -0,0 +1,52 @@
+// ----------------------------------------------------------------------------
+//  Filename: threadpool.h
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+#pragma once
+
+typedef function<void()> POOLTASK;
+
+// One worker's share of the tasks. The owner takes from the back, idle
+// workers steal from the front.
+struct WORKQUEUE
+{
+	mutex				Lock;
+	deque<POOLTASK>		tTasks;
+};
+
+// Fixed set of worker threads, each with its own queue of tasks. A worker
+// that runs out of its own work steals from the others, so uneven tasks still
+// keep every thread busy.
+class CThreadPool
+{
+protected:
+	vector<thread>		m_tThreads;
+	vector<WORKQUEUE*>	m_tQueues;
+
+	mutex				m_Lock;
+	condition_variable	m_Wake;
+	condition_variable	m_Done;
+
+	atomic<int>			m_nQueued;
+	atomic<int>			m_nPending;
+	unsigned int		m_nNext;
+	bool				m_bQuit;
+
+protected:
+	void	WorkerMain( int nWorker );
+	bool	TakeTask( int nWorker, POOLTASK* pTask );
+
+public:
+	CThreadPool();
+	virtual ~CThreadPool();
+
+	bool	Init( int nThreads );
+	void	Destroy();
+
+	void	Submit( const POOLTASK& task );
+	void	Wait();
+
+	int		GetThreadCount() const;
+};
@@ -0,0 +1,110 @@
+// ----------------------------------------------------------------------------
+//  Filename: timer.cpp
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+
+
+
+
+// Preprocessor directives.
+#include "main.h"
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: CTimer
+//
+//  Desc: Constructor
+// ----------------------------------------------------------------------------
+CTimer::CTimer()
+{
+	m_nFrequency	= 1;
+	m_nStart		= 0;
+	m_nLast			= 0;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: ~CTimer
+//
+//  Desc: Destructor
+// ----------------------------------------------------------------------------
+CTimer::~CTimer()
+{
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Init
+//
+//  Desc: Finds out how fast the performance counter runs and starts the
+//        clock at 0.
+// ----------------------------------------------------------------------------
+HRESULT CTimer::Init()
+{
+	LARGE_INTEGER n;
+
+	if( !QueryPerformanceFrequency( &n ) || (n.QuadPart <= 0) ) return E_FAIL;
+
+	m_nFrequency = n.QuadPart;
+
+	m_nStart = m_nLast = GetTicks();
+
+	return S_OK;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetTicks
+//
+//  Desc: Returns the raw performance counter.
+// ----------------------------------------------------------------------------
+LONGLONG CTimer::GetTicks() const
+{
+	LARGE_INTEGER n;
+
+	QueryPerformanceCounter( &n );
+
+	return n.QuadPart;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: GetTime
+//
+//  Desc: Returns the seconds since Init.
+// ----------------------------------------------------------------------------
+double CTimer::GetTime() const
+{
+	return (double)(GetTicks() - m_nStart) / (double)m_nFrequency;
+}
+
+
+
+
+// ----------------------------------------------------------------------------
+//  Name: Tick
+//
+//  Desc: Returns the seconds since the last call. The difference is taken in
+//        whole ticks before it's turned into seconds, so nothing is lost.
+// ----------------------------------------------------------------------------
+double CTimer::Tick()
+{
+	LONGLONG nNow = GetTicks();
+	LONGLONG nElapsed = nNow - m_nLast;
+
+	m_nLast = nNow;
+
+	return (double)nElapsed / (double)m_nFrequency;
+}
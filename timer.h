@@ -0,0 +1,27 @@
+// ----------------------------------------------------------------------------
+//  Filename: timer.h
+//  Author: Lucas Suggs
+//
+//  Copyright (c) 2009, Lucas Suggs
+// ----------------------------------------------------------------------------
+#pragma once
+
+// High resolution game clock. Time is kept as a 64-bit count of performance
+// counter ticks, so it doesn't lose precision however long the game runs.
+class CTimer
+{
+protected:
+	LONGLONG	m_nFrequency;
+	LONGLONG	m_nStart;
+	LONGLONG	m_nLast;
+
+public:
+	CTimer();
+	virtual ~CTimer();
+
+	HRESULT		Init();
+
+	LONGLONG	GetTicks() const;
+	double		GetTime() const;
+	double		Tick();
+};
@@ -31,6 +31,13 @@ struct TLVERTEX
 	FLOAT tu, tv;
 };
 
+// Colored vertex, unlit. Particles are drawn with these as points.
+struct VERTEX
+{
+	FLOAT x, y, z;
+	DWORD color;
+};
+
 // Plain and simple, colored, 2D vertex.
 struct VERTEX2D
 {